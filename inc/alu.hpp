@@ -20,8 +20,65 @@ namespace Alu {
     NE   = 0b11001,
     SLTS = 0b00010,
     SLTU = 0b00011,
+    MUL    = 0b10000,
+    MULH   = 0b10001,
+    MULHSU = 0b10010,
+    MULHU  = 0b10011,
+    DIV    = 0b10100,
+    DIVU   = 0b10101,
+    REM    = 0b10110,
+    REMU   = 0b10111,
+    SH1ADD = 0b100000,
+    SH2ADD,
+    SH3ADD,
+    ANDN  ,
+    ORN   ,
+    XNOR  ,
+    CLZ   ,
+    CTZ   ,
+    CPOP  ,
+    MAX   ,
+    MAXU  ,
+    MIN   ,
+    MINU  ,
+    SEXTB ,
+    SEXTH ,
+    ZEXTH ,
+    ROL   ,
+    ROR   ,
+    ORCB  ,
+    REV8  ,
+    BCLR  ,
+    BEXT  ,
+    BINV  ,
+    BSET  ,
+    // RV64 only. Operate on the low words and sign-extend the result.
+    ADDW  ,
+    SUBW  ,
+    SLLW  ,
+    SRLW  ,
+    SRAW  ,
+    MULW  ,
+    DIVW  ,
+    DIVUW ,
+    REMW  ,
+    REMUW ,
+    CLZW  ,
+    CTZW  ,
+    CPOPW ,
+    ROLW  ,
+    RORW  ,
+    // RV64 only. Zero-extend the low word of `a`.
+    ADDUW   ,
+    SH1ADDUW,
+    SH2ADDUW,
+    SH3ADDUW,
+    SLLIUW  ,
   };
 
-  [[nodiscard("PURE FUN")]] Uxlen calc_result(Op op, Uxlen a, Uxlen b);
-  [[nodiscard("PURE FUN")]] bool  calc_flag  (Op op, Uxlen a, Uxlen b);
+  // Instantiated for RV32 and RV64.
+  template <unsigned int xlen = 32>
+  [[nodiscard("PURE FUN")]] Uxlen_t<xlen> calc_result(Op op, Uxlen_t<xlen> a, Uxlen_t<xlen> b);
+  template <unsigned int xlen = 32>
+  [[nodiscard("PURE FUN")]] bool calc_flag(Op op, Uxlen_t<xlen> a, Uxlen_t<xlen> b);
 };
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A extension. The memory operations act on host memory through std::atomic_ref, so harts
+// running on separate host threads see each other's atomics. They are instantiated for
+// std::uint32_t and std::uint64_t, the .w and .d widths.
+namespace Amo {
+  enum Op {
+    LR  ,
+    SC  ,
+    SWAP,
+    ADD ,
+    XOR ,
+    AND ,
+    OR  ,
+    MIN ,
+    MAX ,
+    MINU,
+    MAXU,
+  };
+
+  // The value an AMO stores, from the loaded one and rs2.
+  template <typename T>
+  [[nodiscard("PURE FUN")]] T calc(Op op, T loaded, T operand);
+
+  // `host` is aligned to the width of T.
+  template <typename T>
+  [[nodiscard]] T load(const std::byte *host);
+  // Atomically stores calc(op, old, operand) and returns the old value.
+  template <typename T>
+  T fetch_op(Op op, std::byte *host, T operand);
+  // Stores `desired` if the memory still holds `expected`.
+  template <typename T>
+  [[nodiscard]] bool compare_exchange(std::byte *host, T expected, T desired);
+
+  // The lr reservations of the harts sharing a memory, one granule per hart. Any store to a
+  // reserved granule drops the reservations on it, so the following sc fails. sc also
+  // compares the reserved value, which catches stores that aren't tracked here, such as
+  // those of devices.
+  class Reservation_set {
+    public:
+      // Bytes, enough for lr.d.
+      static constexpr std::size_t granule{8};
+
+      explicit Reservation_set(std::size_t harts) : m_granules(harts) {
+        for (std::atomic<std::uint64_t> &reserved : m_granules) reserved.store(none);
+      }
+
+      void reserve(std::size_t hart, std::size_t addr) {
+        m_granules.at(hart).store(get_granule(addr));
+      }
+      // Drops the reservation of `hart` and tells whether it was on `addr`.
+      [[nodiscard]] bool take(std::size_t hart, std::size_t addr) {
+        return m_granules.at(hart).exchange(none) == get_granule(addr);
+      }
+      // Drops every reservation on the granules of [addr, addr + size).
+      void invalidate(std::size_t addr, std::size_t size) {
+        const std::uint64_t first{get_granule(addr)};
+        const std::uint64_t last {get_granule(addr + size - 1)};
+        for (std::atomic<std::uint64_t> &reserved : m_granules) {
+          std::uint64_t reserved_granule{reserved.load(std::memory_order_relaxed)};
+          if ((reserved_granule >= first) && (reserved_granule <= last) &&
+              (reserved_granule != none)) {
+            reserved.compare_exchange_strong(reserved_granule, none);
+          }
+        }
+      }
+
+    private:
+      static constexpr std::uint64_t none{~std::uint64_t{0}};
+
+      [[nodiscard("PURE FUN")]] static constexpr std::uint64_t get_granule(std::size_t addr) {
+        return addr & ~std::uint64_t{granule - 1};
+      }
+
+      std::vector<std::atomic<std::uint64_t>> m_granules;
+  };
+}
@@ -3,16 +3,21 @@
 #include "exception.hpp"
 #include "memory.hpp"
 
+#include <iterator>
 #include <map>
 #include <vector>
 
-class Bus : public Memory {
+template <unsigned int xlen>
+class Basic_bus : public Basic_memory<xlen> {
   private:
-    using Nodes = std::map<std::size_t, Memory&>;
+    using Nodes = std::map<std::size_t, Basic_memory<xlen>&>;
     Nodes nodes{};
 
   public:
-    void attach(std::size_t start_addr, Memory &node_mem) {
+    using Data = Uxlen_t<xlen>;
+    using Basic_memory<xlen>::full_byte_en;
+
+    void attach(std::size_t start_addr, Basic_memory<xlen> &node_mem) {
       bool was_inserted{nodes.insert_or_assign(start_addr, node_mem).second};
       if (!was_inserted) {
         throw Errors::Illegal_addr{start_addr,
@@ -20,48 +25,63 @@ class Bus : public Memory {
       }
     }
 
-    void write(std::size_t addr, Uxlen data, unsigned int byte_en = 0xf) override {
-      Nodes::value_type node{try_get_node(addr)};
+    void write(std::size_t addr, Data data, unsigned int byte_en = full_byte_en) override {
+      typename Nodes::value_type node{try_get_node(addr)};
       node.second.write(addr - node.first, data, byte_en);
     }
-    [[nodiscard]] Uxlen read (std::size_t addr, unsigned int byte_en = 0xf) override {
-      Nodes::value_type node{try_get_node(addr)};
+    [[nodiscard]] Data read (std::size_t addr, unsigned int byte_en = full_byte_en) override {
+      typename Nodes::value_type node{try_get_node(addr)};
       return node.second.read(addr - node.first, byte_en);
     }
+    // Only within a node: the range mustn't reach the start of the next one.
+    [[nodiscard]] std::byte* get_host_ptr(std::size_t addr, std::size_t size) override {
+      typename Nodes::const_iterator next{nodes.upper_bound(addr)};
+      if ((next == nodes.begin()) || (size == 0)) return nullptr;
+      if ((next != nodes.end()) && (next->first - addr < size)) return nullptr;
+      const typename Nodes::value_type &node{*std::prev(next)};
+      return node.second.get_host_ptr(addr - node.first, size);
+    }
   private:
-    Nodes::value_type try_get_node(std::size_t addr) const {
+    // The node with the greatest start address not above `addr`.
+    typename Nodes::value_type try_get_node(std::size_t addr) const {
       if (nodes.empty()) {
-        Errors::Error{"Bus. There isn't a node attached to the bus."};
+        throw Errors::Error{"Bus. There isn't a node attached to the bus."};
       }
-      Nodes::const_iterator it{nodes.lower_bound(addr)};
-      if ((it == nodes.end()) || (it->first >= addr)) {
-        return *--it;
-      } else if (it->first == addr) {
-        return *it;
-      } else {
+      typename Nodes::const_iterator it{nodes.upper_bound(addr)};
+      if (it == nodes.begin()) {
         throw Errors::Illegal_addr{addr,
             "Bus. Failed to get a node at addr=" + std::to_string(addr)};
       }
+      return *--it;
     }
 };
 
-class Common_write_bus : public Memory {
+using Bus   = Basic_bus<32>;
+using Bus64 = Basic_bus<64>;
+
+template <unsigned int xlen>
+class Basic_common_write_bus : public Basic_memory<xlen> {
   public:
-    explicit Common_write_bus(Memory &rw_node) : nodes(1, &rw_node) {};
+    using Data = Uxlen_t<xlen>;
+    using Basic_memory<xlen>::full_byte_en;
 
-    void attach(Memory *write_only_node) {
+    explicit Basic_common_write_bus(Basic_memory<xlen> &rw_node) : nodes(1, &rw_node) {};
+
+    void attach(Basic_memory<xlen> *write_only_node) {
       nodes.push_back(write_only_node);
     }
 
-    void write(std::size_t addr, Uxlen data, unsigned int byte_en = 0xf) override {
+    void write(std::size_t addr, Data data, unsigned int byte_en = full_byte_en) override {
       for (auto *el : nodes) el->write(addr, data, byte_en);
     }
 
-    [[nodiscard]] Uxlen read (std::size_t addr, unsigned int byte_en = 0xf) override {
+    [[nodiscard]] Data read (std::size_t addr, unsigned int byte_en = full_byte_en) override {
       assert(nodes.at(0));
       return nodes[0]->read(addr, byte_en);
     }
 
   private:
-    std::vector<Memory*> nodes{};
+    std::vector<Basic_memory<xlen>*> nodes{};
 };
+
+using Common_write_bus = Basic_common_write_bus<32>;
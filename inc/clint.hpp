@@ -0,0 +1,92 @@
+#pragma once
+
+#include "irq.hpp"
+#include "memory.hpp"
+#include "scheduler.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// SiFive-compatible core-local interruptor. Hart n has its msip at MSIP + 4 * n and its
+// mtimecmp at MTIMECMP + 8 * n; mtime is shared.
+//
+// mtime either follows the virtual time of a `Scheduler`, in which case the timer interrupt
+// is an event at the precomputed deadline, or is moved explicitly with `advance`.
+//
+// Harts on separate host threads may access the registers concurrently. msip is only a
+// line in the pending word of its hart; the timer state is guarded by a mutex, since
+// register accesses are rare next to instructions. The scheduler itself is single-threaded.
+class Clint : public Memory {
+  public:
+    enum Register : std::size_t {
+      MSIP       = 0x0000,
+      MTIMECMP   = 0x4000,
+      MTIMECMP_H = 0x4004,
+      MTIME      = 0xbff8,
+      MTIME_H    = 0xbffc,
+    };
+    // As many as fit below mtime.
+    static constexpr std::size_t max_harts{4095};
+
+    explicit Clint(Irq_pending &irq_pending) : Clint(std::vector<Irq_pending*>{&irq_pending}) {}
+    // The pending word of every hart, in mhartid order.
+    explicit Clint(std::vector<Irq_pending*> harts) : Clint(std::move(harts), nullptr, 1) {}
+    // mtime increments once per `instructions_per_tick` units of virtual time.
+    Clint(Irq_pending &irq_pending, Scheduler &scheduler, std::uint64_t instructions_per_tick = 1)
+        : Clint(std::vector<Irq_pending*>{&irq_pending}, scheduler, instructions_per_tick) {}
+    Clint(std::vector<Irq_pending*> harts, Scheduler &scheduler,
+        std::uint64_t instructions_per_tick = 1)
+        : Clint(std::move(harts), &scheduler, instructions_per_tick) {}
+    ~Clint() override;
+    Clint(const Clint&) = delete;
+    Clint& operator=(const Clint&) = delete;
+
+    void write(std::size_t addr, Uxlen data, unsigned int byte_en = 0xf) override;
+    [[nodiscard]] Uxlen read (std::size_t addr, unsigned int byte_en = 0xf) override;
+
+    // Moves mtime forward. The comparison against mtimecmp happens once per call,
+    // so the caller decides how often time is published to the guest.
+    void advance(std::uint64_t ticks);
+
+    // Virtual-time fast-forward for idle harts: jumps mtime straight to the earliest armed
+    // deadline. Returns false if there is no deadline ahead to jump to.
+    bool skip_to_deadline();
+
+    [[nodiscard]] std::uint64_t get_time() const;
+    // Earliest mtime value at which a timer interrupt fires.
+    [[nodiscard]] std::uint64_t get_next_deadline() const;
+
+  private:
+    struct Hart {
+      Irq_pending *irq_pending{nullptr};
+      std::uint64_t mtimecmp{std::numeric_limits<std::uint64_t>::max()};
+      std::optional<Scheduler::Event_id> timer_event{};
+    };
+
+    std::vector<Hart> m_harts;
+    Scheduler *m_scheduler{nullptr};
+    const std::uint64_t m_instructions_per_tick{1};
+    mutable std::mutex m_mutex{};
+    // mtime at virtual time m_epoch.
+    std::uint64_t m_mtime{0};
+    Scheduler::Time m_epoch{0};
+    std::optional<Scheduler::Event_id> m_tick_event{};
+    Scheduler::Time m_tick_event_time{0};
+
+    Clint(std::vector<Irq_pending*> harts, Scheduler *scheduler,
+        std::uint64_t instructions_per_tick);
+
+    // The hart of an msip or mtimecmp register, if it exists.
+    [[nodiscard]] Hart* get_hart(std::size_t addr, Register base, std::size_t stride);
+
+    // The rest expect m_mutex to be held.
+    [[nodiscard]] std::uint64_t get_mtime() const;
+    void set_time(std::uint64_t mtime);
+    void update_timer_irqs();
+    void update_timer_irq(Hart &hart);
+    void arm_tick_event();
+};
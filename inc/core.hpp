@@ -1,11 +1,23 @@
 #pragma once
 
+#include "amo.hpp"
+#include "decode_cache.hpp"
+#include "decoder.hpp"
+#include "fpu.hpp"
+#include "irq.hpp"
 #include "isa_extension.hpp"
 #include "riscv.hpp"
 #include "memory.hpp"
+#include "mmu.hpp"
+#include "rf.hpp"
+#include "scheduler.hpp"
+#include "vpu.hpp"
 
+#include <array>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <optional>
 
 #include <cassert>
 
@@ -13,35 +25,253 @@ namespace spdlog {
   class logger;
 }
 
-class Core {
+// Instruction fetch goes through a 32-bit port for every XLEN, since instructions are at
+// most 32 bits wide; data, csr and register accesses are XLEN wide.
+//
+// With the S extension the core switches between M-, S- and U-mode. Address translation
+// takes an Mmu, whose ports are then the instruction and data memories of the core.
+template <unsigned int xlen>
+class Basic_core {
   public:
-    Core(Memory &instr_mem, Memory &data_mem, Memory &csr, Memory &rf,
-        std::shared_ptr<spdlog::logger> logger, Isa_ext_container isa_ext_container = {})
+    using Data    = Uxlen_t<xlen>;
+    using Xmemory = Basic_memory<xlen>;
+    // Serves a call of the guest to its environment instead of a trap: an ecall, e.g. to
+    // emulate the system calls of an OS in user-mode emulation, or a semihosting call.
+    // Returns the exit code once the guest exits, which halts the core.
+    using Call_handler = std::function<std::optional<Data>()>;
+
+    Basic_core(Memory &instr_mem, Xmemory &data_mem, Xmemory &csr, Xmemory &rf,
+        std::shared_ptr<spdlog::logger> logger, Isa_ext_container isa_ext_container = {},
+        const Irq_pending *irq_pending = nullptr, Amo::Reservation_set *reservations = nullptr,
+        std::size_t hart = 0, Basic_mmu<xlen> *mmu = nullptr)
         : m_instr_mem{instr_mem}, m_data_mem{data_mem}, m_csr{csr}, m_rf{rf}, m_logger{logger},
-        m_isa_ext_container{isa_ext_container} {
+        m_isa_ext_container{isa_ext_container}, m_decoder{isa_ext_container},
+        m_irq_pending{irq_pending},
+        m_vrf{isa_ext_container[Isa_extension::isa_zvl256b] ? 256u : 128u},
+        m_reservations{reservations ? *reservations : m_own_reservations},
+        m_hart{reservations ? hart : 0}, m_mmu{mmu} {
       assert(m_logger && "logger == nullptr in core");
+      update_irq_mask();
+      update_translation();
+      update_frm();
+      reset_vector_config();
     }
-    ~Core() = default;
+    ~Basic_core() = default;
 
-    void request_irq() { this->m_irq_req = true; }
+    // Executes one instruction. Does nothing while the core waits for an interrupt.
     void cycle();
-    std::function<void()> m_irq_callback{nullptr};
-    std::function<void()> m_return_from_irq{nullptr};
+
+    // Set by wfi and by jumps that can't leave a loop without outside help: a jump to
+    // itself or a short loop polling memory that doesn't change. While it's set the host
+    // can skip time to the next timer deadline or block in `wait_for_interrupt`.
+    [[nodiscard]] bool is_waiting() const { return m_wait_state != Wait_state::running; }
+    // Blocks the host thread until an enabled interrupt is pending.
+    void wait_for_interrupt();
+    // Resumes execution, e.g. after time was skipped. Harmless if the core is still idle:
+    // wfi is allowed to complete early and an idle loop is detected again. A halted or
+    // stopped core stays so.
+    void wake() {
+      if (!is_halted() && !is_stopped()) m_wait_state = Wait_state::running;
+    }
+    // Waiting in an idle loop, which stores from other harts and devices may end as well as
+    // an interrupt.
+    [[nodiscard]] bool is_polling() const { return m_wait_state == Wait_state::idle_loop; }
+    // Stopped for good, once the guest exited. A halted core is waiting too.
+    [[nodiscard]] bool is_halted() const { return m_wait_state == Wait_state::halted; }
+    // Stops the core for good after the current instruction, e.g. for a device the guest
+    // signals its exit to.
+    void halt(Data exit_code) {
+      m_exit_code  = exit_code;
+      m_wait_state = Wait_state::halted;
+    }
+    // Set once halted.
+    [[nodiscard]] std::optional<Data> get_exit_code() const { return m_exit_code; }
+
+    // Stops the core for a debugger after the current instruction, e.g. at a watchpoint.
+    // Only `resume` ends it, not interrupts. A stopped core is waiting too.
+    void stop() {
+      if (!is_halted()) m_wait_state = Wait_state::stopped;
+    }
+    void resume() {
+      if (is_stopped()) m_wait_state = Wait_state::running;
+      m_at_breakpoint = false;
+    }
+    [[nodiscard]] bool is_stopped() const { return m_wait_state == Wait_state::stopped; }
+    // The core stops before executing the instruction at a breakpoint. Breakpoints live in
+    // the decode cache, so they cost nothing until hit.
+    void set_breakpoint(Data pc) { m_decode_cache.set_breakpoint(pc); }
+    void clear_breakpoint(Data pc) { m_decode_cache.clear_breakpoint(pc); }
+    // Resumes and executes one instruction, even the one at a breakpoint, e.g. to
+    // single-step or to continue from a breakpoint.
+    void step();
+    void set_ecall_handler(Call_handler handler) { m_ecall_handler = std::move(handler); }
+    // Takes the semihosting sequence `slli x0, x0, 0x1f; ebreak; srai x0, x0, 7` instead of
+    // a breakpoint. The three instructions are uncompressed and on the same page.
+    void set_semihosting_handler(Call_handler handler) {
+      m_semihosting_handler = std::move(handler);
+    }
+
+    // Executes until virtual time reaches `until`, one time unit per retired instruction.
+    // Instructions run in slices that end exactly at the next event deadline; a waiting
+    // core jumps straight to it.
+    void run(Scheduler &scheduler, Scheduler::Time until);
+
+    [[nodiscard]] Data get_pc() const { return m_pc; }
+    void set_pc(Data pc) { m_pc = pc; }
+    [[nodiscard]] Csr_base::Privilege get_privilege() const { return m_privilege; }
+
+    [[nodiscard]] Fp_rf& get_fp_rf() { return m_fp_rf; }
+    [[nodiscard]] Vpu::Vrf& get_vrf() { return m_vrf; }
+
+    // What the next instructions depend on besides the memories, the rf and the csrs, for
+    // snapshots. Setting it takes the csrs as they are, so they are restored first.
+    struct State;
+    [[nodiscard]] State get_state() const;
+    void set_state(const State &state);
 
   private:
-    Core(const Core&) = delete;
-    Core& operator=(const Core& ) = delete;
-    Core& operator=(      Core&&) = delete;
+    Basic_core(const Basic_core&) = delete;
+    Basic_core& operator=(const Basic_core& ) = delete;
+    Basic_core& operator=(      Basic_core&&) = delete;
+
+    using Info = typename Basic_decoder<xlen>::Instruction_info;
 
-    bool m_irq_req{false};
     Memory &m_instr_mem;
-    Memory &m_data_mem;
-    Memory &m_csr;
-    Memory &m_rf;
+    Xmemory &m_data_mem;
+    Xmemory &m_csr;
+    Xmemory &m_rf;
+    Fp_rf m_fp_rf{};
     std::shared_ptr<spdlog::logger> m_logger{nullptr};
-    Uxlen m_pc{0};
+    Data m_pc{0};
+    // Fetches, decodes and executes the instruction at pc.
+    void execute();
+    // Raw bits of the instruction at pc: a halfword for compressed instructions.
     [[nodiscard]] Uxlen fetch_instruction() const;
     const Isa_ext_container m_isa_ext_container;
+    const Basic_decoder<xlen> m_decoder;
+    Basic_decode_cache<xlen> m_decode_cache{};
+    [[nodiscard]] const Info& decode(Uxlen instruction);
 
-    void increment_pc();
+    const Irq_pending *m_irq_pending{nullptr};
+    // mie gated by mstatus.MIE and mstatus.SIE, as they apply in the current privilege
+    // mode to the interrupts mideleg leaves in M-mode and to those it delegates. Cached so
+    // the per-cycle check is a single AND with the pending word; refreshed whenever the core
+    // itself changes one of those csrs.
+    Uxlen m_irq_mask{0};
+    Uxlen m_irq_enable{0};
+    enum class Wait_state {
+      running,
+      // Only an interrupt can resume the core.
+      wfi,
+      // Memory changes made by devices can resume the core as well.
+      idle_loop,
+      // Nothing resumes the core.
+      halted,
+      // Only a debugger resumes the core.
+      stopped,
+    };
+    Wait_state m_wait_state{Wait_state::running};
+    // Stopped before the instruction at a breakpoint, which hasn't retired.
+    bool m_at_breakpoint{false};
+
+    struct Idle_loop {
+      static constexpr Data max_size{32};
+      static constexpr unsigned int min_iterations{8};
+      using Registers = std::array<Data, 32>;
+
+      Data branch_pc{0};
+      std::uint64_t side_effects{0};
+      unsigned int iterations{0};
+      Registers registers{};
+    };
+    Idle_loop m_idle_loop{};
+    // Stores, csr writes, FP and vector instructions and AMOs executed so far. The FP and
+    // vector registers aren't part of an idle loop's snapshot, so changing them counts as a
+    // side effect too. lr doesn't count, so a loop polling a lock with it is still idle.
+    std::uint64_t m_side_effects{0};
+    void detect_idle_loop(Data branch_pc);
+    // Any enabled pending interrupt ends wfi, even with mstatus.MIE clear.
+    [[nodiscard]] bool is_wakeup_pending() const {
+      return m_irq_pending && !is_halted() && !is_stopped() &&
+          (m_irq_pending->get(std::memory_order_relaxed) & m_irq_enable);
+    }
+
+    void update_irq_mask();
+
+    // frm, cached for instructions with the dynamic rounding mode. Refreshed whenever the
+    // core writes a csr.
+    Fpu::Rounding_mode m_frm{Fpu::RNE};
+    void update_frm();
+    void execute_fp(const Info &instr_info, Uxlen instruction);
+
+    Vpu::Vrf m_vrf;
+    // vl and vtype, also published in the read-only csrs. vtype is empty while vill is set.
+    Data m_vl{0};
+    std::optional<Vpu::Vtype> m_vtype{};
+    void reset_vector_config();
+    void execute_vset(const Info &instr_info);
+    // Throws unless vtype is valid.
+    [[nodiscard]] Vpu::Vtype get_vtype(Uxlen instruction) const;
+    void execute_vector(const Info &instr_info, Uxlen instruction);
+    // Unit-stride accesses without a mask are one block access; the others go through a
+    // host pointer to the memory they span where there is one.
+    void execute_vector_memory(const Info &instr_info, Uxlen instruction, bool is_store);
+
+    // Harts sharing a memory share its reservation set; a core on its own keeps one for
+    // itself. Every store drops the reservations on the bytes it writes.
+    Amo::Reservation_set m_own_reservations{1};
+    Amo::Reservation_set &m_reservations;
+    const std::size_t m_hart;
+    // What lr loaded. sc also requires the memory to still hold the value.
+    struct Reservation {
+      Data addr{0};
+      Data value{0};
+    };
+    std::optional<Reservation> m_reservation{};
+    void execute_fence(const Info &instr_info);
+    // Atomics on RAM use host atomics; other memories get a plain read-modify-write.
+    void execute_amo(const Info &instr_info);
+    template <typename T>
+    void execute_amo(const Info &instr_info, Amo::Op op);
+    Csr_base::Privilege m_privilege{Csr_base::Privilege::machine};
+    Basic_mmu<xlen> *const m_mmu;
+    // Passes the privilege, satp and mstatus to the mmu. Called whenever one of them may
+    // have changed.
+    void update_translation();
+    void execute_sfence_vma(const Info &instr_info);
+
+    void take_pending_irq();
+    // Traps to S-mode if medeleg or mideleg delegates the cause and the core isn't in M-mode.
+    void enter_trap(Data cause, Data tval = 0);
+    // mret.
+    void return_from_trap();
+    void return_from_supervisor_trap();
+
+    Call_handler m_ecall_handler{};
+    Call_handler m_semihosting_handler{};
+    std::optional<Data> m_exit_code{};
+    // Traps unless there is a handler.
+    void execute_ecall();
+    void execute_ebreak();
+    [[nodiscard]] bool is_semihosting_call() const;
+    void call(const Call_handler &handler);
 };
+
+template <unsigned int xlen>
+struct Basic_core<xlen>::State {
+  Data pc{0};
+  Csr_base::Privilege privilege{Csr_base::Privilege::machine};
+  Wait_state wait_state{Wait_state::running};
+  std::optional<Data> exit_code{};
+  Fp_rf::Container fp_registers{};
+  Vpu::Vrf::Container vector_registers{};
+  Data vl{0};
+  std::optional<Vpu::Vtype> vtype{};
+  std::optional<Reservation> reservation{};
+  // When the core goes idle, and so virtual time, depends on them too.
+  Idle_loop idle_loop{};
+  std::uint64_t side_effects{0};
+};
+
+using Core   = Basic_core<32>;
+using Core64 = Basic_core<64>;
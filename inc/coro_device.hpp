@@ -0,0 +1,192 @@
+#pragma once
+
+#include "memory.hpp"
+#include "plic.hpp"
+#include "scheduler.hpp"
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Free lists of coroutine frames by size class, so that devices spawning a coroutine per
+// transfer don't go to the general-purpose heap each time. Frames must be freed by the
+// thread that allocated them.
+class Frame_pool {
+  public:
+    [[nodiscard]] static void* allocate(std::size_t size);
+    static void deallocate(void *ptr, std::size_t size);
+};
+
+// Coroutine type of a device model. Starts suspended; `Coro_device::spawn` runs it.
+class Device_task {
+  public:
+    struct promise_type {
+      std::exception_ptr m_exception{nullptr};
+
+      Device_task get_return_object() {
+        return Device_task{std::coroutine_handle<promise_type>::from_promise(*this)};
+      }
+      std::suspend_always initial_suspend() noexcept { return {}; }
+      std::suspend_always final_suspend() noexcept { return {}; }
+      void return_void() {}
+      void unhandled_exception() { m_exception = std::current_exception(); }
+
+      static void* operator new(std::size_t size) { return Frame_pool::allocate(size); }
+      static void operator delete(void *ptr, std::size_t size) {
+        Frame_pool::deallocate(ptr, size);
+      }
+    };
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Device_task(Device_task &&that) noexcept : m_handle{std::exchange(that.m_handle, {})} {}
+    Device_task& operator=(Device_task that) noexcept {
+      std::swap(m_handle, that.m_handle);
+      return *this;
+    }
+    ~Device_task() { if (m_handle) m_handle.destroy(); }
+
+    [[nodiscard]] Handle get_handle() const { return m_handle; }
+
+  private:
+    explicit Device_task(Handle handle) : m_handle{handle} {}
+    Handle m_handle{};
+};
+
+// Base for MMIO devices written as coroutines. Registers are plain words the guest
+// reads and writes; the device coroutines `co_await` virtual-time delays, accesses to a
+// register and the guest acknowledging the device interrupt. Every resumption goes
+// through the scheduler, so the device never runs in the middle of an instruction.
+class Coro_device : public Memory {
+  public:
+    struct Irq_config {
+      Plic &plic;
+      unsigned int source;
+      // A guest write to this register acknowledges the interrupt.
+      std::size_t ack_addr;
+    };
+
+    Coro_device(Scheduler &scheduler, std::size_t registers_number,
+        std::optional<Irq_config> irq_config = std::nullopt);
+    ~Coro_device() override;
+    Coro_device(const Coro_device&) = delete;
+    Coro_device& operator=(const Coro_device&) = delete;
+
+    void write(std::size_t addr, Uxlen data, unsigned int byte_en = 0xf) override;
+    [[nodiscard]] Uxlen read (std::size_t addr, unsigned int byte_en = 0xf) override;
+
+  protected:
+    class Delay {
+      public:
+        Delay(Coro_device &device, Scheduler::Time ticks) : m_device{device}, m_ticks{ticks} {}
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) {
+          m_device.resume_in(m_ticks, handle);
+        }
+        void await_resume() const noexcept {}
+      private:
+        Coro_device &m_device;
+        Scheduler::Time m_ticks;
+    };
+
+    enum class Access { read, write };
+
+    class Register_access {
+      public:
+        Register_access(Coro_device &device, Access access, std::size_t addr)
+            : m_device{device}, m_access{access}, m_addr{addr} {}
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) {
+          m_device.m_access_waiters.push_back({m_access, m_addr, handle, &m_data});
+        }
+        // Value written or read by the guest.
+        Uxlen await_resume() const noexcept { return m_data; }
+      private:
+        Coro_device &m_device;
+        Access m_access;
+        std::size_t m_addr;
+        Uxlen m_data{0};
+    };
+
+    class Irq_ack {
+      public:
+        explicit Irq_ack(Coro_device &device) : m_device{device} {}
+        bool await_ready() const noexcept { return !m_device.m_irq_raised; }
+        void await_suspend(std::coroutine_handle<> handle) {
+          m_device.m_ack_waiters.push_back(handle);
+        }
+        void await_resume() const noexcept {}
+      private:
+        Coro_device &m_device;
+    };
+
+    // Wakes up device coroutines on host-side input, e.g. a byte arriving at a UART.
+    // Awaited directly; `notify` resumes all waiters through the scheduler.
+    class Notification {
+      public:
+        explicit Notification(Coro_device &device) : m_device{device} {}
+        Notification(const Notification&) = delete;
+        Notification& operator=(const Notification&) = delete;
+
+        void notify() {
+          for (std::coroutine_handle<> handle : std::exchange(m_waiters, {})) {
+            m_device.resume_in(0, handle);
+          }
+        }
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { m_waiters.push_back(handle); }
+        void await_resume() const noexcept {}
+      private:
+        Coro_device &m_device;
+        std::vector<std::coroutine_handle<>> m_waiters{};
+    };
+
+    [[nodiscard]] Delay delay(Scheduler::Time ticks) { return {*this, ticks}; }
+    [[nodiscard]] Register_access wait_write(std::size_t addr) {
+      return {*this, Access::write, addr};
+    }
+    [[nodiscard]] Register_access wait_read(std::size_t addr) {
+      return {*this, Access::read, addr};
+    }
+    // Completes immediately if the interrupt is not raised.
+    [[nodiscard]] Irq_ack wait_irq_ack() { return Irq_ack{*this}; }
+
+    void raise_irq();
+    void spawn(Device_task task);
+
+    [[nodiscard]] Uxlen& reg(std::size_t addr);
+    [[nodiscard]] Scheduler& get_scheduler() { return m_scheduler; }
+
+    // Register side effects. By default registers are plain storage.
+    virtual void  on_write(std::size_t addr, Uxlen data) { reg(addr) = data; }
+    virtual Uxlen on_read (std::size_t addr) { return reg(addr); }
+
+  private:
+    struct Access_waiter {
+      Access access;
+      std::size_t addr;
+      std::coroutine_handle<> handle;
+      Uxlen *data;
+    };
+
+    Scheduler &m_scheduler;
+    std::vector<Uxlen> m_registers;
+    std::optional<Irq_config> m_irq_config;
+    bool m_irq_raised{false};
+    // Unfinished tasks by coroutine frame.
+    std::unordered_map<void*, Device_task> m_tasks{};
+    std::vector<Access_waiter> m_access_waiters{};
+    std::vector<std::coroutine_handle<>> m_ack_waiters{};
+    // Resumptions in flight by coroutine frame, cancelled if the device goes away first. A
+    // suspended coroutine has at most one.
+    std::unordered_map<void*, Scheduler::Event_id> m_events{};
+
+    void resume_in(Scheduler::Time ticks, std::coroutine_handle<> handle);
+    void notify_access(Access access, std::size_t addr, Uxlen data);
+    // Frees the task once it has finished, rethrowing the exception it failed with.
+    void reap(std::coroutine_handle<> handle);
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "coro_device.hpp"
+
+// Down-counting timer modelled as a single coroutine. LOAD is latched when counting starts;
+// on expiry STATUS.EXPIRED is set and the interrupt raised. A one-shot timer disables itself
+// and waits for the guest to clear STATUS before it can be restarted, a periodic one reloads
+// immediately.
+class Coro_timer : public Coro_device {
+  public:
+    enum Register : std::size_t {
+      LOAD   = 0x0,
+      CTRL   = 0x4,
+      COUNT  = 0x8,
+      STATUS = 0xc,
+    };
+    enum Ctrl : Uxlen {
+      CTRL_ENABLE   = 1 << 0,
+      CTRL_PERIODIC = 1 << 1,
+    };
+    enum Status : Uxlen {
+      STATUS_EXPIRED = 1 << 0,
+    };
+
+    Coro_timer(Scheduler &scheduler, Plic &plic, unsigned int irq_source);
+
+  protected:
+    void  on_write(std::size_t addr, Uxlen data) override;
+    Uxlen on_read (std::size_t addr) override;
+
+  private:
+    Scheduler::Time m_deadline{0};
+
+    Device_task count();
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "coro_device.hpp"
+
+#include <deque>
+#include <ostream>
+#include <string_view>
+
+// Minimal UART modelled as a transmitter and a receiver coroutine. Each character takes
+// `char_time` ticks on the line. Characters written to a full TX FIFO and received into a
+// full RX FIFO are dropped; the latter sets STATUS.OVERRUN until STATUS is read.
+class Coro_uart : public Coro_device {
+  public:
+    static constexpr std::size_t fifo_depth{16};
+
+    enum Register : std::size_t {
+      TXDATA = 0x00,
+      RXDATA = 0x04,
+      STATUS = 0x08,
+      CTRL   = 0x0c,
+      // Any write acknowledges the RX interrupt. The next character raises it again.
+      ACK    = 0x10,
+    };
+    enum Status : Uxlen {
+      STATUS_TX_FULL  = 1 << 0,
+      STATUS_TX_EMPTY = 1 << 1,
+      STATUS_RX_VALID = 1 << 2,
+      STATUS_OVERRUN  = 1 << 3,
+    };
+    enum Ctrl : Uxlen {
+      CTRL_RX_IRQ = 1 << 0,
+    };
+
+    Coro_uart(Scheduler &scheduler, std::ostream &out, Scheduler::Time char_time,
+        Plic &plic, unsigned int irq_source);
+
+    // Host side of the RX line.
+    void receive(std::string_view input);
+
+  protected:
+    void  on_write(std::size_t addr, Uxlen data) override;
+    Uxlen on_read (std::size_t addr) override;
+
+  private:
+    std::ostream &m_out;
+    const Scheduler::Time m_char_time;
+    std::deque<char> m_tx_fifo{};
+    std::deque<char> m_rx_fifo{};
+    // Characters on their way to the RX FIFO.
+    std::deque<char> m_rx_line{};
+    Notification m_rx_arrived{*this};
+    bool m_overrun{false};
+
+    Device_task transmit();
+    Device_task receive_line();
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "image_cache.hpp"
+#include "memory.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Ram of a fixed size with an image loaded at `base`, which shares the pages of the image
+// with the other memories mapping it. A page is copied on its first write, or when a host
+// pointer into it is handed out, since the caller may write through it; the pages that
+// are only read and fetched from, such as text and read-only data, stay shared. Pages
+// outside of the image read as zero until written.
+//
+// Like Ram, it may be accessed from several host threads at once.
+template <unsigned int xlen>
+class Basic_cow_ram : public Basic_memory<xlen> {
+  public:
+    using Data = Uxlen_t<xlen>;
+    using Basic_memory<xlen>::full_byte_en;
+    static constexpr std::size_t page_size{Image::page_size};
+
+    // `base` is page-aligned and the image fits below `size`.
+    explicit Basic_cow_ram(std::size_t size, std::shared_ptr<const Image> image = {},
+        std::size_t base = 0);
+    ~Basic_cow_ram() override;
+    Basic_cow_ram(const Basic_cow_ram&) = delete;
+    Basic_cow_ram& operator=(const Basic_cow_ram&) = delete;
+
+    void write(std::size_t addr, Data data, unsigned int byte_en = full_byte_en) override;
+    [[nodiscard]] Data read (std::size_t addr, unsigned int byte_en = full_byte_en) override;
+    // Within a page only.
+    [[nodiscard]] std::byte* get_host_ptr(std::size_t addr, std::size_t size) override;
+
+    [[nodiscard]] std::size_t size() const { return m_size; }
+    // Pages copied so far, the memory this instance holds on top of the shared image.
+    [[nodiscard]] std::size_t get_private_pages() const {
+      return m_private_pages.load(std::memory_order_relaxed);
+    }
+
+  private:
+    const std::size_t m_size;
+    const std::shared_ptr<const Image> m_image;
+    const std::size_t m_image_page;
+    // Set once per page, by the first writer.
+    std::vector<std::atomic<std::byte*>> m_pages;
+    std::atomic<std::size_t> m_private_pages{0};
+
+    [[nodiscard]] const std::byte* get_shared_page(std::size_t page) const;
+    [[nodiscard]] const std::byte* get_page(std::size_t page) const;
+    [[nodiscard]] std::byte* get_private_page(std::size_t page);
+
+    void assert_inside(std::size_t addr) const;
+};
+
+using Cow_ram   = Basic_cow_ram<32>;
+using Cow_ram64 = Basic_cow_ram<64>;
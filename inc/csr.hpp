@@ -1,28 +1,149 @@
 #pragma once
 
+#include "irq.hpp"
 #include "memory.hpp"
+#include "pmp.hpp"
 
 #include <map>
 
-class Csr : public Memory {
+// Register numbers, shared by every XLEN.
+class Csr_base {
   public:
     enum Register : std::size_t {
+      FFLAGS   = 0x001,
+      FRM      = 0x002,
+      // fflags and frm, not stored separately.
+      FCSR     = 0x003,
+      // Hardwired to 0: vector instructions are never interrupted part way.
+      VSTART   = 0x008,
+      // Views of mstatus, mie and mip restricted to S-mode.
+      SSTATUS  = 0x100,
+      SIE      = 0x104,
+      STVEC    = 0x105,
+      SSCRATCH = 0x140,
+      SEPC     = 0x141,
+      SCAUSE   = 0x142,
+      STVAL    = 0x143,
+      SIP      = 0x144,
+      SATP     = 0x180,
+      MSTATUS  = 0x300,
+      MEDELEG  = 0x302,
+      MIDELEG  = 0x303,
       MEPC     = 0x341,
       MIE      = 0x304,
       MTVEC    = 0x305,
       MSCRATCH = 0x340,
       MCAUSE   = 0x342,
+      MTVAL    = 0x343,
+      MIP      = 0x344,
+      // Followed by pmpcfg1-3, of which RV64 only has pmpcfg2, and by pmpaddr1-15.
+      PMPCFG0  = 0x3a0,
+      PMPADDR0 = 0x3b0,
+      // Read-only for the guest; vset{i}vl{i} writes them through the core.
+      VL       = 0xc20,
+      VTYPE    = 0xc21,
+      VLENB    = 0xc22,
+      MHARTID  = 0xf14,
     };
 
-    using Container = std::map<Register, Uxlen>;
+    // The top two bits of the number are set for read-only registers.
+    [[nodiscard("PURE FUN")]] static constexpr bool is_read_only(std::size_t reg) {
+      return ((reg >> 10) & 0b11) == 0b11;
+    }
+
+    enum class Privilege : unsigned int {
+      user       = 0,
+      supervisor = 1,
+      machine    = 3,
+    };
+
+    // The next two bits hold the lowest privilege allowed to access the register.
+    [[nodiscard("PURE FUN")]] static constexpr Privilege get_privilege(std::size_t reg) {
+      return static_cast<Privilege>((reg >> 8) & 0b11);
+    }
+
+    enum Mstatus : Uxlen {
+      MSTATUS_SIE  = Uxlen{1} << 1,
+      MSTATUS_MIE  = Uxlen{1} << 3,
+      MSTATUS_SPIE = Uxlen{1} << 5,
+      MSTATUS_MPIE = Uxlen{1} << 7,
+      MSTATUS_SPP  = Uxlen{1} << 8,
+      MSTATUS_MPP  = Uxlen{0b11} << 11,
+      // Loads and stores of M-mode translate as in the mode in mpp.
+      MSTATUS_MPRV = Uxlen{1} << 17,
+      // S-mode may access user pages.
+      MSTATUS_SUM  = Uxlen{1} << 18,
+      // Loads may read executable pages.
+      MSTATUS_MXR  = Uxlen{1} << 19,
+      SSTATUS_MASK = MSTATUS_SIE | MSTATUS_SPIE | MSTATUS_SPP | MSTATUS_SUM | MSTATUS_MXR,
+    };
+    static constexpr unsigned int MSTATUS_MPP_SHIFT{11};
+
+    // Synchronous causes in mcause/scause.
+    enum Exception : Uxlen {
+      // Denied by pmp.
+      INSTRUCTION_ACCESS_FAULT = 1,
+      BREAKPOINT               = 3,
+      LOAD_ACCESS_FAULT        = 5,
+      STORE_ACCESS_FAULT       = 7,
+      // ecall from U-, S- and M-mode.
+      USER_ECALL               = 8,
+      SUPERVISOR_ECALL         = 9,
+      MACHINE_ECALL            = 11,
+      INSTRUCTION_PAGE_FAULT   = 12,
+      LOAD_PAGE_FAULT          = 13,
+      STORE_PAGE_FAULT         = 15,
+    };
+
+    // Sv32, the only translation mode besides Bare. On RV64 satp stays Bare.
+    static constexpr Uxlen SATP_SV32{Uxlen{1} << 31};
+    static constexpr unsigned int SATP_ASID_SHIFT{22};
+    static constexpr Uxlen SATP_ASID_MASK{0x1ff};
+    static constexpr Uxlen SATP_PPN_MASK{(Uxlen{1} << 22) - 1};
+
+};
+
+template <unsigned int xlen>
+class Basic_csr : public Basic_memory<xlen>, public Csr_base {
+  public:
+    using Data = Uxlen_t<xlen>;
+    using Basic_memory<xlen>::full_byte_en;
+
+    static constexpr Data MCAUSE_INTERRUPT{Data{1} << (xlen - 1)};
+
+    using Container = std::map<Register, Data>;
+
+    // `hart` is the value of mhartid.
+    explicit Basic_csr(std::size_t hart = 0);
+    // mip reads reflect the lines driven by the interrupt controllers.
+    explicit Basic_csr(const Irq_pending &irq_pending, std::size_t hart = 0);
 
-    void write(std::size_t addr, Uxlen data, unsigned int byte_en = 0xf) override;
-    [[nodiscard]] Uxlen read (std::size_t addr, unsigned int byte_en = 0xf) override;
+    void write(std::size_t addr, Data data, unsigned int byte_en = full_byte_en) override;
+    [[nodiscard]] Data read (std::size_t addr, unsigned int byte_en = full_byte_en) override;
 
     [[nodiscard]] const Container& get_content() const {
       return m_registers;
     }
 
+    // Held by pmpcfg and pmpaddr, and checked by an Mmu given it.
+    [[nodiscard]] Basic_pmp<xlen>& get_pmp() { return m_pmp; }
+
+    // For snapshots. Flags accrued in the host FPU aren't part of it until fflags is read.
+    struct State {
+      Container registers{};
+      Basic_pmp<xlen> pmp{};
+    };
+    [[nodiscard]] State get_state() const { return {.registers = m_registers, .pmp = m_pmp}; }
+    void set_state(const State &state) {
+      m_registers = state.registers;
+      m_pmp       = state.pmp;
+    }
+
   private:
     Container m_registers{};
+    Basic_pmp<xlen> m_pmp{};
+    const Irq_pending *m_irq_pending{nullptr};
 };
+
+using Csr   = Basic_csr<32>;
+using Csr64 = Basic_csr<64>;
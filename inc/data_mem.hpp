@@ -1,3 +1,5 @@
+#pragma once
+
 #include "memory.hpp"
 #include "riscv_algos.hpp"
 #include "exception.hpp"
@@ -7,55 +9,44 @@
 #include <utility>
 #include <unordered_map>
 
-class Data_mem : public Memory {
+template <unsigned int xlen>
+class Basic_data_mem : public Basic_memory<xlen> {
   public:
-    using Map = std::unordered_map<std::size_t, std::byte>;
-    Data_mem(Map content) : m_content{std::move(content)} {}
+    using Map  = std::unordered_map<std::size_t, std::byte>;
+    using Data = Uxlen_t<xlen>;
+    using Basic_memory<xlen>::full_byte_en;
+    Basic_data_mem(Map content) : m_content{std::move(content)} {}
 
     using mapped_type = Map::mapped_type;
 
-    void write(std::size_t addr, Uxlen data, unsigned int byte_en = 0xf) override {
+    void write(std::size_t addr, Data data, unsigned int byte_en = full_byte_en) override {
       if(m_assured_aligment && is_misaliged(addr, byte_en)) {
         throw Errors::Misalignment{addr, "illegal byte_en (" +
             std::to_string(byte_en) + ") when reading from data_mem"};
       }
-      const auto to_byte = [](Uxlen data_) {
+      const auto to_byte = [](Data data_) {
         return mapped_type{static_cast<uint8_t>(data_)};
       };
-      if (extract_bits(byte_en, 0)) {
-        m_content.insert_or_assign(addr, to_byte(extract_bits(data, {7,0})));
-      }
-      if (extract_bits(byte_en, 1)) {
-        m_content.insert_or_assign(addr+1, to_byte(extract_bits(data, {15,8})));
-      }
-      if (extract_bits(byte_en, 2)) {
-        m_content.insert_or_assign(addr+2, to_byte(extract_bits(data, {23,16})));
-      }
-      if (extract_bits(byte_en, 3)) {
-        m_content.insert_or_assign(addr+3, to_byte(extract_bits(data, {31,24})));
+      for (unsigned int lane{0}; lane < lanes_number; ++lane) {
+        if (extract_bits(byte_en, lane)) {
+          m_content.insert_or_assign(addr + lane, to_byte(data >> (lane * CHAR_BIT)));
+        }
       }
     }
 
-    [[nodiscard]] Uxlen read (std::size_t addr, unsigned int byte_en = 0xf) override {
+    [[nodiscard]] Data read (std::size_t addr, unsigned int byte_en = full_byte_en) override {
       if(m_assured_aligment && is_misaliged(addr, byte_en)) {
         throw Errors::Misalignment{addr, "illegal byte_en (" +
             std::to_string(byte_en) + ") when writing to data_mem"};
       }
-      const auto to_uxlen = [](mapped_type b) {
-        return static_cast<Uxlen>(b);
+      const auto to_data = [](mapped_type b) {
+        return static_cast<Data>(b);
       };
-      Uxlen data{0};
-      if (extract_bits(byte_en, 0)) {
-        data |= to_uxlen(try_get(addr));
-      }
-      if (extract_bits(byte_en, 1)) {
-        data |= to_uxlen(try_get(addr+1)) << CHAR_BIT;
-      }
-      if (extract_bits(byte_en, 2)) {
-        data |= to_uxlen(try_get(addr+2)) << 2*CHAR_BIT;
-      }
-      if (extract_bits(byte_en, 3)) {
-        data |= to_uxlen(try_get(addr+3)) << 3*CHAR_BIT;
+      Data data{0};
+      for (unsigned int lane{0}; lane < lanes_number; ++lane) {
+        if (extract_bits(byte_en, lane)) {
+          data |= to_data(try_get(addr + lane)) << (lane * CHAR_BIT);
+        }
       }
       return data;
     }
@@ -65,11 +56,13 @@ class Data_mem : public Memory {
     }
 
   private:
+    static constexpr unsigned int lanes_number{xlen / CHAR_BIT};
+
     Map m_content;
 
     [[nodiscard("PURE FUN")]] bool is_misaliged(std::size_t addr,
-        unsigned int byte_en = 0xf) const {
-      return !((byte_en > 0) && (byte_en <= 0xf));
+        unsigned int byte_en = full_byte_en) const {
+      return !((byte_en > 0) && (byte_en <= full_byte_en));
     }
 
     mapped_type try_get(std::size_t addr) const {
@@ -80,3 +73,6 @@ class Data_mem : public Memory {
       }
     }
 };
+
+using Data_mem   = Basic_data_mem<32>;
+using Data_mem64 = Basic_data_mem<64>;
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "decoder.hpp"
+#include "riscv.hpp"
+
+#include <cstddef>
+#include <unordered_set>
+#include <vector>
+
+// Decoded instructions by pc. Direct-mapped; an entry only hits while the raw bits fetched
+// at its pc are the ones it was decoded from, so code modified at run time is decoded
+// anew without explicit invalidation.
+//
+// Breakpoints of a debugger are entries holding instr_debug_break instead of the decoded
+// instruction, so a hit costs the same with or without them. Only misses look at the
+// breakpoint set, and an entry evicted or decoded anew is patched again.
+template <unsigned int xlen>
+class Basic_decode_cache {
+  public:
+    using Pc   = Uxlen_t<xlen>;
+    using Info = typename Basic_decoder<xlen>::Instruction_info;
+
+    static constexpr std::size_t entries_number{4096};
+
+    [[nodiscard]] const Info* find(Pc pc, Uxlen raw) const {
+      const Entry &entry{m_entries[get_index(pc)]};
+      return (entry.valid && (entry.pc == pc) && (entry.raw == raw)) ? &entry.info : nullptr;
+    }
+
+    const Info& insert(Pc pc, Uxlen raw, const Info &info) {
+      Entry &entry{m_entries[get_index(pc)]};
+      entry = {.pc = pc, .raw = raw, .info = info, .valid = true};
+      if (!m_breakpoints.empty() && m_breakpoints.contains(pc)) [[unlikely]] patch(entry);
+      return entry.info;
+    }
+
+    void clear() { m_entries.assign(entries_number, {}); }
+
+    void set_breakpoint(Pc pc) {
+      m_breakpoints.insert(pc);
+      Entry &entry{m_entries[get_index(pc)]};
+      if (entry.valid && (entry.pc == pc)) patch(entry);
+    }
+    // Returns whether there was one. The entry is decoded anew on the next fetch.
+    bool clear_breakpoint(Pc pc) {
+      if (!m_breakpoints.erase(pc)) return false;
+      Entry &entry{m_entries[get_index(pc)]};
+      if (entry.pc == pc) entry.valid = false;
+      return true;
+    }
+    [[nodiscard]] bool is_breakpoint(Pc pc) const { return m_breakpoints.contains(pc); }
+
+  private:
+    struct Entry {
+      Pc    pc {0};
+      Uxlen raw{0};
+      Info  info{};
+      bool valid{false};
+    };
+
+    std::vector<Entry> m_entries{entries_number};
+    std::unordered_set<Pc> m_breakpoints{};
+
+    static void patch(Entry &entry) {
+      entry.info = {.instruction = Decoder_base::instr_debug_break};
+    }
+
+    // Instructions are at least halfword-aligned.
+    [[nodiscard("PURE FUN")]] static std::size_t get_index(Pc pc) {
+      return (pc >> 1) % entries_number;
+    }
+};
+
+using Decode_cache = Basic_decode_cache<32>;
@@ -4,9 +4,12 @@
 
 #include "isa_extension.hpp"
 
+#include <optional>
+
 #include <cassert>
 
-class Decoder {
+// Instruction formats and opcodes, shared by the decoders of every XLEN.
+class Decoder_base {
   public:
 
     enum class Instruction_type {
@@ -16,7 +19,25 @@ class Decoder {
       u,
       uj,
       sb,
+      // Shift amount of log2(XLEN) bits.
       i_sh5,
+      // rd and rs1 only.
+      unary,
+      // r with the rounding mode in funct3.
+      r_fp,
+      // r_fp with rs3.
+      r4,
+      // Vector arithmetic: vd in rd, vs2 in rs2, vs1 or a scalar register in rs1, a
+      // sign-extended 5-bit immediate in imm, and vm.
+      v,
+      // v with an unsigned immediate, for shifts.
+      v_uimm,
+      // Vector loads: vd in rd, the base in rs1 and the stride in rs2.
+      v_load,
+      // As v_load with vs3 in rs3.
+      v_store,
+      // vsetvli and vsetivli: vtype in imm. vsetivli has its AVL in rs1.
+      v_cfg,
       none
     };
 
@@ -59,55 +80,361 @@ class Decoder {
       instr_or    ,
       instr_and   ,
       instr_fence ,
+      instr_ecall ,
+      instr_ebreak,
       instr_mret  ,
+      instr_wfi   ,
+      // S.
+      instr_sret  ,
+      instr_sfence_vma,
       instr_csrrw ,
       instr_csrrs ,
       instr_csrrc ,
       instr_csrrwi,
       instr_csrrsi,
       instr_csrrci,
+      instr_mul   ,
+      instr_mulh  ,
+      instr_mulhsu,
+      instr_mulhu ,
+      instr_div   ,
+      instr_divu  ,
+      instr_rem   ,
+      instr_remu  ,
+      instr_sh1add,
+      instr_sh2add,
+      instr_sh3add,
+      instr_andn  ,
+      instr_orn   ,
+      instr_xnor  ,
+      instr_clz   ,
+      instr_ctz   ,
+      instr_cpop  ,
+      instr_max   ,
+      instr_maxu  ,
+      instr_min   ,
+      instr_minu  ,
+      instr_sext_b,
+      instr_sext_h,
+      instr_zext_h,
+      instr_rol   ,
+      instr_ror   ,
+      instr_rori  ,
+      instr_orc_b ,
+      instr_rev8  ,
+      instr_bclr  ,
+      instr_bclri ,
+      instr_bext  ,
+      instr_bexti ,
+      instr_binv  ,
+      instr_binvi ,
+      instr_bset  ,
+      instr_bseti ,
+      // RV64 only.
+      instr_lwu   ,
+      instr_ld    ,
+      instr_sd    ,
+      instr_addiw ,
+      instr_slliw ,
+      instr_srliw ,
+      instr_sraiw ,
+      instr_addw  ,
+      instr_subw  ,
+      instr_sllw  ,
+      instr_srlw  ,
+      instr_sraw  ,
+      instr_mulw  ,
+      instr_divw  ,
+      instr_divuw ,
+      instr_remw  ,
+      instr_remuw ,
+      instr_add_uw,
+      instr_sh1add_uw,
+      instr_sh2add_uw,
+      instr_sh3add_uw,
+      instr_slli_uw,
+      instr_clzw  ,
+      instr_ctzw  ,
+      instr_cpopw ,
+      instr_rolw  ,
+      instr_rorw  ,
+      instr_roriw ,
+      // F.
+      instr_flw   ,
+      instr_fsw   ,
+      instr_fmadd_s,
+      instr_fmsub_s,
+      instr_fnmsub_s,
+      instr_fnmadd_s,
+      instr_fadd_s,
+      instr_fsub_s,
+      instr_fmul_s,
+      instr_fdiv_s,
+      instr_fsqrt_s,
+      instr_fsgnj_s,
+      instr_fsgnjn_s,
+      instr_fsgnjx_s,
+      instr_fmin_s,
+      instr_fmax_s,
+      instr_fcvt_w_s,
+      instr_fcvt_wu_s,
+      instr_fmv_x_w,
+      instr_feq_s ,
+      instr_flt_s ,
+      instr_fle_s ,
+      instr_fclass_s,
+      instr_fcvt_s_w,
+      instr_fcvt_s_wu,
+      instr_fmv_w_x,
+      instr_fcvt_l_s,
+      instr_fcvt_lu_s,
+      instr_fcvt_s_l,
+      instr_fcvt_s_lu,
+      // D.
+      instr_fld   ,
+      instr_fsd   ,
+      instr_fmadd_d,
+      instr_fmsub_d,
+      instr_fnmsub_d,
+      instr_fnmadd_d,
+      instr_fadd_d,
+      instr_fsub_d,
+      instr_fmul_d,
+      instr_fdiv_d,
+      instr_fsqrt_d,
+      instr_fsgnj_d,
+      instr_fsgnjn_d,
+      instr_fsgnjx_d,
+      instr_fmin_d,
+      instr_fmax_d,
+      instr_fcvt_s_d,
+      instr_fcvt_d_s,
+      instr_feq_d ,
+      instr_flt_d ,
+      instr_fle_d ,
+      instr_fclass_d,
+      instr_fcvt_w_d,
+      instr_fcvt_wu_d,
+      instr_fcvt_d_w,
+      instr_fcvt_d_wu,
+      instr_fcvt_l_d,
+      instr_fcvt_lu_d,
+      instr_fmv_x_d,
+      instr_fcvt_d_l,
+      instr_fcvt_d_lu,
+      instr_fmv_d_x,
+      // V.
+      instr_vsetvli,
+      instr_vsetivli,
+      instr_vsetvl,
+      instr_vle8_v,
+      instr_vle16_v,
+      instr_vle32_v,
+      instr_vle64_v,
+      instr_vlse8_v,
+      instr_vlse16_v,
+      instr_vlse32_v,
+      instr_vlse64_v,
+      instr_vse8_v,
+      instr_vse16_v,
+      instr_vse32_v,
+      instr_vse64_v,
+      instr_vsse8_v,
+      instr_vsse16_v,
+      instr_vsse32_v,
+      instr_vsse64_v,
+      instr_vadd_vv,
+      instr_vadd_vx,
+      instr_vadd_vi,
+      instr_vsub_vv,
+      instr_vsub_vx,
+      instr_vrsub_vx,
+      instr_vrsub_vi,
+      instr_vminu_vv,
+      instr_vminu_vx,
+      instr_vmin_vv,
+      instr_vmin_vx,
+      instr_vmaxu_vv,
+      instr_vmaxu_vx,
+      instr_vmax_vv,
+      instr_vmax_vx,
+      instr_vand_vv,
+      instr_vand_vx,
+      instr_vand_vi,
+      instr_vor_vv,
+      instr_vor_vx,
+      instr_vor_vi,
+      instr_vxor_vv,
+      instr_vxor_vx,
+      instr_vxor_vi,
+      instr_vsll_vv,
+      instr_vsll_vx,
+      instr_vsll_vi,
+      instr_vsrl_vv,
+      instr_vsrl_vx,
+      instr_vsrl_vi,
+      instr_vsra_vv,
+      instr_vsra_vx,
+      instr_vsra_vi,
+      instr_vmul_vv,
+      instr_vmul_vx,
+      instr_vmulh_vv,
+      instr_vmulh_vx,
+      instr_vmulhu_vv,
+      instr_vmulhu_vx,
+      instr_vmulhsu_vv,
+      instr_vmulhsu_vx,
+      instr_vmerge_vvm,
+      instr_vmerge_vxm,
+      instr_vmerge_vim,
+      instr_vmv_v_v,
+      instr_vmv_v_x,
+      instr_vmv_v_i,
+      instr_vmseq_vv,
+      instr_vmseq_vx,
+      instr_vmseq_vi,
+      instr_vmsne_vv,
+      instr_vmsne_vx,
+      instr_vmsne_vi,
+      instr_vmsltu_vv,
+      instr_vmsltu_vx,
+      instr_vmslt_vv,
+      instr_vmslt_vx,
+      instr_vmsleu_vv,
+      instr_vmsleu_vx,
+      instr_vmsleu_vi,
+      instr_vmsle_vv,
+      instr_vmsle_vx,
+      instr_vmsle_vi,
+      instr_vmsgtu_vx,
+      instr_vmsgtu_vi,
+      instr_vmsgt_vx,
+      instr_vmsgt_vi,
+      instr_vredsum_vs,
+      instr_vredand_vs,
+      instr_vredor_vs,
+      instr_vredxor_vs,
+      instr_vredminu_vs,
+      instr_vredmin_vs,
+      instr_vredmaxu_vs,
+      instr_vredmax_vs,
+      instr_vmv_x_s,
+      instr_vmv_s_x,
+      // A.
+      instr_lr_w,
+      instr_sc_w,
+      instr_amoswap_w,
+      instr_amoadd_w,
+      instr_amoxor_w,
+      instr_amoand_w,
+      instr_amoor_w,
+      instr_amomin_w,
+      instr_amomax_w,
+      instr_amominu_w,
+      instr_amomaxu_w,
+      // A, RV64 only.
+      instr_lr_d,
+      instr_sc_d,
+      instr_amoswap_d,
+      instr_amoadd_d,
+      instr_amoxor_d,
+      instr_amoand_d,
+      instr_amoor_d,
+      instr_amomin_d,
+      instr_amomax_d,
+      instr_amominu_d,
+      instr_amomaxu_d,
+      // Not an encoding: what the decode cache holds at a debugger breakpoint.
+      instr_debug_break,
+    };
+
+    [[nodiscard]] static Instruction_type get_type(Concrete_instruction instruction);
+
+    [[nodiscard("PURE FUN")]] static constexpr bool is_compressed(Uxlen instruction) {
+      return (instruction & 0b11) != 0b11;
+    }
+
+  protected:
+    enum class Opcode {
+      load      = 0b00000,
+      misc_mem  = 0b00011,
+      op_imm    = 0b00100,
+      auipc     = 0b00101,
+      load_fp   = 0b00001,
+      op_imm_32 = 0b00110,
+      store     = 0b01000,
+      store_fp  = 0b01001,
+      amo       = 0b01011,
+      op        = 0b01100,
+      lui       = 0b01101,
+      op_32     = 0b01110,
+      madd      = 0b10000,
+      msub      = 0b10001,
+      nmsub     = 0b10010,
+      nmadd     = 0b10011,
+      op_fp     = 0b10100,
+      op_v      = 0b10101,
+      branch    = 0b11000,
+      jalr      = 0b11001,
+      jal       = 0b11011,
+      system    = 0b11100
     };
+};
+
+// Instructions are 32 bits wide for every XLEN; the XLEN selects the RV64 encodings and
+// the width of the immediates, which are sign-extended to it.
+template <unsigned int xlen>
+class Basic_decoder : public Decoder_base {
+  public:
 
     struct Instruction_info {
       unsigned int         rs1        {};
       unsigned int         rs2        {};
       unsigned int         rs3        {};
-      Imm                  imm        {};
+      Uxlen_t<xlen>        imm        {};
       unsigned int         rd         {};
       Concrete_instruction instruction{};
+      // Rounding mode field of F and D instructions.
+      unsigned int         rm         {};
+      // In bytes: 2 for compressed instructions, 4 otherwise.
+      unsigned int         length     {4};
+      // Vector instructions are masked by v0 if clear.
+      bool                 vm         {true};
 
-      [[nodiscard]] Instruction_type get_type() const;
+      [[nodiscard]] Instruction_type get_type() const {
+        return Decoder_base::get_type(instruction);
+      }
     };
 
-    explicit Decoder(Isa_ext_container extensions)
+    explicit Basic_decoder(Isa_ext_container extensions)
         : m_isa_ext_container{extensions} {};
-    Decoder() = default;
+    Basic_decoder() = default;
+    // A compressed instruction is taken from the lower halfword and expanded into the
+    // equivalent base one.
     Instruction_info decode(Uxlen instruction) const;
 
   private:
     const Isa_ext_container m_isa_ext_container{};
 
     Concrete_instruction decode_concrete_instruction(Uxlen instruction) const;
-
-    enum class Opcode {
-      load     = 0b00000,
-      misc_mem = 0b00011,
-      op_imm   = 0b00100,
-      auipc    = 0b00101,
-      store    = 0b01000,
-      op       = 0b01100,
-      lui      = 0b01101,
-      branch   = 0b11000,
-      jalr     = 0b11001,
-      jal      = 0b11011,
-      system   = 0b11100
-    };
-
+    Instruction_info decode_compressed(Uxlen instruction) const;
+    [[nodiscard]] std::optional<Concrete_instruction> decode_bitmanip(Uxlen instruction,
+        std::optional<Isa_extension> &missing_extension) const;
+    [[nodiscard]] std::optional<Concrete_instruction> decode_fp(Uxlen instruction,
+        std::optional<Isa_extension> &missing_extension) const;
+    [[nodiscard]] std::optional<Concrete_instruction> decode_vector(Uxlen instruction,
+        std::optional<Isa_extension> &missing_extension) const;
+    [[nodiscard]] std::optional<Concrete_instruction> decode_atomic(Uxlen instruction,
+        std::optional<Isa_extension> &missing_extension) const;
 };
 
-[[nodiscard]] inline Decoder::Instruction_type Decoder::Instruction_info::get_type() const {
-  using enum Decoder::Concrete_instruction;
-  using enum Decoder::Instruction_type;
+using Decoder   = Basic_decoder<32>;
+using Decoder64 = Basic_decoder<64>;
+
+[[nodiscard]] inline Decoder_base::Instruction_type Decoder_base::get_type(
+    Concrete_instruction instruction) {
+  using enum Decoder_base::Concrete_instruction;
+  using enum Decoder_base::Instruction_type;
   switch (instruction) {
     case instr_lui   :
     case instr_auipc : return u;
@@ -120,7 +447,12 @@ class Decoder {
     case instr_lw    :
     case instr_lbu   :
     case instr_lhu   :
+    case instr_lwu   :
+    case instr_ld    :
+    case instr_flw   :
+    case instr_fld   :
     case instr_addi  :
+    case instr_addiw :
     case instr_slti  :
     case instr_sltiu :
     case instr_xori  :
@@ -131,7 +463,9 @@ class Decoder {
     case instr_csrrc :
     case instr_csrrwi:
     case instr_csrrsi:
-    case instr_csrrci: return i;
+    case instr_csrrci:
+    // fm, pred and succ in imm.
+    case instr_fence : return i;
 
     case instr_beq   :
     case instr_bne   :
@@ -142,11 +476,46 @@ class Decoder {
 
     case instr_sb    :
     case instr_sh    :
-    case instr_sw    : return s;
+    case instr_sw    :
+    case instr_sd    :
+    case instr_fsw   :
+    case instr_fsd   : return s;
+
+    case instr_fmadd_s :
+    case instr_fmsub_s :
+    case instr_fnmsub_s:
+    case instr_fnmadd_s:
+    case instr_fmadd_d :
+    case instr_fmsub_d :
+    case instr_fnmsub_d:
+    case instr_fnmadd_d: return r4;
+
 
     case instr_slli  :
     case instr_srli  :
-    case instr_srai  : return i_sh5;
+    case instr_srai  :
+    case instr_rori  :
+    case instr_bclri :
+    case instr_bexti :
+    case instr_binvi :
+    case instr_bseti :
+    case instr_slliw :
+    case instr_srliw :
+    case instr_sraiw :
+    case instr_slli_uw:
+    case instr_roriw : return i_sh5;
+
+    case instr_clz   :
+    case instr_ctz   :
+    case instr_cpop  :
+    case instr_sext_b:
+    case instr_sext_h:
+    case instr_zext_h:
+    case instr_orc_b :
+    case instr_rev8  :
+    case instr_clzw  :
+    case instr_ctzw  :
+    case instr_cpopw : return unary;
 
     case instr_add   :
     case instr_sub   :
@@ -157,10 +526,231 @@ class Decoder {
     case instr_srl   :
     case instr_sra   :
     case instr_or    :
-    case instr_and   : return r;
+    case instr_and   :
+    case instr_mul   :
+    case instr_mulh  :
+    case instr_mulhsu:
+    case instr_mulhu :
+    case instr_div   :
+    case instr_divu  :
+    case instr_rem   :
+    case instr_remu  :
+    case instr_sh1add:
+    case instr_sh2add:
+    case instr_sh3add:
+    case instr_andn  :
+    case instr_orn   :
+    case instr_xnor  :
+    case instr_max   :
+    case instr_maxu  :
+    case instr_min   :
+    case instr_minu  :
+    case instr_rol   :
+    case instr_ror   :
+    case instr_bclr  :
+    case instr_bext  :
+    case instr_binv  :
+    case instr_bset  :
+    case instr_addw  :
+    case instr_subw  :
+    case instr_sllw  :
+    case instr_srlw  :
+    case instr_sraw  :
+    case instr_mulw  :
+    case instr_divw  :
+    case instr_divuw :
+    case instr_remw  :
+    case instr_remuw :
+    case instr_add_uw:
+    case instr_sh1add_uw:
+    case instr_sh2add_uw:
+    case instr_sh3add_uw:
+    case instr_rolw  :
+    case instr_rorw  :
+    case instr_vsetvl:
+    case instr_lr_w     :
+    case instr_sc_w     :
+    case instr_amoswap_w:
+    case instr_amoadd_w :
+    case instr_amoxor_w :
+    case instr_amoand_w :
+    case instr_amoor_w  :
+    case instr_amomin_w :
+    case instr_amomax_w :
+    case instr_amominu_w:
+    case instr_amomaxu_w:
+    case instr_lr_d     :
+    case instr_sc_d     :
+    case instr_amoswap_d:
+    case instr_amoadd_d :
+    case instr_amoxor_d :
+    case instr_amoand_d :
+    case instr_amoor_d  :
+    case instr_amomin_d :
+    case instr_amomax_d :
+    case instr_amominu_d:
+    case instr_amomaxu_d: return r;
+
+    case instr_fadd_s  :
+    case instr_fsub_s  :
+    case instr_fmul_s  :
+    case instr_fdiv_s  :
+    case instr_fsqrt_s :
+    case instr_fsgnj_s :
+    case instr_fsgnjn_s:
+    case instr_fsgnjx_s:
+    case instr_fmin_s  :
+    case instr_fmax_s  :
+    case instr_fcvt_w_s:
+    case instr_fcvt_wu_s:
+    case instr_fmv_x_w :
+    case instr_feq_s   :
+    case instr_flt_s   :
+    case instr_fle_s   :
+    case instr_fclass_s:
+    case instr_fcvt_s_w:
+    case instr_fcvt_s_wu:
+    case instr_fmv_w_x :
+    case instr_fcvt_l_s:
+    case instr_fcvt_lu_s:
+    case instr_fcvt_s_l:
+    case instr_fcvt_s_lu:
+    case instr_fadd_d  :
+    case instr_fsub_d  :
+    case instr_fmul_d  :
+    case instr_fdiv_d  :
+    case instr_fsqrt_d :
+    case instr_fsgnj_d :
+    case instr_fsgnjn_d:
+    case instr_fsgnjx_d:
+    case instr_fmin_d  :
+    case instr_fmax_d  :
+    case instr_fcvt_s_d:
+    case instr_fcvt_d_s:
+    case instr_feq_d   :
+    case instr_flt_d   :
+    case instr_fle_d   :
+    case instr_fclass_d:
+    case instr_fcvt_w_d:
+    case instr_fcvt_wu_d:
+    case instr_fcvt_d_w:
+    case instr_fcvt_d_wu:
+    case instr_fcvt_l_d:
+    case instr_fcvt_lu_d:
+    case instr_fmv_x_d :
+    case instr_fcvt_d_l:
+    case instr_fcvt_d_lu:
+    case instr_fmv_d_x : return r_fp;
+
+    case instr_vadd_vv    :
+    case instr_vadd_vx    :
+    case instr_vadd_vi    :
+    case instr_vsub_vv    :
+    case instr_vsub_vx    :
+    case instr_vrsub_vx   :
+    case instr_vrsub_vi   :
+    case instr_vminu_vv   :
+    case instr_vminu_vx   :
+    case instr_vmin_vv    :
+    case instr_vmin_vx    :
+    case instr_vmaxu_vv   :
+    case instr_vmaxu_vx   :
+    case instr_vmax_vv    :
+    case instr_vmax_vx    :
+    case instr_vand_vv    :
+    case instr_vand_vx    :
+    case instr_vand_vi    :
+    case instr_vor_vv     :
+    case instr_vor_vx     :
+    case instr_vor_vi     :
+    case instr_vxor_vv    :
+    case instr_vxor_vx    :
+    case instr_vxor_vi    :
+    case instr_vsll_vv    :
+    case instr_vsll_vx    :
+    case instr_vsrl_vv    :
+    case instr_vsrl_vx    :
+    case instr_vsra_vv    :
+    case instr_vsra_vx    :
+    case instr_vmul_vv    :
+    case instr_vmul_vx    :
+    case instr_vmulh_vv   :
+    case instr_vmulh_vx   :
+    case instr_vmulhu_vv  :
+    case instr_vmulhu_vx  :
+    case instr_vmulhsu_vv :
+    case instr_vmulhsu_vx :
+    case instr_vmerge_vvm :
+    case instr_vmerge_vxm :
+    case instr_vmerge_vim :
+    case instr_vmv_v_v    :
+    case instr_vmv_v_x    :
+    case instr_vmv_v_i    :
+    case instr_vmseq_vv   :
+    case instr_vmseq_vx   :
+    case instr_vmseq_vi   :
+    case instr_vmsne_vv   :
+    case instr_vmsne_vx   :
+    case instr_vmsne_vi   :
+    case instr_vmsltu_vv  :
+    case instr_vmsltu_vx  :
+    case instr_vmslt_vv   :
+    case instr_vmslt_vx   :
+    case instr_vmsleu_vv  :
+    case instr_vmsleu_vx  :
+    case instr_vmsleu_vi  :
+    case instr_vmsle_vv   :
+    case instr_vmsle_vx   :
+    case instr_vmsle_vi   :
+    case instr_vmsgtu_vx  :
+    case instr_vmsgtu_vi  :
+    case instr_vmsgt_vx   :
+    case instr_vmsgt_vi   :
+    case instr_vredsum_vs :
+    case instr_vredand_vs :
+    case instr_vredor_vs  :
+    case instr_vredxor_vs :
+    case instr_vredminu_vs:
+    case instr_vredmin_vs :
+    case instr_vredmaxu_vs:
+    case instr_vredmax_vs :
+    case instr_vmv_x_s    :
+    case instr_vmv_s_x    : return v;
+
+    case instr_vsll_vi:
+    case instr_vsrl_vi:
+    case instr_vsra_vi: return v_uimm;
+
+    case instr_vle8_v  :
+    case instr_vle16_v :
+    case instr_vle32_v :
+    case instr_vle64_v :
+    case instr_vlse8_v :
+    case instr_vlse16_v:
+    case instr_vlse32_v:
+    case instr_vlse64_v: return v_load;
+
+    case instr_vse8_v  :
+    case instr_vse16_v :
+    case instr_vse32_v :
+    case instr_vse64_v :
+    case instr_vsse8_v :
+    case instr_vsse16_v:
+    case instr_vsse32_v:
+    case instr_vsse64_v: return v_store;
+
+    case instr_vsetvli :
+    case instr_vsetivli: return v_cfg;
+
+    case instr_ecall :
+    case instr_ebreak:
+    case instr_mret  :
+    case instr_wfi   :
+    case instr_sret  :
+    case instr_debug_break: return none;
 
-    case instr_fence :
-    case instr_mret  : return none;
+    // The virtual address in rs1 and the ASID in rs2.
+    case instr_sfence_vma: return r;
   }
 
   assert((void("Unknown instruction" + std::to_string(instruction)),0));
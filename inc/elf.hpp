@@ -0,0 +1,48 @@
+#pragma once
+
+#include "memory.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// A statically linked RISC-V executable, ELF32 or ELF64 and little-endian: its loadable
+// segments, its entry point and the symbols of its symbol table, e.g. `tohost`.
+// Throws Errors::Error on anything else and on a truncated file.
+class Elf {
+  public:
+    struct Segment {
+      // Physical, as bare-metal programs are loaded.
+      std::uint64_t addr{0};
+      std::vector<std::byte> content{};
+      // The size in memory, the rest past the content being zeros.
+      std::uint64_t mem_size{0};
+    };
+
+    explicit Elf(std::span<const std::byte> file);
+    [[nodiscard]] static Elf from_file(const std::string &path);
+
+    // 32 or 64.
+    [[nodiscard]] unsigned int get_xlen() const { return m_xlen; }
+    [[nodiscard]] std::uint64_t get_entry() const { return m_entry; }
+    [[nodiscard]] const std::vector<Segment>& get_segments() const { return m_segments; }
+    [[nodiscard]] std::optional<std::uint64_t> find_symbol(std::string_view name) const;
+
+    // Writes the segments to `memory`, at their address less `base`.
+    template <unsigned int xlen>
+    void load(Basic_memory<xlen> &memory, std::uint64_t base = 0) const;
+
+  private:
+    unsigned int m_xlen{0};
+    std::uint64_t m_entry{0};
+    std::vector<Segment> m_segments{};
+    std::unordered_map<std::string, std::uint64_t> m_symbols{};
+
+    template <typename Header>
+    void parse(std::span<const std::byte> file);
+};
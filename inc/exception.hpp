@@ -29,6 +29,27 @@ namespace Errors {
         : Error("Write to read only memory : " + message) {}
   };
 
+  // Raised by address translation and by physical memory protection, and taken by the core
+  // as a trap, with `m_cause` as mcause/scause and the faulting virtual address as
+  // mtval/stval.
+  struct Memory_fault : public Error {
+    using Addr = std::size_t;
+    Addr m_addr{};
+    unsigned int m_cause{};
+
+    Memory_fault(const std::string &kind, Addr addr, unsigned int cause)
+        : Error(kind + ". Addr:" + std::to_string(addr) + ", cause: " + std::to_string(cause)),
+          m_addr{addr}, m_cause{cause} {}
+  };
+
+  struct Page_fault : public Memory_fault {
+    Page_fault(Addr addr, unsigned int cause) : Memory_fault("Page fault", addr, cause) {}
+  };
+
+  struct Access_fault : public Memory_fault {
+    Access_fault(Addr addr, unsigned int cause) : Memory_fault("Access fault", addr, cause) {}
+  };
+
   struct Misalignment : public Error {
     using Addr = std::size_t;
     Addr m_addr{};
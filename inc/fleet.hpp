@@ -0,0 +1,95 @@
+#pragma once
+
+#include "image_cache.hpp"
+#include "isa_extension.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace spdlog {
+  class logger;
+}
+
+// A guest program, loaded at the page-aligned `base` of a ram of `ram_size` bytes. The
+// image comes from the Image_cache, so jobs running the same program share its pages:
+// they fetch their instructions straight from it and copy only the pages they write.
+struct Fleet_image {
+  std::shared_ptr<const Image> image{};
+  std::size_t base{0};
+  std::size_t ram_size{0};
+};
+
+struct Fleet_job {
+  Fleet_image image{};
+  std::uint64_t entry{0};
+  // Instructions; a job still running after them has timed out.
+  std::uint64_t budget{0};
+  // Compared with the exit code if set.
+  std::optional<std::uint64_t> expected_exit{};
+};
+
+struct Fleet_result {
+  enum class Status {
+    passed   ,
+    failed   ,
+    timed_out,
+    error    ,
+  };
+
+  Status status{Status::error};
+  // a0 of the halted guest.
+  std::uint64_t exit{0};
+  std::uint64_t instructions{0};
+  // The pages of the image and ram the job wrote, i.e. didn't share.
+  std::size_t private_pages{0};
+  // The exception of an errored job.
+  std::string message{};
+};
+
+struct Fleet_report {
+  // In the order of the jobs.
+  std::vector<Fleet_result> results{};
+  std::size_t passed   {0};
+  std::size_t failed   {0};
+  std::size_t timed_out{0};
+  std::size_t errors   {0};
+  std::uint64_t instructions{0};
+  double seconds{0};
+
+  [[nodiscard]] double get_instructions_per_second() const {
+    return (seconds > 0) ? static_cast<double>(instructions) / seconds : 0;
+  }
+};
+
+// Runs independent guest programs, each on a core of its own with its own registers, csrs
+// and ram, on a pool of host threads. The jobs are dealt out to per-thread queues; a thread
+// takes from the back of its own queue and, once that is empty, steals from the front of
+// the others, so a few long jobs don't leave the other threads idle.
+//
+// Without devices nothing can wake a waiting core, so a guest exits by halting: wfi, a jump
+// to itself or an idle loop, with its exit code in a0. The logger must be thread-safe.
+template <unsigned int xlen>
+class Basic_fleet {
+  public:
+    // `threads` of 0 picks the number of host threads.
+    Basic_fleet(std::shared_ptr<spdlog::logger> logger, Isa_ext_container isa_ext_container = {},
+        std::size_t threads = 0);
+
+    [[nodiscard]] std::size_t get_threads() const { return m_threads; }
+
+    [[nodiscard]] Fleet_report run(const std::vector<Fleet_job> &jobs) const;
+
+  private:
+    std::shared_ptr<spdlog::logger> m_logger;
+    const Isa_ext_container m_isa_ext_container;
+    const std::size_t m_threads;
+
+    [[nodiscard]] Fleet_result run_job(const Fleet_job &job) const;
+};
+
+using Fleet   = Basic_fleet<32>;
+using Fleet64 = Basic_fleet<64>;
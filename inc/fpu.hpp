@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+
+// F and D arithmetic on the host FPU. Registers are FLEN = 64 bits wide and hold single
+// precision values NaN-boxed: a value whose upper half isn't all ones reads as the
+// canonical NaN.
+//
+// Operations run in the host rounding mode, which `set_rounding_mode` switches only when
+// it changes. The exception flags accrue in the host FPU as a side effect of the
+// arithmetic and are collected by `take_flags` when the guest reads fflags, so executing
+// an instruction never touches the flags.
+namespace Fpu {
+  using Reg = std::uint64_t;
+
+  enum class Format {
+    s,
+    d,
+  };
+
+  enum Rounding_mode : unsigned int {
+    RNE = 0b000,
+    RTZ = 0b001,
+    RDN = 0b010,
+    RUP = 0b011,
+    RMM = 0b100,
+    // In the rm field only: use frm.
+    DYN = 0b111,
+  };
+
+  // fflags bits.
+  enum Flag : unsigned int {
+    NX = 1 << 0,
+    UF = 1 << 1,
+    OF = 1 << 2,
+    DZ = 1 << 3,
+    NV = 1 << 4,
+  };
+
+  enum Op {
+    // Floating-point result.
+    ADD  ,
+    SUB  ,
+    MUL  ,
+    DIV  ,
+    SQRT ,
+    SGNJ ,
+    SGNJN,
+    SGNJX,
+    MIN  ,
+    MAX  ,
+    MADD ,
+    MSUB ,
+    NMSUB,
+    NMADD,
+    // From the other format.
+    CVT_F,
+    // Integer result, sign-extended to 64 bits.
+    EQ    ,
+    LT    ,
+    LE    ,
+    CLASS ,
+    CVT_W ,
+    CVT_WU,
+    CVT_L ,
+    CVT_LU,
+    MV_X  ,
+    // From an integer.
+    CVT_FROM_W ,
+    CVT_FROM_WU,
+    CVT_FROM_L ,
+    CVT_FROM_LU,
+    MV_F       ,
+  };
+
+  [[nodiscard("PURE FUN")]] constexpr bool is_valid(Rounding_mode rm) { return rm <= RMM; }
+  // Whether the result depends on the rounding mode. Others ignore the rm field.
+  [[nodiscard("PURE FUN")]] bool is_rounded(Op op, Format format);
+
+  // `rm` must be valid. RMM has no host equivalent and rounds to nearest even, except in
+  // conversions to integers.
+  void set_rounding_mode(Rounding_mode rm);
+  // Flags accrued since the last call, cleared in the host FPU.
+  [[nodiscard]] unsigned int take_flags();
+
+  [[nodiscard]] Reg calc(Op op, Format format, Reg a, Reg b = 0, Reg c = 0);
+  // `rm` is the resolved rounding mode, needed by conversions.
+  [[nodiscard]] std::uint64_t to_integer(Op op, Format format, Reg a, Reg b, Rounding_mode rm);
+  [[nodiscard]] Reg from_integer(Op op, Format format, std::uint64_t a);
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "core.hpp"
+#include "history.hpp"
+#include "memory.hpp"
+#include "scheduler.hpp"
+#include "watchpoints.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+
+// Server of the GDB remote serial protocol for a core, over a connected socket, e.g. of
+// `accept_tcp` for `target remote :port` or of `accept_unix`.
+//
+// Registers are x0-x31 and pc, the F and D registers as 33-64 and the csrs from 65 on, as
+// gdb numbers them for RISC-V. Memory is accessed through `memory`, which should be the
+// one under any Watch_mem_wrap or Mmu so that the debugger doesn't hit its own
+// watchpoints. Software and hardware breakpoints are both breakpoints of the core, which
+// live in its decode cache. Watchpoints need the Watchpoints of the Mmu or Watch_mem_wrap
+// the core loads and stores through.
+//
+// With a History, the debugger can step and continue backwards, and writes to registers or
+// memory drop the history after them.
+//
+// The core runs in slices of `poll_interval` instructions of virtual time, and between
+// them the stub looks for an interrupt of the debugger. Csrs written by the debugger take
+// effect on the core's cached state, e.g. the enabled interrupts, at its next csr
+// instruction or trap.
+template <unsigned int xlen>
+class Basic_gdb_stub {
+  public:
+    using Data = Uxlen_t<xlen>;
+
+    static constexpr Scheduler::Time poll_interval{100'000};
+
+    // Takes over `fd`.
+    Basic_gdb_stub(int fd, Basic_core<xlen> &core, Basic_memory<xlen> &rf,
+        Basic_memory<xlen> &csr, Basic_memory<xlen> &memory, Scheduler &scheduler,
+        Basic_watchpoints<xlen> *watchpoints = nullptr, Basic_history<xlen> *history = nullptr);
+    Basic_gdb_stub(const Basic_gdb_stub&) = delete;
+    Basic_gdb_stub& operator=(const Basic_gdb_stub&) = delete;
+    ~Basic_gdb_stub();
+
+    // Listen on localhost or at a path and return the socket of the first connection.
+    // Throw Errors::Error if they can't.
+    [[nodiscard]] static int accept_tcp(std::uint16_t port);
+    [[nodiscard]] static int accept_unix(const std::string &path);
+
+    // Serves the debugger until it detaches or kills the guest or the connection is closed.
+    // Breakpoints and watchpoints are removed on the way out.
+    void serve();
+
+  private:
+    static constexpr std::size_t fp_first{33};
+    static constexpr std::size_t csr_first{65};
+    static constexpr std::size_t packet_size{0x4000};
+
+    const int m_fd;
+    Basic_core<xlen> &m_core;
+    Basic_memory<xlen> &m_rf;
+    Basic_memory<xlen> &m_csr;
+    Basic_memory<xlen> &m_memory;
+    Scheduler &m_scheduler;
+    Basic_watchpoints<xlen> *const m_watchpoints;
+    Basic_history<xlen> *const m_history;
+
+    // Bytes received but not handled yet.
+    std::string m_input{};
+    bool m_no_ack{false};
+    std::set<Data> m_breakpoints{};
+    std::optional<typename Basic_watchpoints<xlen>::Hit> m_watch_hit{};
+    std::string m_stop_reply{"S05"};
+
+    // Without the framing. Empty once the connection is closed.
+    [[nodiscard]] std::optional<std::string> receive_packet();
+    void send_packet(std::string_view data);
+    // Reads what is there without blocking unless `block`. Returns false once the
+    // connection is closed.
+    bool receive(bool block);
+    // Whether the debugger sent an interrupt, i.e. ctrl-c, while the core was running.
+    [[nodiscard]] bool is_interrupted();
+
+    // Returns false once the session is over.
+    bool handle(std::string_view packet);
+    [[nodiscard]] std::string handle_query(std::string_view packet) const;
+    [[nodiscard]] std::string handle_point(std::string_view packet);
+    // Continues or single-steps, from `addr` if given. Returns the stop reply.
+    [[nodiscard]] std::string resume(std::string_view addr, bool single_step);
+    [[nodiscard]] std::string resume_back(bool single_step);
+    [[nodiscard]] std::string get_stop_reply() const;
+
+    [[nodiscard]] std::optional<std::string> read_register(std::size_t reg);
+    bool write_register(std::size_t reg, std::string_view hex);
+    [[nodiscard]] std::string read_memory(std::string_view args);
+    [[nodiscard]] std::string write_memory(std::string_view args);
+    [[nodiscard]] static std::string get_target_xml();
+    // Bytes of a csr on the wire, as the target description declares it.
+    [[nodiscard("PURE FUN")]] static std::size_t get_csr_size(std::size_t csr);
+    void remove_points();
+};
+
+using Gdb_stub   = Basic_gdb_stub<32>;
+using Gdb_stub64 = Basic_gdb_stub<64>;
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "core.hpp"
+#include "csr.hpp"
+#include "ram.hpp"
+#include "rf.hpp"
+#include "scheduler.hpp"
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <vector>
+
+// Execution history of a core for reverse debugging: snapshots taken as it runs and, to go
+// back, the latest snapshot before the target restored and run forward to it. Execution is
+// deterministic in virtual time, so the replay repeats the run exactly.
+//
+// A snapshot holds the state of the core, its rf and csrs, the virtual time and the pages
+// of the RAM, each shared with the snapshot before when it didn't change since. When they
+// take more than `max_bytes`, every other snapshot is dropped and the spacing doubles, so
+// going back never replays more than a few spacings, however long the run.
+//
+// Devices aren't part of the snapshots. Events of the scheduler that ran before a rewind
+// don't run again in the replay, so only a machine whose devices don't change what the core
+// sees in between, or whose inputs come from a Replay_log, replays the same. The debugger's
+// breakpoints stay active in a replay.
+template <unsigned int xlen>
+class Basic_history {
+  public:
+    using Time = Scheduler::Time;
+    using Data = Uxlen_t<xlen>;
+
+    static constexpr std::size_t page_size{4096};
+
+    struct Config {
+      // Of the first snapshots.
+      Time interval{10'000'000};
+      std::size_t max_bytes{std::size_t{1} << 30};
+    };
+
+    // Takes the first snapshot, the beginning of the history.
+    Basic_history(Basic_core<xlen> &core, Basic_rf<xlen> &rf, Basic_csr<xlen> &csr,
+        Basic_ram<xlen> &ram, Scheduler &scheduler, const Config &config);
+    Basic_history(Basic_core<xlen> &core, Basic_rf<xlen> &rf, Basic_csr<xlen> &csr,
+        Basic_ram<xlen> &ram, Scheduler &scheduler)
+        : Basic_history(core, rf, csr, ram, scheduler, Config{}) {}
+    Basic_history(const Basic_history&) = delete;
+    Basic_history& operator=(const Basic_history&) = delete;
+    ~Basic_history();
+
+    // Goes to `time`, back or forward, or to the beginning if it's earlier.
+    void rewind_to(Time time);
+    // Go back one unit of virtual time, or to the last time the core stopped, e.g. at a
+    // breakpoint. Return false if they got to the beginning instead.
+    bool step_back();
+    bool continue_back();
+    // Drops the snapshots after now, once the debugger changed the state of the past.
+    void forget_future();
+
+    [[nodiscard]] Time get_begin() const { return m_snapshots.front().time; }
+    [[nodiscard]] std::size_t get_snapshots() const { return m_snapshots.size(); }
+    [[nodiscard]] Time get_interval() const { return m_interval; }
+    // Pages held by the snapshots.
+    [[nodiscard]] std::size_t get_bytes() const { return m_bytes; }
+
+  private:
+    using Page = std::array<std::byte, page_size>;
+
+    struct Snapshot {
+      Time time{0};
+      typename Basic_core<xlen>::State core{};
+      typename Basic_rf<xlen>::Container rf{};
+      typename Basic_csr<xlen>::State csr{};
+      std::vector<std::shared_ptr<const Page>> pages{};
+    };
+
+    Basic_core<xlen> &m_core;
+    Basic_rf<xlen> &m_rf;
+    Basic_csr<xlen> &m_csr;
+    Basic_ram<xlen> &m_ram;
+    Scheduler &m_scheduler;
+    const std::size_t m_max_bytes;
+    Time m_interval;
+    // By time.
+    std::vector<Snapshot> m_snapshots{};
+    std::size_t m_bytes{0};
+    std::optional<Scheduler::Event_id> m_event{};
+
+    void take_snapshot();
+    void schedule_snapshot();
+    // Drops every other snapshot but the first and the last one.
+    void thin_out();
+    void release(const Snapshot &snapshot);
+    // The latest snapshot at `time` or before, else the first one.
+    [[nodiscard]] const Snapshot& find(Time time) const;
+    // Restores it and returns its time.
+    Time restore(Time time);
+    // Runs until `time`, stepping over the places the core stops at, e.g. breakpoints. Returns
+    // the time of the last of them.
+    std::optional<Time> run_to(Time time);
+};
+
+using History   = Basic_history<32>;
+using History64 = Basic_history<64>;
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Console output of a guest to a host file descriptor, collected and written in large
+// chunks rather than with a write(2) per character. It's written out once the buffer fills
+// up, on `flush` and on destruction, so a guest exiting flushes it before the host reports
+// the exit.
+class Host_output {
+  public:
+    explicit Host_output(int fd, std::size_t capacity = 4096);
+    Host_output(const Host_output&) = delete;
+    Host_output& operator=(const Host_output&) = delete;
+    ~Host_output();
+
+    void write(std::span<const std::byte> data);
+    void write(std::string_view text) { write(std::as_bytes(std::span{text})); }
+    void flush();
+
+    [[nodiscard]] int get_fd() const { return m_fd; }
+    // Calls of write(2) so far.
+    [[nodiscard]] std::uint64_t get_host_writes() const { return m_host_writes; }
+
+  private:
+    const int m_fd;
+    std::vector<std::byte> m_buffer{};
+    std::uint64_t m_host_writes{0};
+};
+
+// Console output written by a host thread of its own, so the guest only waits for the host
+// when the ring between them is full. The guest thread is the single producer and the
+// writer the single consumer of the ring, which needs no lock. The writer is woken at a
+// newline, when the ring is half full and on `flush`, and otherwise drains it every
+// `interval`.
+class Async_host_output {
+  public:
+    // `capacity` is rounded up to a power of 2.
+    explicit Async_host_output(int fd, std::size_t capacity = 1 << 16,
+        std::chrono::milliseconds interval = std::chrono::milliseconds{10});
+    Async_host_output(const Async_host_output&) = delete;
+    Async_host_output& operator=(const Async_host_output&) = delete;
+    // Writes what is left.
+    ~Async_host_output();
+
+    void write(std::span<const std::byte> data);
+    void write(std::string_view text) { write(std::as_bytes(std::span{text})); }
+    // Returns once everything written so far reached the host.
+    void flush();
+
+    // Calls of write(2) so far.
+    [[nodiscard]] std::uint64_t get_host_writes() const { return m_host_writes; }
+
+  private:
+    const int m_fd;
+    const std::chrono::milliseconds m_interval;
+    std::vector<std::byte> m_ring;
+    // Bytes consumed and produced since the start; the ring holds the difference.
+    std::atomic<std::size_t> m_head{0};
+    std::atomic<std::size_t> m_tail{0};
+    std::atomic<std::uint64_t> m_host_writes{0};
+    std::mutex m_mutex{};
+    std::condition_variable m_wake_up{};
+    std::condition_variable m_drained{};
+    bool m_wake_requested{false};
+    bool m_stop{false};
+    std::thread m_writer;
+
+    void wake();
+    void run();
+    void drain();
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "elf.hpp"
+#include "host_output.hpp"
+#include "memory.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+// The host-target interface of Spike and the riscv-tests: the guest writes commands to the
+// 64-bit `tohost` and gets answers in `fromhost`, two words in its memory found through the
+// symbols of those names. Wraps the memory the core accesses them through, keeping both
+// registers itself and passing every other access on.
+//
+// A command is device << 56 | command << 48 | payload:
+// - device 0 with an odd payload exits with payload >> 1 as the exit code, 0 for a pass.
+// - device 0 with an even payload points to the 8 doublewords of a proxied system call: the
+//   number and the arguments, with the result replacing the number. Only write and exit.
+// - device 1, command 1 prints the low byte of the payload.
+// The command runs once the high word of tohost is written, so RV32 guests write the low
+// word first, as the riscv-tests do.
+template <unsigned int xlen>
+class Basic_htif : public Basic_memory<xlen> {
+  public:
+    using Data = Uxlen_t<xlen>;
+    using Basic_memory<xlen>::full_byte_en;
+    // Given the exit code, e.g. to halt the core so the run stops right away.
+    using Exit_handler = std::function<void(std::uint64_t)>;
+
+    enum Syscall : std::uint64_t {
+      SYS_WRITE = 64,
+      SYS_EXIT  = 93,
+    };
+
+    Basic_htif(Basic_memory<xlen> &memory, std::size_t tohost,
+        std::optional<std::size_t> fromhost, Host_output &out, Host_output &err);
+    // At the symbols of the program, fromhost being optional. Throws Errors::Error without
+    // tohost.
+    Basic_htif(Basic_memory<xlen> &memory, const Elf &elf, Host_output &out, Host_output &err);
+
+    void set_exit_handler(Exit_handler handler) { m_exit_handler = std::move(handler); }
+    // Set once the guest exited.
+    [[nodiscard]] std::optional<std::uint64_t> get_exit_code() const { return m_exit_code; }
+
+    void write(std::size_t addr, Data data, unsigned int byte_en = full_byte_en) override;
+    [[nodiscard]] Data read(std::size_t addr, unsigned int byte_en = full_byte_en) override;
+    // None for ranges holding a register, whose accesses have to reach the device.
+    [[nodiscard]] std::byte* get_host_ptr(std::size_t addr, std::size_t size) override;
+
+  private:
+    static constexpr std::size_t reg_size{8};
+
+    Basic_memory<xlen> &m_memory;
+    const std::size_t m_tohost;
+    const std::optional<std::size_t> m_fromhost;
+    Host_output &m_out;
+    Host_output &m_err;
+    std::uint64_t m_tohost_value{0};
+    std::uint64_t m_fromhost_value{0};
+    Exit_handler m_exit_handler{};
+    std::optional<std::uint64_t> m_exit_code{};
+
+    [[nodiscard("PURE FUN")]] static bool is_in(std::size_t addr, std::optional<std::size_t> reg) {
+      return reg && (addr >= *reg) && (addr - *reg < reg_size);
+    }
+    void run(std::uint64_t command);
+    [[nodiscard]] std::int64_t syscall(std::uint64_t number, std::uint64_t fd,
+        std::uint64_t buf, std::uint64_t len);
+    void exit(std::uint64_t code);
+};
+
+using Htif   = Basic_htif<32>;
+using Htif64 = Basic_htif<64>;
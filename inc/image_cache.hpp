@@ -0,0 +1,65 @@
+#pragma once
+
+#include "riscv.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// The contents of a guest program, padded with zeros to whole pages. It is never written
+// after construction, so any number of memories and threads may read it at once.
+class Image {
+  public:
+    static constexpr std::size_t page_size{4096};
+
+    Image(std::span<const std::byte> content, std::uint64_t hash);
+
+    [[nodiscard]] std::size_t size() const { return m_size; }
+    [[nodiscard]] std::uint64_t get_hash() const { return m_hash; }
+    [[nodiscard]] std::size_t get_pages() const { return m_pages.size() / page_size; }
+    [[nodiscard]] const std::byte* get_page(std::size_t page) const {
+      return m_pages.data() + page * page_size;
+    }
+    [[nodiscard]] std::span<const std::byte> get_content() const {
+      return {m_pages.data(), m_size};
+    }
+
+    // Instruction fetch, by word index; the bytes past the end of the content read as zero.
+    // Throws std::out_of_range for words that start outside of it, as Instr_mem expects.
+    [[nodiscard]] Uxlen at(std::size_t word) const;
+
+  private:
+    std::vector<std::byte> m_pages;
+    std::size_t m_size;
+    std::uint64_t m_hash;
+};
+
+// Process-wide cache of images by content hash, so that emulators loading the same program
+// share one copy of it. The cache doesn't own the images: an image lives as long as a
+// returned pointer to it, and a later `intern` of the same content after that loads it
+// again.
+class Image_cache {
+  public:
+    [[nodiscard]] static Image_cache& get_instance();
+
+    // The cached image with this content, or a new one.
+    [[nodiscard]] std::shared_ptr<const Image> intern(std::span<const std::byte> content);
+    // Images still in use.
+    [[nodiscard]] std::size_t get_images();
+
+    // 64-bit FNV-1a.
+    [[nodiscard("PURE FUN")]] static std::uint64_t hash(std::span<const std::byte> content);
+
+  private:
+    Image_cache() = default;
+
+    std::mutex m_mutex{};
+    // Colliding hashes share a key, so their contents are compared too.
+    std::unordered_multimap<std::uint64_t, std::weak_ptr<const Image>> m_images{};
+
+    void erase_expired();
+};
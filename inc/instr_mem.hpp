@@ -23,11 +23,18 @@ class Instr_mem : public Memory {
       throw Errors::Read_only{"Write into instr_mem"};
     }
 
+    // `addr` selects a word and `byte_en` its lanes; the disabled lanes read as zero.
+    // Compressed instructions need halfword access.
     [[nodiscard]] Uxlen read (std::size_t addr, unsigned int byte_en = 0xf) override {
-      assert((byte_en == 0xf) && "only word access is supported");
+      assert(((byte_en == 0xf) || (byte_en == 0b0011) || (byte_en == 0b1100)) &&
+          "only word and halfword access is supported");
       assert(!(addr & 0b11) && "only alignment by word is supported");
       const std::size_t word_addr{addr >> 2};
-      return try_get(word_addr);
+      switch (byte_en) {
+        case 0b0011: return try_get(word_addr) & 0x0000ffff;
+        case 0b1100: return try_get(word_addr) & 0xffff0000;
+        default    : return try_get(word_addr);
+      }
     }
 
     [[nodiscard]] const Container& get_content() const {
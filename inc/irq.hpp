@@ -0,0 +1,63 @@
+#pragma once
+
+#include "riscv.hpp"
+
+#include <atomic>
+
+namespace Irq {
+  // Bit positions in mip/mie.
+  enum Cause : unsigned int {
+    SSI = 1,
+    MSI = 3,
+    STI = 5,
+    MTI = 7,
+    SEI = 9,
+    MEI = 11,
+  };
+
+  [[nodiscard("PURE FUN")]] constexpr Uxlen to_mask(Cause cause) {
+    return Uxlen{1} << cause;
+  }
+}
+
+// The hardware-driven part of mip. Interrupt controllers raise and lower their lines here,
+// `Csr` reflects it in mip and `Core` only has to test this word for being non-zero.
+//
+// Lines may be raised and lowered from any host thread. Every update is a single atomic
+// read-modify-write, so device threads never block the core.
+class Irq_pending {
+  public:
+    Irq_pending() = default;
+    ~Irq_pending();
+    Irq_pending(const Irq_pending&) = delete;
+    Irq_pending& operator=(const Irq_pending&) = delete;
+
+    void raise(Irq::Cause cause);
+    void lower(Irq::Cause cause) {
+      m_pending.fetch_and(~Irq::to_mask(cause));
+      m_pending.notify_all();
+    }
+    void set(Irq::Cause cause, bool value) {
+      if (value) raise(cause);
+      else       lower(cause);
+    }
+
+    // Acquire pairs with the updates, so that whatever a device thread published before
+    // raising a line is visible to the trap handler.
+    [[nodiscard]] Uxlen get(std::memory_order order = std::memory_order_acquire) const {
+      return m_pending.load(order);
+    }
+    // Cheap check for the execution loop.
+    [[nodiscard]] bool any() const { return get(std::memory_order_relaxed) != 0; }
+
+    // Returns an eventfd that becomes readable whenever a line goes from low to high, so an
+    // idle core can sleep in poll/epoll together with other host events. Must be called
+    // before the pending word is shared between threads.
+    [[nodiscard]] int enable_wakeup_fd();
+    // Blocks on a futex until the word differs from `old`.
+    void wait(Uxlen old) const { m_pending.wait(old, std::memory_order_acquire); }
+
+  private:
+    std::atomic<Uxlen> m_pending{0};
+    int m_wakeup_fd{-1};
+};
@@ -6,6 +6,21 @@
 
 enum class Isa_extension {
   isa_zicsr,
+  isa_m,
+  isa_a,
+  isa_c,
+  isa_zba,
+  isa_zbb,
+  isa_zbs,
+  isa_f,
+  // Requires F.
+  isa_d,
+  // Integer subset of V, with VLEN = 128.
+  isa_v,
+  // Requires V. VLEN is 256 instead of 128.
+  isa_zvl256b,
+  // Supervisor and user modes, with sret and sfence.vma. Sv32 translation takes an Mmu.
+  isa_s,
   isa_number_
 };
 
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "memory.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+// User-mode emulation of Linux, like qemu-user: the ecall handler of a core running a
+// statically linked program, which forwards its system calls to the host. The guest passes
+// the number in a7 and the arguments in a0-a5 and gets the result, or -errno, in a0.
+//
+// Guest pointers are addresses in `memory`. Buffers of read and write are handed to the
+// host straight where the memory is plain host memory, so large transfers aren't copied;
+// elsewhere they go through a bounce buffer. Guest file descriptors map to host ones, and
+// 0-2 to the `stdio` descriptors, which the guest never closes on the host.
+//
+// Anonymous and private file mappings are carved out of the memory below `mmap_top`, down
+// towards the program break, and are never reused.
+template <unsigned int xlen>
+class Basic_linux_syscalls {
+  public:
+    using Data    = Uxlen_t<xlen>;
+    using Xmemory = Basic_memory<xlen>;
+
+    // The generic numbers, shared by RV32 and RV64. RV32 only has the 64-bit time calls.
+    enum Number : Data {
+      OPENAT          = 56,
+      CLOSE           = 57,
+      READ            = 63,
+      WRITE           = 64,
+      FSTAT           = 80,
+      EXIT            = 93,
+      EXIT_GROUP      = 94,
+      CLOCK_GETTIME   = 113,
+      BRK             = 214,
+      MUNMAP          = 215,
+      // mmap2 on RV32, with the offset in pages.
+      MMAP            = 222,
+      CLOCK_GETTIME64 = 403,
+    };
+
+    static constexpr std::size_t page_size{4096};
+
+    // `brk` is the initial program break, the end of the loaded program.
+    Basic_linux_syscalls(Xmemory &rf, Xmemory &memory, std::size_t brk, std::size_t mmap_top,
+        std::array<int, 3> stdio = {0, 1, 2});
+    Basic_linux_syscalls(const Basic_linux_syscalls&) = delete;
+    Basic_linux_syscalls& operator=(const Basic_linux_syscalls&) = delete;
+    // Closes the host files the guest left open.
+    ~Basic_linux_syscalls();
+
+    // Runs the system call in the registers. Returns the exit code once the guest exited, so
+    // it can serve as the ecall handler of the core.
+    std::optional<Data> handle();
+
+    // Set once the guest exited.
+    [[nodiscard]] std::optional<Data> get_exit_code() const { return m_exit_code; }
+    [[nodiscard]] std::size_t get_brk() const { return m_brk; }
+    // Bytes read and written without a copy.
+    [[nodiscard]] std::uint64_t get_zero_copy_bytes() const { return m_zero_copy_bytes; }
+
+  private:
+    using Sdata = Sxlen_t<xlen>;
+
+    struct Fd {
+      int host{-1};
+      // Opened by the guest rather than given.
+      bool owned{false};
+    };
+
+    Xmemory &m_rf;
+    Xmemory &m_memory;
+    const std::size_t m_initial_brk;
+    std::size_t m_brk;
+    // The lowest mapping so far.
+    std::size_t m_mmap_bottom;
+    std::vector<std::optional<Fd>> m_fds{};
+    std::vector<std::byte> m_bounce{};
+    std::optional<Data> m_exit_code{};
+    std::uint64_t m_zero_copy_bytes{0};
+
+    [[nodiscard]] Sdata call(Data number, const std::array<Data, 6> &args);
+
+    [[nodiscard]] Sdata sys_read (Data fd, Data buf, Data count);
+    [[nodiscard]] Sdata sys_write(Data fd, Data buf, Data count);
+    [[nodiscard]] Sdata sys_openat(Data dirfd, Data path, Data flags, Data mode);
+    [[nodiscard]] Sdata sys_close(Data fd);
+    [[nodiscard]] Sdata sys_fstat(Data fd, Data buf);
+    [[nodiscard]] Sdata sys_brk(Data addr);
+    [[nodiscard]] Sdata sys_mmap(Data len, Data flags, Data fd, Data offset);
+    [[nodiscard]] Sdata sys_clock_gettime(Data clock, Data buf);
+
+    // The host descriptor of a guest one, or nullptr.
+    [[nodiscard]] const Fd* get_fd(Data fd) const;
+    [[nodiscard]] std::string read_string(std::size_t addr) const;
+    // Runs `io(host, size)`, which returns what read(2) and write(2) do, on the guest buffer
+    // [addr, addr + size) in pieces: on the guest memory itself where it's host memory and
+    // through the bounce buffer elsewhere, copied in or out of the guest as `into_guest`
+    // says. Returns the bytes transferred or -errno.
+    template <typename Io>
+    [[nodiscard]] Sdata transfer(std::size_t addr, std::size_t size, bool into_guest, Io io);
+};
+
+using Linux_syscalls   = Basic_linux_syscalls<32>;
+using Linux_syscalls64 = Basic_linux_syscalls<64>;
@@ -1,85 +1,87 @@
-#pragma once
-
-#include "riscv.hpp"
-#include "riscv_algos.hpp"
-
-#include <cstddef>
-#include <cassert>
-
-namespace Lsu {
-  enum class Op {
-    b,
-    bu,
-    h,
-    hu,
-    w
-  };
-
-  [[nodiscard("PURE FUN")]] inline bool is_misaligned(Op op, std::size_t addr) {
-    switch (op) {
-      case Op::bu: case Op::b: return false;
-      case Op::hu: case Op::h: return addr & 0b01;
-      case Op::w             : return addr & 0b11;
-    }
-    assert(0 && "Illegal lsu op");
-  }
-
-  [[nodiscard("PURE FUN")]] inline Uxlen transform_data(Op op, std::size_t addr, Uxlen data) {
-    switch (op) {
-      case Op::b:
-        switch (addr & 0b11) {
-          case 0: return extract_bits(data, { 7,  0}, true);
-          case 1: return extract_bits(data, {15,  8}, true);
-          case 2: return extract_bits(data, {23, 16}, true);
-          case 3: return extract_bits(data, {31, 24}, true);
-        }
-
-      case Op::h:
-        assert(!(addr & 0b01) && "Misalignment");
-        return (addr & 0b10) ? extract_bits(data, {31, 16}, true) :
-            extract_bits(data, {15, 0}, true);
-
-      case Op::w:
-        assert(!(addr & 0b11) && "Misalignment");
-        return data;
-
-      case Op::bu:
-        switch (addr & 0b11) {
-          case 0: return extract_bits(data, { 7,  0}, false);
-          case 1: return extract_bits(data, {15,  8}, false);
-          case 2: return extract_bits(data, {23, 16}, false);
-          case 3: return extract_bits(data, {31, 24}, false);
-        }
-
-      case Op::hu:
-        assert(!(addr & 0b01) && "Misalignment");
-        return (addr & 0b10) ? extract_bits(data, {31, 16}, false) :
-            extract_bits(data, {15, 0}, false);
-    }
-
-    assert(0 && "Invalid op");
-  }
-
-  [[nodiscard("PURE FUN")]] inline unsigned int get_be(Op op, std::size_t addr) {
-    const auto byte_offset{addr & 0b11};
-    switch (op) {
-      case Op::b: case Op::bu: return 1u      << byte_offset;
-      case Op::h: case Op::hu: return 0b0011u << byte_offset;
-      case Op::w             : return 0xfu    << byte_offset;
-    }
-    assert(0 && "Illegal lsu op");
-  }
-}
-
-[[nodiscard("PURE FUN")]] inline std::string to_string(Lsu::Op op) {
-  using enum Lsu::Op;
-  switch (op) {
-    case b : return "b";
-    case bu: return "bu";
-    case h : return "h";
-    case hu: return "hu";
-    case w : return "w";
-  }
-
-  assert(0 && "Illegal lsu op");
-}
+#pragma once
+
+#include "riscv.hpp"
+#include "riscv_algos.hpp"
+
+#include <cstddef>
+#include <string>
+#include <cassert>
+
+// Memories take the address of an XLEN-wide word and the byte lanes within it enabled by
+// byte_en. The functions are instantiated for the XLEN of the core.
+namespace Lsu {
+  enum class Op {
+    b,
+    bu,
+    h,
+    hu,
+    w,
+    // RV64 only.
+    wu,
+    d,
+  };
+
+  [[nodiscard("PURE FUN")]] constexpr std::size_t get_size(Op op) {
+    switch (op) {
+      case Op::b: case Op::bu: return 1;
+      case Op::h: case Op::hu: return 2;
+      case Op::w: case Op::wu: return 4;
+      case Op::d             : return 8;
+    }
+    assert(0 && "Illegal lsu op");
+  }
+
+  [[nodiscard("PURE FUN")]] constexpr bool is_signed(Op op) {
+    return (op == Op::b) || (op == Op::h) || (op == Op::w);
+  }
+
+  [[nodiscard("PURE FUN")]] inline bool is_misaligned(Op op, std::size_t addr) {
+    return addr & (get_size(op) - 1);
+  }
+
+  template <unsigned int xlen>
+  [[nodiscard("PURE FUN")]] constexpr std::size_t get_lane(std::size_t addr) {
+    return addr & (xlen / CHAR_BIT - 1);
+  }
+
+  // Moves loaded data from the lanes of `addr` into the low bits and extends it.
+  template <unsigned int xlen>
+  [[nodiscard("PURE FUN")]] inline Uxlen_t<xlen> transform_data(Op op, std::size_t addr,
+      Uxlen_t<xlen> data) {
+    assert(!is_misaligned(op, addr) && "Misalignment");
+    if (get_size(op) * CHAR_BIT == xlen) return data;
+    const std::size_t lsb{get_lane<xlen>(addr) * CHAR_BIT};
+    return extract_bits(data, {lsb + get_size(op) * CHAR_BIT - 1, lsb}, is_signed(op));
+  }
+
+  template <unsigned int xlen>
+  [[nodiscard("PURE FUN")]] inline std::size_t get_word_addr(std::size_t addr) {
+    return addr & ~(std::size_t{xlen / CHAR_BIT} - 1);
+  }
+
+  // Moves store data from the low bits into the lanes of `addr`.
+  template <unsigned int xlen>
+  [[nodiscard("PURE FUN")]] inline Uxlen_t<xlen> to_lanes(std::size_t addr, Uxlen_t<xlen> data) {
+    return data << (CHAR_BIT * get_lane<xlen>(addr));
+  }
+
+  template <unsigned int xlen>
+  [[nodiscard("PURE FUN")]] inline unsigned int get_be(Op op, std::size_t addr) {
+    return make_mask<unsigned int>(get_size(op)) << get_lane<xlen>(addr);
+  }
+}
+
+[[nodiscard("PURE FUN")]] inline std::string to_string(Lsu::Op op) {
+  using enum Lsu::Op;
+  switch (op) {
+    case b : return "b";
+    case bu: return "bu";
+    case h : return "h";
+    case hu: return "hu";
+    case w : return "w";
+    case wu: return "wu";
+    case d : return "d";
+  }
+
+  assert(0 && "Illegal lsu op");
+}
@@ -5,6 +5,7 @@
 
 #include <iterator>
 #include <memory>
+#include <span>
 
 #include <cassert>
 
@@ -12,31 +13,66 @@ namespace spdlog {
   class logger;
 }
 
-class Memory {
+template <unsigned int xlen>
+class Basic_memory {
   public:
-    virtual void write(std::size_t addr, Uxlen data, unsigned int byte_en = 0xf) = 0;
-    [[nodiscard]] virtual Uxlen read (std::size_t addr, unsigned int byte_en = 0xf) = 0;
+    using Data = Uxlen_t<xlen>;
+    // One bit per byte lane of a word.
+    static constexpr unsigned int full_byte_en{(1u << (xlen / 8)) - 1};
 
-    virtual ~Memory() = default;
+    virtual void write(std::size_t addr, Data data, unsigned int byte_en = full_byte_en) = 0;
+    [[nodiscard]] virtual Data read (std::size_t addr, unsigned int byte_en = full_byte_en) = 0;
+
+    // Host memory holding the bytes [addr, addr + size) in guest order, or nullptr if they
+    // aren't plain memory, e.g. device registers or a range crossing nodes of a bus.
+    [[nodiscard]] virtual std::byte* get_host_ptr(std::size_t /*addr*/, std::size_t /*size*/) {
+      return nullptr;
+    }
+
+    // Accesses of any size and alignment, e.g. of vector loads and stores. They copy
+    // through the host pointer when there is one and fall back to word accesses otherwise.
+    void read_block (std::size_t addr, std::span<std::byte> data);
+    void write_block(std::size_t addr, std::span<const std::byte> data);
+
+    virtual ~Basic_memory() = default;
 };
 
+// Copies between a host pointer into guest memory and memory private to the caller. Harts
+// on other host threads may access the guest bytes meanwhile, so those are relaxed atomics,
+// whole words where aligned, as in Ram.
+void copy_from_guest(std::byte *to, const std::byte *guest, std::size_t size);
+void copy_to_guest(std::byte *guest, const std::byte *from, std::size_t size);
 
-class Ranged_mem_wrap : public Memory {
+using Memory   = Basic_memory<32>;
+using Memory64 = Basic_memory<64>;
+
+
+template <unsigned int xlen>
+class Basic_ranged_mem_wrap : public Basic_memory<xlen> {
   public:
-    Ranged_mem_wrap(Memory &memory, std::size_t size, std::size_t start_addr = 0)
+    using Data = Uxlen_t<xlen>;
+    using Basic_memory<xlen>::full_byte_en;
+
+    Basic_ranged_mem_wrap(Basic_memory<xlen> &memory, std::size_t size, std::size_t start_addr = 0)
         : m_memory{memory}, m_start_addr{start_addr}, m_size{size} {}
-    Ranged_mem_wrap(const Ranged_mem_wrap& that) = default;
-    Ranged_mem_wrap& operator=(Ranged_mem_wrap) = delete;
-    Ranged_mem_wrap(Ranged_mem_wrap&&) = delete;
+    Basic_ranged_mem_wrap(const Basic_ranged_mem_wrap& that) = default;
+    Basic_ranged_mem_wrap& operator=(Basic_ranged_mem_wrap) = delete;
+    Basic_ranged_mem_wrap(Basic_ranged_mem_wrap&&) = delete;
 
-    void write(std::size_t addr, Uxlen data, unsigned int byte_en = 0xf) override {
+    void write(std::size_t addr, Data data, unsigned int byte_en = full_byte_en) override {
       assert_inside_range(addr);
       m_memory.write(addr - m_start_addr, data, byte_en);
     }
-    [[nodiscard]] Uxlen read (std::size_t addr, unsigned int byte_en = 0xf) override {
+    [[nodiscard]] Data read (std::size_t addr, unsigned int byte_en = full_byte_en) override {
       assert_inside_range(addr);
       return m_memory.read(addr - m_start_addr, byte_en);
     }
+    [[nodiscard]] std::byte* get_host_ptr(std::size_t addr, std::size_t size) override {
+      if ((addr < m_start_addr) || (size > m_size) || (addr - m_start_addr > m_size - size)) {
+        return nullptr;
+      }
+      return m_memory.get_host_ptr(addr - m_start_addr, size);
+    }
 
   private:
     void assert_inside_range(std::size_t addr) const {
@@ -46,7 +82,7 @@ class Ranged_mem_wrap : public Memory {
       }
     }
 
-    Memory &m_memory;
+    Basic_memory<xlen> &m_memory;
     const std::size_t m_start_addr;
     const std::size_t m_size;
     [[nodiscard]] std::size_t get_end_addr() const {
@@ -54,23 +90,66 @@ class Ranged_mem_wrap : public Memory {
     }
 };
 
-class Traced_mem_wrap : public Memory {
+using Ranged_mem_wrap = Basic_ranged_mem_wrap<32>;
+
+template <unsigned int xlen>
+class Basic_traced_mem_wrap : public Basic_memory<xlen> {
   public:
-    Traced_mem_wrap(Memory &mem, std::shared_ptr<spdlog::logger> logger, std::string msg = "")
-        : m_mem{mem}, m_logger{logger}, m_msg{std::move(msg)} {
+    using Data = Uxlen_t<xlen>;
+    using Basic_memory<xlen>::full_byte_en;
+
+    Basic_traced_mem_wrap(Basic_memory<xlen> &mem, std::shared_ptr<spdlog::logger> logger,
+        std::string msg = "") : m_mem{mem}, m_logger{logger}, m_msg{std::move(msg)} {
       assert(m_logger && "logger == nullptr in Traced_mem");
     }
 
-    void write(std::size_t addr, Uxlen data, unsigned int byte_en = 0xf) override;
+    void write(std::size_t addr, Data data, unsigned int byte_en = full_byte_en) override;
 
-    [[nodiscard]] Uxlen read (std::size_t addr, unsigned int byte_en = 0xf) override;
+    [[nodiscard]] Data read (std::size_t addr, unsigned int byte_en = full_byte_en) override;
 
   private:
-    Memory &m_mem;
+    Basic_memory<xlen> &m_mem;
     std::shared_ptr<spdlog::logger> m_logger{nullptr};
     const std::string m_msg;
 };
 
+using Traced_mem_wrap = Basic_traced_mem_wrap<32>;
+
+// 64-bit view of a memory with 32-bit words, e.g. of a device on an RV64 bus. A doubleword
+// access is split into the accesses of the words whose lanes are enabled. Host pointers
+// are byte-addressed, so they're passed through.
+class Narrow_mem_wrap : public Memory64 {
+  public:
+    explicit Narrow_mem_wrap(Memory &memory) : m_memory{memory} {}
+
+    void write(std::size_t addr, Data data, unsigned int byte_en = full_byte_en) override {
+      assert(!(addr & 0b111) && "only alignment by doubleword is supported");
+      if (const unsigned int low_en{byte_en & Memory::full_byte_en}) {
+        m_memory.write(addr, static_cast<Uxlen>(data), low_en);
+      }
+      if (const unsigned int high_en{byte_en >> 4}) {
+        m_memory.write(addr + 4, static_cast<Uxlen>(data >> 32), high_en);
+      }
+    }
+    [[nodiscard]] Data read (std::size_t addr, unsigned int byte_en = full_byte_en) override {
+      assert(!(addr & 0b111) && "only alignment by doubleword is supported");
+      Data data{0};
+      if (const unsigned int low_en{byte_en & Memory::full_byte_en}) {
+        data |= m_memory.read(addr, low_en);
+      }
+      if (const unsigned int high_en{byte_en >> 4}) {
+        data |= Data{m_memory.read(addr + 4, high_en)} << 32;
+      }
+      return data;
+    }
+    [[nodiscard]] std::byte* get_host_ptr(std::size_t addr, std::size_t size) override {
+      return m_memory.get_host_ptr(addr, size);
+    }
+
+  private:
+    Memory &m_memory;
+};
+
 class Mem_iterator {
 
   public:
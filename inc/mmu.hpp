@@ -0,0 +1,153 @@
+#pragma once
+
+#include "csr.hpp"
+#include "memory.hpp"
+#include "watchpoints.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+// Address translation between a core and its physical memory, usually a Bus. The core
+// fetches through `get_instr_port` and loads and stores through `get_data_port`, and
+// passes the Mmu itself so that it can keep the privilege, satp and mstatus up to date and
+// run sfence.vma. In M-mode and with satp in Bare mode the ports forward to the memory.
+//
+// Sv32 page tables are walked on misses of a software TLB: direct-mapped, split into
+// instruction and data entries and tagged with the ASID, so switching address spaces
+// needs no flush. An entry caches the host pointer of its page when the page is plain
+// memory, so a hit on RAM accesses it like Ram does, without going through the bus. The
+// accessed and dirty bits of the page tables are set by the walk. Faults throw
+// Errors::Page_fault, which the core takes as a trap.
+//
+// Given the Pmp of the hart's Csr, the Mmu also checks every physical access against it,
+// those of page table walks included, and throws Errors::Access_fault on violations. This
+// holds in M-mode and in Bare mode too, where it's the only cost over the memory.
+//
+// Given Watchpoints, whose addresses are then virtual, the Mmu fills the TLB entries of
+// watched pages without their host pointer, so only loads and stores to those pages leave
+// the fast path and are checked. The TLB is flushed whenever the watched pages change. In
+// Bare mode, which has no fast path, every data access is checked.
+template <unsigned int xlen>
+class Basic_mmu {
+  public:
+    using Data = Uxlen_t<xlen>;
+    using Privilege = Csr_base::Privilege;
+    static constexpr std::size_t page_size{4096};
+    static constexpr std::size_t tlb_entries{64};
+
+    explicit Basic_mmu(Basic_memory<xlen> &memory, Basic_pmp<xlen> *pmp = nullptr,
+        Basic_watchpoints<xlen> *watchpoints = nullptr);
+    Basic_mmu(const Basic_mmu&) = delete;
+    Basic_mmu& operator=(const Basic_mmu&) = delete;
+    ~Basic_mmu();
+
+    [[nodiscard]] Memory& get_instr_port() { return m_instr_port; }
+    [[nodiscard]] Basic_memory<xlen>& get_data_port() { return m_data_port; }
+
+    void set_context(Privilege privilege, Data satp, Data mstatus);
+    // sfence.vma: drops the entries of `vaddr`, or all of them, of the address space
+    // `asid`, or of all of them. Global mappings stay unless all are dropped.
+    void flush(std::optional<Data> vaddr = {}, std::optional<Data> asid = {});
+
+    // Page table walks so far, i.e. TLB misses.
+    [[nodiscard]] std::uint64_t get_walks() const { return m_walks; }
+
+  private:
+    using Access = Pmp_base::Access;
+
+    struct Entry {
+      bool valid{false};
+      bool global{false};
+      std::uint8_t pte_flags{0};
+      Data vpn{0};
+      Data asid{0};
+      std::size_t page{0};
+      std::byte *host{nullptr};
+    };
+    using Tlb = std::array<Entry, tlb_entries>;
+
+    struct Translation {
+      std::size_t addr{0};
+      // Into the host memory of the page, or nullptr.
+      std::byte *host{nullptr};
+    };
+
+    class Instr_port : public Memory {
+      public:
+        explicit Instr_port(Basic_mmu &mmu) : m_mmu{mmu} {}
+        void write(std::size_t addr, Uxlen data, unsigned int byte_en = 0xf) override;
+        [[nodiscard]] Uxlen read (std::size_t addr, unsigned int byte_en = 0xf) override;
+
+      private:
+        Basic_mmu &m_mmu;
+    };
+
+    class Data_port : public Basic_memory<xlen> {
+      public:
+        using Basic_memory<xlen>::full_byte_en;
+
+        explicit Data_port(Basic_mmu &mmu) : m_mmu{mmu} {}
+        void write(std::size_t addr, Data data, unsigned int byte_en = full_byte_en) override;
+        [[nodiscard]] Data read (std::size_t addr, unsigned int byte_en = full_byte_en) override;
+        // Only to pages already in the TLB as writable and dirty, since the caller may write
+        // through it. Never faults.
+        [[nodiscard]] std::byte* get_host_ptr(std::size_t addr, std::size_t size) override;
+
+      private:
+        Basic_mmu &m_mmu;
+    };
+
+    Basic_memory<xlen> &m_memory;
+    Basic_pmp<xlen> *const m_pmp;
+    Basic_watchpoints<xlen> *const m_watchpoints;
+    typename Basic_watchpoints<xlen>::Subscription m_watch_subscription{0};
+    Instr_port m_instr_port{*this};
+    Data_port m_data_port{*this};
+
+    Privilege m_privilege{Privilege::machine};
+    // Of loads and stores, which mstatus.MPRV may lower.
+    Privilege m_data_privilege{Privilege::machine};
+    bool m_translate_fetch{false};
+    bool m_translate_data{false};
+    bool m_sum{false};
+    bool m_mxr{false};
+    Data m_asid{0};
+    std::size_t m_root{0};
+
+    Tlb m_itlb{};
+    Tlb m_dtlb{};
+    std::uint64_t m_walks{0};
+
+    [[nodiscard]] Translation translate(std::size_t vaddr, Access access);
+    [[nodiscard]] Entry* lookup(Tlb &tlb, Data vpn);
+    [[nodiscard]] bool is_allowed(const Entry &entry, Access access) const;
+    // Fills the entry of `vpn`, or throws.
+    Entry& walk(Tlb &tlb, std::size_t vaddr, Access access);
+
+    // Throws the access fault of `vaddr` unless pmp allows the access to `paddr`.
+    void protect(std::size_t paddr, std::size_t vaddr, std::size_t size, Access access,
+        Privilege privilege) {
+      if (m_pmp && !m_pmp->is_allowed(paddr, size, access, privilege == Privilege::machine))
+          [[unlikely]] {
+        throw_access_fault(vaddr, access);
+      }
+    }
+    [[noreturn]] static void throw_access_fault(std::size_t vaddr, Access access);
+
+    // Of the slow path of loads and stores, at the virtual address.
+    void check_watchpoints(std::size_t vaddr, unsigned int byte_en, Access access) {
+      using Kind = typename Basic_watchpoints<xlen>::Kind;
+      if (m_watchpoints) {
+        m_watchpoints->check(vaddr, byte_en, (access == Access::store) ? Kind::write : Kind::read);
+      }
+    }
+
+    // 32-bit words of the physical memory, for instructions and page table entries.
+    [[nodiscard]] Uxlen read_word(std::size_t addr, unsigned int byte_en = 0xf);
+    void write_word(std::size_t addr, Uxlen data);
+};
+
+using Mmu   = Basic_mmu<32>;
+using Mmu64 = Basic_mmu<64>;
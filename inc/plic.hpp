@@ -0,0 +1,57 @@
+#pragma once
+
+#include "irq.hpp"
+#include "memory.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Platform-level interrupt controller with a single M-mode context and level-triggered
+// sources.
+//
+// `set_level` may be called from device threads concurrently with the core accessing the
+// registers. All state is kept in atomics and meip is recomputed until no other writer
+// changed any of the state it was derived from, so no update can be lost without taking a
+// lock.
+class Plic : public Memory {
+  public:
+    static constexpr unsigned int sources_number{32};
+
+    enum Register : std::size_t {
+      PRIORITY  = 0x000000,
+      PENDING   = 0x001000,
+      ENABLE    = 0x002000,
+      THRESHOLD = 0x200000,
+      CLAIM     = 0x200004,
+    };
+
+    explicit Plic(Irq_pending &irq_pending) : m_irq_pending{irq_pending} {}
+
+    void write(std::size_t addr, Uxlen data, unsigned int byte_en = 0xf) override;
+    [[nodiscard]] Uxlen read (std::size_t addr, unsigned int byte_en = 0xf) override;
+
+    // Level of the interrupt line of a device. Source 0 doesn't exist.
+    void set_level(unsigned int source, bool level);
+    void raise(unsigned int source) { set_level(source, true ); }
+    void lower(unsigned int source) { set_level(source, false); }
+
+  private:
+    using Bits = std::uint32_t;
+
+    Irq_pending &m_irq_pending;
+    std::array<std::atomic<Uxlen>, sources_number> m_priority{};
+    std::atomic<Bits>  m_level    {0};
+    std::atomic<Bits>  m_enable   {0};
+    // Sources between claim and complete. The gateway holds back their new requests.
+    std::atomic<Bits>  m_claimed  {0};
+    std::atomic<Uxlen> m_threshold{0};
+    // Bumped on every change of the state above.
+    std::atomic<std::uint64_t> m_version{0};
+
+    [[nodiscard]] Bits get_pending() const { return m_level & ~m_claimed; }
+    [[nodiscard]] unsigned int claim();
+    void complete(unsigned int source);
+    // Recomputes meip. Called after every change of the controller state.
+    void update_irq();
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "riscv.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Shared by every XLEN.
+class Pmp_base {
+  public:
+    static constexpr std::size_t entries{16};
+
+    enum class Access {
+      fetch,
+      load ,
+      store,
+    };
+
+    // The fields of an entry in pmpcfg.
+    enum Cfg : std::uint8_t {
+      CFG_R = 1u << 0,
+      CFG_W = 1u << 1,
+      CFG_X = 1u << 2,
+      CFG_A = 0b11u << 3,
+      // Applies the entry to M-mode too and ignores writes to it until reset.
+      CFG_L = 1u << 7,
+    };
+
+    enum class Mode : std::uint8_t {
+      off   = 0,
+      // Top of range: from the address of the previous entry up to this one.
+      tor   = 1,
+      na4   = 2,
+      napot = 3,
+    };
+};
+
+// Physical memory protection: the entries of pmpcfg0-3 and pmpaddr0-15, held by the Csr,
+// and the check of physical accesses against them, which the Mmu does on every fetch, load
+// and store, page table walks included.
+//
+// Scanning 16 entries per access would cost more than the access, so the decision is cached
+// per 4 KiB page in a direct-mapped table, which only writes to the pmp csrs clear. A page
+// that an entry covers only in part isn't cached and is scanned on every access.
+template <unsigned int xlen>
+class Basic_pmp : public Pmp_base {
+  public:
+    using Data = Uxlen_t<xlen>;
+    static constexpr std::size_t page_size{4096};
+    static constexpr std::size_t cache_entries{256};
+
+    // Writes to locked entries are ignored, as are writes to the address of an entry that a
+    // locked TOR entry above uses as its bottom.
+    void set_cfg (std::size_t entry, std::uint8_t cfg);
+    void set_addr(std::size_t entry, Data addr);
+    [[nodiscard]] std::uint8_t get_cfg (std::size_t entry) const { return m_cfg.at(entry); }
+    [[nodiscard]] Data         get_addr(std::size_t entry) const { return m_addr.at(entry); }
+
+    // Whether an access of M-mode or of a lower mode may touch the bytes [addr, addr + size).
+    // The hit of the cache is inline.
+    [[nodiscard]] bool is_allowed(std::size_t addr, std::size_t size, Access access,
+        bool machine) {
+      const std::size_t page{addr / page_size};
+      const Cache_entry &entry{m_cache[page % cache_entries]};
+      if ((entry.page != page) || entry.partial || ((addr + size - 1) / page_size != page))
+          [[unlikely]] {
+        return is_allowed_slow(addr, size, access, machine);
+      }
+      return (static_cast<unsigned int>(entry.allowed) >> get_bit(access, machine)) & 1u;
+    }
+
+    // Decisions taken from scans rather than from the cache, for tests.
+    [[nodiscard]] std::uint64_t get_scans() const { return m_scans; }
+
+  private:
+    // The allowed accesses of lower modes and of M-mode: a bit per Access, shifted by 3 for
+    // M-mode.
+    using Allowed = std::uint8_t;
+    static constexpr Allowed all_allowed{0b111};
+    [[nodiscard("PURE FUN")]] static constexpr unsigned int get_bit(Access access, bool machine) {
+      return static_cast<unsigned int>(access) + (machine ? 3 : 0);
+    }
+
+    struct Region {
+      std::uint64_t begin{0};
+      // Exclusive.
+      std::uint64_t end{0};
+    };
+
+    struct Cache_entry {
+      std::size_t page{~std::size_t{0}};
+      bool partial{false};
+      Allowed allowed{0};
+    };
+
+    std::array<std::uint8_t, entries> m_cfg{};
+    std::array<Data, entries> m_addr{};
+    std::array<Region, entries> m_regions{};
+    std::array<Cache_entry, cache_entries> m_cache{};
+    std::uint64_t m_scans{0};
+
+    void update();
+    [[nodiscard]] bool is_locked(std::size_t entry) const { return m_cfg[entry] & CFG_L; }
+    [[nodiscard]] Allowed get_allowed(std::size_t entry) const;
+    [[nodiscard]] Cache_entry decide(std::size_t page) const;
+    [[nodiscard]] bool is_allowed_slow(std::size_t addr, std::size_t size, Access access,
+        bool machine);
+    [[nodiscard]] bool scan(std::uint64_t begin, std::uint64_t end, Access access, bool machine);
+};
+
+using Pmp   = Basic_pmp<32>;
+using Pmp64 = Basic_pmp<64>;
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "memory.hpp"
+#include "exception.hpp"
+
+#include <atomic>
+#include <bit>
+#include <climits>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Zero-initialised memory of a fixed size in one host allocation. Unlike Data_mem it
+// hands out host pointers, so bulk accesses such as vector loads and stores are copies
+// rather than one virtual call per word. Accesses may come from several host threads at
+// once; bulk copies go through `copy_from_guest` and `copy_to_guest`, which keep them
+// free of data races too.
+template <unsigned int xlen>
+class Basic_ram : public Basic_memory<xlen> {
+  public:
+    using Data = Uxlen_t<xlen>;
+    using Basic_memory<xlen>::full_byte_en;
+
+    explicit Basic_ram(std::size_t size) : m_content(size) {}
+
+    void write(std::size_t addr, Data data, unsigned int byte_en = full_byte_en) override {
+      assert_inside(addr);
+      if ((byte_en == full_byte_en) && is_aligned(addr)) {
+        get_word(addr).store(data, std::memory_order_relaxed);
+        return;
+      }
+      for (unsigned int lane{0}; lane < sizeof(Data); ++lane) {
+        if ((byte_en >> lane) & 1u) {
+          get_byte(addr + lane).store(static_cast<std::byte>(data >> (lane * CHAR_BIT)),
+              std::memory_order_relaxed);
+        }
+      }
+    }
+
+    [[nodiscard]] Data read (std::size_t addr, unsigned int byte_en = full_byte_en) override {
+      assert_inside(addr);
+      if ((byte_en == full_byte_en) && is_aligned(addr)) {
+        return get_word(addr).load(std::memory_order_relaxed);
+      }
+      Data data{0};
+      for (unsigned int lane{0}; lane < sizeof(Data); ++lane) {
+        if ((byte_en >> lane) & 1u) {
+          data |= std::to_integer<Data>(get_byte(addr + lane).load(std::memory_order_relaxed)) <<
+              (lane * CHAR_BIT);
+        }
+      }
+      return data;
+    }
+
+    [[nodiscard]] std::byte* get_host_ptr(std::size_t addr, std::size_t size) override {
+      if ((size > m_content.size()) || (addr > m_content.size() - size)) return nullptr;
+      return m_content.data() + addr;
+    }
+
+    [[nodiscard]] std::span<const std::byte> get_content() const {
+      return m_content;
+    }
+
+  private:
+    // Words are copied in host order and the host pointers expose guest memory.
+    static_assert(std::endian::native == std::endian::little, "RISC-V is little-endian");
+
+    // Harts on other host threads may access the same words, so accesses are relaxed
+    // atomics: plain moves on the host, without tearing or a data race. The byte lanes of a
+    // partial word are accessed one at a time.
+    [[nodiscard]] bool is_aligned(std::size_t addr) const {
+      return !(reinterpret_cast<std::uintptr_t>(m_content.data() + addr) %
+          std::atomic_ref<Data>::required_alignment);
+    }
+    [[nodiscard]] std::atomic_ref<Data> get_word(std::size_t addr) {
+      return std::atomic_ref<Data>{*reinterpret_cast<Data*>(m_content.data() + addr)};
+    }
+    [[nodiscard]] std::atomic_ref<std::byte> get_byte(std::size_t addr) {
+      return std::atomic_ref<std::byte>{m_content[addr]};
+    }
+
+    void assert_inside(std::size_t addr) const {
+      if ((m_content.size() < sizeof(Data)) || (addr > m_content.size() - sizeof(Data))) {
+        throw Errors::Illegal_addr{addr, "Out of ram. Size: " + std::to_string(m_content.size())};
+      }
+    }
+
+    std::vector<std::byte> m_content;
+};
+
+using Ram   = Basic_ram<32>;
+using Ram64 = Basic_ram<64>;
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "irq.hpp"
+#include "memory.hpp"
+#include "plic.hpp"
+#include "scheduler.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Record and replay of the inputs that make a run nondeterministic: interrupt lines raised by
+// device threads, reads of devices outside the emulator and host input of a UART. Everything
+// else runs in virtual time, which is one unit per retired instruction, so a run fed the
+// same inputs at the same virtual times repeats exactly.
+//
+// Each input is a channel, added in the same order for recording and replaying. Recording
+// logs every input with the virtual time it was applied at and costs nothing between them.
+// The log is a file of variable-length integers: the time since the previous input, the
+// channel and the data, usually 3 to 5 bytes an input. Replaying applies them at the same
+// times from the log and drops the live ones.
+//
+// Inputs posted by other host threads wait for the next poll, every `poll_interval` of
+// virtual time, which applies them between two instructions. Inputs of the core's thread,
+// e.g. of a device polling the host in a scheduler event, are applied at once.
+class Replay_log {
+  public:
+    using Time    = Scheduler::Time;
+    using Channel = std::uint32_t;
+    // Applies an input to the emulator.
+    using Apply   = std::function<void(std::uint64_t)>;
+
+    enum class Mode {
+      record,
+      replay,
+    };
+
+    static constexpr Time default_poll_interval{10'000};
+
+    // Throws Errors::Error if the log can't be created or read.
+    Replay_log(Scheduler &scheduler, const std::string &path, Mode mode,
+        Time poll_interval = default_poll_interval);
+    Replay_log(const Replay_log&) = delete;
+    Replay_log& operator=(const Replay_log&) = delete;
+    // Writes out what is left of the log.
+    ~Replay_log();
+
+    [[nodiscard]] bool is_replaying() const { return m_mode == Mode::replay; }
+
+    [[nodiscard]] Channel add_input(Apply apply);
+    // The level of a line, e.g. raised and lowered by a device thread.
+    [[nodiscard]] Channel add_irq_line(Irq_pending &irq_pending, Irq::Cause cause);
+    [[nodiscard]] Channel add_plic_source(Plic &plic, unsigned int source);
+    // Values read by the core, e.g. of Replay_mem_wrap.
+    [[nodiscard]] Channel add_reads();
+
+    // From any thread. Applied at the next poll while recording, dropped while replaying.
+    void post(Channel channel, std::uint64_t data);
+    // From the core's thread. Applied at once while recording, dropped while replaying.
+    void deliver(Channel channel, std::uint64_t data);
+
+    // Of a channel of reads. Recording logs the value read, replaying returns it. Throws
+    // Errors::Error if the replay diverged from the log.
+    void record(Channel channel, std::uint64_t data);
+    [[nodiscard]] std::uint64_t replay(Channel channel);
+
+    // Throws Errors::Error if the log can't be written.
+    void flush();
+    // Recorded or replayed so far.
+    [[nodiscard]] std::uint64_t get_inputs() const { return m_inputs_number; }
+
+  private:
+    struct Entry {
+      Time time{0};
+      Channel channel{0};
+      std::uint64_t data{0};
+    };
+
+    static constexpr std::size_t buffer_size{0x10000};
+
+    Scheduler &m_scheduler;
+    const Mode m_mode;
+    const Time m_poll_interval;
+    // Of the log being recorded.
+    int m_fd{-1};
+    // Empty for channels of reads.
+    std::vector<Apply> m_channels{};
+    std::optional<Scheduler::Event_id> m_event{};
+    std::uint64_t m_inputs_number{0};
+
+    // Recording.
+    std::vector<std::uint8_t> m_buffer{};
+    Time m_last_time{0};
+    std::mutex m_posted_mutex{};
+    std::vector<std::pair<Channel, std::uint64_t>> m_posted{};
+    std::atomic<bool> m_has_posted{false};
+
+    // Replaying. The next entry to apply and, for channels of reads, the next entry of each.
+    std::vector<Entry> m_entries{};
+    std::size_t m_next{0};
+    std::vector<std::size_t> m_next_read{};
+
+    void append(Channel channel, std::uint64_t data);
+    void poll();
+    void read_log(const std::string &path);
+    void dispatch();
+    // Skips the entries of reads.
+    void schedule_dispatch();
+    [[nodiscard]] bool is_input(Channel channel) const {
+      return (channel < m_channels.size()) && m_channels[channel];
+    }
+};
+
+// Reads of a device outside the emulator, e.g. a memory shared with another process,
+// recorded and replayed. Writes reach the device either way.
+template <unsigned int xlen>
+class Basic_replay_mem_wrap : public Basic_memory<xlen> {
+  public:
+    using Data = Uxlen_t<xlen>;
+    using Basic_memory<xlen>::full_byte_en;
+
+    Basic_replay_mem_wrap(Basic_memory<xlen> &memory, Replay_log &log)
+        : m_memory{memory}, m_log{log}, m_channel{log.add_reads()} {}
+    Basic_replay_mem_wrap(const Basic_replay_mem_wrap&) = delete;
+    Basic_replay_mem_wrap& operator=(const Basic_replay_mem_wrap&) = delete;
+
+    void write(std::size_t addr, Data data, unsigned int byte_en = full_byte_en) override {
+      m_memory.write(addr, data, byte_en);
+    }
+    [[nodiscard]] Data read (std::size_t addr, unsigned int byte_en = full_byte_en) override {
+      if (m_log.is_replaying()) return static_cast<Data>(m_log.replay(m_channel));
+      const Data data{m_memory.read(addr, byte_en)};
+      m_log.record(m_channel, data);
+      return data;
+    }
+
+  private:
+    Basic_memory<xlen> &m_memory;
+    Replay_log &m_log;
+    const Replay_log::Channel m_channel;
+};
+
+using Replay_mem_wrap   = Basic_replay_mem_wrap<32>;
+using Replay_mem_wrap64 = Basic_replay_mem_wrap<64>;
@@ -2,18 +2,23 @@
 
 #include "memory.hpp"
 
+#include <array>
 #include <vector>
 
-class Rf : public Memory {
+template <unsigned int xlen>
+class Basic_rf : public Basic_memory<xlen> {
   public:
-    using Container = std::vector<Uxlen>;
+    using Data      = Uxlen_t<xlen>;
+    using Container = std::vector<Data>;
+    using Basic_memory<xlen>::full_byte_en;
 
-    Rf(unsigned int registers_number = 32) : m_registers(registers_number, 0) {}
+    Basic_rf(unsigned int registers_number = 32) : m_registers(registers_number, 0) {}
 
-    void write(std::size_t addr, Uxlen data, unsigned int byte_en = 0xf) override {
+    void write(std::size_t addr, Data data, unsigned int byte_en = full_byte_en) override {
+      if (addr == 0) return; // x0 is hardwired to zero
       m_registers[addr] = data;
     }
-    [[nodiscard]] Uxlen read (std::size_t addr, unsigned int byte_en = 0xf) override {
+    [[nodiscard]] Data read (std::size_t addr, unsigned int byte_en = full_byte_en) override {
       return m_registers[addr];
     }
 
@@ -24,3 +29,27 @@ class Rf : public Memory {
   private:
     Container m_registers;
 };
+
+using Rf   = Basic_rf<32>;
+using Rf64 = Basic_rf<64>;
+
+// F and D registers, FLEN = 64 bits wide for every XLEN. Unlike x0, f0 is an ordinary
+// register.
+class Fp_rf : public Memory64 {
+  public:
+    using Container = std::array<Data, 32>;
+
+    void write(std::size_t addr, Data data, unsigned int byte_en = full_byte_en) override {
+      m_registers[addr] = data;
+    }
+    [[nodiscard]] Data read (std::size_t addr, unsigned int byte_en = full_byte_en) override {
+      return m_registers[addr];
+    }
+
+    [[nodiscard]] const Container& get_content() const {
+      return m_registers;
+    }
+
+  private:
+    Container m_registers{};
+};
@@ -2,7 +2,35 @@
 
 #include <cstdint>
 
-using Uxlen = std::uint32_t;
-using Sxlen = std::int32_t;
+// Integer types of an XLEN. The core, decoder, ALU, LSU, register file and memory
+// interface are instantiated for each supported XLEN, so the width is never checked at
+// run time.
+template <unsigned int xlen> struct Xlen_traits;
+
+template <> struct Xlen_traits<32> {
+  using Uxlen  = std::uint32_t;
+  using Sxlen  = std::int32_t;
+  // Double width, for the high half of products.
+  using Udxlen = std::uint64_t;
+  using Sdxlen = std::int64_t;
+};
+
+template <> struct Xlen_traits<64> {
+  using Uxlen  = std::uint64_t;
+  using Sxlen  = std::int64_t;
+  using Udxlen = unsigned __int128;
+  using Sdxlen = __int128;
+};
+
+template <unsigned int xlen> using Uxlen_t  = typename Xlen_traits<xlen>::Uxlen;
+template <unsigned int xlen> using Sxlen_t  = typename Xlen_traits<xlen>::Sxlen;
+template <unsigned int xlen> using Udxlen_t = typename Xlen_traits<xlen>::Udxlen;
+template <unsigned int xlen> using Sdxlen_t = typename Xlen_traits<xlen>::Sdxlen;
+
+// RV32, also the width of instructions and of the devices' registers.
+using Uxlen  = Uxlen_t <32>;
+using Sxlen  = Sxlen_t <32>;
+using Udxlen = Udxlen_t<32>;
+using Sdxlen = Sdxlen_t<32>;
 
 using Imm = Uxlen;
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <unordered_set>
+#include <vector>
+
+// Discrete-event queue in virtual time. One unit of virtual time is one retired
+// instruction, so device timing is deterministic and independent of the host.
+//
+// Events live in a 4-ary min-heap: pushes and pops touch log4(n) levels and the children of
+// a node share a cache line.
+class Scheduler {
+  public:
+    using Time     = std::uint64_t;
+    using Callback = std::function<void()>;
+    using Event_id = std::uint64_t;
+
+    static constexpr Time never{std::numeric_limits<Time>::max()};
+
+    // Events with equal time run in the order they were scheduled.
+    Event_id schedule_at(Time time, Callback callback);
+    Event_id schedule_in(Time delay, Callback callback) {
+      return schedule_at(m_now + delay, std::move(callback));
+    }
+    // Cancelling an event that already ran is a no-op.
+    void cancel(Event_id id);
+
+    // Moves virtual time forward to `time`, running every event due on the way.
+    void advance_to(Time time);
+    // Retires one unit of time without looking at the queue. For the execution loop, which
+    // stops at the next deadline itself and then calls `advance_to`.
+    void tick() { ++m_now; }
+    // Sets virtual time without running events, e.g. to restore a snapshot. Queued events
+    // keep their times, so those already due run at the next `advance_to`, and events that
+    // already ran don't run again.
+    void jump_to(Time time) { m_now = time; }
+
+    [[nodiscard]] Time get_now() const { return m_now; }
+    [[nodiscard]] Time get_next_deadline() const {
+      return m_heap.empty() ? never : m_heap.front().time;
+    }
+    [[nodiscard]] bool empty() const { return m_heap.empty(); }
+
+  private:
+    struct Event {
+      Time     time{};
+      Event_id id  {};
+      Callback callback{};
+
+      [[nodiscard]] bool operator<(const Event &rhs) const {
+        return (time != rhs.time) ? (time < rhs.time) : (id < rhs.id);
+      }
+    };
+
+    static constexpr std::size_t arity{4};
+
+    std::vector<Event> m_heap{};
+    // Ids of the events in the heap, so cancelling one that already ran leaves no trace.
+    std::unordered_set<Event_id> m_queued{};
+    std::unordered_set<Event_id> m_cancelled{};
+    Time m_now{0};
+    Event_id m_next_id{0};
+
+    void push(Event event);
+    Event pop();
+    void drop_cancelled();
+};
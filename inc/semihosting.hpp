@@ -0,0 +1,73 @@
+#pragma once
+
+#include "host_output.hpp"
+#include "memory.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+
+// RISC-V semihosting, the calls of ARM semihosting made with an ebreak between
+// `slli x0, x0, 0x1f` and `srai x0, x0, 7`: the semihosting handler of a core running a
+// bare-metal program. The guest passes the operation in a0 and the parameter, mostly a
+// pointer to a block of XLEN-wide words, in a1, and gets the result in a0.
+//
+// Only the console is served: ":tt" opens to the output given, writes go to it, and reads
+// see the end of the file. The output is flushed when the guest exits.
+template <unsigned int xlen>
+class Basic_semihosting {
+  public:
+    using Data    = Uxlen_t<xlen>;
+    using Xmemory = Basic_memory<xlen>;
+
+    enum Operation : Data {
+      SYS_OPEN          = 0x01,
+      SYS_CLOSE         = 0x02,
+      SYS_WRITEC        = 0x03,
+      SYS_WRITE0        = 0x04,
+      SYS_WRITE         = 0x05,
+      SYS_READ          = 0x06,
+      SYS_CLOCK         = 0x10,
+      SYS_EXIT          = 0x18,
+      SYS_EXIT_EXTENDED = 0x20,
+    };
+
+    // The reason of an exit that has an exit code. Any other is a failure.
+    static constexpr Data ADP_Stopped_ApplicationExit{0x20026};
+
+    // The handles of the console.
+    enum Handle : Data {
+      STDIN  = 1,
+      STDOUT = 2,
+      STDERR = 3,
+    };
+
+    Basic_semihosting(Xmemory &rf, Xmemory &memory, Host_output &out, Host_output &err);
+
+    // Runs the call in the registers. Returns the exit code once the guest exited, so it can
+    // serve as the semihosting handler of the core.
+    std::optional<Data> handle();
+
+    [[nodiscard]] std::optional<Data> get_exit_code() const { return m_exit_code; }
+
+  private:
+    Xmemory &m_rf;
+    Xmemory &m_memory;
+    Host_output &m_out;
+    Host_output &m_err;
+    // SYS_CLOCK counts from here.
+    const std::chrono::steady_clock::time_point m_start{std::chrono::steady_clock::now()};
+    std::optional<Data> m_exit_code{};
+
+    [[nodiscard]] Data call(Data operation, Data parameter);
+    // The `index`th word of the parameter block.
+    [[nodiscard]] Data get_field(Data block, std::size_t index);
+    [[nodiscard]] char read_char(Data addr);
+    [[nodiscard]] Host_output* get_output(Data handle);
+    [[nodiscard]] Data sys_open(Data block);
+    [[nodiscard]] Data sys_write(Data block);
+    void exit(Data reason, Data subcode);
+};
+
+using Semihosting   = Basic_semihosting<32>;
+using Semihosting64 = Basic_semihosting<64>;
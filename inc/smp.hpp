@@ -0,0 +1,82 @@
+#pragma once
+
+#include "amo.hpp"
+#include "core.hpp"
+#include "csr.hpp"
+#include "irq.hpp"
+#include "isa_extension.hpp"
+#include "memory.hpp"
+#include "rf.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace spdlog {
+  class logger;
+}
+
+// Harts sharing their instruction and data memories, each on its own host thread. Every
+// hart has its own registers, csrs (with mhartid set to its index) and pending word, so
+// interrupt controllers such as a multi-hart Clint can be wired to `get_irq_pending`.
+//
+// The shared memories must tolerate concurrent accesses: Ram does, with lr/sc and AMOs on
+// host atomics and a reservation set shared by the harts. The logger must be thread-safe.
+template <unsigned int xlen>
+class Basic_smp {
+  public:
+    Basic_smp(std::size_t harts, Memory &instr_mem, Basic_memory<xlen> &data_mem,
+        std::shared_ptr<spdlog::logger> logger, Isa_ext_container isa_ext_container = {});
+    ~Basic_smp();
+    Basic_smp(const Basic_smp&) = delete;
+    Basic_smp& operator=(const Basic_smp&) = delete;
+
+    [[nodiscard]] std::size_t get_harts() const { return m_harts.size(); }
+    [[nodiscard]] Basic_core<xlen>& get_core(std::size_t hart) { return m_harts.at(hart)->core; }
+    [[nodiscard]] Basic_rf<xlen>& get_rf(std::size_t hart) { return m_harts.at(hart)->rf; }
+    [[nodiscard]] Basic_csr<xlen>& get_csr(std::size_t hart) { return m_harts.at(hart)->csr; }
+    [[nodiscard]] Irq_pending& get_irq_pending(std::size_t hart) {
+      return m_harts.at(hart)->irq_pending;
+    }
+    // In mhartid order, for a Clint.
+    [[nodiscard]] std::vector<Irq_pending*> get_irq_pendings();
+
+    // Runs every hart on a thread of its own until it has executed `instructions`
+    // instructions or halted, or until `stop` is called. A hart in wfi sleeps until an
+    // enabled interrupt is pending; one in an idle loop yields its thread, since another hart
+    // may end the loop with a store. A halted hart leaves the others running, so the run
+    // returns once every guest exited; a hart stopped for a debugger stops them all. The
+    // first exception thrown by a hart stops the others and is rethrown.
+    void run(std::uint64_t instructions);
+    // May be called from any thread, a hart's included.
+    void stop();
+
+  private:
+    struct Hart {
+      Hart(std::size_t index, Memory &instr_mem, Basic_memory<xlen> &data_mem,
+          std::shared_ptr<spdlog::logger> logger, Isa_ext_container isa_ext_container,
+          Amo::Reservation_set &reservations)
+          : csr{irq_pending, index},
+          core{instr_mem, data_mem, csr, rf, std::move(logger), isa_ext_container, &irq_pending,
+              &reservations, index} {}
+
+      Irq_pending irq_pending{};
+      Basic_rf<xlen> rf{};
+      Basic_csr<xlen> csr;
+      Basic_core<xlen> core;
+    };
+
+    Amo::Reservation_set m_reservations;
+    std::vector<std::unique_ptr<Hart>> m_harts{};
+    std::atomic<bool> m_stop{false};
+    // Readable while stopping, so that sleeping harts wake up.
+    int m_stop_fd{-1};
+
+    void run_hart(Hart &hart, std::uint64_t instructions);
+    // Blocks until an interrupt line of `hart` goes high or the run is stopped.
+    void sleep(Hart &hart) const;
+};
+
+using Smp   = Basic_smp<32>;
+using Smp64 = Basic_smp<64>;
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "host_output.hpp"
+#include "memory.hpp"
+#include "plic.hpp"
+#include "replay_log.hpp"
+#include "scheduler.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+// 16550-compatible UART, as the console of most RISC-V boards, attached to a bus at its
+// base address. The registers are bytes, `1 << reg_shift` bytes apart.
+//
+// TX is done as soon as the byte is written, so THR is always empty and the guest never
+// polls. The bytes go to the host in batches, as the mode says. RX is fed by the host with
+// `receive`, or from a host file descriptor, e.g. stdin or a file, polled every
+// `rx_poll_interval` of virtual time as long as the FIFO has room. The interrupt line goes to
+// the PLIC, if there is one. With a Replay_log, RX is an input of its own, recorded or
+// replayed, and replaying doesn't read the host file descriptor.
+//
+// Line control, the divisor latch and modem control are kept for the driver but change
+// nothing, except for the loopback of MCR.
+class Uart16550 : public Memory {
+  public:
+    static constexpr std::size_t fifo_depth{16};
+
+    enum Register : std::size_t {
+      // RBR on read, THR on write. DLL with LCR.DLAB.
+      RBR = 0,
+      THR = 0,
+      DLL = 0,
+      // DLM with LCR.DLAB.
+      IER = 1,
+      DLM = 1,
+      // IIR on read, FCR on write.
+      IIR = 2,
+      FCR = 2,
+      LCR = 3,
+      MCR = 4,
+      LSR = 5,
+      MSR = 6,
+      SCR = 7,
+    };
+    enum Bits : std::uint8_t {
+      IER_ERBFI     = 1 << 0,
+      IER_ETBEI     = 1 << 1,
+      IIR_NO_IRQ    = 0x01,
+      IIR_THRE      = 0x02,
+      IIR_RX_DATA   = 0x04,
+      IIR_FIFOS     = 0xc0,
+      FCR_FIFO_EN   = 1 << 0,
+      FCR_RX_RESET  = 1 << 1,
+      LCR_DLAB      = 1 << 7,
+      MCR_LOOPBACK  = 1 << 4,
+      LSR_DR        = 1 << 0,
+      LSR_OE        = 1 << 1,
+      LSR_THRE      = 1 << 5,
+      LSR_TEMT      = 1 << 6,
+      // CTS, DSR and DCD: a terminal is always there.
+      MSR_CONNECTED = 0xb0,
+    };
+
+    enum class Tx_mode {
+      // Written out at a newline, when the buffer is full and `tx_flush_delay` of virtual
+      // time after the first byte that waits.
+      line,
+      // Written out by a host thread, so the guest doesn't wait for the host.
+      thread,
+      // Dropped and only counted, e.g. for benchmarks.
+      discard,
+    };
+
+    struct Config {
+      Tx_mode tx_mode{Tx_mode::line};
+      int tx_fd{1};
+      std::size_t tx_buffer{4096};
+      Scheduler::Time tx_flush_delay{1'000'000};
+      // None if negative.
+      int rx_fd{-1};
+      Scheduler::Time rx_poll_interval{10'000};
+      unsigned int reg_shift{0};
+    };
+
+    Uart16550(Scheduler &scheduler, const Config &config, Plic *plic = nullptr,
+        unsigned int irq_source = 0, Replay_log *replay_log = nullptr);
+    Uart16550(const Uart16550&) = delete;
+    Uart16550& operator=(const Uart16550&) = delete;
+    // Writes out what is left of TX.
+    ~Uart16550() override;
+
+    void write(std::size_t addr, Uxlen data, unsigned int byte_en = 0xf) override;
+    [[nodiscard]] Uxlen read (std::size_t addr, unsigned int byte_en = 0xf) override;
+
+    // Host side of the RX line. What doesn't fit in the FIFO is lost with an overrun.
+    void receive(std::string_view input);
+    void flush();
+
+    // Bytes the guest transmitted, including discarded ones.
+    [[nodiscard]] std::uint64_t get_tx_bytes() const { return m_tx_bytes; }
+
+  private:
+    Scheduler &m_scheduler;
+    const Config m_config;
+    Plic *const m_plic;
+    const unsigned int m_irq_source;
+    Replay_log *const m_replay_log;
+    Replay_log::Channel m_rx_channel{0};
+
+    std::unique_ptr<Host_output> m_line_output{};
+    std::unique_ptr<Async_host_output> m_thread_output{};
+    std::optional<Scheduler::Event_id> m_flush_event{};
+    std::optional<Scheduler::Event_id> m_poll_event{};
+    std::uint64_t m_tx_bytes{0};
+
+    std::deque<char> m_rx_fifo{};
+    std::uint8_t m_ier{0};
+    std::uint8_t m_lcr{0};
+    std::uint8_t m_mcr{0};
+    std::uint8_t m_scr{0};
+    std::uint8_t m_dll{0};
+    std::uint8_t m_dlm{0};
+    bool m_fifos_enabled{false};
+    bool m_overrun{false};
+    // Reading IIR while it reports THR empty acknowledges it.
+    bool m_thre_pending{false};
+
+    void write_reg(std::size_t reg, std::uint8_t data);
+    [[nodiscard]] std::uint8_t read_reg(std::size_t reg);
+    [[nodiscard]] std::uint8_t get_iir() const;
+    void transmit(char c);
+    void push_rx(char c);
+    void poll_rx();
+    void update_irq();
+};
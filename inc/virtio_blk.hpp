@@ -0,0 +1,151 @@
+#pragma once
+
+#include "memory.hpp"
+#include "plic.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Virtio block device on the MMIO transport, version 2, with a single request queue. The
+// disk is a host image file mapped into memory, so a request is served by copying straight
+// between the guest buffers and the mapping: through the host pointers of `dma` where guest
+// memory is host memory, a single memcpy per buffer. The kernel writes dirty pages back in
+// the background and a flush request waits for it.
+//
+// Requests are served synchronously on the queue notification and completed by raising the
+// interrupt line, which stays high until the guest acknowledges every interrupt status bit.
+// A request touching memory outside of `dma` marks the device as needing a reset.
+template <unsigned int xlen>
+class Basic_virtio_blk : public Memory {
+  public:
+    enum Register : std::size_t {
+      MAGIC_VALUE         = 0x000,
+      VERSION             = 0x004,
+      DEVICE_ID           = 0x008,
+      VENDOR_ID           = 0x00c,
+      DEVICE_FEATURES     = 0x010,
+      DEVICE_FEATURES_SEL = 0x014,
+      DRIVER_FEATURES     = 0x020,
+      DRIVER_FEATURES_SEL = 0x024,
+      QUEUE_SEL           = 0x030,
+      QUEUE_NUM_MAX       = 0x034,
+      QUEUE_NUM           = 0x038,
+      QUEUE_READY         = 0x044,
+      QUEUE_NOTIFY        = 0x050,
+      INTERRUPT_STATUS    = 0x060,
+      INTERRUPT_ACK       = 0x064,
+      STATUS              = 0x070,
+      QUEUE_DESC_LOW      = 0x080,
+      QUEUE_DESC_HIGH     = 0x084,
+      QUEUE_DRIVER_LOW    = 0x090,
+      QUEUE_DRIVER_HIGH   = 0x094,
+      QUEUE_DEVICE_LOW    = 0x0a0,
+      QUEUE_DEVICE_HIGH   = 0x0a4,
+      CONFIG_GENERATION   = 0x0fc,
+      // capacity in sectors, a 64-bit word, then the rest of virtio_blk_config.
+      CONFIG              = 0x100,
+      CONFIG_BLK_SIZE     = 0x114,
+    };
+    enum Request_type : std::uint32_t {
+      T_IN     = 0,
+      T_OUT    = 1,
+      T_FLUSH  = 4,
+      T_GET_ID = 8,
+    };
+    enum Request_status : std::uint8_t {
+      S_OK     = 0,
+      S_IOERR  = 1,
+      S_UNSUPP = 2,
+    };
+    static constexpr Uxlen STATUS_NEEDS_RESET{0x40};
+    static constexpr Uxlen INTERRUPT_USED_BUFFER  {1 << 0};
+    static constexpr Uxlen INTERRUPT_CONFIG_CHANGE{1 << 1};
+
+    static constexpr std::uint32_t magic{0x74726976};
+    static constexpr std::uint32_t block_device{2};
+    static constexpr std::uint32_t queue_num_max{256};
+    static constexpr std::size_t sector_size{512};
+
+    static constexpr std::uint64_t F_RO       {std::uint64_t{1} << 5};
+    static constexpr std::uint64_t F_BLK_SIZE {std::uint64_t{1} << 6};
+    static constexpr std::uint64_t F_FLUSH    {std::uint64_t{1} << 9};
+    static constexpr std::uint64_t F_VERSION_1{std::uint64_t{1} << 32};
+
+    // Maps the image, whose size is rounded down to whole sectors. Throws Errors::Error if it
+    // can't be opened or mapped.
+    Basic_virtio_blk(Basic_memory<xlen> &dma, const std::string &image_path, bool read_only,
+        Plic &plic, unsigned int irq_source);
+    Basic_virtio_blk(const Basic_virtio_blk&) = delete;
+    Basic_virtio_blk& operator=(const Basic_virtio_blk&) = delete;
+    ~Basic_virtio_blk() override;
+
+    void write(std::size_t addr, Uxlen data, unsigned int byte_en = 0xf) override;
+    [[nodiscard]] Uxlen read (std::size_t addr, unsigned int byte_en = 0xf) override;
+
+    [[nodiscard]] std::uint64_t get_capacity() const { return m_image.size() / sector_size; }
+    [[nodiscard]] std::uint64_t get_requests() const { return m_requests; }
+
+  private:
+    // A guest buffer of a descriptor chain.
+    struct Segment {
+      std::uint64_t addr{0};
+      std::uint32_t len{0};
+    };
+    static constexpr std::uint16_t DESC_F_NEXT {1};
+    static constexpr std::uint16_t DESC_F_WRITE{2};
+    static constexpr std::uint16_t AVAIL_F_NO_INTERRUPT{1};
+    static constexpr std::size_t header_size{16};
+
+    Basic_memory<xlen> &m_dma;
+    const bool m_read_only;
+    Plic &m_plic;
+    const unsigned int m_irq_source;
+    int m_fd{-1};
+    std::span<std::byte> m_image{};
+    std::uint64_t m_requests{0};
+
+    Uxlen m_status{0};
+    Uxlen m_interrupt_status{0};
+    Uxlen m_device_features_sel{0};
+    Uxlen m_driver_features_sel{0};
+    std::uint64_t m_driver_features{0};
+    Uxlen m_queue_sel{0};
+    Uxlen m_queue_num{0};
+    bool m_queue_ready{false};
+    std::uint64_t m_desc{0};
+    std::uint64_t m_avail{0};
+    std::uint64_t m_used{0};
+    std::uint16_t m_last_avail{0};
+    std::uint16_t m_used_idx{0};
+    // The chain of the current request, split into the parts the device reads and writes.
+    // Kept to reuse their storage.
+    std::vector<Segment> m_readable{};
+    std::vector<Segment> m_writable{};
+
+    [[nodiscard]] std::uint64_t get_features() const;
+    void reset();
+    void process_queue();
+    // Returns the bytes written to the guest.
+    [[nodiscard]] std::uint32_t serve(std::uint16_t head);
+    // The data are the readable bytes past the header for T_OUT and the writable bytes but
+    // the status for the others.
+    [[nodiscard]] Request_status execute(std::uint32_t type, std::uint64_t sector,
+        std::uint64_t data_size);
+    void read_chain(std::uint16_t head);
+    // Copy between the buffers of the chain, from byte `offset` of them on, and the host.
+    void copy_from_guest(const std::vector<Segment> &segments, std::uint64_t offset,
+        std::span<std::byte> data);
+    void copy_to_guest(const std::vector<Segment> &segments, std::uint64_t offset,
+        std::span<const std::byte> data);
+    template <typename T>
+    [[nodiscard]] T load(std::uint64_t addr);
+    template <typename T>
+    void store(std::uint64_t addr, T value);
+    void update_irq();
+};
+
+using Virtio_blk   = Basic_virtio_blk<32>;
+using Virtio_blk64 = Basic_virtio_blk<64>;
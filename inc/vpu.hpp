@@ -0,0 +1,138 @@
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Integer subset of the V extension. Vector registers are VLEN = 128 or 256 bits wide and
+// hold their elements in guest (little-endian) byte order, so unit-stride loads and stores
+// are plain copies and a register group is a contiguous run of bytes.
+//
+// Operations run a host vector at a time where the host has the instruction for the
+// element width: with AVX2 when the build targets it (e.g. -march=native), otherwise with
+// SSE2 on x86. Other ops, widths and hosts, and the elements left over at the end, take an
+// element by element loop.
+namespace Vpu {
+  constexpr unsigned int max_vlen{256};
+  // Bytes of the largest register group, LMUL = 8.
+  constexpr std::size_t max_group_bytes{8 * max_vlen / CHAR_BIT};
+
+  // Element width, the vsew field of vtype.
+  enum class Sew : unsigned int {
+    e8 ,
+    e16,
+    e32,
+    e64,
+  };
+
+  [[nodiscard("PURE FUN")]] constexpr std::size_t get_bytes(Sew sew) {
+    return std::size_t{1} << static_cast<unsigned int>(sew);
+  }
+
+  struct Vtype {
+    Sew sew{Sew::e8};
+    // log2(LMUL), from -3 for 1/8 to 3 for 8.
+    int lmul_log2{0};
+    bool tail_agnostic{false};
+    bool mask_agnostic{false};
+  };
+
+  // Empty for a reserved vtype, which sets vill. ELEN is 64, so fractional LMULs must
+  // leave room for an element: SEW <= LMUL * 64.
+  [[nodiscard("PURE FUN")]] std::optional<Vtype> decode_vtype(std::uint64_t vtype);
+
+  [[nodiscard("PURE FUN")]] constexpr std::size_t get_vlmax(unsigned int vlen, Vtype vtype) {
+    const int shift{vtype.lmul_log2 - static_cast<int>(vtype.sew) - 3};
+    return (shift < 0) ? std::size_t{vlen} >> -shift : std::size_t{vlen} << shift;
+  }
+
+  class Vrf {
+    public:
+      using Container = std::vector<std::byte>;
+
+      explicit Vrf(unsigned int vlen) : m_vlenb{vlen / CHAR_BIT}, m_registers(32 * m_vlenb) {}
+
+      [[nodiscard]] unsigned int get_vlen () const { return m_vlenb * CHAR_BIT; }
+      [[nodiscard]] unsigned int get_vlenb() const { return m_vlenb; }
+
+      // A register group continues into the following registers.
+      [[nodiscard]] std::byte* get(unsigned int reg) {
+        return m_registers.data() + std::size_t{reg} * m_vlenb;
+      }
+
+      [[nodiscard]] const Container& get_content() const {
+        return m_registers;
+      }
+
+    private:
+      unsigned int m_vlenb;
+      Container m_registers;
+  };
+
+  // vs2 is the first operand and vs1 (or the scalar of the .vx and .vi forms) the second
+  // one, e.g. SUB is vs2 - vs1 and SLT is vs2 < vs1.
+  enum Op {
+    // Vector result.
+    ADD   ,
+    SUB   ,
+    RSUB  ,
+    AND   ,
+    OR    ,
+    XOR   ,
+    MINU  ,
+    MIN   ,
+    MAXU  ,
+    MAX   ,
+    SLL   ,
+    SRL   ,
+    SRA   ,
+    MUL   ,
+    MULH  ,
+    MULHU ,
+    MULHSU,
+    // vs1, or vs2 where the mask is clear: vmv.v and vmerge.
+    MERGE ,
+    // Mask result.
+    SEQ   ,
+    SNE   ,
+    SLTU  ,
+    SLT   ,
+    SLEU  ,
+    SLE   ,
+    SGTU  ,
+    SGT   ,
+    // Element 0 from element 0 of vs1 and the elements of vs2.
+    REDSUM ,
+    REDAND ,
+    REDOR  ,
+    REDXOR ,
+    REDMINU,
+    REDMIN ,
+    REDMAXU,
+    REDMAX ,
+  };
+
+  [[nodiscard("PURE FUN")]] constexpr bool is_mask_result(Op op) {
+    return (op >= SEQ) && (op <= SGT);
+  }
+  [[nodiscard("PURE FUN")]] constexpr bool is_reduction(Op op) { return op >= REDSUM; }
+
+  [[nodiscard("PURE FUN")]] inline bool is_active(const std::byte *mask, std::size_t i) {
+    return std::to_integer<unsigned int>(mask[i / CHAR_BIT] >> (i % CHAR_BIT)) & 1u;
+  }
+
+  // Writes the body elements [0, vl) of `vd` where `mask` is set, or all of them without a
+  // mask. Masked-off and tail elements are left undisturbed, which the agnostic policies
+  // allow too. MERGE uses the mask as a selector and writes every body element.
+  void calc(Op op, Sew sew, std::size_t vl, std::byte *vd, const std::byte *vs2,
+      const std::byte *vs1, const std::byte *mask = nullptr);
+
+  // The scalar operand of the .vx and .vi forms, truncated to SEW, in elements [0, vl).
+  void splat(Sew sew, std::size_t vl, std::byte *vd, std::uint64_t value);
+
+  // Zero-extended.
+  [[nodiscard]] std::uint64_t get_element(Sew sew, const std::byte *vreg, std::size_t i);
+  void set_element(Sew sew, std::byte *vreg, std::size_t i, std::uint64_t value);
+}
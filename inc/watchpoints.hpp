@@ -0,0 +1,123 @@
+#pragma once
+
+#include "memory.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+// Data watchpoints of a debugger, kept by page. Memories that hand out host pointers refuse
+// them for a watched page, so that accesses to it take the slow path, where `check`
+// compares them with the exact ranges. Accesses to every other page stay on the fast path
+// and are never looked at.
+//
+// An Mmu given the watchpoints keeps the watched pages out of its TLB's fast path, and the
+// addresses are virtual. Without an Mmu, Watch_mem_wrap does the same for the memory it
+// wraps. Whatever caches host pointers subscribes to changes of the watched pages.
+//
+// The access completes before the callback is called, so a debugger stops after the
+// instruction, as with hardware watchpoints.
+template <unsigned int xlen>
+class Basic_watchpoints {
+  public:
+    static constexpr std::size_t page_size{4096};
+
+    enum class Kind {
+      write,
+      read,
+      access,
+    };
+    struct Hit {
+      // The start of the watched range.
+      std::size_t addr{0};
+      Kind kind{Kind::write};
+    };
+    using Callback = std::function<void(const Hit&)>;
+    using Invalidator = std::function<void()>;
+    using Subscription = std::size_t;
+
+    Basic_watchpoints() = default;
+    Basic_watchpoints(const Basic_watchpoints&) = delete;
+    Basic_watchpoints& operator=(const Basic_watchpoints&) = delete;
+
+    void set_callback(Callback callback) { m_callback = std::move(callback); }
+    // `invalidate` is called whenever a page starts or stops being watched.
+    [[nodiscard]] Subscription subscribe(Invalidator invalidate);
+    void unsubscribe(Subscription subscription) { m_invalidators.erase(subscription); }
+
+    // Watches the bytes [addr, addr + size).
+    void insert(std::size_t addr, std::size_t size, Kind kind);
+    // Returns whether there was one.
+    bool erase(std::size_t addr, std::size_t size, Kind kind);
+    void clear();
+
+    // Whether [addr, addr + size) shares a page with a watchpoint.
+    [[nodiscard]] bool is_watched(std::size_t addr, std::size_t size) const {
+      return !m_pages.empty() && is_any_page_watched(addr, size);
+    }
+    // Of the lanes enabled in `byte_en` of the word at `addr`, on the slow path.
+    void check(std::size_t addr, unsigned int byte_en, Kind access) {
+      if (!m_pages.empty()) [[unlikely]] check_ranges(addr, byte_en, access);
+    }
+
+  private:
+    struct Watchpoint {
+      std::size_t addr{0};
+      std::size_t size{0};
+      Kind kind{Kind::write};
+    };
+
+    std::vector<Watchpoint> m_watchpoints{};
+    // Watchpoints on each watched page.
+    std::unordered_map<std::size_t, unsigned int> m_pages{};
+    Callback m_callback{};
+    std::map<Subscription, Invalidator> m_invalidators{};
+    Subscription m_next_subscription{0};
+
+    [[nodiscard]] bool is_any_page_watched(std::size_t addr, std::size_t size) const;
+    void check_ranges(std::size_t addr, unsigned int byte_en, Kind access);
+    // Adds `delta` to the count of each page of the watchpoint.
+    void count_pages(const Watchpoint &watchpoint, int delta);
+    void invalidate() const;
+};
+
+using Watchpoints   = Basic_watchpoints<32>;
+using Watchpoints64 = Basic_watchpoints<64>;
+
+// Loads and stores of a memory, usually the data memory of a core without an Mmu, checked
+// against watchpoints. Host pointers are handed out only for unwatched pages, so block
+// accesses and atomics fall back to checked word accesses on watched ones.
+template <unsigned int xlen>
+class Basic_watch_mem_wrap : public Basic_memory<xlen> {
+  public:
+    using Data = Uxlen_t<xlen>;
+    using Kind = typename Basic_watchpoints<xlen>::Kind;
+    using Basic_memory<xlen>::full_byte_en;
+
+    Basic_watch_mem_wrap(Basic_memory<xlen> &memory, Basic_watchpoints<xlen> &watchpoints)
+        : m_memory{memory}, m_watchpoints{watchpoints} {}
+    Basic_watch_mem_wrap(const Basic_watch_mem_wrap&) = delete;
+    Basic_watch_mem_wrap& operator=(const Basic_watch_mem_wrap&) = delete;
+
+    void write(std::size_t addr, Data data, unsigned int byte_en = full_byte_en) override {
+      m_memory.write(addr, data, byte_en);
+      m_watchpoints.check(addr, byte_en, Kind::write);
+    }
+    [[nodiscard]] Data read (std::size_t addr, unsigned int byte_en = full_byte_en) override {
+      const Data data{m_memory.read(addr, byte_en)};
+      m_watchpoints.check(addr, byte_en, Kind::read);
+      return data;
+    }
+    [[nodiscard]] std::byte* get_host_ptr(std::size_t addr, std::size_t size) override {
+      return m_watchpoints.is_watched(addr, size) ? nullptr : m_memory.get_host_ptr(addr, size);
+    }
+
+  private:
+    Basic_memory<xlen> &m_memory;
+    Basic_watchpoints<xlen> &m_watchpoints;
+};
+
+using Watch_mem_wrap   = Basic_watch_mem_wrap<32>;
+using Watch_mem_wrap64 = Basic_watch_mem_wrap<64>;
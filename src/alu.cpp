@@ -1,23 +1,83 @@
 #include "alu.hpp"
 
+#include "riscv_algos.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
 #include <string>
 #include <cassert>
 
 namespace {
   using enum Alu::Op;
 
-  std::pair<Uxlen, bool> calculate(Alu::Op op, Uxlen a, Uxlen b) {
-      const Sxlen a_signed{static_cast<Sxlen>(a)};
-      const Sxlen b_signed{static_cast<Sxlen>(b)};
+  // Division by zero and overflow don't trap, the results are fixed by the spec.
+  template <typename Signed, typename Unsigned = std::make_unsigned_t<Signed>>
+  Unsigned divide(Signed a, Signed b) {
+    if (b == 0) return static_cast<Unsigned>(-1);
+    if ((a == std::numeric_limits<Signed>::min()) && (b == -1)) return static_cast<Unsigned>(a);
+    return static_cast<Unsigned>(a / b);
+  }
+  template <typename Signed, typename Unsigned = std::make_unsigned_t<Signed>>
+  Unsigned remainder(Signed a, Signed b) {
+    if (b == 0) return static_cast<Unsigned>(a);
+    if ((a == std::numeric_limits<Signed>::min()) && (b == -1)) return 0;
+    return static_cast<Unsigned>(a % b);
+  }
+
+  // Shift amount, bit index or rotation amount held by the low bits of the operand.
+  template <typename Data>
+  [[nodiscard("PURE FUN")]] int get_index(Data b) {
+    return static_cast<int>(b & (sizeof(Data) * CHAR_BIT - 1));
+  }
+
+  template <typename Data>
+  [[nodiscard("PURE FUN")]] Data or_combine_bytes(Data a) {
+    Data result{0};
+    for (unsigned int byte{0}; byte < sizeof(Data); ++byte) {
+      if ((a >> (byte * CHAR_BIT)) & 0xff) result |= Data{0xff} << (byte * CHAR_BIT);
+    }
+    return result;
+  }
+
+  template <typename Data>
+  [[nodiscard("PURE FUN")]] Data reverse_bytes(Data a) {
+    Data result{0};
+    for (unsigned int byte{0}; byte < sizeof(Data); ++byte) {
+      result = (result << CHAR_BIT) | ((a >> (byte * CHAR_BIT)) & 0xff);
+    }
+    return result;
+  }
+
+  template <unsigned int xlen>
+  std::pair<Uxlen_t<xlen>, bool> calculate(Alu::Op op, Uxlen_t<xlen> a, Uxlen_t<xlen> b);
+
+  // The W ops of RV64: the RV32 op on the low words, sign-extended.
+  [[nodiscard("PURE FUN")]] std::uint64_t calculate_word(Alu::Op op, std::uint64_t a,
+      std::uint64_t b) {
+    const std::uint32_t result{calculate<32>(op, static_cast<std::uint32_t>(a),
+        static_cast<std::uint32_t>(b)).first};
+    return static_cast<std::uint64_t>(static_cast<std::int64_t>(static_cast<std::int32_t>(result)));
+  }
+
+  template <unsigned int xlen>
+  std::pair<Uxlen_t<xlen>, bool> calculate(Alu::Op op, Uxlen_t<xlen> a, Uxlen_t<xlen> b) {
+      using Data   = Uxlen_t <xlen>;
+      using Sdata  = Sxlen_t <xlen>;
+      using Udata2 = Udxlen_t<xlen>;
+      using Sdata2 = Sdxlen_t<xlen>;
+
+      const Sdata a_signed{static_cast<Sdata>(a)};
+      const Sdata b_signed{static_cast<Sdata>(b)};
 
       const auto get_shamt = [b]() {
-        constexpr Uxlen shamt_mask{(sizeof(Uxlen) * 8) - 1};
-        assert((b & shamt_mask) == b);
-        return b;
+        return get_index(b);
       };
+      // Low word of `a` for the .uw ops.
+      const Data a_word{static_cast<std::uint32_t>(a)};
 
-      Uxlen result{};
-      bool  flag  {};
+      Data result{};
+      bool flag  {};
 
       switch (op) {
         case ADD : result = a + b                                      ; break;
@@ -25,7 +85,7 @@ namespace {
         case XOR : result = a ^ b                                      ; break;
         case OR  : result = a | b                                      ; break;
         case AND : result = a & b                                      ; break;
-        case SRA : result = static_cast<Uxlen>(a_signed >> get_shamt()); break;
+        case SRA : result = static_cast<Data>(a_signed >> get_shamt()) ; break;
         case SRL : result = a >> get_shamt()                           ; break;
         case SLL : result = a << get_shamt()                           ; break;
         case SLTS: result = a_signed < b_signed                        ; break;
@@ -36,7 +96,68 @@ namespace {
         case GEU : flag   = a >= b                                     ; break;
         case EQ  : flag   = a == b                                     ; break;
         case NE  : flag   = a != b                                     ; break;
-        default  : assert((void("Unknown_alu_op " + std::to_string(op)), 0));
+        case MUL   : result = a * b; break;
+        case MULH  : result = static_cast<Data>(
+            (Sdata2{a_signed} * Sdata2{b_signed}) >> xlen); break;
+        case MULHSU: result = static_cast<Data>(
+            (Sdata2{a_signed} * static_cast<Sdata2>(Udata2{b})) >> xlen); break;
+        case MULHU : result = static_cast<Data>((Udata2{a} * Udata2{b}) >> xlen); break;
+        case DIV   : result = divide(a_signed, b_signed); break;
+        case DIVU  : result = (b == 0) ? static_cast<Data>(-1) : a / b; break;
+        case REM   : result = remainder(a_signed, b_signed); break;
+        case REMU  : result = (b == 0) ? a : a % b; break;
+        case SH1ADD: result = (a << 1) + b; break;
+        case SH2ADD: result = (a << 2) + b; break;
+        case SH3ADD: result = (a << 3) + b; break;
+        case ANDN  : result = a & ~b; break;
+        case ORN   : result = a | ~b; break;
+        case XNOR  : result = ~(a ^ b); break;
+        case CLZ   : result = static_cast<Data>(std::countl_zero(a)); break;
+        case CTZ   : result = static_cast<Data>(std::countr_zero(a)); break;
+        case CPOP  : result = static_cast<Data>(std::popcount(a)); break;
+        case MAX   : result = static_cast<Data>(std::max(a_signed, b_signed)); break;
+        case MAXU  : result = std::max(a, b); break;
+        case MIN   : result = static_cast<Data>(std::min(a_signed, b_signed)); break;
+        case MINU  : result = std::min(a, b); break;
+        case SEXTB : result = extract_bits(a, { 7, 0}, true); break;
+        case SEXTH : result = extract_bits(a, {15, 0}, true); break;
+        case ZEXTH : result = extract_bits(a, {15, 0}); break;
+        case ROL   : result = std::rotl(a, get_index(b)); break;
+        case ROR   : result = std::rotr(a, get_index(b)); break;
+        case ORCB  : result = or_combine_bytes(a); break;
+        case REV8  : result = reverse_bytes(a); break;
+        case BCLR  : result = a & ~(Data{1} << get_index(b)); break;
+        case BEXT  : result = (a >> get_index(b)) & 1; break;
+        case BINV  : result = a ^ (Data{1} << get_index(b)); break;
+        case BSET  : result = a | (Data{1} << get_index(b)); break;
+        default:
+          if constexpr (xlen == 64) {
+            switch (op) {
+              case ADDW : result = calculate_word(ADD , a, b); break;
+              case SUBW : result = calculate_word(SUB , a, b); break;
+              case SLLW : result = calculate_word(SLL , a, b); break;
+              case SRLW : result = calculate_word(SRL , a, b); break;
+              case SRAW : result = calculate_word(SRA , a, b); break;
+              case MULW : result = calculate_word(MUL , a, b); break;
+              case DIVW : result = calculate_word(DIV , a, b); break;
+              case DIVUW: result = calculate_word(DIVU, a, b); break;
+              case REMW : result = calculate_word(REM , a, b); break;
+              case REMUW: result = calculate_word(REMU, a, b); break;
+              case CLZW : result = calculate_word(CLZ , a, b); break;
+              case CTZW : result = calculate_word(CTZ , a, b); break;
+              case CPOPW: result = calculate_word(CPOP, a, b); break;
+              case ROLW : result = calculate_word(ROL , a, b); break;
+              case RORW : result = calculate_word(ROR , a, b); break;
+              case ADDUW   : result = a_word + b; break;
+              case SH1ADDUW: result = (a_word << 1) + b; break;
+              case SH2ADDUW: result = (a_word << 2) + b; break;
+              case SH3ADDUW: result = (a_word << 3) + b; break;
+              case SLLIUW  : result = a_word << get_shamt(); break;
+              default: assert((void("Unknown_alu_op " + std::to_string(op)), 0));
+            }
+          } else {
+            assert((void("Unknown_alu_op " + std::to_string(op)), 0));
+          }
       }
 
       return {result, flag};
@@ -44,13 +165,20 @@ namespace {
 }
 
 namespace Alu {
-  Uxlen calc_result(Alu::Op op, Uxlen a, Uxlen b) {
-    const auto [result, flag] = calculate(op, a, b);
+  template <unsigned int xlen>
+  Uxlen_t<xlen> calc_result(Alu::Op op, Uxlen_t<xlen> a, Uxlen_t<xlen> b) {
+    const auto [result, flag] = calculate<xlen>(op, a, b);
     return result;
   }
 
-  bool calc_flag(Alu::Op op, Uxlen a, Uxlen b) {
-    const auto [result, flag] = calculate(op, a, b);
+  template <unsigned int xlen>
+  bool calc_flag(Alu::Op op, Uxlen_t<xlen> a, Uxlen_t<xlen> b) {
+    const auto [result, flag] = calculate<xlen>(op, a, b);
     return flag;
   }
+
+  template Uxlen_t<32> calc_result<32>(Op, Uxlen_t<32>, Uxlen_t<32>);
+  template Uxlen_t<64> calc_result<64>(Op, Uxlen_t<64>, Uxlen_t<64>);
+  template bool calc_flag<32>(Op, Uxlen_t<32>, Uxlen_t<32>);
+  template bool calc_flag<64>(Op, Uxlen_t<64>, Uxlen_t<64>);
 }
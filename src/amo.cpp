@@ -0,0 +1,73 @@
+#include "amo.hpp"
+
+#include <algorithm>
+#include <type_traits>
+
+#include <cassert>
+
+namespace {
+  using enum Amo::Op;
+
+  template <typename T>
+  [[nodiscard]] std::atomic_ref<T> to_atomic(std::byte *host) {
+    assert(!(reinterpret_cast<std::uintptr_t>(host) % std::atomic_ref<T>::required_alignment) &&
+        "Misaligned atomic");
+    return std::atomic_ref<T>{*reinterpret_cast<T*>(host)};
+  }
+}
+
+template <typename T>
+T Amo::calc(Op op, T loaded, T operand) {
+  using S = std::make_signed_t<T>;
+  switch (op) {
+    case SWAP: return operand;
+    case ADD : return loaded + operand;
+    case XOR : return loaded ^ operand;
+    case AND : return loaded & operand;
+    case OR  : return loaded | operand;
+    case MIN : return (static_cast<S>(loaded) < static_cast<S>(operand)) ? loaded : operand;
+    case MAX : return (static_cast<S>(loaded) > static_cast<S>(operand)) ? loaded : operand;
+    case MINU: return std::min(loaded, operand);
+    case MAXU: return std::max(loaded, operand);
+    default: assert(0 && "Not a read-modify-write AMO");
+  }
+}
+
+template <typename T>
+T Amo::load(const std::byte *host) {
+  // atomic_ref of a const object is C++26, and nothing is written here.
+  return to_atomic<T>(const_cast<std::byte*>(host)).load();
+}
+
+// The host has instructions for the arithmetic and logic ones; min and max retry a
+// compare-exchange.
+template <typename T>
+T Amo::fetch_op(Op op, std::byte *host, T operand) {
+  std::atomic_ref<T> atomic{to_atomic<T>(host)};
+  switch (op) {
+    case SWAP: return atomic.exchange (operand);
+    case ADD : return atomic.fetch_add(operand);
+    case XOR : return atomic.fetch_xor(operand);
+    case AND : return atomic.fetch_and(operand);
+    case OR  : return atomic.fetch_or (operand);
+    default: {
+      T loaded{atomic.load()};
+      while (!atomic.compare_exchange_weak(loaded, calc(op, loaded, operand))) {}
+      return loaded;
+    }
+  }
+}
+
+template <typename T>
+bool Amo::compare_exchange(std::byte *host, T expected, T desired) {
+  return to_atomic<T>(host).compare_exchange_strong(expected, desired);
+}
+
+template std::uint32_t Amo::calc<std::uint32_t>(Op, std::uint32_t, std::uint32_t);
+template std::uint64_t Amo::calc<std::uint64_t>(Op, std::uint64_t, std::uint64_t);
+template std::uint32_t Amo::load<std::uint32_t>(const std::byte*);
+template std::uint64_t Amo::load<std::uint64_t>(const std::byte*);
+template std::uint32_t Amo::fetch_op<std::uint32_t>(Op, std::byte*, std::uint32_t);
+template std::uint64_t Amo::fetch_op<std::uint64_t>(Op, std::byte*, std::uint64_t);
+template bool Amo::compare_exchange<std::uint32_t>(std::byte*, std::uint32_t, std::uint32_t);
+template bool Amo::compare_exchange<std::uint64_t>(std::byte*, std::uint64_t, std::uint64_t);
@@ -0,0 +1,169 @@
+#include "clint.hpp"
+
+#include "exception.hpp"
+#include "riscv_algos.hpp"
+
+#include <algorithm>
+
+#include <cassert>
+
+namespace {
+  void set_low (std::uint64_t &reg, Uxlen data) {
+    reg = (reg & ~make_mask<std::uint64_t>(32)) | data;
+  }
+  void set_high(std::uint64_t &reg, Uxlen data) {
+    reg = (reg &  make_mask<std::uint64_t>(32)) | (std::uint64_t{data} << 32);
+  }
+  Uxlen get_low (std::uint64_t reg) { return static_cast<Uxlen>(reg); }
+  Uxlen get_high(std::uint64_t reg) { return static_cast<Uxlen>(reg >> 32); }
+}
+
+Clint::Clint(std::vector<Irq_pending*> harts, Scheduler *scheduler,
+    std::uint64_t instructions_per_tick)
+    : m_scheduler{scheduler}, m_instructions_per_tick{instructions_per_tick} {
+  assert(!harts.empty() && (harts.size() <= max_harts) && "Clint. Unsupported number of harts");
+  for (Irq_pending *irq_pending : harts) m_harts.push_back({.irq_pending = irq_pending});
+}
+
+Clint::~Clint() {
+  if (!m_scheduler) return;
+  for (const Hart &hart : m_harts) {
+    if (hart.timer_event) m_scheduler->cancel(*hart.timer_event);
+  }
+  if (m_tick_event) m_scheduler->cancel(*m_tick_event);
+}
+
+void Clint::write(std::size_t addr, Uxlen data, unsigned int byte_en) {
+  assert((byte_en == 0xf) && "only word access is supported");
+  if (Hart *hart{get_hart(addr, MSIP, 4)}) {
+    hart->irq_pending->set(Irq::MSI, extract_bits(data, 0));
+    return;
+  }
+
+  const std::scoped_lock lock{m_mutex};
+  if (Hart *hart{get_hart(addr, MTIMECMP, 8)}) {
+    if (addr % 8) {
+      set_high(hart->mtimecmp, data);
+    } else {
+      set_low (hart->mtimecmp, data);
+    }
+    update_timer_irq(*hart);
+    return;
+  }
+  std::uint64_t mtime{get_mtime()};
+  switch (addr) {
+    case MTIME  : set_low (mtime, data); break;
+    case MTIME_H: set_high(mtime, data); break;
+    default: throw Errors::Illegal_addr{addr, "Clint. Write to unknown register."};
+  }
+  set_time(mtime);
+  update_timer_irqs();
+}
+
+Uxlen Clint::read(std::size_t addr, unsigned int byte_en) {
+  assert((byte_en == 0xf) && "only word access is supported");
+  if (const Hart *hart{get_hart(addr, MSIP, 4)}) {
+    return extract_bits(hart->irq_pending->get(), Irq::MSI);
+  }
+
+  const std::scoped_lock lock{m_mutex};
+  if (const Hart *hart{get_hart(addr, MTIMECMP, 8)}) {
+    return (addr % 8) ? get_high(hart->mtimecmp) : get_low(hart->mtimecmp);
+  }
+  switch (addr) {
+    case MTIME  : arm_tick_event(); return get_low (get_mtime());
+    case MTIME_H: arm_tick_event(); return get_high(get_mtime());
+    default: throw Errors::Illegal_addr{addr, "Clint. Read from unknown register."};
+  }
+}
+
+void Clint::advance(std::uint64_t ticks) {
+  assert(!m_scheduler && "mtime follows the scheduler");
+  const std::scoped_lock lock{m_mutex};
+  m_mtime += ticks;
+  update_timer_irqs();
+}
+
+bool Clint::skip_to_deadline() {
+  assert(!m_scheduler && "the scheduler skips idle time itself");
+  const std::scoped_lock lock{m_mutex};
+  std::uint64_t deadline{std::numeric_limits<std::uint64_t>::max()};
+  for (const Hart &hart : m_harts) {
+    if (hart.mtimecmp > m_mtime) deadline = std::min(deadline, hart.mtimecmp);
+  }
+  if (deadline == std::numeric_limits<std::uint64_t>::max()) return false;
+  m_mtime = deadline;
+  update_timer_irqs();
+  return true;
+}
+
+std::uint64_t Clint::get_time() const {
+  const std::scoped_lock lock{m_mutex};
+  return get_mtime();
+}
+
+std::uint64_t Clint::get_next_deadline() const {
+  const std::scoped_lock lock{m_mutex};
+  std::uint64_t deadline{std::numeric_limits<std::uint64_t>::max()};
+  for (const Hart &hart : m_harts) deadline = std::min(deadline, hart.mtimecmp);
+  return deadline;
+}
+
+Clint::Hart* Clint::get_hart(std::size_t addr, Register base, std::size_t stride) {
+  if ((addr < base) || (addr % 4)) return nullptr;
+  const std::size_t index{(addr - base) / stride};
+  return (index < m_harts.size()) ? &m_harts[index] : nullptr;
+}
+
+std::uint64_t Clint::get_mtime() const {
+  if (!m_scheduler) return m_mtime;
+  return m_mtime + (m_scheduler->get_now() - m_epoch) / m_instructions_per_tick;
+}
+
+void Clint::set_time(std::uint64_t mtime) {
+  m_mtime = mtime;
+  if (m_scheduler) m_epoch = m_scheduler->get_now();
+}
+
+void Clint::update_timer_irqs() {
+  for (Hart &hart : m_harts) update_timer_irq(hart);
+}
+
+void Clint::update_timer_irq(Hart &hart) {
+  const std::uint64_t mtime{get_mtime()};
+  hart.irq_pending->set(Irq::MTI, mtime >= hart.mtimecmp);
+  if (!m_scheduler) return;
+
+  if (hart.timer_event) {
+    m_scheduler->cancel(*hart.timer_event);
+    hart.timer_event.reset();
+  }
+  if (mtime >= hart.mtimecmp) return;
+  // Virtual time of the tick at which mtime reaches mtimecmp.
+  const Scheduler::Time now{m_scheduler->get_now()};
+  const std::uint64_t ticks_left{hart.mtimecmp - mtime};
+  const Scheduler::Time tick_phase{(now - m_epoch) % m_instructions_per_tick};
+  if (ticks_left > (Scheduler::never - now) / m_instructions_per_tick) return;
+  const Scheduler::Time deadline{now - tick_phase + ticks_left * m_instructions_per_tick};
+  hart.timer_event = m_scheduler->schedule_at(deadline, [this, &hart]() {
+    const std::scoped_lock lock{m_mutex};
+    hart.timer_event.reset();
+    update_timer_irq(hart);
+  });
+}
+
+// With several instructions per tick a loop polling mtime reads the same value more than
+// once and looks idle to the core. An event at the next tick bounds how far the scheduler
+// skips time for such a loop.
+void Clint::arm_tick_event() {
+  if (!m_scheduler || (m_instructions_per_tick == 1)) return;
+  const Scheduler::Time now{m_scheduler->get_now()};
+  const Scheduler::Time next_tick{now - (now - m_epoch) % m_instructions_per_tick +
+      m_instructions_per_tick};
+  if (m_tick_event && (m_tick_event_time == next_tick)) return;
+  m_tick_event_time = next_tick;
+  m_tick_event = m_scheduler->schedule_at(next_tick, [this]() {
+    const std::scoped_lock lock{m_mutex};
+    m_tick_event.reset();
+  });
+}
@@ -1,13 +1,23 @@
 #include "core.hpp"
 
 #include "alu.hpp"
+#include "amo.hpp"
 #include "csr.hpp"
 #include "decoder.hpp"
+#include "exception.hpp"
+#include "fpu.hpp"
 #include "lsu.hpp"
 #include "riscv.hpp"
+#include "vpu.hpp"
 
 #include "spdlog/logger.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <limits>
+#include <span>
+#include <type_traits>
 #include <cassert>
 
 namespace {
@@ -50,6 +60,71 @@ namespace {
       case instr_beq : return Alu::EQ  ;
       case instr_bne : return Alu::NE  ;
 
+      case instr_mul   : return Alu::MUL   ;
+      case instr_mulh  : return Alu::MULH  ;
+      case instr_mulhsu: return Alu::MULHSU;
+      case instr_mulhu : return Alu::MULHU ;
+      case instr_div   : return Alu::DIV   ;
+      case instr_divu  : return Alu::DIVU  ;
+      case instr_rem   : return Alu::REM   ;
+      case instr_remu  : return Alu::REMU  ;
+
+      case instr_sh1add: return Alu::SH1ADD;
+      case instr_sh2add: return Alu::SH2ADD;
+      case instr_sh3add: return Alu::SH3ADD;
+      case instr_andn  : return Alu::ANDN  ;
+      case instr_orn   : return Alu::ORN   ;
+      case instr_xnor  : return Alu::XNOR  ;
+      case instr_clz   : return Alu::CLZ   ;
+      case instr_ctz   : return Alu::CTZ   ;
+      case instr_cpop  : return Alu::CPOP  ;
+      case instr_max   : return Alu::MAX   ;
+      case instr_maxu  : return Alu::MAXU  ;
+      case instr_min   : return Alu::MIN   ;
+      case instr_minu  : return Alu::MINU  ;
+      case instr_sext_b: return Alu::SEXTB ;
+      case instr_sext_h: return Alu::SEXTH ;
+      case instr_zext_h: return Alu::ZEXTH ;
+      case instr_rori  :
+      case instr_ror   : return Alu::ROR   ;
+      case instr_rol   : return Alu::ROL   ;
+      case instr_orc_b : return Alu::ORCB  ;
+      case instr_rev8  : return Alu::REV8  ;
+      case instr_bclri :
+      case instr_bclr  : return Alu::BCLR  ;
+      case instr_bexti :
+      case instr_bext  : return Alu::BEXT  ;
+      case instr_binvi :
+      case instr_binv  : return Alu::BINV  ;
+      case instr_bseti :
+      case instr_bset  : return Alu::BSET  ;
+
+      case instr_addiw :
+      case instr_addw  : return Alu::ADDW  ;
+      case instr_subw  : return Alu::SUBW  ;
+      case instr_slliw :
+      case instr_sllw  : return Alu::SLLW  ;
+      case instr_srliw :
+      case instr_srlw  : return Alu::SRLW  ;
+      case instr_sraiw :
+      case instr_sraw  : return Alu::SRAW  ;
+      case instr_mulw  : return Alu::MULW  ;
+      case instr_divw  : return Alu::DIVW  ;
+      case instr_divuw : return Alu::DIVUW ;
+      case instr_remw  : return Alu::REMW  ;
+      case instr_remuw : return Alu::REMUW ;
+      case instr_clzw  : return Alu::CLZW  ;
+      case instr_ctzw  : return Alu::CTZW  ;
+      case instr_cpopw : return Alu::CPOPW ;
+      case instr_rolw  : return Alu::ROLW  ;
+      case instr_roriw :
+      case instr_rorw  : return Alu::RORW  ;
+      case instr_add_uw   : return Alu::ADDUW   ;
+      case instr_sh1add_uw: return Alu::SH1ADDUW;
+      case instr_sh2add_uw: return Alu::SH2ADDUW;
+      case instr_sh3add_uw: return Alu::SH3ADDUW;
+      case instr_slli_uw  : return Alu::SLLIUW  ;
+
       default: assert(0 && "Invalid instr2alu_op conversion");
     }
   }
@@ -92,11 +167,250 @@ namespace {
 
       case instr_lbu: return bu;
       case instr_lhu: return hu;
+      case instr_lwu: return wu;
+
+      case instr_sd:
+      case instr_ld: return d;
+
+      case instr_fsw: return w;
+      case instr_flw: return wu;
+      case instr_fsd:
+      case instr_fld: return d;
 
       default: assert(0 && "Invalid instr2lsu_op conversion");
     }
   }
 
+  struct Fpu_op {
+    Fpu::Op op;
+    Fpu::Format format;
+  };
+
+  Fpu_op to_fpu_op(Decoder::Concrete_instruction instr) {
+    using enum Decoder::Concrete_instruction;
+    switch (instr) {
+      case instr_fmadd_s  : return {Fpu::MADD,        Fpu::Format::s};
+      case instr_fmsub_s  : return {Fpu::MSUB,        Fpu::Format::s};
+      case instr_fnmsub_s : return {Fpu::NMSUB,       Fpu::Format::s};
+      case instr_fnmadd_s : return {Fpu::NMADD,       Fpu::Format::s};
+      case instr_fadd_s   : return {Fpu::ADD,         Fpu::Format::s};
+      case instr_fsub_s   : return {Fpu::SUB,         Fpu::Format::s};
+      case instr_fmul_s   : return {Fpu::MUL,         Fpu::Format::s};
+      case instr_fdiv_s   : return {Fpu::DIV,         Fpu::Format::s};
+      case instr_fsqrt_s  : return {Fpu::SQRT,        Fpu::Format::s};
+      case instr_fsgnj_s  : return {Fpu::SGNJ,        Fpu::Format::s};
+      case instr_fsgnjn_s : return {Fpu::SGNJN,       Fpu::Format::s};
+      case instr_fsgnjx_s : return {Fpu::SGNJX,       Fpu::Format::s};
+      case instr_fmin_s   : return {Fpu::MIN,         Fpu::Format::s};
+      case instr_fmax_s   : return {Fpu::MAX,         Fpu::Format::s};
+      case instr_fcvt_w_s : return {Fpu::CVT_W,       Fpu::Format::s};
+      case instr_fcvt_wu_s: return {Fpu::CVT_WU,      Fpu::Format::s};
+      case instr_fmv_x_w  : return {Fpu::MV_X,        Fpu::Format::s};
+      case instr_feq_s    : return {Fpu::EQ,          Fpu::Format::s};
+      case instr_flt_s    : return {Fpu::LT,          Fpu::Format::s};
+      case instr_fle_s    : return {Fpu::LE,          Fpu::Format::s};
+      case instr_fclass_s : return {Fpu::CLASS,       Fpu::Format::s};
+      case instr_fcvt_s_w : return {Fpu::CVT_FROM_W,  Fpu::Format::s};
+      case instr_fcvt_s_wu: return {Fpu::CVT_FROM_WU, Fpu::Format::s};
+      case instr_fmv_w_x  : return {Fpu::MV_F,        Fpu::Format::s};
+      case instr_fcvt_l_s : return {Fpu::CVT_L,       Fpu::Format::s};
+      case instr_fcvt_lu_s: return {Fpu::CVT_LU,      Fpu::Format::s};
+      case instr_fcvt_s_l : return {Fpu::CVT_FROM_L,  Fpu::Format::s};
+      case instr_fcvt_s_lu: return {Fpu::CVT_FROM_LU, Fpu::Format::s};
+      case instr_fcvt_s_d : return {Fpu::CVT_F,       Fpu::Format::s};
+      case instr_fmadd_d  : return {Fpu::MADD,        Fpu::Format::d};
+      case instr_fmsub_d  : return {Fpu::MSUB,        Fpu::Format::d};
+      case instr_fnmsub_d : return {Fpu::NMSUB,       Fpu::Format::d};
+      case instr_fnmadd_d : return {Fpu::NMADD,       Fpu::Format::d};
+      case instr_fadd_d   : return {Fpu::ADD,         Fpu::Format::d};
+      case instr_fsub_d   : return {Fpu::SUB,         Fpu::Format::d};
+      case instr_fmul_d   : return {Fpu::MUL,         Fpu::Format::d};
+      case instr_fdiv_d   : return {Fpu::DIV,         Fpu::Format::d};
+      case instr_fsqrt_d  : return {Fpu::SQRT,        Fpu::Format::d};
+      case instr_fsgnj_d  : return {Fpu::SGNJ,        Fpu::Format::d};
+      case instr_fsgnjn_d : return {Fpu::SGNJN,       Fpu::Format::d};
+      case instr_fsgnjx_d : return {Fpu::SGNJX,       Fpu::Format::d};
+      case instr_fmin_d   : return {Fpu::MIN,         Fpu::Format::d};
+      case instr_fmax_d   : return {Fpu::MAX,         Fpu::Format::d};
+      case instr_fcvt_d_s : return {Fpu::CVT_F,       Fpu::Format::d};
+      case instr_feq_d    : return {Fpu::EQ,          Fpu::Format::d};
+      case instr_flt_d    : return {Fpu::LT,          Fpu::Format::d};
+      case instr_fle_d    : return {Fpu::LE,          Fpu::Format::d};
+      case instr_fclass_d : return {Fpu::CLASS,       Fpu::Format::d};
+      case instr_fcvt_w_d : return {Fpu::CVT_W,       Fpu::Format::d};
+      case instr_fcvt_wu_d: return {Fpu::CVT_WU,      Fpu::Format::d};
+      case instr_fcvt_d_w : return {Fpu::CVT_FROM_W,  Fpu::Format::d};
+      case instr_fcvt_d_wu: return {Fpu::CVT_FROM_WU, Fpu::Format::d};
+      case instr_fcvt_l_d : return {Fpu::CVT_L,       Fpu::Format::d};
+      case instr_fcvt_lu_d: return {Fpu::CVT_LU,      Fpu::Format::d};
+      case instr_fmv_x_d  : return {Fpu::MV_X,        Fpu::Format::d};
+      case instr_fcvt_d_l : return {Fpu::CVT_FROM_L,  Fpu::Format::d};
+      case instr_fcvt_d_lu: return {Fpu::CVT_FROM_LU, Fpu::Format::d};
+      case instr_fmv_d_x  : return {Fpu::MV_F,        Fpu::Format::d};
+
+      default: assert(0 && "Invalid instr2fpu_op conversion");
+    }
+  }
+
+  enum class Vector_operand {
+    vector,
+    scalar,
+    imm,
+  };
+
+  struct Vector_op {
+    Vpu::Op op;
+    // Of vs1.
+    Vector_operand operand;
+  };
+
+  Vector_op to_vector_op(Decoder::Concrete_instruction instr) {
+    using enum Decoder::Concrete_instruction;
+    switch (instr) {
+      case instr_vadd_vv     : return {Vpu::ADD,    Vector_operand::vector};
+      case instr_vadd_vx     : return {Vpu::ADD,    Vector_operand::scalar};
+      case instr_vadd_vi     : return {Vpu::ADD,    Vector_operand::imm};
+      case instr_vsub_vv     : return {Vpu::SUB,    Vector_operand::vector};
+      case instr_vsub_vx     : return {Vpu::SUB,    Vector_operand::scalar};
+      case instr_vrsub_vx    : return {Vpu::RSUB,   Vector_operand::scalar};
+      case instr_vrsub_vi    : return {Vpu::RSUB,   Vector_operand::imm};
+      case instr_vminu_vv    : return {Vpu::MINU,   Vector_operand::vector};
+      case instr_vminu_vx    : return {Vpu::MINU,   Vector_operand::scalar};
+      case instr_vmin_vv     : return {Vpu::MIN,    Vector_operand::vector};
+      case instr_vmin_vx     : return {Vpu::MIN,    Vector_operand::scalar};
+      case instr_vmaxu_vv    : return {Vpu::MAXU,   Vector_operand::vector};
+      case instr_vmaxu_vx    : return {Vpu::MAXU,   Vector_operand::scalar};
+      case instr_vmax_vv     : return {Vpu::MAX,    Vector_operand::vector};
+      case instr_vmax_vx     : return {Vpu::MAX,    Vector_operand::scalar};
+      case instr_vand_vv     : return {Vpu::AND,    Vector_operand::vector};
+      case instr_vand_vx     : return {Vpu::AND,    Vector_operand::scalar};
+      case instr_vand_vi     : return {Vpu::AND,    Vector_operand::imm};
+      case instr_vor_vv      : return {Vpu::OR,     Vector_operand::vector};
+      case instr_vor_vx      : return {Vpu::OR,     Vector_operand::scalar};
+      case instr_vor_vi      : return {Vpu::OR,     Vector_operand::imm};
+      case instr_vxor_vv     : return {Vpu::XOR,    Vector_operand::vector};
+      case instr_vxor_vx     : return {Vpu::XOR,    Vector_operand::scalar};
+      case instr_vxor_vi     : return {Vpu::XOR,    Vector_operand::imm};
+      case instr_vsll_vv     : return {Vpu::SLL,    Vector_operand::vector};
+      case instr_vsll_vx     : return {Vpu::SLL,    Vector_operand::scalar};
+      case instr_vsll_vi     : return {Vpu::SLL,    Vector_operand::imm};
+      case instr_vsrl_vv     : return {Vpu::SRL,    Vector_operand::vector};
+      case instr_vsrl_vx     : return {Vpu::SRL,    Vector_operand::scalar};
+      case instr_vsrl_vi     : return {Vpu::SRL,    Vector_operand::imm};
+      case instr_vsra_vv     : return {Vpu::SRA,    Vector_operand::vector};
+      case instr_vsra_vx     : return {Vpu::SRA,    Vector_operand::scalar};
+      case instr_vsra_vi     : return {Vpu::SRA,    Vector_operand::imm};
+      case instr_vmul_vv     : return {Vpu::MUL,    Vector_operand::vector};
+      case instr_vmul_vx     : return {Vpu::MUL,    Vector_operand::scalar};
+      case instr_vmulh_vv    : return {Vpu::MULH,   Vector_operand::vector};
+      case instr_vmulh_vx    : return {Vpu::MULH,   Vector_operand::scalar};
+      case instr_vmulhu_vv   : return {Vpu::MULHU,  Vector_operand::vector};
+      case instr_vmulhu_vx   : return {Vpu::MULHU,  Vector_operand::scalar};
+      case instr_vmulhsu_vv  : return {Vpu::MULHSU, Vector_operand::vector};
+      case instr_vmulhsu_vx  : return {Vpu::MULHSU, Vector_operand::scalar};
+      case instr_vmerge_vvm  : return {Vpu::MERGE,  Vector_operand::vector};
+      case instr_vmerge_vxm  : return {Vpu::MERGE,  Vector_operand::scalar};
+      case instr_vmerge_vim  : return {Vpu::MERGE,  Vector_operand::imm};
+      case instr_vmv_v_v     : return {Vpu::MERGE,  Vector_operand::vector};
+      case instr_vmv_v_x     : return {Vpu::MERGE,  Vector_operand::scalar};
+      case instr_vmv_v_i     : return {Vpu::MERGE,  Vector_operand::imm};
+      case instr_vmseq_vv    : return {Vpu::SEQ,    Vector_operand::vector};
+      case instr_vmseq_vx    : return {Vpu::SEQ,    Vector_operand::scalar};
+      case instr_vmseq_vi    : return {Vpu::SEQ,    Vector_operand::imm};
+      case instr_vmsne_vv    : return {Vpu::SNE,    Vector_operand::vector};
+      case instr_vmsne_vx    : return {Vpu::SNE,    Vector_operand::scalar};
+      case instr_vmsne_vi    : return {Vpu::SNE,    Vector_operand::imm};
+      case instr_vmsltu_vv   : return {Vpu::SLTU,   Vector_operand::vector};
+      case instr_vmsltu_vx   : return {Vpu::SLTU,   Vector_operand::scalar};
+      case instr_vmslt_vv    : return {Vpu::SLT,    Vector_operand::vector};
+      case instr_vmslt_vx    : return {Vpu::SLT,    Vector_operand::scalar};
+      case instr_vmsleu_vv   : return {Vpu::SLEU,   Vector_operand::vector};
+      case instr_vmsleu_vx   : return {Vpu::SLEU,   Vector_operand::scalar};
+      case instr_vmsleu_vi   : return {Vpu::SLEU,   Vector_operand::imm};
+      case instr_vmsle_vv    : return {Vpu::SLE,    Vector_operand::vector};
+      case instr_vmsle_vx    : return {Vpu::SLE,    Vector_operand::scalar};
+      case instr_vmsle_vi    : return {Vpu::SLE,    Vector_operand::imm};
+      case instr_vmsgtu_vx   : return {Vpu::SGTU,   Vector_operand::scalar};
+      case instr_vmsgtu_vi   : return {Vpu::SGTU,   Vector_operand::imm};
+      case instr_vmsgt_vx    : return {Vpu::SGT,    Vector_operand::scalar};
+      case instr_vmsgt_vi    : return {Vpu::SGT,    Vector_operand::imm};
+      case instr_vredsum_vs  : return {Vpu::REDSUM, Vector_operand::vector};
+      case instr_vredand_vs  : return {Vpu::REDAND, Vector_operand::vector};
+      case instr_vredor_vs   : return {Vpu::REDOR,  Vector_operand::vector};
+      case instr_vredxor_vs  : return {Vpu::REDXOR, Vector_operand::vector};
+      case instr_vredminu_vs : return {Vpu::REDMINU,Vector_operand::vector};
+      case instr_vredmin_vs  : return {Vpu::REDMIN, Vector_operand::vector};
+      case instr_vredmaxu_vs : return {Vpu::REDMAXU,Vector_operand::vector};
+      case instr_vredmax_vs  : return {Vpu::REDMAX, Vector_operand::vector};
+
+      default: assert(0 && "Invalid instr2vector_op conversion");
+    }
+  }
+
+  struct Vector_access {
+    Vpu::Sew eew;
+    bool is_strided;
+  };
+
+  Vector_access to_vector_access(Decoder::Concrete_instruction instr) {
+    using enum Decoder::Concrete_instruction;
+    switch (instr) {
+      case instr_vle8_v  : return {Vpu::Sew::e8,  false};
+      case instr_vle16_v : return {Vpu::Sew::e16, false};
+      case instr_vle32_v : return {Vpu::Sew::e32, false};
+      case instr_vle64_v : return {Vpu::Sew::e64, false};
+      case instr_vlse8_v : return {Vpu::Sew::e8,  true };
+      case instr_vlse16_v: return {Vpu::Sew::e16, true };
+      case instr_vlse32_v: return {Vpu::Sew::e32, true };
+      case instr_vlse64_v: return {Vpu::Sew::e64, true };
+      case instr_vse8_v  : return {Vpu::Sew::e8,  false};
+      case instr_vse16_v : return {Vpu::Sew::e16, false};
+      case instr_vse32_v : return {Vpu::Sew::e32, false};
+      case instr_vse64_v : return {Vpu::Sew::e64, false};
+      case instr_vsse8_v : return {Vpu::Sew::e8,  true };
+      case instr_vsse16_v: return {Vpu::Sew::e16, true };
+      case instr_vsse32_v: return {Vpu::Sew::e32, true };
+      case instr_vsse64_v: return {Vpu::Sew::e64, true };
+
+      default: assert(0 && "Invalid instr2vector_access conversion");
+    }
+  }
+
+  struct Amo_op {
+    Amo::Op op;
+    bool is_doubleword;
+  };
+
+  Amo_op to_amo_op(Decoder::Concrete_instruction instr) {
+    using enum Decoder::Concrete_instruction;
+    switch (instr) {
+      case instr_lr_w     : return {Amo::LR  , false};
+      case instr_sc_w     : return {Amo::SC  , false};
+      case instr_amoswap_w: return {Amo::SWAP, false};
+      case instr_amoadd_w : return {Amo::ADD , false};
+      case instr_amoxor_w : return {Amo::XOR , false};
+      case instr_amoand_w : return {Amo::AND , false};
+      case instr_amoor_w  : return {Amo::OR  , false};
+      case instr_amomin_w : return {Amo::MIN , false};
+      case instr_amomax_w : return {Amo::MAX , false};
+      case instr_amominu_w: return {Amo::MINU, false};
+      case instr_amomaxu_w: return {Amo::MAXU, false};
+      case instr_lr_d     : return {Amo::LR  , true };
+      case instr_sc_d     : return {Amo::SC  , true };
+      case instr_amoswap_d: return {Amo::SWAP, true };
+      case instr_amoadd_d : return {Amo::ADD , true };
+      case instr_amoxor_d : return {Amo::XOR , true };
+      case instr_amoand_d : return {Amo::AND , true };
+      case instr_amoor_d  : return {Amo::OR  , true };
+      case instr_amomin_d : return {Amo::MIN , true };
+      case instr_amomax_d : return {Amo::MAX , true };
+      case instr_amominu_d: return {Amo::MINU, true };
+      case instr_amomaxu_d: return {Amo::MAXU, true };
+
+      default: assert(0 && "Invalid instr2amo_op conversion");
+    }
+  }
+
   enum class Handler_type {
     type_calc_reg,
     type_calc_imm,
@@ -109,8 +423,23 @@ namespace {
     type_jalr,
     type_lui,
     type_auipc,
+    type_ecall,
+    type_ebreak,
     type_mret,
+    type_wfi,
+    type_sret,
+    type_sfence_vma,
     type_fence,
+    type_fp_load,
+    type_fp_store,
+    type_fp,
+    type_vset,
+    type_vector,
+    type_vector_load,
+    type_vector_store,
+    type_load_reserved,
+    type_amo,
+    type_debug_break,
   };
 
   Handler_type to_handler_type(Decoder::Concrete_instruction instr) {
@@ -121,11 +450,14 @@ namespace {
       case instr_lh    :
       case instr_lw    :
       case instr_lbu   :
-      case instr_lhu   : return type_load;
+      case instr_lhu   :
+      case instr_lwu   :
+      case instr_ld    : return type_load;
 
       case instr_sb    :
       case instr_sh    :
-      case instr_sw    : return type_store;
+      case instr_sw    :
+      case instr_sd    : return type_store;
 
       case instr_beq   :
       case instr_bne   :
@@ -142,7 +474,29 @@ namespace {
       case instr_andi  :
       case instr_slli  :
       case instr_srli  :
-      case instr_srai  : return type_calc_imm;
+      case instr_srai  :
+      case instr_clz   :
+      case instr_ctz   :
+      case instr_cpop  :
+      case instr_sext_b:
+      case instr_sext_h:
+      case instr_zext_h:
+      case instr_rori  :
+      case instr_orc_b :
+      case instr_rev8  :
+      case instr_bclri :
+      case instr_bexti :
+      case instr_binvi :
+      case instr_bseti :
+      case instr_addiw :
+      case instr_slliw :
+      case instr_srliw :
+      case instr_sraiw :
+      case instr_slli_uw:
+      case instr_clzw  :
+      case instr_ctzw  :
+      case instr_cpopw :
+      case instr_roriw : return type_calc_imm;
 
       case instr_add   :
       case instr_sub   :
@@ -153,7 +507,47 @@ namespace {
       case instr_srl   :
       case instr_sra   :
       case instr_or    :
-      case instr_and   : return type_calc_reg;
+      case instr_and   :
+      case instr_mul   :
+      case instr_mulh  :
+      case instr_mulhsu:
+      case instr_mulhu :
+      case instr_div   :
+      case instr_divu  :
+      case instr_rem   :
+      case instr_remu  :
+      case instr_sh1add:
+      case instr_sh2add:
+      case instr_sh3add:
+      case instr_andn  :
+      case instr_orn   :
+      case instr_xnor  :
+      case instr_max   :
+      case instr_maxu  :
+      case instr_min   :
+      case instr_minu  :
+      case instr_rol   :
+      case instr_ror   :
+      case instr_bclr  :
+      case instr_bext  :
+      case instr_binv  :
+      case instr_bset  :
+      case instr_addw  :
+      case instr_subw  :
+      case instr_sllw  :
+      case instr_srlw  :
+      case instr_sraw  :
+      case instr_mulw  :
+      case instr_divw  :
+      case instr_divuw :
+      case instr_remw  :
+      case instr_remuw :
+      case instr_add_uw:
+      case instr_sh1add_uw:
+      case instr_sh2add_uw:
+      case instr_sh3add_uw:
+      case instr_rolw  :
+      case instr_rorw  : return type_calc_reg;
 
       case instr_csrrw :
       case instr_csrrs :
@@ -169,123 +563,441 @@ namespace {
       case instr_auipc: return type_auipc;
       case instr_lui  : return type_lui;
 
+      case instr_flw:
+      case instr_fld: return type_fp_load;
+      case instr_fsw:
+      case instr_fsd: return type_fp_store;
+
+      case instr_fmadd_s  :
+      case instr_fmsub_s  :
+      case instr_fnmsub_s :
+      case instr_fnmadd_s :
+      case instr_fadd_s   :
+      case instr_fsub_s   :
+      case instr_fmul_s   :
+      case instr_fdiv_s   :
+      case instr_fsqrt_s  :
+      case instr_fsgnj_s  :
+      case instr_fsgnjn_s :
+      case instr_fsgnjx_s :
+      case instr_fmin_s   :
+      case instr_fmax_s   :
+      case instr_fcvt_w_s :
+      case instr_fcvt_wu_s:
+      case instr_fmv_x_w  :
+      case instr_feq_s    :
+      case instr_flt_s    :
+      case instr_fle_s    :
+      case instr_fclass_s :
+      case instr_fcvt_s_w :
+      case instr_fcvt_s_wu:
+      case instr_fmv_w_x  :
+      case instr_fcvt_l_s :
+      case instr_fcvt_lu_s:
+      case instr_fcvt_s_l :
+      case instr_fcvt_s_lu:
+      case instr_fcvt_s_d :
+      case instr_fmadd_d  :
+      case instr_fmsub_d  :
+      case instr_fnmsub_d :
+      case instr_fnmadd_d :
+      case instr_fadd_d   :
+      case instr_fsub_d   :
+      case instr_fmul_d   :
+      case instr_fdiv_d   :
+      case instr_fsqrt_d  :
+      case instr_fsgnj_d  :
+      case instr_fsgnjn_d :
+      case instr_fsgnjx_d :
+      case instr_fmin_d   :
+      case instr_fmax_d   :
+      case instr_fcvt_d_s :
+      case instr_feq_d    :
+      case instr_flt_d    :
+      case instr_fle_d    :
+      case instr_fclass_d :
+      case instr_fcvt_w_d :
+      case instr_fcvt_wu_d:
+      case instr_fcvt_d_w :
+      case instr_fcvt_d_wu:
+      case instr_fcvt_l_d :
+      case instr_fcvt_lu_d:
+      case instr_fmv_x_d  :
+      case instr_fcvt_d_l :
+      case instr_fcvt_d_lu:
+      case instr_fmv_d_x  : return type_fp;
+
+      case instr_vsetvli :
+      case instr_vsetivli:
+      case instr_vsetvl  : return type_vset;
+      case instr_vadd_vv    :
+      case instr_vadd_vx    :
+      case instr_vadd_vi    :
+      case instr_vsub_vv    :
+      case instr_vsub_vx    :
+      case instr_vrsub_vx   :
+      case instr_vrsub_vi   :
+      case instr_vminu_vv   :
+      case instr_vminu_vx   :
+      case instr_vmin_vv    :
+      case instr_vmin_vx    :
+      case instr_vmaxu_vv   :
+      case instr_vmaxu_vx   :
+      case instr_vmax_vv    :
+      case instr_vmax_vx    :
+      case instr_vand_vv    :
+      case instr_vand_vx    :
+      case instr_vand_vi    :
+      case instr_vor_vv     :
+      case instr_vor_vx     :
+      case instr_vor_vi     :
+      case instr_vxor_vv    :
+      case instr_vxor_vx    :
+      case instr_vxor_vi    :
+      case instr_vsll_vv    :
+      case instr_vsll_vx    :
+      case instr_vsll_vi    :
+      case instr_vsrl_vv    :
+      case instr_vsrl_vx    :
+      case instr_vsrl_vi    :
+      case instr_vsra_vv    :
+      case instr_vsra_vx    :
+      case instr_vsra_vi    :
+      case instr_vmul_vv    :
+      case instr_vmul_vx    :
+      case instr_vmulh_vv   :
+      case instr_vmulh_vx   :
+      case instr_vmulhu_vv  :
+      case instr_vmulhu_vx  :
+      case instr_vmulhsu_vv :
+      case instr_vmulhsu_vx :
+      case instr_vmerge_vvm :
+      case instr_vmerge_vxm :
+      case instr_vmerge_vim :
+      case instr_vmv_v_v    :
+      case instr_vmv_v_x    :
+      case instr_vmv_v_i    :
+      case instr_vmseq_vv   :
+      case instr_vmseq_vx   :
+      case instr_vmseq_vi   :
+      case instr_vmsne_vv   :
+      case instr_vmsne_vx   :
+      case instr_vmsne_vi   :
+      case instr_vmsltu_vv  :
+      case instr_vmsltu_vx  :
+      case instr_vmslt_vv   :
+      case instr_vmslt_vx   :
+      case instr_vmsleu_vv  :
+      case instr_vmsleu_vx  :
+      case instr_vmsleu_vi  :
+      case instr_vmsle_vv   :
+      case instr_vmsle_vx   :
+      case instr_vmsle_vi   :
+      case instr_vmsgtu_vx  :
+      case instr_vmsgtu_vi  :
+      case instr_vmsgt_vx   :
+      case instr_vmsgt_vi   :
+      case instr_vredsum_vs :
+      case instr_vredand_vs :
+      case instr_vredor_vs  :
+      case instr_vredxor_vs :
+      case instr_vredminu_vs:
+      case instr_vredmin_vs :
+      case instr_vredmaxu_vs:
+      case instr_vredmax_vs :
+      case instr_vmv_x_s     :
+      case instr_vmv_s_x     : return type_vector;
+
+      case instr_vle8_v   :
+      case instr_vle16_v  :
+      case instr_vle32_v  :
+      case instr_vle64_v  :
+      case instr_vlse8_v  :
+      case instr_vlse16_v :
+      case instr_vlse32_v :
+      case instr_vlse64_v : return type_vector_load;
+
+      case instr_vse8_v   :
+      case instr_vse16_v  :
+      case instr_vse32_v  :
+      case instr_vse64_v  :
+      case instr_vsse8_v  :
+      case instr_vsse16_v :
+      case instr_vsse32_v :
+      case instr_vsse64_v : return type_vector_store;
+
+      case instr_lr_w     :
+      case instr_lr_d     : return type_load_reserved;
+      case instr_sc_w     :
+      case instr_amoswap_w:
+      case instr_amoadd_w :
+      case instr_amoxor_w :
+      case instr_amoand_w :
+      case instr_amoor_w  :
+      case instr_amomin_w :
+      case instr_amomax_w :
+      case instr_amominu_w:
+      case instr_amomaxu_w:
+      case instr_sc_d     :
+      case instr_amoswap_d:
+      case instr_amoadd_d :
+      case instr_amoxor_d :
+      case instr_amoand_d :
+      case instr_amoor_d  :
+      case instr_amomin_d :
+      case instr_amomax_d :
+      case instr_amominu_d:
+      case instr_amomaxu_d: return type_amo;
+
       case instr_fence: return type_fence;
+      case instr_ecall : return type_ecall;
+      case instr_ebreak: return type_ebreak;
       case instr_mret : return type_mret;
+      case instr_wfi  : return type_wfi;
+      case instr_sret : return type_sret;
+      case instr_sfence_vma: return type_sfence_vma;
+      case instr_debug_break: return type_debug_break;
     }
 
     assert(0 && "Invalid instr2handler_type conversion");
   }
 
-  void handle_type_calc_imm(const Decoder::Instruction_info &instr_info, Memory &rf) {
-    const Uxlen a{rf.read(instr_info.rs1)};
-    const Uxlen alu_res{Alu::calc_result(to_alu_op(instr_info.instruction), a, instr_info.imm)};
+  template <unsigned int xlen>
+  using Info = typename Basic_decoder<xlen>::Instruction_info;
+
+  template <unsigned int xlen>
+  void handle_type_calc_imm(const Info<xlen> &instr_info, Basic_memory<xlen> &rf) {
+    const Uxlen_t<xlen> a{rf.read(instr_info.rs1)};
+    const Uxlen_t<xlen> alu_res{Alu::calc_result<xlen>(to_alu_op(instr_info.instruction), a,
+        instr_info.imm)};
     rf.write(instr_info.rd, alu_res);
   }
 
-  void handle_type_calc_reg(const Decoder::Instruction_info &instr_info, Memory &rf) {
-    const Uxlen a{rf.read(instr_info.rs1)};
-    const Uxlen b{rf.read(instr_info.rs2)};
-    const Uxlen alu_res{Alu::calc_result(to_alu_op(instr_info.instruction), a, b)};
+  template <unsigned int xlen>
+  void handle_type_calc_reg(const Info<xlen> &instr_info, Basic_memory<xlen> &rf) {
+    const Uxlen_t<xlen> a{rf.read(instr_info.rs1)};
+    const Uxlen_t<xlen> b{rf.read(instr_info.rs2)};
+    const Uxlen_t<xlen> alu_res{Alu::calc_result<xlen>(to_alu_op(instr_info.instruction), a, b)};
     rf.write(instr_info.rd, alu_res);
   }
 
-  void handle_type_store(const Decoder::Instruction_info &instr_info, Memory &rf,
-      Memory &data_mem, spdlog::logger &logger, auto pc) {
-    const std::size_t addr{rf.read(instr_info.rs1) + instr_info.imm};
-    const Uxlen data{rf.read(instr_info.rs2)};
+  template <unsigned int xlen>
+  void handle_type_store(const Info<xlen> &instr_info, Basic_memory<xlen> &rf,
+      Basic_memory<xlen> &data_mem, Amo::Reservation_set &reservations, spdlog::logger &logger,
+      auto pc) {
+    const std::size_t addr{static_cast<std::size_t>(rf.read(instr_info.rs1) + instr_info.imm)};
+    const Uxlen_t<xlen> data{rf.read(instr_info.rs2)};
     const auto lsu_op = to_lsu_op(instr_info.instruction);
     if (Lsu::is_misaligned(lsu_op, addr)) {
       logger.warn("LSU. Store. Misalignment. Continuing. PC: 0x{:x}, addr: 0x{:x}, LSU op: {}.",
           pc, addr, to_string(lsu_op));
     }
-    data_mem.write(addr, data, Lsu::get_be(lsu_op, addr));
+    data_mem.write(Lsu::get_word_addr<xlen>(addr), Lsu::to_lanes<xlen>(addr, data),
+        Lsu::get_be<xlen>(lsu_op, addr));
+    reservations.invalidate(addr, Lsu::get_size(lsu_op));
   }
 
-  void handle_type_load(const Decoder::Instruction_info &instr_info, Memory &rf,
-      Memory &data_mem, spdlog::logger &logger, auto pc) {
-    const std::size_t addr{rf.read(instr_info.rs1) + instr_info.imm};
+  template <unsigned int xlen>
+  void handle_type_load(const Info<xlen> &instr_info, Basic_memory<xlen> &rf,
+      Basic_memory<xlen> &data_mem, spdlog::logger &logger, auto pc) {
+    const std::size_t addr{static_cast<std::size_t>(rf.read(instr_info.rs1) + instr_info.imm)};
     const auto lsu_op = to_lsu_op(instr_info.instruction);
     if (Lsu::is_misaligned(lsu_op, addr)) {
       logger.warn("LSU. Load. Misalignment. Continuing. PC: 0x{:x}, addr: 0x{:x}, LSU op: {}.",
           pc, addr, to_string(lsu_op));
     }
-    Uxlen data{data_mem.read(addr, Lsu::get_be(lsu_op, addr))};
-    data = Lsu::transform_data(lsu_op, addr, data);
+    Uxlen_t<xlen> data{data_mem.read(Lsu::get_word_addr<xlen>(addr),
+        Lsu::get_be<xlen>(lsu_op, addr))};
+    data = Lsu::transform_data<xlen>(lsu_op, addr, data);
     rf.write(instr_info.rd, data);
   }
 
-  void handle_type_branch(const Decoder::Instruction_info &instr_info, Memory &rf, auto &pc) {
-    const Uxlen a{rf.read(instr_info.rs1)};
-    const Uxlen b{rf.read(instr_info.rs2)};
-    const Uxlen alu_flag{Alu::calc_flag(to_alu_op(instr_info.instruction), a, b)};
-    if (alu_flag) pc += instr_info.imm;
+  // FLEN is 64 bits, so RV32 accesses a double as two words.
+  template <unsigned int xlen>
+  Fpu::Reg load_fp(Basic_memory<xlen> &data_mem, std::size_t addr, Lsu::Op op) {
+    if constexpr (xlen == 32) {
+      if (op == Lsu::Op::d) {
+        return load_fp(data_mem, addr, Lsu::Op::wu) |
+            (load_fp(data_mem, addr + 4, Lsu::Op::wu) << 32);
+      }
+    }
+    const Uxlen_t<xlen> data{data_mem.read(Lsu::get_word_addr<xlen>(addr),
+        Lsu::get_be<xlen>(op, addr))};
+    return Lsu::transform_data<xlen>(op, addr, data);
   }
 
-  void handle_type_auipc(const Decoder::Instruction_info &instr_info, Memory &rf, const auto &pc) {
-    rf.write(instr_info.rd, pc + (instr_info.imm << 12));
+  template <unsigned int xlen>
+  void store_fp(Basic_memory<xlen> &data_mem, std::size_t addr, Lsu::Op op, Fpu::Reg data) {
+    if constexpr (xlen == 32) {
+      if (op == Lsu::Op::d) {
+        store_fp(data_mem, addr, Lsu::Op::w, data);
+        store_fp(data_mem, addr + 4, Lsu::Op::w, data >> 32);
+        return;
+      }
+    }
+    data_mem.write(Lsu::get_word_addr<xlen>(addr),
+        Lsu::to_lanes<xlen>(addr, static_cast<Uxlen_t<xlen>>(data)), Lsu::get_be<xlen>(op, addr));
   }
 
-  void handle_type_lui(const Decoder::Instruction_info &instr_info, Memory &rf) {
-    rf.write(instr_info.rd, instr_info.imm << 12);
+  template <unsigned int xlen>
+  void handle_type_fp_load(const Info<xlen> &instr_info, Basic_memory<xlen> &rf,
+      Basic_memory<xlen> &data_mem, Memory64 &fp_rf, spdlog::logger &logger, auto pc) {
+    const std::size_t addr{static_cast<std::size_t>(rf.read(instr_info.rs1) + instr_info.imm)};
+    const auto lsu_op = to_lsu_op(instr_info.instruction);
+    if (Lsu::is_misaligned(lsu_op, addr)) {
+      logger.warn("LSU. FP load. Misalignment. Continuing. PC: 0x{:x}, addr: 0x{:x}, LSU op: {}.",
+          pc, addr, to_string(lsu_op));
+    }
+    Fpu::Reg data{load_fp(data_mem, addr, lsu_op)};
+    // Singles are NaN-boxed.
+    if (lsu_op == Lsu::Op::wu) data |= Fpu::Reg{0xffff'ffff} << 32;
+    fp_rf.write(instr_info.rd, data);
   }
 
-  void handle_type_jal(const Decoder::Instruction_info &instr_info, Memory &rf, auto &pc) {
-    rf.write(instr_info.rd, pc + 4);
+  template <unsigned int xlen>
+  void handle_type_fp_store(const Info<xlen> &instr_info, Basic_memory<xlen> &rf,
+      Basic_memory<xlen> &data_mem, Memory64 &fp_rf, Amo::Reservation_set &reservations,
+      spdlog::logger &logger, auto pc) {
+    const std::size_t addr{static_cast<std::size_t>(rf.read(instr_info.rs1) + instr_info.imm)};
+    const auto lsu_op = to_lsu_op(instr_info.instruction);
+    if (Lsu::is_misaligned(lsu_op, addr)) {
+      logger.warn("LSU. FP store. Misalignment. Continuing. PC: 0x{:x}, addr: 0x{:x}, LSU op: {}.",
+          pc, addr, to_string(lsu_op));
+    }
+    store_fp(data_mem, addr, lsu_op, fp_rf.read(instr_info.rs2));
+    reservations.invalidate(addr, Lsu::get_size(lsu_op));
+  }
+
+  template <unsigned int xlen>
+  void handle_type_branch(const Info<xlen> &instr_info, Basic_memory<xlen> &rf, auto &pc) {
+    const Uxlen_t<xlen> a{rf.read(instr_info.rs1)};
+    const Uxlen_t<xlen> b{rf.read(instr_info.rs2)};
+    const bool alu_flag{Alu::calc_flag<xlen>(to_alu_op(instr_info.instruction), a, b)};
+    pc += alu_flag ? instr_info.imm : instr_info.length;
+  }
+
+  // The 32-bit value of lui and auipc is sign-extended on RV64.
+  template <unsigned int xlen>
+  Uxlen_t<xlen> get_upper_imm(const Info<xlen> &instr_info) {
+    return static_cast<Uxlen_t<xlen>>(static_cast<Sxlen_t<xlen>>(
+        static_cast<Sxlen>(static_cast<Uxlen>(instr_info.imm << 12))));
+  }
+
+  template <unsigned int xlen>
+  void handle_type_auipc(const Info<xlen> &instr_info, Basic_memory<xlen> &rf, const auto &pc) {
+    rf.write(instr_info.rd, pc + get_upper_imm<xlen>(instr_info));
+  }
+
+  template <unsigned int xlen>
+  void handle_type_lui(const Info<xlen> &instr_info, Basic_memory<xlen> &rf) {
+    rf.write(instr_info.rd, get_upper_imm<xlen>(instr_info));
+  }
+
+  template <unsigned int xlen>
+  void handle_type_jal(const Info<xlen> &instr_info, Basic_memory<xlen> &rf, auto &pc) {
+    rf.write(instr_info.rd, pc + instr_info.length);
     pc += instr_info.imm;
   }
 
-  void handle_type_jalr(const Decoder::Instruction_info &instr_info, Memory &rf, auto &pc) {
-    rf.write(instr_info.rd, pc + 4);
-    pc = (rf.read(instr_info.rs1) + instr_info.imm) & make_mask<Uxlen>(32, 1);
+  template <unsigned int xlen>
+  void handle_type_jalr(const Info<xlen> &instr_info, Basic_memory<xlen> &rf, auto &pc) {
+    const Uxlen_t<xlen> target{(rf.read(instr_info.rs1) + instr_info.imm) & ~Uxlen_t<xlen>{1}};
+    rf.write(instr_info.rd, pc + instr_info.length);
+    pc = target;
   }
 
-  Uxlen exec_csr_op(Memory &csr, Csr_op op, std::size_t addr, Uxlen data) {
+  // As in the spec, csrrw with rd == x0 doesn't read the csr and csrrs/csrrc with
+  // rs1 == x0 don't write it, so they can read the read-only csrs.
+  template <unsigned int xlen>
+  Uxlen_t<xlen> exec_csr_op(Basic_memory<xlen> &csr, Csr_op op, Uxlen_t<xlen> data,
+      const Info<xlen> &instr_info) {
     using enum Csr_op;
-    Uxlen res{csr.read(addr)};
+    // The csr number is the 12-bit immediate, which the decoder sign-extends.
+    const std::size_t addr{static_cast<std::size_t>(instr_info.imm & 0xfff)};
+    const auto write = [&csr, addr](Uxlen_t<xlen> value) {
+      if (Csr_base::is_read_only(addr)) throw Errors::Read_only{"csr " + std::to_string(addr)};
+      csr.write(addr, value);
+    };
+    Uxlen_t<xlen> res{0};
     switch (op) {
       case CSR_RW: case CSR_RWI:
-        csr.write(addr, data);
+        if (instr_info.rd != 0) res = csr.read(addr);
+        write(data);
         break;
       case CSR_RS: case CSR_RSI:
-        csr.write(addr, res | data);
+        res = csr.read(addr);
+        if (instr_info.rs1 != 0) write(res | data);
         break;
       case CSR_RC: case CSR_RCI:
-        csr.write(addr, res & ~data);
+        res = csr.read(addr);
+        if (instr_info.rs1 != 0) write(res & ~data);
         break;
       default: assert(0 && "Illegal csr op.");
     }
     return res;
   }
 
-  void handle_type_csr_imm(const Decoder::Instruction_info &instr_info, Memory &rf, Memory &csr) {
+  template <unsigned int xlen>
+  void handle_type_csr_imm(const Info<xlen> &instr_info, Basic_memory<xlen> &rf,
+      Basic_memory<xlen> &csr) {
     const Csr_op op{to_csr_op(instr_info.instruction)};
-    const Uxlen rd_data{exec_csr_op(csr, op, instr_info.imm, instr_info.rs1)};
+    const Uxlen_t<xlen> rd_data{exec_csr_op<xlen>(csr, op, instr_info.rs1, instr_info)};
     rf.write(instr_info.rd, rd_data);
   }
 
-  void handle_type_csr_reg(const Decoder::Instruction_info &instr_info, Memory &rf, Memory &csr) {
+  template <unsigned int xlen>
+  void handle_type_csr_reg(const Info<xlen> &instr_info, Basic_memory<xlen> &rf,
+      Basic_memory<xlen> &csr) {
     const Csr_op op{to_csr_op(instr_info.instruction)};
-    const Uxlen rd_data{exec_csr_op(csr, op, instr_info.imm,
-        rf.read(instr_info.rs1))};
+    const Uxlen_t<xlen> rd_data{exec_csr_op<xlen>(csr, op, rf.read(instr_info.rs1), instr_info)};
     rf.write(instr_info.rd, rd_data);
   }
 
-  void handle_type_mret(std::function<void(void)> return_from_irq, Memory &csr, auto &pc) {
-    const auto mepc = csr.read(Csr::Register::MEPC);
-    pc = mepc;
-    return_from_irq();
+  // Below the privilege in its number, a csr is an illegal instruction.
+  template <unsigned int xlen>
+  void check_csr_privilege(const Info<xlen> &instr_info, Uxlen instruction,
+      Csr_base::Privilege privilege) {
+    const std::size_t addr{static_cast<std::size_t>(instr_info.imm & 0xfff)};
+    if (privilege < Csr_base::get_privilege(addr)) {
+      throw Errors::Illegal_instruction{instruction, "csr " + std::to_string(addr) +
+          " of a higher privilege"};
+    }
   }
+
 }
 
-void Core::cycle() {
+template <unsigned int xlen>
+void Basic_core<xlen>::cycle() {
+  if (is_waiting()) [[unlikely]] {
+    if (!is_wakeup_pending()) return;
+    m_wait_state = Wait_state::running;
+  }
+
+  if (m_irq_pending && (m_irq_pending->get(std::memory_order_relaxed) & m_irq_mask))
+      [[unlikely]] {
+    take_pending_irq();
+  }
+
+  // Page and access faults of the fetch and of loads and stores happen before the
+  // instruction changes any register, so it's restarted by returning from the trap.
+  const Data instr_pc{m_pc};
+  try {
+    execute();
+  } catch (const Errors::Memory_fault &fault) {
+    m_pc = instr_pc;
+    enter_trap(fault.m_cause, static_cast<Data>(fault.m_addr));
+  }
+}
+
+template <unsigned int xlen>
+void Basic_core<xlen>::execute() {
   const Uxlen instruction{fetch_instruction()};
-  const Decoder decoder{m_isa_ext_container};
-  const Decoder::Instruction_info instr_info{decoder.decode(instruction)};
-  Memory &rf{m_rf};
-  Memory &csr{m_csr};
-  Memory &data_mem{m_data_mem};
+  const Info &instr_info{decode(instruction)};
+  Xmemory &rf{m_rf};
+  Xmemory &csr{m_csr};
+  Xmemory &data_mem{m_data_mem};
   auto &pc = m_pc;
-  auto return_from_irq = m_return_from_irq;
+  const Data instr_pc{m_pc};
 
   assert(m_logger && "logger == nullptr in core");
   spdlog::logger &logger{*m_logger};
@@ -294,24 +1006,681 @@ void Core::cycle() {
     case Handler_type::type_calc_imm: handle_type_calc_imm(instr_info, rf); break;
     case Handler_type::type_calc_reg: handle_type_calc_reg(instr_info, rf); break;
     case Handler_type::type_store: handle_type_store(instr_info, rf,
-        data_mem, logger, m_pc); break;
+        data_mem, m_reservations, logger, m_pc); ++m_side_effects; break;
     case Handler_type::type_load: handle_type_load(instr_info, rf,
         data_mem, logger, m_pc); break;
-    case Handler_type::type_branch: handle_type_branch(instr_info, rf, pc); return;
+    case Handler_type::type_branch: handle_type_branch(instr_info, rf, pc);
+        detect_idle_loop(instr_pc); return;
     case Handler_type::type_auipc: handle_type_auipc(instr_info, rf, pc); break;
     case Handler_type::type_lui: handle_type_lui(instr_info, rf); break;
-    case Handler_type::type_fence: break;
-    case Handler_type::type_jal: handle_type_jal(instr_info, rf, pc); return;
+    case Handler_type::type_fence: execute_fence(instr_info); break;
+    case Handler_type::type_jal: handle_type_jal(instr_info, rf, pc);
+        detect_idle_loop(instr_pc); return;
     case Handler_type::type_jalr: handle_type_jalr(instr_info, rf, pc); return;
-    case Handler_type::type_csr_imm: handle_type_csr_imm(instr_info, rf, csr); break;
-    case Handler_type::type_csr_reg: handle_type_csr_reg(instr_info, rf, csr); break;
-    case Handler_type::type_mret: handle_type_mret(return_from_irq, csr, pc); break;
+    case Handler_type::type_csr_imm:
+        check_csr_privilege<xlen>(instr_info, instruction, m_privilege);
+        handle_type_csr_imm(instr_info, rf, csr);
+        update_irq_mask(); update_frm(); update_translation(); ++m_side_effects; break;
+    case Handler_type::type_csr_reg:
+        check_csr_privilege<xlen>(instr_info, instruction, m_privilege);
+        handle_type_csr_reg(instr_info, rf, csr);
+        update_irq_mask(); update_frm(); update_translation(); ++m_side_effects; break;
+    case Handler_type::type_fp_load: handle_type_fp_load(instr_info, rf,
+        data_mem, m_fp_rf, logger, m_pc); ++m_side_effects; break;
+    case Handler_type::type_fp_store: handle_type_fp_store(instr_info, rf,
+        data_mem, m_fp_rf, m_reservations, logger, m_pc); ++m_side_effects; break;
+    case Handler_type::type_fp: execute_fp(instr_info, instruction); ++m_side_effects; break;
+    case Handler_type::type_vset: execute_vset(instr_info); ++m_side_effects; break;
+    case Handler_type::type_vector: execute_vector(instr_info, instruction);
+        ++m_side_effects; break;
+    case Handler_type::type_vector_load: execute_vector_memory(instr_info, instruction, false);
+        ++m_side_effects; break;
+    case Handler_type::type_vector_store: execute_vector_memory(instr_info, instruction, true);
+        ++m_side_effects; break;
+    case Handler_type::type_load_reserved: execute_amo(instr_info); break;
+    case Handler_type::type_amo: execute_amo(instr_info); ++m_side_effects; break;
+    case Handler_type::type_ecall: execute_ecall(); return;
+    case Handler_type::type_ebreak: execute_ebreak(); return;
+    case Handler_type::type_mret:
+        if (m_privilege != Csr_base::Privilege::machine) {
+          throw Errors::Illegal_instruction{instruction, "mret below M-mode"};
+        }
+        return_from_trap(); return;
+    case Handler_type::type_sret:
+        if (m_privilege == Csr_base::Privilege::user) {
+          throw Errors::Illegal_instruction{instruction, "sret in U-mode"};
+        }
+        return_from_supervisor_trap(); return;
+    case Handler_type::type_sfence_vma:
+        if (m_privilege == Csr_base::Privilege::user) {
+          throw Errors::Illegal_instruction{instruction, "sfence.vma in U-mode"};
+        }
+        execute_sfence_vma(instr_info); break;
+    // Before the instruction, which is executed once the debugger steps over it.
+    case Handler_type::type_debug_break:
+        m_wait_state    = Wait_state::stopped;
+        m_at_breakpoint = true;
+        return;
+    case Handler_type::type_wfi:
+        if (!m_irq_pending || !(m_irq_pending->get() & m_irq_enable)) {
+          m_wait_state = Wait_state::wfi;
+        }
+        break;
+  }
+
+  pc += instr_info.length;
+}
+
+template <unsigned int xlen>
+void Basic_core<xlen>::run(Scheduler &scheduler, Scheduler::Time until) {
+  while ((scheduler.get_now() < until) && !is_halted() && !is_stopped()) {
+    if (is_waiting() && !is_wakeup_pending()) {
+      // Nothing happens until the next event, so time jumps straight to it.
+      const Wait_state wait_state{m_wait_state};
+      scheduler.advance_to(std::min(until, scheduler.get_next_deadline()));
+      // The event may have changed the memory an idle loop polls.
+      if (wait_state == Wait_state::idle_loop) wake();
+      continue;
+    }
+
+    // Events scheduled by the executed instructions are picked up by re-reading the
+    // deadline, so the slice never runs past the earliest event. Devices read the current
+    // time from the scheduler, so it's kept exact within the slice too.
+    while (scheduler.get_now() < std::min(until, scheduler.get_next_deadline())) {
+      cycle();
+      if (is_waiting()) [[unlikely]] {
+        if (!m_at_breakpoint) scheduler.tick();
+        break;
+      }
+      scheduler.tick();
+    }
+    scheduler.advance_to(scheduler.get_now());
+  }
+}
+
+template <unsigned int xlen>
+void Basic_core<xlen>::step() {
+  resume();
+  const Data pc{m_pc};
+  const bool breakpoint{m_decode_cache.clear_breakpoint(pc)};
+  cycle();
+  if (breakpoint) m_decode_cache.set_breakpoint(pc);
+}
+
+template <unsigned int xlen>
+auto Basic_core<xlen>::get_state() const -> State {
+  return {.pc = m_pc, .privilege = m_privilege, .wait_state = m_wait_state,
+      .exit_code = m_exit_code, .fp_registers = m_fp_rf.get_content(),
+      .vector_registers = m_vrf.get_content(), .vl = m_vl, .vtype = m_vtype,
+      .reservation = m_reservation, .idle_loop = m_idle_loop, .side_effects = m_side_effects};
+}
+
+// The memory may hold other code and page tables now, so the decode cache and the TLB are
+// dropped.
+template <unsigned int xlen>
+void Basic_core<xlen>::set_state(const State &state) {
+  m_pc          = state.pc;
+  m_privilege   = state.privilege;
+  m_wait_state  = state.wait_state;
+  m_exit_code   = state.exit_code;
+  for (std::size_t reg{0}; reg < state.fp_registers.size(); ++reg) {
+    m_fp_rf.write(reg, state.fp_registers[reg]);
   }
+  assert(state.vector_registers.size() == m_vrf.get_content().size());
+  std::copy(state.vector_registers.begin(), state.vector_registers.end(), m_vrf.get(0));
+  m_vl          = state.vl;
+  m_vtype       = state.vtype;
+  m_reservation = state.reservation;
+  if (m_reservation) m_reservations.reserve(m_hart, m_reservation->addr);
+  else               static_cast<void>(m_reservations.take(m_hart, 0));
+  m_idle_loop     = state.idle_loop;
+  m_side_effects  = state.side_effects;
+  m_at_breakpoint = false;
 
-  pc += 4;
+  m_decode_cache.clear();
+  update_irq_mask();
+  update_frm();
+  update_translation();
+  if (m_mmu) m_mmu->flush();
+}
 
+template <unsigned int xlen>
+void Basic_core<xlen>::wait_for_interrupt() {
+  assert(m_irq_pending && "Nothing can wake up a core without interrupts");
+  while ((m_wait_state != Wait_state::running) && !is_halted() && !is_stopped()) {
+    const Uxlen pending{m_irq_pending->get()};
+    if (pending & m_irq_enable) {
+      m_wait_state = Wait_state::running;
+    } else {
+      m_irq_pending->wait(pending);
+    }
+  }
 }
 
-[[nodiscard]] Uxlen Core::fetch_instruction() const {
-  return m_instr_mem.read(m_pc);
+template <unsigned int xlen>
+void Basic_core<xlen>::detect_idle_loop(Data branch_pc) {
+  Idle_loop &loop{m_idle_loop};
+  if ((m_pc > branch_pc) || ((branch_pc - m_pc) > Idle_loop::max_size)) return;
+
+  if (m_pc == branch_pc) {
+    // Nothing but an interrupt can get the core out of a jump to itself.
+    m_wait_state = Wait_state::wfi;
+    return;
+  }
+
+  if ((loop.branch_pc != branch_pc) || (loop.side_effects != m_side_effects)) {
+    loop = {.branch_pc = branch_pc, .side_effects = m_side_effects};
+    return;
+  }
+
+  ++loop.iterations;
+  if (loop.iterations < Idle_loop::min_iterations) return;
+
+  // Without side effects an iteration depends only on the integer registers and the
+  // polled memory. Equal registers on two back-to-back iterations mean the loop waits for
+  // the memory to be changed from outside.
+  typename Idle_loop::Registers registers{};
+  for (std::size_t i{0}; i < registers.size(); ++i) registers[i] = m_rf.read(i);
+  if (loop.iterations == Idle_loop::min_iterations) {
+    loop.registers = registers;
+  } else if (loop.registers == registers) {
+    m_logger->debug("Core. Idle loop at PC: 0x{:x}.", branch_pc);
+    m_wait_state = Wait_state::idle_loop;
+    loop.iterations = 0;
+  } else {
+    loop.iterations = 0;
+  }
 }
+
+template <unsigned int xlen>
+void Basic_core<xlen>::update_irq_mask() {
+  using enum Csr_base::Privilege;
+  if (!m_irq_pending) return;
+  const Data mstatus{m_csr.read(Csr_base::MSTATUS)};
+  const Uxlen delegated{static_cast<Uxlen>(m_csr.read(Csr_base::MIDELEG))};
+  m_irq_enable = static_cast<Uxlen>(m_csr.read(Csr_base::MIE));
+  // Interrupts for a higher privilege mode are always enabled, those for a lower one never.
+  const bool machine_enable{(m_privilege != machine) || (mstatus & Csr_base::MSTATUS_MIE)};
+  const bool supervisor_enable{(m_privilege == user) ||
+      ((m_privilege == supervisor) && (mstatus & Csr_base::MSTATUS_SIE))};
+  m_irq_mask = (machine_enable ? (m_irq_enable & ~delegated) : 0) |
+      (supervisor_enable ? (m_irq_enable & delegated) : 0);
+}
+
+template <unsigned int xlen>
+void Basic_core<xlen>::update_frm() {
+  if (!m_isa_ext_container[Isa_extension::isa_f]) return;
+  m_frm = static_cast<Fpu::Rounding_mode>(m_csr.read(Csr_base::FRM));
+}
+
+// Operands and results are in the FP or the integer registers depending on the group of
+// the Fpu op.
+template <unsigned int xlen>
+void Basic_core<xlen>::execute_fp(const Info &instr_info, Uxlen instruction) {
+  const auto [op, format] = to_fpu_op(instr_info.instruction);
+  Fpu::Rounding_mode rm{static_cast<Fpu::Rounding_mode>(instr_info.rm)};
+  if (rm == Fpu::DYN) rm = m_frm;
+  if (Fpu::is_rounded(op, format)) {
+    if (!Fpu::is_valid(rm)) {
+      throw Errors::Illegal_instruction{instruction, "Reserved rounding mode in frm"};
+    }
+    Fpu::set_rounding_mode(rm);
+  }
+
+  const Fpu::Reg a{m_fp_rf.read(instr_info.rs1)};
+  const Fpu::Reg b{m_fp_rf.read(instr_info.rs2)};
+  if (op <= Fpu::CVT_F) {
+    m_fp_rf.write(instr_info.rd, Fpu::calc(op, format, a, b, m_fp_rf.read(instr_info.rs3)));
+  } else if (op <= Fpu::MV_X) {
+    m_rf.write(instr_info.rd, static_cast<Data>(Fpu::to_integer(op, format, a, b, rm)));
+  } else {
+    m_fp_rf.write(instr_info.rd, Fpu::from_integer(op, format, m_rf.read(instr_info.rs1)));
+  }
+}
+
+template <unsigned int xlen>
+void Basic_core<xlen>::reset_vector_config() {
+  if (!m_isa_ext_container[Isa_extension::isa_v]) return;
+  m_csr.write(Csr_base::VLENB, m_vrf.get_vlenb());
+  m_csr.write(Csr_base::VL, 0);
+  m_csr.write(Csr_base::VTYPE, Data{1} << (xlen - 1));
+}
+
+// The AVL is x[rs1], or VLMAX for rs1 == x0 and rd != x0. With both x0 vl is kept, clipped
+// to the new VLMAX.
+template <unsigned int xlen>
+void Basic_core<xlen>::execute_vset(const Info &instr_info) {
+  using enum Decoder::Concrete_instruction;
+  const Data vtype_bits{(instr_info.instruction == instr_vsetvl) ? m_rf.read(instr_info.rs2)
+                                                                 : instr_info.imm};
+  Data avl{m_vl};
+  if (instr_info.instruction == instr_vsetivli) {
+    avl = instr_info.rs1;
+  } else if (instr_info.rs1 != 0) {
+    avl = m_rf.read(instr_info.rs1);
+  } else if (instr_info.rd != 0) {
+    avl = std::numeric_limits<Data>::max();
+  }
+
+  m_vtype = Vpu::decode_vtype(vtype_bits);
+  m_vl = m_vtype ? static_cast<Data>(std::min<std::uint64_t>(avl,
+                                         Vpu::get_vlmax(m_vrf.get_vlen(), *m_vtype)))
+                 : 0;
+  m_rf.write(instr_info.rd, m_vl);
+  m_csr.write(Csr_base::VL, m_vl);
+  m_csr.write(Csr_base::VTYPE, m_vtype ? vtype_bits : Data{1} << (xlen - 1));
+}
+
+template <unsigned int xlen>
+Vpu::Vtype Basic_core<xlen>::get_vtype(Uxlen instruction) const {
+  if (!m_vtype) throw Errors::Illegal_instruction{instruction, "vill is set"};
+  return *m_vtype;
+}
+
+namespace {
+  // A group of 2^emul_log2 registers starts at a multiple of its size.
+  void check_group(Uxlen instruction, unsigned int reg, int emul_log2) {
+    if ((emul_log2 > 0) && (reg & ((1u << emul_log2) - 1))) {
+      throw Errors::Illegal_instruction{instruction, "Misaligned vector register group"};
+    }
+  }
+
+  [[nodiscard("PURE FUN")]] std::uint64_t sign_extend_element(Vpu::Sew sew, std::uint64_t value) {
+    const unsigned int shift{64 - static_cast<unsigned int>(Vpu::get_bytes(sew)) * CHAR_BIT};
+    return static_cast<std::uint64_t>(static_cast<std::int64_t>(value << shift) >> shift);
+  }
+}
+
+// Scalar operands are sign-extended to SEW, or truncated to it, and splatted so that every
+// form runs the same element loops.
+template <unsigned int xlen>
+void Basic_core<xlen>::execute_vector(const Info &instr_info, Uxlen instruction) {
+  using enum Decoder::Concrete_instruction;
+  const Vpu::Vtype vtype{get_vtype(instruction)};
+  const std::size_t vl{static_cast<std::size_t>(m_vl)};
+  std::byte *vd{m_vrf.get(instr_info.rd)};
+  const auto to_element = [](Data scalar) {
+    return static_cast<std::uint64_t>(static_cast<std::int64_t>(static_cast<Sxlen_t<xlen>>(scalar)));
+  };
+
+  // Element 0 regardless of LMUL; vmv.s.x leaves it alone for vl == 0.
+  if (instr_info.instruction == instr_vmv_x_s) {
+    const std::uint64_t element{Vpu::get_element(vtype.sew, m_vrf.get(instr_info.rs2), 0)};
+    m_rf.write(instr_info.rd, static_cast<Data>(sign_extend_element(vtype.sew, element)));
+    return;
+  }
+  if (instr_info.instruction == instr_vmv_s_x) {
+    if (vl) Vpu::set_element(vtype.sew, vd, 0, to_element(m_rf.read(instr_info.rs1)));
+    return;
+  }
+
+  const auto [op, operand] = to_vector_op(instr_info.instruction);
+  // Mask results and reductions write a single register.
+  const bool is_single_vd{Vpu::is_mask_result(op) || Vpu::is_reduction(op)};
+  check_group(instruction, instr_info.rd , is_single_vd ? 0 : vtype.lmul_log2);
+  check_group(instruction, instr_info.rs2, vtype.lmul_log2);
+  if (!instr_info.vm && !is_single_vd && (instr_info.rd == 0)) {
+    throw Errors::Illegal_instruction{instruction, "Masked vector result in v0"};
+  }
+
+  std::array<std::byte, Vpu::max_group_bytes> splatted;
+  const std::byte *vs1{splatted.data()};
+  switch (operand) {
+    case Vector_operand::vector:
+      if (!Vpu::is_reduction(op)) check_group(instruction, instr_info.rs1, vtype.lmul_log2);
+      vs1 = m_vrf.get(instr_info.rs1);
+      break;
+    case Vector_operand::scalar:
+      Vpu::splat(vtype.sew, vl, splatted.data(), to_element(m_rf.read(instr_info.rs1)));
+      break;
+    case Vector_operand::imm:
+      Vpu::splat(vtype.sew, vl, splatted.data(), to_element(instr_info.imm));
+      break;
+  }
+
+  Vpu::calc(op, vtype.sew, vl, vd, m_vrf.get(instr_info.rs2), vs1,
+      instr_info.vm ? nullptr : m_vrf.get(0));
+}
+
+template <unsigned int xlen>
+void Basic_core<xlen>::execute_vector_memory(const Info &instr_info, Uxlen instruction,
+    bool is_store) {
+  const Vpu::Vtype vtype{get_vtype(instruction)};
+  const auto [eew, is_strided] = to_vector_access(instr_info.instruction);
+  // EMUL = EEW / SEW * LMUL.
+  const int emul_log2{vtype.lmul_log2 + static_cast<int>(eew) - static_cast<int>(vtype.sew)};
+  if ((emul_log2 < -3) || (emul_log2 > 3)) {
+    throw Errors::Illegal_instruction{instruction, "Vector EMUL out of range"};
+  }
+  const unsigned int vreg{is_store ? instr_info.rs3 : instr_info.rd};
+  check_group(instruction, vreg, emul_log2);
+  if (!is_store && !instr_info.vm && (vreg == 0)) {
+    throw Errors::Illegal_instruction{instruction, "Masked vector load into v0"};
+  }
+
+  const std::size_t vl{static_cast<std::size_t>(m_vl)};
+  if (vl == 0) return;
+  const std::size_t bytes{Vpu::get_bytes(eew)};
+  const Data base{m_rf.read(instr_info.rs1)};
+  const Data stride{is_strided ? m_rf.read(instr_info.rs2) : static_cast<Data>(bytes)};
+  std::byte *data{m_vrf.get(vreg)};
+  const std::byte *mask{instr_info.vm ? nullptr : m_vrf.get(0)};
+  Xmemory &data_mem{m_data_mem};
+
+  const auto access = [&data_mem, is_store](std::size_t addr, std::span<std::byte> block) {
+    if (is_store) {
+      data_mem.write_block(addr, block);
+    } else {
+      data_mem.read_block(addr, block);
+    }
+  };
+
+  if (!mask && (stride == bytes)) {
+    access(static_cast<std::size_t>(base), {data, vl * bytes});
+    if (is_store) m_reservations.invalidate(static_cast<std::size_t>(base), vl * bytes);
+    return;
+  }
+
+  // The lowest address and the span of the accessed bytes, for negative strides too.
+  const bool is_negative{static_cast<Sxlen_t<xlen>>(stride) < 0};
+  const Data magnitude{is_negative ? static_cast<Data>(-stride) : stride};
+  const Data lowest{is_negative ? static_cast<Data>(base - (vl - 1) * magnitude) : base};
+  std::byte *host{nullptr};
+  const bool has_extent{magnitude <= (std::numeric_limits<std::size_t>::max() - bytes) / vl};
+  if (has_extent) {
+    const std::size_t extent{(vl - 1) * static_cast<std::size_t>(magnitude) + bytes};
+    host = data_mem.get_host_ptr(lowest, extent);
+    if (is_store) m_reservations.invalidate(lowest, extent);
+  }
+
+  for (std::size_t i{0}; i < vl; ++i) {
+    if (mask && !Vpu::is_active(mask, i)) continue;
+    std::byte *element{data + i * bytes};
+    const Data addr{static_cast<Data>(base + i * stride)};
+    if (is_store && !has_extent) m_reservations.invalidate(addr, bytes);
+    if (!host) {
+      access(addr, {element, bytes});
+    } else if (is_store) {
+      copy_to_guest(host + static_cast<Data>(addr - lowest), element, bytes);
+    } else {
+      copy_from_guest(element, host + static_cast<Data>(addr - lowest), bytes);
+    }
+  }
+}
+
+// Guest loads and stores are relaxed host atomics, so a fence maps to a host fence. Only
+// ordering earlier stores before later loads takes a full barrier; the other orderings
+// only keep the host compiler and CPU from reordering across the fence, which costs
+// nothing on x86. fence.tso doesn't order stores before loads.
+template <unsigned int xlen>
+void Basic_core<xlen>::execute_fence(const Info &instr_info) {
+  enum Access : unsigned int {
+    W = 0b0001,
+    R = 0b0010,
+  };
+  const unsigned int succ{static_cast<unsigned int>(instr_info.imm) & 0xf};
+  const unsigned int pred{(static_cast<unsigned int>(instr_info.imm) >> 4) & 0xf};
+  const unsigned int fm  {(static_cast<unsigned int>(instr_info.imm) >> 8) & 0xf};
+  if ((fm != 0b1000) && (pred & W) && (succ & R)) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  } else {
+    std::atomic_thread_fence(std::memory_order_acq_rel);
+  }
+}
+
+template <unsigned int xlen>
+void Basic_core<xlen>::execute_amo(const Info &instr_info) {
+  const auto [op, is_doubleword] = to_amo_op(instr_info.instruction);
+  if constexpr (xlen == 64) {
+    if (is_doubleword) {
+      execute_amo<std::uint64_t>(instr_info, op);
+      return;
+    }
+  }
+  execute_amo<std::uint32_t>(instr_info, op);
+}
+
+template <unsigned int xlen>
+template <typename T>
+void Basic_core<xlen>::execute_amo(const Info &instr_info, Amo::Op op) {
+  const Data addr{m_rf.read(instr_info.rs1)};
+  if (addr % sizeof(T)) throw Errors::Misalignment{addr, "AMO"};
+  // rs2 is read before rd is written, they may be the same register.
+  const T operand{static_cast<T>(m_rf.read(instr_info.rs2))};
+  Xmemory &data_mem{m_data_mem};
+  std::byte *host{data_mem.get_host_ptr(addr, sizeof(T))};
+
+  const Lsu::Op lsu_op{(sizeof(T) == 4) ? Lsu::Op::w : Lsu::Op::d};
+  const std::size_t word_addr{Lsu::get_word_addr<xlen>(addr)};
+  const unsigned int byte_en{Lsu::get_be<xlen>(lsu_op, addr)};
+  const auto load = [&]() -> T {
+    if (host) return Amo::load<T>(host);
+    return static_cast<T>(Lsu::transform_data<xlen>(lsu_op, addr,
+        data_mem.read(word_addr, byte_en)));
+  };
+  const auto store = [&](T value) {
+    data_mem.write(word_addr, Lsu::to_lanes<xlen>(addr, value), byte_en);
+  };
+  // Loaded values are sign-extended to XLEN.
+  const auto write_rd = [&](T value) {
+    m_rf.write(instr_info.rd, static_cast<Data>(static_cast<std::make_signed_t<T>>(value)));
+  };
+
+  switch (op) {
+    case Amo::LR: {
+      const T value{load()};
+      m_reservations.reserve(m_hart, addr);
+      m_reservation = Reservation{addr, value};
+      write_rd(value);
+      return;
+    }
+    case Amo::SC: {
+      const bool is_reserved{m_reservations.take(m_hart, addr) && m_reservation &&
+          (m_reservation->addr == addr)};
+      const T expected{m_reservation ? static_cast<T>(m_reservation->value) : T{0}};
+      m_reservation.reset();
+      bool is_stored{false};
+      if (is_reserved && host) {
+        is_stored = Amo::compare_exchange<T>(host, expected, operand);
+      } else if (is_reserved && (load() == expected)) {
+        store(operand);
+        is_stored = true;
+      }
+      if (is_stored) m_reservations.invalidate(addr, sizeof(T));
+      m_rf.write(instr_info.rd, is_stored ? 0 : 1);
+      return;
+    }
+    default: {
+      T loaded{};
+      if (host) {
+        loaded = Amo::fetch_op<T>(op, host, operand);
+      } else {
+        loaded = load();
+        store(Amo::calc<T>(op, loaded, operand));
+      }
+      m_reservations.invalidate(addr, sizeof(T));
+      write_rd(loaded);
+      return;
+    }
+  }
+}
+
+template <unsigned int xlen>
+void Basic_core<xlen>::take_pending_irq() {
+  const Uxlen pending{m_irq_pending->get() & m_irq_mask};
+  // Priority order defined by the privileged spec.
+  for (const Irq::Cause cause : {Irq::MEI, Irq::MSI, Irq::MTI, Irq::SEI, Irq::SSI, Irq::STI}) {
+    if (pending & Irq::to_mask(cause)) {
+      m_logger->debug("Core. Taking interrupt {} at PC: 0x{:x}.", static_cast<unsigned int>(cause),
+          m_pc);
+      enter_trap(Basic_csr<xlen>::MCAUSE_INTERRUPT | cause);
+      return;
+    }
+  }
+}
+
+template <unsigned int xlen>
+void Basic_core<xlen>::enter_trap(Data cause, Data tval) {
+  using Xcsr = Basic_csr<xlen>;
+  using enum Csr_base::Privilege;
+  Xmemory &csr{m_csr};
+  const bool is_interrupt{(cause & Xcsr::MCAUSE_INTERRUPT) != 0};
+  const Data code{cause & ~Xcsr::MCAUSE_INTERRUPT};
+  const Data delegation{csr.read(is_interrupt ? Xcsr::MIDELEG : Xcsr::MEDELEG)};
+  const bool to_supervisor{(m_privilege != machine) && ((delegation >> code) & 1)};
+
+  const Data mstatus{csr.read(Xcsr::MSTATUS)};
+  Data tvec{0};
+  if (to_supervisor) {
+    const Data spie{(mstatus & Xcsr::MSTATUS_SIE) ? Data{Xcsr::MSTATUS_SPIE} : Data{0}};
+    const Data spp{(m_privilege == supervisor) ? Data{Xcsr::MSTATUS_SPP} : Data{0}};
+    csr.write(Xcsr::MSTATUS, (mstatus &
+        ~Data{Xcsr::MSTATUS_SIE | Xcsr::MSTATUS_SPIE | Xcsr::MSTATUS_SPP}) | spie | spp);
+    csr.write(Xcsr::SEPC, m_pc);
+    csr.write(Xcsr::SCAUSE, cause);
+    csr.write(Xcsr::STVAL, tval);
+    tvec = csr.read(Xcsr::STVEC);
+    m_privilege = supervisor;
+  } else {
+    const Data mpie{(mstatus & Xcsr::MSTATUS_MIE) ? Data{Xcsr::MSTATUS_MPIE} : Data{0}};
+    const Data mpp{static_cast<Data>(m_privilege) << Xcsr::MSTATUS_MPP_SHIFT};
+    csr.write(Xcsr::MSTATUS, (mstatus &
+        ~Data{Xcsr::MSTATUS_MIE | Xcsr::MSTATUS_MPIE | Xcsr::MSTATUS_MPP}) | mpie | mpp);
+    csr.write(Xcsr::MEPC, m_pc);
+    csr.write(Xcsr::MCAUSE, cause);
+    csr.write(Xcsr::MTVAL, tval);
+    tvec = csr.read(Xcsr::MTVEC);
+    m_privilege = machine;
+  }
+
+  const Data base{tvec & ~make_mask<Data>(2)};
+  const bool vectored{(tvec & 0b11) == 1};
+  m_pc = (vectored && is_interrupt) ? base + 4 * code : base;
+  update_irq_mask();
+  update_translation();
+}
+
+// Without S-mode, mpp stays M.
+template <unsigned int xlen>
+void Basic_core<xlen>::execute_ecall() {
+  if (!m_ecall_handler) {
+    switch (m_privilege) {
+      case Csr_base::Privilege::user      : enter_trap(Csr_base::USER_ECALL); return;
+      case Csr_base::Privilege::supervisor: enter_trap(Csr_base::SUPERVISOR_ECALL); return;
+      case Csr_base::Privilege::machine   : enter_trap(Csr_base::MACHINE_ECALL); return;
+      default: assert(0 && "Unknown privilege");
+    }
+  }
+  call(m_ecall_handler);
+}
+
+template <unsigned int xlen>
+void Basic_core<xlen>::execute_ebreak() {
+  if (m_semihosting_handler && is_semihosting_call()) {
+    call(m_semihosting_handler);
+  } else {
+    enter_trap(Csr_base::BREAKPOINT, m_pc);
+  }
+}
+
+// The sequence can't cross a page, so the neighbouring fetches don't fault once the
+// ebreak was fetched.
+template <unsigned int xlen>
+bool Basic_core<xlen>::is_semihosting_call() const {
+  constexpr Uxlen slli_x0_x0_0x1f{0x01f01013};
+  constexpr Uxlen ebreak         {0x00100073};
+  constexpr Uxlen srai_x0_x0_7   {0x40705013};
+  constexpr std::size_t page_size{4096};
+  const std::size_t pc{m_pc};
+  if ((pc & 0b11) || ((pc % page_size) == 0) || ((pc % page_size) == page_size - 4)) {
+    return false;
+  }
+  return (m_instr_mem.read(pc) == ebreak) && (m_instr_mem.read(pc - 4) == slli_x0_x0_0x1f) &&
+      (m_instr_mem.read(pc + 4) == srai_x0_x0_7);
+}
+
+template <unsigned int xlen>
+void Basic_core<xlen>::call(const Call_handler &handler) {
+  // The handler may change registers and memory.
+  ++m_side_effects;
+  if (const std::optional<Data> exit_code{handler()}) halt(*exit_code);
+  m_pc += 4;
+}
+
+template <unsigned int xlen>
+void Basic_core<xlen>::return_from_trap() {
+  using Xcsr = Basic_csr<xlen>;
+  using enum Csr_base::Privilege;
+  Xmemory &csr{m_csr};
+  const Data mstatus{csr.read(Xcsr::MSTATUS)};
+  const Data mie{(mstatus & Xcsr::MSTATUS_MPIE) ? Data{Xcsr::MSTATUS_MIE} : Data{0}};
+  Data next{mstatus & ~Data{Xcsr::MSTATUS_MIE}};
+  if (m_isa_ext_container[Isa_extension::isa_s]) {
+    m_privilege = static_cast<Csr_base::Privilege>(
+        (mstatus & Xcsr::MSTATUS_MPP) >> Xcsr::MSTATUS_MPP_SHIFT);
+    next &= ~Data{Xcsr::MSTATUS_MPP};
+    if (m_privilege != machine) next &= ~Data{Xcsr::MSTATUS_MPRV};
+  }
+  csr.write(Xcsr::MSTATUS, next | mie | Xcsr::MSTATUS_MPIE);
+  m_pc = csr.read(Xcsr::MEPC);
+  update_irq_mask();
+  update_translation();
+}
+
+template <unsigned int xlen>
+void Basic_core<xlen>::return_from_supervisor_trap() {
+  using Xcsr = Basic_csr<xlen>;
+  using enum Csr_base::Privilege;
+  Xmemory &csr{m_csr};
+  const Data mstatus{csr.read(Xcsr::MSTATUS)};
+  const Data sie{(mstatus & Xcsr::MSTATUS_SPIE) ? Data{Xcsr::MSTATUS_SIE} : Data{0}};
+  m_privilege = (mstatus & Xcsr::MSTATUS_SPP) ? supervisor : user;
+  csr.write(Xcsr::MSTATUS, (mstatus & ~Data{Xcsr::MSTATUS_SIE | Xcsr::MSTATUS_SPP |
+      Xcsr::MSTATUS_MPRV}) | sie | Xcsr::MSTATUS_SPIE);
+  m_pc = csr.read(Xcsr::SEPC);
+  update_irq_mask();
+  update_translation();
+}
+
+template <unsigned int xlen>
+void Basic_core<xlen>::update_translation() {
+  if (!m_mmu) return;
+  m_mmu->set_context(m_privilege, m_csr.read(Csr_base::SATP), m_csr.read(Csr_base::MSTATUS));
+}
+
+// rs1 and rs2 of x0 stand for every address and every address space.
+template <unsigned int xlen>
+void Basic_core<xlen>::execute_sfence_vma(const Info &instr_info) {
+  if (!m_mmu) return;
+  std::optional<Data> vaddr{};
+  std::optional<Data> asid{};
+  if (instr_info.rs1 != 0) vaddr = m_rf.read(instr_info.rs1);
+  if (instr_info.rs2 != 0) asid  = m_rf.read(instr_info.rs2);
+  m_mmu->flush(vaddr, asid);
+}
+
+// Instructions are halfword-aligned with the C extension, so a 32-bit one may straddle two
+// words. Only the halves that belong to the instruction are read.
+template <unsigned int xlen>
+[[nodiscard]] Uxlen Basic_core<xlen>::fetch_instruction() const {
+  constexpr Uxlen halfword_mask{0xffff};
+  if (!(m_pc & 0b10)) {
+    const Uxlen word{m_instr_mem.read(m_pc)};
+    return Decoder::is_compressed(word) ? (word & halfword_mask) : word;
+  }
+  const std::size_t word_addr{static_cast<std::size_t>(m_pc) & ~std::size_t{0b11}};
+  const Uxlen low{m_instr_mem.read(word_addr, 0b1100) >> 16};
+  if (Decoder::is_compressed(low)) return low;
+  return low | (m_instr_mem.read(word_addr + 4, 0b0011) << 16);
+}
+
+template <unsigned int xlen>
+auto Basic_core<xlen>::decode(Uxlen instruction) -> const Info& {
+  if (const Info *info{m_decode_cache.find(m_pc, instruction)}) {
+    return *info;
+  }
+  return m_decode_cache.insert(m_pc, instruction, m_decoder.decode(instruction));
+}
+
+template class Basic_core<32>;
+template class Basic_core<64>;
@@ -0,0 +1,138 @@
+#include "coro_device.hpp"
+
+#include "exception.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <new>
+#include <utility>
+
+namespace {
+  constexpr std::size_t size_granularity{64};
+  constexpr std::size_t size_classes_number{16};
+
+  struct Free_block {
+    Free_block *next;
+  };
+
+  class Free_lists {
+    public:
+      Free_lists() = default;
+      Free_lists(const Free_lists&) = delete;
+      Free_lists& operator=(const Free_lists&) = delete;
+      ~Free_lists() {
+        for (Free_block *head : m_heads) {
+          while (head) ::operator delete(std::exchange(head, head->next));
+        }
+      }
+
+      Free_block*& operator[](std::size_t size_class) { return m_heads[size_class]; }
+
+    private:
+      std::array<Free_block*, size_classes_number> m_heads{};
+  };
+
+  thread_local Free_lists free_lists{};
+
+  [[nodiscard("PURE FUN")]] std::size_t get_size_class(std::size_t size) {
+    return (size + size_granularity - 1) / size_granularity - 1;
+  }
+}
+
+void* Frame_pool::allocate(std::size_t size) {
+  const std::size_t size_class{get_size_class(size)};
+  if (size_class >= size_classes_number) return ::operator new(size);
+  if (Free_block *block{free_lists[size_class]}) {
+    free_lists[size_class] = block->next;
+    return block;
+  }
+  return ::operator new((size_class + 1) * size_granularity);
+}
+
+void Frame_pool::deallocate(void *ptr, std::size_t size) {
+  const std::size_t size_class{get_size_class(size)};
+  if (size_class >= size_classes_number) {
+    ::operator delete(ptr);
+    return;
+  }
+  free_lists[size_class] = new (ptr) Free_block{free_lists[size_class]};
+}
+
+Coro_device::Coro_device(Scheduler &scheduler, std::size_t registers_number,
+    std::optional<Irq_config> irq_config)
+    : m_scheduler{scheduler}, m_registers(registers_number, 0), m_irq_config{irq_config} {
+  if (m_irq_config) assert((m_irq_config->ack_addr / 4 < registers_number) && "no ack register");
+}
+
+Coro_device::~Coro_device() {
+  for (const auto &[frame, event] : m_events) m_scheduler.cancel(event);
+}
+
+void Coro_device::write(std::size_t addr, Uxlen data, unsigned int byte_en) {
+  assert((byte_en == 0xf) && "only word access is supported");
+  on_write(addr, data);
+  if (m_irq_config && (addr == m_irq_config->ack_addr) && m_irq_raised) {
+    m_irq_raised = false;
+    m_irq_config->plic.lower(m_irq_config->source);
+    for (std::coroutine_handle<> handle : std::exchange(m_ack_waiters, {})) {
+      resume_in(0, handle);
+    }
+  }
+  notify_access(Access::write, addr, data);
+}
+
+Uxlen Coro_device::read(std::size_t addr, unsigned int byte_en) {
+  assert((byte_en == 0xf) && "only word access is supported");
+  const Uxlen data{on_read(addr)};
+  notify_access(Access::read, addr, data);
+  return data;
+}
+
+void Coro_device::raise_irq() {
+  assert(m_irq_config && "the device has no interrupt line");
+  m_irq_raised = true;
+  m_irq_config->plic.raise(m_irq_config->source);
+}
+
+void Coro_device::spawn(Device_task task) {
+  const std::coroutine_handle<> handle{task.get_handle()};
+  m_tasks.emplace(handle.address(), std::move(task));
+  resume_in(0, handle);
+}
+
+Uxlen& Coro_device::reg(std::size_t addr) {
+  if ((addr % 4 != 0) || (addr / 4 >= m_registers.size())) {
+    throw Errors::Illegal_addr{addr, "Coro_device. Unknown register."};
+  }
+  return m_registers[addr / 4];
+}
+
+void Coro_device::resume_in(Scheduler::Time ticks, std::coroutine_handle<> handle) {
+  assert(!m_events.contains(handle.address()) && "the coroutine is already scheduled");
+  m_events[handle.address()] = m_scheduler.schedule_in(ticks, [this, handle]() {
+    m_events.erase(handle.address());
+    handle.resume();
+    reap(handle);
+  });
+}
+
+// Waiters are resumed from the scheduler, after the access has completed.
+void Coro_device::notify_access(Access access, std::size_t addr, Uxlen data) {
+  std::erase_if(m_access_waiters, [&](const Access_waiter &waiter) {
+    if ((waiter.access != access) || (waiter.addr != addr)) return false;
+    *waiter.data = data;
+    resume_in(0, waiter.handle);
+    return true;
+  });
+}
+
+// A failed device model stops the run loop which resumed it.
+void Coro_device::reap(std::coroutine_handle<> handle) {
+  if (!handle.done()) return;
+  const auto task{m_tasks.find(handle.address())};
+  assert((task != m_tasks.end()) && "not a spawned task");
+  const std::exception_ptr exception{task->second.get_handle().promise().m_exception};
+  m_tasks.erase(task);
+  if (exception) std::rethrow_exception(exception);
+}
@@ -0,0 +1,49 @@
+#include "coro_timer.hpp"
+
+#include "exception.hpp"
+
+#include <algorithm>
+
+Coro_timer::Coro_timer(Scheduler &scheduler, Plic &plic, unsigned int irq_source)
+    : Coro_device{scheduler, 4, Irq_config{plic, irq_source, STATUS}} {
+  spawn(count());
+}
+
+void Coro_timer::on_write(std::size_t addr, Uxlen data) {
+  switch (addr) {
+    case LOAD  :
+    case CTRL  : reg(addr) = data; return;
+    // Write one to clear.
+    case STATUS: reg(addr) &= ~data; return;
+    case COUNT : throw Errors::Read_only{"Coro_timer. Count."};
+    default: throw Errors::Illegal_addr{addr, "Coro_timer. Write to unknown register."};
+  }
+}
+
+Uxlen Coro_timer::on_read(std::size_t addr) {
+  if (addr != COUNT) return reg(addr);
+  const Scheduler::Time now{get_scheduler().get_now()};
+  return (m_deadline > now) ? static_cast<Uxlen>(m_deadline - now) : 0;
+}
+
+Device_task Coro_timer::count() {
+  for (;;) {
+    if (!(reg(CTRL) & CTRL_ENABLE)) {
+      co_await wait_write(CTRL);
+      continue;
+    }
+    // A zero period would expire forever without time moving.
+    const Uxlen load{std::max(reg(LOAD), Uxlen{1})};
+    m_deadline = get_scheduler().get_now() + load;
+    co_await delay(load);
+    // Disabled while counting.
+    if (!(reg(CTRL) & CTRL_ENABLE)) continue;
+
+    reg(STATUS) |= STATUS_EXPIRED;
+    raise_irq();
+    if (!(reg(CTRL) & CTRL_PERIODIC)) {
+      reg(CTRL) &= ~CTRL_ENABLE;
+      co_await wait_irq_ack();
+    }
+  }
+}
@@ -0,0 +1,73 @@
+#include "coro_uart.hpp"
+
+#include "exception.hpp"
+
+Coro_uart::Coro_uart(Scheduler &scheduler, std::ostream &out, Scheduler::Time char_time,
+    Plic &plic, unsigned int irq_source)
+    : Coro_device{scheduler, 5, Irq_config{plic, irq_source, ACK}}, m_out{out},
+      m_char_time{char_time} {
+  spawn(transmit());
+  spawn(receive_line());
+}
+
+void Coro_uart::receive(std::string_view input) {
+  m_rx_line.insert(m_rx_line.end(), input.begin(), input.end());
+  m_rx_arrived.notify();
+}
+
+void Coro_uart::on_write(std::size_t addr, Uxlen data) {
+  switch (addr) {
+    case TXDATA:
+      if (m_tx_fifo.size() < fifo_depth) m_tx_fifo.push_back(static_cast<char>(data));
+      return;
+    case CTRL  : reg(addr) = data; return;
+    case ACK   : return;
+    case RXDATA:
+    case STATUS: throw Errors::Read_only{"Coro_uart. Register " + std::to_string(addr)};
+    default: throw Errors::Illegal_addr{addr, "Coro_uart. Write to unknown register."};
+  }
+}
+
+Uxlen Coro_uart::on_read(std::size_t addr) {
+  switch (addr) {
+    case RXDATA: {
+      if (m_rx_fifo.empty()) return 0;
+      const char data{m_rx_fifo.front()};
+      m_rx_fifo.pop_front();
+      return static_cast<unsigned char>(data);
+    }
+    case STATUS: {
+      Uxlen status{0};
+      if (m_tx_fifo.size() == fifo_depth) status |= STATUS_TX_FULL;
+      if (m_tx_fifo.empty()             ) status |= STATUS_TX_EMPTY;
+      if (!m_rx_fifo.empty()            ) status |= STATUS_RX_VALID;
+      if (m_overrun                     ) status |= STATUS_OVERRUN;
+      m_overrun = false;
+      return status;
+    }
+    case CTRL  : return reg(addr);
+    case TXDATA:
+    case ACK   : return 0;
+    default: throw Errors::Illegal_addr{addr, "Coro_uart. Read from unknown register."};
+  }
+}
+
+Device_task Coro_uart::transmit() {
+  for (;;) {
+    while (m_tx_fifo.empty()) co_await wait_write(TXDATA);
+    co_await delay(m_char_time);
+    m_out.put(m_tx_fifo.front());
+    m_tx_fifo.pop_front();
+  }
+}
+
+Device_task Coro_uart::receive_line() {
+  for (;;) {
+    while (m_rx_line.empty()) co_await m_rx_arrived;
+    co_await delay(m_char_time);
+    if (m_rx_fifo.size() < fifo_depth) m_rx_fifo.push_back(m_rx_line.front());
+    else                               m_overrun = true;
+    m_rx_line.pop_front();
+    if (reg(CTRL) & CTRL_RX_IRQ) raise_irq();
+  }
+}
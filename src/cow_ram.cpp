@@ -0,0 +1,125 @@
+#include "cow_ram.hpp"
+
+#include "exception.hpp"
+
+#include <bit>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace {
+  alignas(Image::page_size) constexpr std::byte zero_page[Image::page_size]{};
+
+  // Shared pages are never written, but atomic_ref of a const object is C++26; private
+  // pages may be written by another thread meanwhile.
+  template <typename T>
+  [[nodiscard]] std::atomic_ref<T> to_atomic(const std::byte *host) {
+    return std::atomic_ref<T>{*reinterpret_cast<T*>(const_cast<std::byte*>(host))};
+  }
+}
+
+template <unsigned int xlen>
+Basic_cow_ram<xlen>::Basic_cow_ram(std::size_t size, std::shared_ptr<const Image> image,
+    std::size_t base)
+    : m_size{size}, m_image{std::move(image)}, m_image_page{base / page_size},
+    m_pages((size + page_size - 1) / page_size) {
+  static_assert(std::endian::native == std::endian::little, "RISC-V is little-endian");
+  if (!m_image) return;
+  if (base % page_size) {
+    throw Errors::Error{"Cow_ram. The image base " + std::to_string(base) +
+        " isn't page-aligned"};
+  }
+  if ((base > size) || (m_image->size() > size - base)) {
+    throw Errors::Error{"Cow_ram. The image doesn't fit in " + std::to_string(size) +
+        " bytes"};
+  }
+}
+
+template <unsigned int xlen>
+Basic_cow_ram<xlen>::~Basic_cow_ram() {
+  for (std::atomic<std::byte*> &page : m_pages) delete[] page.load();
+}
+
+template <unsigned int xlen>
+void Basic_cow_ram<xlen>::write(std::size_t addr, Data data, unsigned int byte_en) {
+  assert_inside(addr);
+  if ((byte_en == full_byte_en) && !(addr % sizeof(Data))) {
+    std::byte *const page{get_private_page(addr / page_size)};
+    to_atomic<Data>(page + addr % page_size).store(data, std::memory_order_relaxed);
+    return;
+  }
+  // A misaligned word may span two pages.
+  for (unsigned int lane{0}; lane < sizeof(Data); ++lane) {
+    if (!((byte_en >> lane) & 1u)) continue;
+    const std::size_t byte_addr{addr + lane};
+    std::byte *const page{get_private_page(byte_addr / page_size)};
+    to_atomic<std::byte>(page + byte_addr % page_size).store(
+        static_cast<std::byte>(data >> (lane * CHAR_BIT)), std::memory_order_relaxed);
+  }
+}
+
+template <unsigned int xlen>
+auto Basic_cow_ram<xlen>::read(std::size_t addr, unsigned int byte_en) -> Data {
+  assert_inside(addr);
+  if ((byte_en == full_byte_en) && !(addr % sizeof(Data))) {
+    const std::byte *const page{get_page(addr / page_size)};
+    return to_atomic<Data>(page + addr % page_size).load(std::memory_order_relaxed);
+  }
+  Data data{0};
+  for (unsigned int lane{0}; lane < sizeof(Data); ++lane) {
+    if (!((byte_en >> lane) & 1u)) continue;
+    const std::size_t byte_addr{addr + lane};
+    const std::byte *const page{get_page(byte_addr / page_size)};
+    data |= std::to_integer<Data>(to_atomic<std::byte>(page + byte_addr % page_size).load(
+        std::memory_order_relaxed)) << (lane * CHAR_BIT);
+  }
+  return data;
+}
+
+template <unsigned int xlen>
+std::byte* Basic_cow_ram<xlen>::get_host_ptr(std::size_t addr, std::size_t size) {
+  if ((size == 0) || (size > m_size) || (addr > m_size - size)) return nullptr;
+  const std::size_t page{addr / page_size};
+  if (page != (addr + size - 1) / page_size) return nullptr;
+  return get_private_page(page) + addr % page_size;
+}
+
+template <unsigned int xlen>
+const std::byte* Basic_cow_ram<xlen>::get_shared_page(std::size_t page) const {
+  if (m_image && (page >= m_image_page) && (page - m_image_page < m_image->get_pages())) {
+    return m_image->get_page(page - m_image_page);
+  }
+  return zero_page;
+}
+
+template <unsigned int xlen>
+const std::byte* Basic_cow_ram<xlen>::get_page(std::size_t page) const {
+  if (const std::byte *own{m_pages[page].load(std::memory_order_acquire)}) return own;
+  return get_shared_page(page);
+}
+
+// Threads writing a shared page at once both copy it, and the copy published first wins.
+template <unsigned int xlen>
+std::byte* Basic_cow_ram<xlen>::get_private_page(std::size_t page) {
+  std::byte *own{m_pages[page].load(std::memory_order_acquire)};
+  if (own) return own;
+  std::unique_ptr<std::byte[]> copy{new std::byte[page_size]};
+  std::memcpy(copy.get(), get_shared_page(page), page_size);
+  if (!m_pages[page].compare_exchange_strong(own, copy.get(), std::memory_order_acq_rel,
+      std::memory_order_acquire)) {
+    return own;
+  }
+  m_private_pages.fetch_add(1, std::memory_order_relaxed);
+  return copy.release();
+}
+
+template <unsigned int xlen>
+void Basic_cow_ram<xlen>::assert_inside(std::size_t addr) const {
+  if ((m_size < sizeof(Data)) || (addr > m_size - sizeof(Data))) {
+    throw Errors::Illegal_addr{addr, "Out of cow_ram. Size: " + std::to_string(m_size)};
+  }
+}
+
+template class Basic_cow_ram<32>;
+template class Basic_cow_ram<64>;
@@ -1,18 +1,44 @@
 #include "csr.hpp"
 
 #include "exception.hpp"
+#include "fpu.hpp"
+#include "riscv_algos.hpp"
+
+#include <optional>
 
 namespace {
 
   template<typename Int_t>
   bool is_legal_reg(Int_t reg) {
-    using enum Csr::Register;
+    using enum Csr_base::Register;
     switch (reg) {
+      case Int_t(FFLAGS):
+      case Int_t(FRM):
+      case Int_t(FCSR):
+      case Int_t(VSTART):
+      case Int_t(SSTATUS):
+      case Int_t(SIE):
+      case Int_t(STVEC):
+      case Int_t(SSCRATCH):
+      case Int_t(SEPC):
+      case Int_t(SCAUSE):
+      case Int_t(STVAL):
+      case Int_t(SIP):
+      case Int_t(SATP):
+      case Int_t(MSTATUS):
+      case Int_t(MEDELEG):
+      case Int_t(MIDELEG):
       case Int_t(MEPC):
       case Int_t(MIE):
       case Int_t(MTVEC):
       case Int_t(MSCRATCH):
-      case Int_t(MCAUSE): return true;
+      case Int_t(MCAUSE):
+      case Int_t(MTVAL):
+      case Int_t(MIP):
+      case Int_t(VL):
+      case Int_t(VTYPE):
+      case Int_t(VLENB):
+      case Int_t(MHARTID): return true;
 
       default: return false;
     }
@@ -22,24 +48,146 @@ namespace {
   void assert_legal_reg(Int_t reg) {
     if (!is_legal_reg(reg)) throw Errors::Illegal_addr{reg, "Illegal csr register."};
   }
+
+  // The first pmp entry of a pmpcfg register. Each holds 4 entries on RV32; RV64 has only
+  // the even ones and each holds 8.
+  template <unsigned int xlen>
+  [[nodiscard]] std::optional<std::size_t> get_pmpcfg_entry(std::size_t addr) {
+    const std::size_t index{addr - Csr_base::PMPCFG0};
+    if ((addr < Csr_base::PMPCFG0) || (index >= Pmp_base::entries / 4)) return {};
+    if ((xlen == 64) && (index % 2)) return {};
+    return index * 4;
+  }
+
+  [[nodiscard]] std::optional<std::size_t> get_pmpaddr_entry(std::size_t addr) {
+    const std::size_t index{addr - Csr_base::PMPADDR0};
+    if ((addr < Csr_base::PMPADDR0) || (index >= Pmp_base::entries)) return {};
+    return index;
+  }
 }
 
-void Csr::write(std::size_t addr, Uxlen data, unsigned int byte_en) {
+template <unsigned int xlen>
+Basic_csr<xlen>::Basic_csr(std::size_t hart) {
+  // Registers the core evaluates on every interrupt check have a defined reset value.
+  m_registers[MSTATUS] = 0;
+  m_registers[MIE]     = 0;
+  m_registers[MIP]     = 0;
+  m_registers[MEDELEG] = 0;
+  m_registers[MIDELEG] = 0;
+  m_registers[SATP]    = 0;
+  m_registers[FFLAGS]  = 0;
+  m_registers[FRM]     = 0;
+  m_registers[VSTART]  = 0;
+  m_registers[MHARTID] = static_cast<Data>(hart);
+  // Flags raised on the host thread before the guest ran don't belong to it.
+  static_cast<void>(Fpu::take_flags());
+}
+
+template <unsigned int xlen>
+Basic_csr<xlen>::Basic_csr(const Irq_pending &irq_pending, std::size_t hart)
+    : Basic_csr(hart) {
+  m_irq_pending = &irq_pending;
+}
+
+template <unsigned int xlen>
+void Basic_csr<xlen>::write(std::size_t addr, Data data, unsigned int byte_en) {
+  if (const auto first{get_pmpcfg_entry<xlen>(addr)}) {
+    for (std::size_t i{0}; i < sizeof(Data); ++i) {
+      m_pmp.set_cfg(*first + i, static_cast<std::uint8_t>(data >> (i * 8)));
+    }
+    return;
+  }
+  if (const auto entry{get_pmpaddr_entry(addr)}) {
+    m_pmp.set_addr(*entry, data);
+    return;
+  }
   assert_legal_reg(addr);
 
   Register reg{static_cast<Register>(addr)};
 
-  m_registers[reg] = data;
+  switch (reg) {
+    // Writing fflags discards what accrued in the host FPU.
+    case FCSR:
+      static_cast<void>(Fpu::take_flags());
+      m_registers[FFLAGS] = data & make_mask<Data>(5);
+      m_registers[FRM]    = (data >> 5) & make_mask<Data>(3);
+      return;
+    case FFLAGS:
+      static_cast<void>(Fpu::take_flags());
+      m_registers[FFLAGS] = data & make_mask<Data>(5);
+      return;
+    case FRM:
+      m_registers[FRM] = data & make_mask<Data>(3);
+      return;
+    case VSTART:
+      return;
+    // mpp is WARL and 0b10 is reserved.
+    case MSTATUS:
+      if (((data & MSTATUS_MPP) >> MSTATUS_MPP_SHIFT) == 0b10) {
+        data = (data & ~Data{MSTATUS_MPP}) | (m_registers[MSTATUS] & MSTATUS_MPP);
+      }
+      m_registers[MSTATUS] = data;
+      return;
+    case SSTATUS:
+      m_registers[MSTATUS] = (m_registers[MSTATUS] & ~Data{SSTATUS_MASK}) |
+          (data & SSTATUS_MASK);
+      return;
+    case SIE:
+      m_registers[MIE] = (m_registers[MIE] & ~m_registers[MIDELEG]) |
+          (data & m_registers[MIDELEG]);
+      return;
+    // Only the software interrupt is pending by a write.
+    case SIP: {
+      const Data writable{Irq::to_mask(Irq::SSI) & m_registers[MIDELEG]};
+      m_registers[MIP] = (m_registers[MIP] & ~writable) | (data & writable);
+      return;
+    }
+    // A write of an unsupported mode has no effect.
+    case SATP:
+      if constexpr (xlen == 32) {
+        m_registers[SATP] = data;
+      } else if (!(data >> 60)) {
+        m_registers[SATP] = data;
+      }
+      return;
+    default:
+      m_registers[reg] = data;
+  }
 }
 
-Uxlen Csr::read(std::size_t addr, unsigned int byte_en) {
+template <unsigned int xlen>
+typename Basic_csr<xlen>::Data Basic_csr<xlen>::read(std::size_t addr, unsigned int byte_en) {
+  if (const auto first{get_pmpcfg_entry<xlen>(addr)}) {
+    Data data{0};
+    for (std::size_t i{0}; i < sizeof(Data); ++i) {
+      data |= Data{m_pmp.get_cfg(*first + i)} << (i * 8);
+    }
+    return data;
+  }
+  if (const auto entry{get_pmpaddr_entry(addr)}) return m_pmp.get_addr(*entry);
   assert_legal_reg(addr);
 
   Register reg{static_cast<Register>(addr)};
 
+  // The exception flags accrue in the host FPU and are only collected here.
+  if ((reg == FFLAGS) || (reg == FCSR)) m_registers[FFLAGS] |= Fpu::take_flags();
+  if (reg == FCSR) return (m_registers[FRM] << 5) | m_registers[FFLAGS];
+
+  switch (reg) {
+    case SSTATUS: return m_registers[MSTATUS] & SSTATUS_MASK;
+    case SIE    : return m_registers[MIE] & m_registers[MIDELEG];
+    case SIP    : return read(MIP) & m_registers[MIDELEG];
+    default: break;
+  }
+
   try {
-    return m_registers.at(reg);
+    Data data{m_registers.at(reg)};
+    if ((reg == MIP) && m_irq_pending) data |= m_irq_pending->get();
+    return data;
   } catch (const std::out_of_range &) {
     throw Errors::Illegal_addr(static_cast<std::size_t>(reg), "Read register was never written.");
   }
 }
+
+template class Basic_csr<32>;
+template class Basic_csr<64>;
@@ -3,6 +3,7 @@
 #include "exception.hpp"
 #include "riscv_algos.hpp"
 
+#include <limits>
 #include <optional>
 #include <type_traits>
 
@@ -32,15 +33,16 @@ namespace {
   }
 
   constexpr Uxlen get_jimm20(Uxlen instruction) {
-    return extract_bits(instruction, {Bit_range{20}, {10, 1}, Bit_range{11}, {19, 12}});
+    return extract_bits(instruction, {Bit_range{31}, {19, 12}, Bit_range{20}, {30, 21}}, true) << 1;
   }
 
   constexpr Uxlen get_imm12(Uxlen instruction) {
     return extract_bits(instruction, {31, 20}, true);
   }
 
-  constexpr Uxlen get_shamt5(Uxlen instruction) {
-    return extract_bits(instruction, {24, 20});
+  // log2(XLEN) bits wide; on RV64 it takes the low bit of funct7.
+  constexpr Uxlen get_shamt(Uxlen instruction, unsigned int xlen) {
+    return extract_bits(instruction, {xlen == 64 ? 25u : 24u, 20});
   }
 
   constexpr Uxlen get_simm12(Uxlen instruction) {
@@ -48,73 +50,225 @@ namespace {
   }
 
   constexpr Uxlen get_sbimm12(Uxlen instruction) {
-    return extract_bits(instruction, {Bit_range{12}, {10, 5}, {4, 1}, Bit_range{11}}, true);
+    return extract_bits(instruction, {Bit_range{31}, Bit_range{7}, {30, 25}, {11, 8}}, true) << 1;
   }
 
   std::string to_string(Isa_extension extension) {
     using enum Isa_extension;
     switch (extension) {
       case isa_zicsr: return "Zicsr";
+      case isa_m    : return "M";
+      case isa_a    : return "A";
+      case isa_c    : return "C";
+      case isa_zba  : return "Zba";
+      case isa_zbb  : return "Zbb";
+      case isa_zbs  : return "Zbs";
+      case isa_f    : return "F";
+      case isa_d    : return "D";
+      case isa_v    : return "V";
+      case isa_zvl256b: return "Zvl256b";
+      case isa_s    : return "S";
       default: assert((void("Unknown isa_extension" + std::to_string(
           static_cast<std::underlying_type_t<Isa_extension>>(extension))), 0)
       );
     }
   }
 
-  void decode_i   (Decoder::Instruction_info &info, Uxlen instr) {
+  // Immediates are extracted as 32-bit values and sign-extended to the XLEN.
+  template <typename Data>
+  constexpr Data sign_extend(Uxlen imm) {
+    return static_cast<Data>(static_cast<std::make_signed_t<Data>>(static_cast<Sxlen>(imm)));
+  }
+
+  template <typename Info>
+  void decode_i   (Info &info, Uxlen instr) {
     info.rd  = get_rd(instr);
     info.rs1 = get_rs1(instr);
-    info.imm = get_imm12(instr);
+    info.imm = sign_extend<decltype(info.imm)>(get_imm12(instr));
   }
-  void decode_i_sh5(Decoder::Instruction_info &info, Uxlen instr) {
+  template <typename Info>
+  void decode_i_sh5(Info &info, Uxlen instr) {
     info.rd  = get_rd(instr);
     info.rs1 = get_rs1(instr);
-    info.imm = get_shamt5(instr);
+    info.imm = get_shamt(instr, std::numeric_limits<decltype(info.imm)>::digits);
   }
-  void decode_r    (Decoder::Instruction_info &info, Uxlen instr) {
+  template <typename Info>
+  void decode_unary(Info &info, Uxlen instr) {
+    info.rd  = get_rd(instr);
+    info.rs1 = get_rs1(instr);
+  }
+  template <typename Info>
+  void decode_r    (Info &info, Uxlen instr) {
     info.rd  = get_rd(instr);
     info.rs1 = get_rs1(instr);
     info.rs2 = get_rs2(instr);
   }
-  void decode_s    (Decoder::Instruction_info &info, Uxlen instr) {
+  template <typename Info>
+  void decode_r_fp (Info &info, Uxlen instr) {
+    decode_r(info, instr);
+    info.rm  = get_funct3(instr);
+  }
+  template <typename Info>
+  void decode_r4   (Info &info, Uxlen instr) {
+    decode_r_fp(info, instr);
+    info.rs3 = extract_bits(instr, {31, 27});
+  }
+  template <typename Info>
+  void decode_v    (Info &info, Uxlen instr) {
+    decode_r(info, instr);
+    info.imm = sign_extend<decltype(info.imm)>(extract_bits(instr, {19, 15}, true));
+    info.vm  = extract_bits(instr, 25) != 0;
+  }
+  template <typename Info>
+  void decode_v_uimm(Info &info, Uxlen instr) {
+    decode_v(info, instr);
+    info.imm = get_rs1(instr);
+  }
+  template <typename Info>
+  void decode_v_load(Info &info, Uxlen instr) {
+    decode_r(info, instr);
+    info.vm  = extract_bits(instr, 25) != 0;
+  }
+  template <typename Info>
+  void decode_v_store(Info &info, Uxlen instr) {
+    decode_v_load(info, instr);
+    info.rd  = 0;
+    info.rs3 = get_rd(instr);
+  }
+  // zimm is 11 bits wide for vsetvli and 10 bits for vsetivli.
+  template <typename Info>
+  void decode_v_cfg(Info &info, Uxlen instr) {
+    decode_unary(info, instr);
+    info.imm = extract_bits(instr, {extract_bits(instr, 31) ? 29u : 30u, 20});
+  }
+  template <typename Info>
+  void decode_s    (Info &info, Uxlen instr) {
     info.rs1 = get_rs1(instr);
     info.rs2 = get_rs2(instr);
-    info.imm = get_simm12(instr);
+    info.imm = sign_extend<decltype(info.imm)>(get_simm12(instr));
   }
-  void decode_u    (Decoder::Instruction_info &info, Uxlen instr) {
+  template <typename Info>
+  void decode_u    (Info &info, Uxlen instr) {
     info.rd  = get_rd(instr);
     info.rs1 = get_rs1(instr);
     info.imm = get_imm20(instr);
   }
-  void decode_uj   (Decoder::Instruction_info &info, Uxlen instr) {
+  template <typename Info>
+  void decode_uj   (Info &info, Uxlen instr) {
     info.rd  = get_rd(instr);
     info.rs1 = get_rs1(instr);
-    info.imm = get_jimm20(instr);
+    info.imm = sign_extend<decltype(info.imm)>(get_jimm20(instr));
   }
-  void decode_sb   (Decoder::Instruction_info &info, Uxlen instr) {
+  template <typename Info>
+  void decode_sb   (Info &info, Uxlen instr) {
     info.rs1 = get_rs1(instr);
     info.rs2 = get_rs2(instr);
-    info.imm = get_sbimm12(instr);
+    info.imm = sign_extend<decltype(info.imm)>(get_sbimm12(instr));
+  }
+
+  constexpr unsigned int get_cfunct3(Uxlen instruction) {
+    return static_cast<unsigned int>(extract_bits(instruction, {15, 13}));
+  }
+
+  // Registers x8-x15 of the 3-bit fields of compressed instructions.
+  constexpr unsigned int get_crs1_prime(Uxlen instruction) {
+    return extract_bits(instruction, {9, 7}) + 8;
+  }
+
+  constexpr unsigned int get_crs2_prime(Uxlen instruction) {
+    return extract_bits(instruction, {4, 2}) + 8;
+  }
+
+  constexpr unsigned int get_crs1(Uxlen instruction) {
+    return extract_bits(instruction, {11, 7});
+  }
+
+  constexpr unsigned int get_crs2(Uxlen instruction) {
+    return extract_bits(instruction, {6, 2});
+  }
+
+  constexpr Uxlen get_cimm6(Uxlen instruction) {
+    return extract_bits(instruction, {Bit_range{12}, {6, 2}}, true);
+  }
+
+  constexpr Uxlen get_cjimm11(Uxlen instruction) {
+    return extract_bits(instruction, {Bit_range{12}, Bit_range{8}, {10, 9}, Bit_range{6},
+        Bit_range{7}, Bit_range{2}, Bit_range{11}, {5, 3}}, true) << 1;
+  }
+
+  constexpr Uxlen get_cbimm8(Uxlen instruction) {
+    return extract_bits(instruction, {Bit_range{12}, {6, 5}, Bit_range{2}, {11, 10}, {4, 3}},
+        true) << 1;
+  }
+
+  // Offset of c.lw and c.sw.
+  constexpr Uxlen get_clsimm5(Uxlen instruction) {
+    return extract_bits(instruction, {Bit_range{5}, {12, 10}, Bit_range{6}}) << 2;
+  }
+
+  constexpr Uxlen get_caddi4spn_imm(Uxlen instruction) {
+    return extract_bits(instruction, {{10, 7}, {12, 11}, Bit_range{5}, Bit_range{6}}) << 2;
+  }
+
+  constexpr Uxlen get_caddi16sp_imm(Uxlen instruction) {
+    return extract_bits(instruction, {Bit_range{12}, {4, 3}, Bit_range{5}, Bit_range{2},
+        Bit_range{6}}, true) << 4;
   }
 
-  void decode_instruction_type(Decoder::Instruction_info &info, Uxlen instruction) {
-    using enum Decoder::Instruction_type;
+  constexpr Uxlen get_clwsp_imm(Uxlen instruction) {
+    return extract_bits(instruction, {{3, 2}, Bit_range{12}, {6, 4}}) << 2;
+  }
+
+  constexpr Uxlen get_cswsp_imm(Uxlen instruction) {
+    return extract_bits(instruction, {{8, 7}, {12, 9}}) << 2;
+  }
+
+  // Offset of c.ld and c.sd.
+  constexpr Uxlen get_cldimm5(Uxlen instruction) {
+    return extract_bits(instruction, {{6, 5}, {12, 10}}) << 3;
+  }
+
+  constexpr Uxlen get_cldsp_imm(Uxlen instruction) {
+    return extract_bits(instruction, {{4, 2}, Bit_range{12}, {6, 5}}) << 3;
+  }
+
+  constexpr Uxlen get_csdsp_imm(Uxlen instruction) {
+    return extract_bits(instruction, {{9, 7}, {12, 10}}) << 3;
+  }
+
+  // Bit 5 must be clear on RV32.
+  constexpr Uxlen get_cshamt(Uxlen instruction) {
+    return extract_bits(instruction, {Bit_range{12}, {6, 2}});
+  }
+
+  template <typename Info>
+  void decode_instruction_type(Info &info, Uxlen instruction) {
+    using enum Decoder_base::Instruction_type;
     switch (info.get_type()) {
       case none :                     break;
       case i    : decode_i    (info, instruction); break;
       case i_sh5: decode_i_sh5(info, instruction); break;
+      case unary: decode_unary(info, instruction); break;
       case r    : decode_r    (info, instruction); break;
+      case r_fp : decode_r_fp (info, instruction); break;
+      case r4   : decode_r4   (info, instruction); break;
       case s    : decode_s    (info, instruction); break;
       case u    : decode_u    (info, instruction); break;
       case uj   : decode_uj   (info, instruction); break;
       case sb   : decode_sb   (info, instruction); break;
+      case v      : decode_v      (info, instruction); break;
+      case v_uimm : decode_v_uimm (info, instruction); break;
+      case v_load : decode_v_load (info, instruction); break;
+      case v_store: decode_v_store(info, instruction); break;
+      case v_cfg  : decode_v_cfg  (info, instruction); break;
       default   : assert(0 && "Unexpected instruction type");
     }
   }
 }
 
-Decoder::Concrete_instruction Decoder::decode_concrete_instruction(Uxlen instruction)
-    const {
+template <unsigned int xlen>
+Decoder_base::Concrete_instruction Basic_decoder<xlen>::decode_concrete_instruction(
+    Uxlen instruction) const {
   if ((instruction & 0b11) != 0b11) {
     throw Errors::Illegal_instruction{instruction, "(instruction & 0b11) != 0b11"};
   }
@@ -124,6 +278,9 @@ Decoder::Concrete_instruction Decoder::decode_concrete_instruction(Uxlen instruc
   // using enum Decoder::Concrete_instruction
 
   std::optional<Isa_extension> missing_extension{};
+  // The shift amounts of op-imm take the low bit of funct7 on RV64.
+  const unsigned int shift_funct7{xlen == 64 ? get_funct7(instruction) & ~1u
+                                             : get_funct7(instruction)};
 
   switch (opcode) {
     case Opcode::load:
@@ -133,17 +290,26 @@ Decoder::Concrete_instruction Decoder::decode_concrete_instruction(Uxlen instruc
         case 2: return Concrete_instruction::instr_lw;
         case 4: return Concrete_instruction::instr_lbu;
         case 5: return Concrete_instruction::instr_lhu;
+        case 3:
+          if constexpr (xlen == 64) return Concrete_instruction::instr_ld;
+          break;
+        case 6:
+          if constexpr (xlen == 64) return Concrete_instruction::instr_lwu;
+          break;
       }
       break;
     case Opcode::op_imm:
+      if (const auto bitmanip{decode_bitmanip(instruction, missing_extension)}) return *bitmanip;
       switch (get_funct3(instruction)) {
         case 0: return Concrete_instruction::instr_addi;
-        case 1: return Concrete_instruction::instr_slli;
+        case 1:
+          if (shift_funct7 == 0) return Concrete_instruction::instr_slli;
+          break;
         case 2: return Concrete_instruction::instr_slti;
         case 3: return Concrete_instruction::instr_sltiu;
         case 4: return Concrete_instruction::instr_xori;
         case 5:
-          switch (get_funct7(instruction)) {
+          switch (shift_funct7) {
             case 0        : return Concrete_instruction::instr_srli;
             case 0b0100000: return Concrete_instruction::instr_srai;
           }
@@ -160,9 +326,104 @@ Decoder::Concrete_instruction Decoder::decode_concrete_instruction(Uxlen instruc
         case 0: return Concrete_instruction::instr_sb;
         case 1: return Concrete_instruction::instr_sh;
         case 2: return Concrete_instruction::instr_sw;
+        case 3:
+          if constexpr (xlen == 64) return Concrete_instruction::instr_sd;
+          break;
+      }
+      break;
+    case Opcode::load_fp:
+    case Opcode::store_fp:
+      if (const auto vector{decode_vector(instruction, missing_extension)}) return *vector;
+      [[fallthrough]];
+    case Opcode::madd:
+    case Opcode::msub:
+    case Opcode::nmsub:
+    case Opcode::nmadd:
+    case Opcode::op_fp:
+      if (const auto fp{decode_fp(instruction, missing_extension)}) return *fp;
+      break;
+    case Opcode::op_v:
+      if (const auto vector{decode_vector(instruction, missing_extension)}) return *vector;
+      break;
+    case Opcode::amo:
+      if (const auto atomic{decode_atomic(instruction, missing_extension)}) return *atomic;
+      break;
+    case Opcode::op_imm_32:
+      if constexpr (xlen == 64) {
+        if (const auto bitmanip{decode_bitmanip(instruction, missing_extension)}) {
+          return *bitmanip;
+        }
+        switch (get_funct3(instruction)) {
+          case 0: return Concrete_instruction::instr_addiw;
+          case 1:
+            if (get_funct7(instruction) == 0) return Concrete_instruction::instr_slliw;
+            break;
+          case 5:
+            switch (get_funct7(instruction)) {
+              case 0        : return Concrete_instruction::instr_srliw;
+              case 0b0100000: return Concrete_instruction::instr_sraiw;
+            }
+            break;
+        }
+      }
+      break;
+    case Opcode::op_32:
+      if constexpr (xlen == 64) {
+        if (get_funct7(instruction) == 0b0000001) {
+          if (!m_isa_ext_container[Isa_extension::isa_m]) {
+            missing_extension = Isa_extension::isa_m;
+            break;
+          }
+          switch (get_funct3(instruction)) {
+            case 0: return Concrete_instruction::instr_mulw;
+            case 4: return Concrete_instruction::instr_divw;
+            case 5: return Concrete_instruction::instr_divuw;
+            case 6: return Concrete_instruction::instr_remw;
+            case 7: return Concrete_instruction::instr_remuw;
+          }
+          break;
+        }
+        if (const auto bitmanip{decode_bitmanip(instruction, missing_extension)}) {
+          return *bitmanip;
+        }
+        switch (get_funct3(instruction)) {
+          case 0:
+            switch (get_funct7(instruction)) {
+              case 0        : return Concrete_instruction::instr_addw;
+              case 0b0100000: return Concrete_instruction::instr_subw;
+            }
+            break;
+          case 1:
+            if (get_funct7(instruction) == 0) return Concrete_instruction::instr_sllw;
+            break;
+          case 5:
+            switch (get_funct7(instruction)) {
+              case 0        : return Concrete_instruction::instr_srlw;
+              case 0b0100000: return Concrete_instruction::instr_sraw;
+            }
+            break;
+        }
       }
       break;
     case Opcode::op:
+      if (get_funct7(instruction) == 0b0000001) {
+        if (!m_isa_ext_container[Isa_extension::isa_m]) {
+          missing_extension = Isa_extension::isa_m;
+          break;
+        }
+        switch (get_funct3(instruction)) {
+          case 0: return Concrete_instruction::instr_mul;
+          case 1: return Concrete_instruction::instr_mulh;
+          case 2: return Concrete_instruction::instr_mulhsu;
+          case 3: return Concrete_instruction::instr_mulhu;
+          case 4: return Concrete_instruction::instr_div;
+          case 5: return Concrete_instruction::instr_divu;
+          case 6: return Concrete_instruction::instr_rem;
+          case 7: return Concrete_instruction::instr_remu;
+        }
+      }
+      if (const auto bitmanip{decode_bitmanip(instruction, missing_extension)}) return *bitmanip;
+      if ((get_funct7(instruction) != 0) && (get_funct7(instruction) != 0b0100000)) break;
       switch (get_funct3(instruction)) {
         case 0:
           switch (get_funct7(instruction)) {
@@ -170,18 +431,30 @@ Decoder::Concrete_instruction Decoder::decode_concrete_instruction(Uxlen instruc
             case 0b0100000: return Concrete_instruction::instr_sub;
           }
           break;
-        case 1: return Concrete_instruction::instr_sll;
-        case 2: return Concrete_instruction::instr_slt;
-        case 3: return Concrete_instruction::instr_sltu;
-        case 4: return Concrete_instruction::instr_xor;
+        case 1:
+          if (get_funct7(instruction) == 0) return Concrete_instruction::instr_sll;
+          break;
+        case 2:
+          if (get_funct7(instruction) == 0) return Concrete_instruction::instr_slt;
+          break;
+        case 3:
+          if (get_funct7(instruction) == 0) return Concrete_instruction::instr_sltu;
+          break;
+        case 4:
+          if (get_funct7(instruction) == 0) return Concrete_instruction::instr_xor;
+          break;
         case 5:
           switch (get_funct7(instruction)) {
             case 0        : return Concrete_instruction::instr_srl;
             case 0b0100000: return Concrete_instruction::instr_sra;
           }
           break;
-        case 6: return Concrete_instruction::instr_or;
-        case 7: return Concrete_instruction::instr_and;
+        case 6:
+          if (get_funct7(instruction) == 0) return Concrete_instruction::instr_or;
+          break;
+        case 7:
+          if (get_funct7(instruction) == 0) return Concrete_instruction::instr_and;
+          break;
       }
       break;
     case Opcode::lui:
@@ -209,8 +482,23 @@ Decoder::Concrete_instruction Decoder::decode_concrete_instruction(Uxlen instruc
     case Opcode::system:
       switch (const auto funct3 = get_funct3(instruction)) {
         case 0:
-          if (extract_bits(instruction, {31, 7}) == 0b0011000000100000000000000) {
-            return Concrete_instruction::instr_mret;
+          switch (extract_bits(instruction, {31, 7})) {
+            case 0b0000000000000000000000000: return Concrete_instruction::instr_ecall;
+            case 0b0000000000010000000000000: return Concrete_instruction::instr_ebreak;
+            case 0b0011000000100000000000000: return Concrete_instruction::instr_mret;
+            case 0b0001000001010000000000000: return Concrete_instruction::instr_wfi;
+            case 0b0001000000100000000000000:
+              if (m_isa_ext_container[Isa_extension::isa_s]) {
+                return Concrete_instruction::instr_sret;
+              }
+              missing_extension = Isa_extension::isa_s;
+              break;
+          }
+          if ((get_funct7(instruction) == 0b0001001) && (get_rd(instruction) == 0)) {
+            if (m_isa_ext_container[Isa_extension::isa_s]) {
+              return Concrete_instruction::instr_sfence_vma;
+            }
+            missing_extension = Isa_extension::isa_s;
           }
           break;
         case 4: break;
@@ -238,7 +526,587 @@ Decoder::Concrete_instruction Decoder::decode_concrete_instruction(Uxlen instruc
   }
 }
 
-Decoder::Instruction_info Decoder::decode(Uxlen instruction) const {
+// Zba/Zbb/Zbs live in the op and op-imm opcodes under funct7 values the base ISA doesn't
+// use. Unary instructions and the immediate forms of Zbb are further selected by rs2. RV64
+// adds the word forms in op-32 and op-imm-32.
+template <unsigned int xlen>
+std::optional<Decoder_base::Concrete_instruction> Basic_decoder<xlen>::decode_bitmanip(
+    Uxlen instruction, std::optional<Isa_extension> &missing_extension) const {
+  using enum Concrete_instruction;
+  using enum Isa_extension;
+  struct Encoding {
+    Opcode opcode;
+    unsigned int funct7;
+    unsigned int funct3;
+    std::optional<unsigned int> rs2;
+    Isa_extension extension;
+    Concrete_instruction instruction;
+    // 0 if the encoding exists for every XLEN.
+    unsigned int only_xlen{0};
+  };
+  static constexpr Encoding encodings[]{
+    {Opcode::op    , 0b0010000, 0b010, {}     , isa_zba, instr_sh1add},
+    {Opcode::op    , 0b0010000, 0b100, {}     , isa_zba, instr_sh2add},
+    {Opcode::op    , 0b0010000, 0b110, {}     , isa_zba, instr_sh3add},
+    {Opcode::op    , 0b0100000, 0b111, {}     , isa_zbb, instr_andn  },
+    {Opcode::op    , 0b0100000, 0b110, {}     , isa_zbb, instr_orn   },
+    {Opcode::op    , 0b0100000, 0b100, {}     , isa_zbb, instr_xnor  },
+    {Opcode::op    , 0b0000101, 0b110, {}     , isa_zbb, instr_max   },
+    {Opcode::op    , 0b0000101, 0b111, {}     , isa_zbb, instr_maxu  },
+    {Opcode::op    , 0b0000101, 0b100, {}     , isa_zbb, instr_min   },
+    {Opcode::op    , 0b0000101, 0b101, {}     , isa_zbb, instr_minu  },
+    {Opcode::op    , 0b0110000, 0b001, {}     , isa_zbb, instr_rol   },
+    {Opcode::op    , 0b0110000, 0b101, {}     , isa_zbb, instr_ror   },
+    {Opcode::op    , 0b0000100, 0b100, 0b00000, isa_zbb, instr_zext_h, 32},
+    {Opcode::op_imm, 0b0110000, 0b001, 0b00000, isa_zbb, instr_clz   },
+    {Opcode::op_imm, 0b0110000, 0b001, 0b00001, isa_zbb, instr_ctz   },
+    {Opcode::op_imm, 0b0110000, 0b001, 0b00010, isa_zbb, instr_cpop  },
+    {Opcode::op_imm, 0b0110000, 0b001, 0b00100, isa_zbb, instr_sext_b},
+    {Opcode::op_imm, 0b0110000, 0b001, 0b00101, isa_zbb, instr_sext_h},
+    {Opcode::op_imm, 0b0110000, 0b101, {}     , isa_zbb, instr_rori  },
+    {Opcode::op_imm, 0b0010100, 0b101, 0b00111, isa_zbb, instr_orc_b },
+    {Opcode::op_imm, 0b0110100, 0b101, 0b11000, isa_zbb, instr_rev8  , 32},
+    {Opcode::op_imm, 0b0110101, 0b101, 0b11000, isa_zbb, instr_rev8  , 64},
+    {Opcode::op    , 0b0100100, 0b001, {}     , isa_zbs, instr_bclr  },
+    {Opcode::op    , 0b0100100, 0b101, {}     , isa_zbs, instr_bext  },
+    {Opcode::op    , 0b0110100, 0b001, {}     , isa_zbs, instr_binv  },
+    {Opcode::op    , 0b0010100, 0b001, {}     , isa_zbs, instr_bset  },
+    {Opcode::op_imm, 0b0100100, 0b001, {}     , isa_zbs, instr_bclri },
+    {Opcode::op_imm, 0b0100100, 0b101, {}     , isa_zbs, instr_bexti },
+    {Opcode::op_imm, 0b0110100, 0b001, {}     , isa_zbs, instr_binvi },
+    {Opcode::op_imm, 0b0010100, 0b001, {}     , isa_zbs, instr_bseti },
+    {Opcode::op_32    , 0b0000100, 0b000, {}     , isa_zba, instr_add_uw   , 64},
+    {Opcode::op_32    , 0b0010000, 0b010, {}     , isa_zba, instr_sh1add_uw, 64},
+    {Opcode::op_32    , 0b0010000, 0b100, {}     , isa_zba, instr_sh2add_uw, 64},
+    {Opcode::op_32    , 0b0010000, 0b110, {}     , isa_zba, instr_sh3add_uw, 64},
+    {Opcode::op_imm_32, 0b0000100, 0b001, {}     , isa_zba, instr_slli_uw  , 64},
+    {Opcode::op_32    , 0b0000100, 0b100, 0b00000, isa_zbb, instr_zext_h   , 64},
+    {Opcode::op_imm_32, 0b0110000, 0b001, 0b00000, isa_zbb, instr_clzw     , 64},
+    {Opcode::op_imm_32, 0b0110000, 0b001, 0b00001, isa_zbb, instr_ctzw     , 64},
+    {Opcode::op_imm_32, 0b0110000, 0b001, 0b00010, isa_zbb, instr_cpopw    , 64},
+    {Opcode::op_32    , 0b0110000, 0b001, {}     , isa_zbb, instr_rolw     , 64},
+    {Opcode::op_32    , 0b0110000, 0b101, {}     , isa_zbb, instr_rorw     , 64},
+    {Opcode::op_imm_32, 0b0110000, 0b101, {}     , isa_zbb, instr_roriw    , 64},
+  };
+
+  const Opcode opcode{static_cast<Opcode>(extract_bits(instruction, {6, 2}))};
+  const unsigned int funct7{get_funct7(instruction)};
+  const unsigned int funct3{get_funct3(instruction)};
+  const unsigned int rs2   {get_rs2(instruction)};
+  for (const Encoding &encoding : encodings) {
+    if (encoding.only_xlen && (encoding.only_xlen != xlen)) continue;
+    // A 6-bit shift amount takes the low bit of funct7.
+    const bool wide_shamt{(xlen == 64) && !encoding.rs2 &&
+        ((encoding.opcode == Opcode::op_imm) || (encoding.instruction == instr_slli_uw))};
+    if ((encoding.opcode != opcode) ||
+        (encoding.funct7 != (wide_shamt ? funct7 & ~1u : funct7)) ||
+        (encoding.funct3 != funct3) || (encoding.rs2 && (*encoding.rs2 != rs2))) {
+      continue;
+    }
+    if (m_isa_ext_container[encoding.extension]) return encoding.instruction;
+    missing_extension = encoding.extension;
+    return std::nullopt;
+  }
+  return std::nullopt;
+}
+
+// F and D. The format of op-fp and of the fused multiply-adds is in the low bits of
+// funct7; the rounding mode, where there is one, is in funct3.
+template <unsigned int xlen>
+std::optional<Decoder_base::Concrete_instruction> Basic_decoder<xlen>::decode_fp(
+    Uxlen instruction, std::optional<Isa_extension> &missing_extension) const {
+  using enum Concrete_instruction;
+  using enum Isa_extension;
+  struct Encoding {
+    unsigned int funct7;
+    // Empty for a rounding mode.
+    std::optional<unsigned int> funct3;
+    std::optional<unsigned int> rs2;
+    Isa_extension extension;
+    Concrete_instruction instruction;
+    // 0 if the encoding exists for every XLEN.
+    unsigned int only_xlen{0};
+  };
+  static constexpr Encoding encodings[]{
+    {0b0000000, {}, {}, isa_f, instr_fadd_s    },
+    {0b0000100, {}, {}, isa_f, instr_fsub_s    },
+    {0b0001000, {}, {}, isa_f, instr_fmul_s    },
+    {0b0001100, {}, {}, isa_f, instr_fdiv_s    },
+    {0b0101100, {}, 0 , isa_f, instr_fsqrt_s   },
+    {0b0010000, 0 , {}, isa_f, instr_fsgnj_s   },
+    {0b0010000, 1 , {}, isa_f, instr_fsgnjn_s  },
+    {0b0010000, 2 , {}, isa_f, instr_fsgnjx_s  },
+    {0b0010100, 0 , {}, isa_f, instr_fmin_s    },
+    {0b0010100, 1 , {}, isa_f, instr_fmax_s    },
+    {0b1100000, {}, 0 , isa_f, instr_fcvt_w_s  },
+    {0b1100000, {}, 1 , isa_f, instr_fcvt_wu_s },
+    {0b1100000, {}, 2 , isa_f, instr_fcvt_l_s  , 64},
+    {0b1100000, {}, 3 , isa_f, instr_fcvt_lu_s , 64},
+    {0b1110000, 0 , 0 , isa_f, instr_fmv_x_w   },
+    {0b1110000, 1 , 0 , isa_f, instr_fclass_s  },
+    {0b1010000, 2 , {}, isa_f, instr_feq_s     },
+    {0b1010000, 1 , {}, isa_f, instr_flt_s     },
+    {0b1010000, 0 , {}, isa_f, instr_fle_s     },
+    {0b1101000, {}, 0 , isa_f, instr_fcvt_s_w  },
+    {0b1101000, {}, 1 , isa_f, instr_fcvt_s_wu },
+    {0b1101000, {}, 2 , isa_f, instr_fcvt_s_l  , 64},
+    {0b1101000, {}, 3 , isa_f, instr_fcvt_s_lu , 64},
+    {0b1111000, 0 , 0 , isa_f, instr_fmv_w_x   },
+    {0b0000001, {}, {}, isa_d, instr_fadd_d    },
+    {0b0000101, {}, {}, isa_d, instr_fsub_d    },
+    {0b0001001, {}, {}, isa_d, instr_fmul_d    },
+    {0b0001101, {}, {}, isa_d, instr_fdiv_d    },
+    {0b0101101, {}, 0 , isa_d, instr_fsqrt_d   },
+    {0b0010001, 0 , {}, isa_d, instr_fsgnj_d   },
+    {0b0010001, 1 , {}, isa_d, instr_fsgnjn_d  },
+    {0b0010001, 2 , {}, isa_d, instr_fsgnjx_d  },
+    {0b0010101, 0 , {}, isa_d, instr_fmin_d    },
+    {0b0010101, 1 , {}, isa_d, instr_fmax_d    },
+    {0b0100000, {}, 1 , isa_d, instr_fcvt_s_d  },
+    {0b0100001, {}, 0 , isa_d, instr_fcvt_d_s  },
+    {0b1010001, 2 , {}, isa_d, instr_feq_d     },
+    {0b1010001, 1 , {}, isa_d, instr_flt_d     },
+    {0b1010001, 0 , {}, isa_d, instr_fle_d     },
+    {0b1110001, 1 , 0 , isa_d, instr_fclass_d  },
+    {0b1100001, {}, 0 , isa_d, instr_fcvt_w_d  },
+    {0b1100001, {}, 1 , isa_d, instr_fcvt_wu_d },
+    {0b1100001, {}, 2 , isa_d, instr_fcvt_l_d  , 64},
+    {0b1100001, {}, 3 , isa_d, instr_fcvt_lu_d , 64},
+    {0b1101001, {}, 0 , isa_d, instr_fcvt_d_w  },
+    {0b1101001, {}, 1 , isa_d, instr_fcvt_d_wu },
+    {0b1101001, {}, 2 , isa_d, instr_fcvt_d_l  , 64},
+    {0b1101001, {}, 3 , isa_d, instr_fcvt_d_lu , 64},
+    {0b1110001, 0 , 0 , isa_d, instr_fmv_x_d   , 64},
+    {0b1111001, 0 , 0 , isa_d, instr_fmv_d_x   , 64},
+  };
+  static constexpr Concrete_instruction fused[][4]{
+    {instr_fmadd_s, instr_fmsub_s, instr_fnmsub_s, instr_fnmadd_s},
+    {instr_fmadd_d, instr_fmsub_d, instr_fnmsub_d, instr_fnmadd_d},
+  };
+
+  const auto require = [&missing_extension, this](Isa_extension extension,
+      Concrete_instruction instr) -> std::optional<Concrete_instruction> {
+    if (m_isa_ext_container[extension]) return instr;
+    missing_extension = extension;
+    return std::nullopt;
+  };
+
+  const Opcode opcode{static_cast<Opcode>(extract_bits(instruction, {6, 2}))};
+  const unsigned int funct3{get_funct3(instruction)};
+  // Static rounding modes 0b101 and 0b110 are reserved.
+  const bool valid_rm{(funct3 != 0b101) && (funct3 != 0b110)};
+
+  switch (opcode) {
+    case Opcode::load_fp:
+      if (funct3 == 0b010) return require(isa_f, instr_flw);
+      if (funct3 == 0b011) return require(isa_d, instr_fld);
+      break;
+    case Opcode::store_fp:
+      if (funct3 == 0b010) return require(isa_f, instr_fsw);
+      if (funct3 == 0b011) return require(isa_d, instr_fsd);
+      break;
+    case Opcode::madd:
+    case Opcode::msub:
+    case Opcode::nmsub:
+    case Opcode::nmadd: {
+      const unsigned int format{static_cast<unsigned int>(extract_bits(instruction, {26, 25}))};
+      if (!valid_rm || (format > 1)) break;
+      const auto index{static_cast<std::size_t>(opcode) - static_cast<std::size_t>(Opcode::madd)};
+      return require(format ? isa_d : isa_f, fused[format][index]);
+    }
+    case Opcode::op_fp: {
+      const unsigned int funct7{get_funct7(instruction)};
+      const unsigned int rs2   {get_rs2(instruction)};
+      for (const Encoding &encoding : encodings) {
+        if (encoding.only_xlen && (encoding.only_xlen != xlen)) continue;
+        if ((encoding.funct7 != funct7) || (encoding.rs2 && (*encoding.rs2 != rs2))) continue;
+        if (encoding.funct3 ? (*encoding.funct3 != funct3) : !valid_rm) continue;
+        return require(encoding.extension, encoding.instruction);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  return std::nullopt;
+}
+
+// The integer subset of V. Vector loads and stores share load-fp and store-fp with F and
+// D, under the widths those don't use; segment, indexed and whole register accesses and
+// the fault-only-first loads aren't supported. Arithmetic is in op-v, selected by funct6
+// and by the operand form in funct3.
+template <unsigned int xlen>
+std::optional<Decoder_base::Concrete_instruction> Basic_decoder<xlen>::decode_vector(
+    Uxlen instruction, std::optional<Isa_extension> &missing_extension) const {
+  using enum Concrete_instruction;
+  enum Form : unsigned int {
+    ivv = 0b000,
+    mvv = 0b010,
+    ivi = 0b011,
+    ivx = 0b100,
+    mvx = 0b110,
+    cfg = 0b111,
+  };
+  struct Encoding {
+    unsigned int funct6;
+    Form form;
+    Concrete_instruction instruction;
+    std::optional<bool> vm{};
+    // Fields that must hold a fixed value.
+    std::optional<unsigned int> rs1{};
+    std::optional<unsigned int> rs2{};
+  };
+  static constexpr Encoding encodings[]{
+    {0b000000, ivv, instr_vadd_vv    },
+    {0b000000, ivx, instr_vadd_vx    },
+    {0b000000, ivi, instr_vadd_vi    },
+    {0b000010, ivv, instr_vsub_vv    },
+    {0b000010, ivx, instr_vsub_vx    },
+    {0b000011, ivx, instr_vrsub_vx   },
+    {0b000011, ivi, instr_vrsub_vi   },
+    {0b000100, ivv, instr_vminu_vv   },
+    {0b000100, ivx, instr_vminu_vx   },
+    {0b000101, ivv, instr_vmin_vv    },
+    {0b000101, ivx, instr_vmin_vx    },
+    {0b000110, ivv, instr_vmaxu_vv   },
+    {0b000110, ivx, instr_vmaxu_vx   },
+    {0b000111, ivv, instr_vmax_vv    },
+    {0b000111, ivx, instr_vmax_vx    },
+    {0b001001, ivv, instr_vand_vv    },
+    {0b001001, ivx, instr_vand_vx    },
+    {0b001001, ivi, instr_vand_vi    },
+    {0b001010, ivv, instr_vor_vv     },
+    {0b001010, ivx, instr_vor_vx     },
+    {0b001010, ivi, instr_vor_vi     },
+    {0b001011, ivv, instr_vxor_vv    },
+    {0b001011, ivx, instr_vxor_vx    },
+    {0b001011, ivi, instr_vxor_vi    },
+    {0b010111, ivv, instr_vmerge_vvm , false},
+    {0b010111, ivx, instr_vmerge_vxm , false},
+    {0b010111, ivi, instr_vmerge_vim , false},
+    {0b010111, ivv, instr_vmv_v_v    , true , {}, 0},
+    {0b010111, ivx, instr_vmv_v_x    , true , {}, 0},
+    {0b010111, ivi, instr_vmv_v_i    , true , {}, 0},
+    {0b011000, ivv, instr_vmseq_vv   },
+    {0b011000, ivx, instr_vmseq_vx   },
+    {0b011000, ivi, instr_vmseq_vi   },
+    {0b011001, ivv, instr_vmsne_vv   },
+    {0b011001, ivx, instr_vmsne_vx   },
+    {0b011001, ivi, instr_vmsne_vi   },
+    {0b011010, ivv, instr_vmsltu_vv  },
+    {0b011010, ivx, instr_vmsltu_vx  },
+    {0b011011, ivv, instr_vmslt_vv   },
+    {0b011011, ivx, instr_vmslt_vx   },
+    {0b011100, ivv, instr_vmsleu_vv  },
+    {0b011100, ivx, instr_vmsleu_vx  },
+    {0b011100, ivi, instr_vmsleu_vi  },
+    {0b011101, ivv, instr_vmsle_vv   },
+    {0b011101, ivx, instr_vmsle_vx   },
+    {0b011101, ivi, instr_vmsle_vi   },
+    {0b011110, ivx, instr_vmsgtu_vx  },
+    {0b011110, ivi, instr_vmsgtu_vi  },
+    {0b011111, ivx, instr_vmsgt_vx   },
+    {0b011111, ivi, instr_vmsgt_vi   },
+    {0b100101, ivv, instr_vsll_vv    },
+    {0b100101, ivx, instr_vsll_vx    },
+    {0b100101, ivi, instr_vsll_vi    },
+    {0b101000, ivv, instr_vsrl_vv    },
+    {0b101000, ivx, instr_vsrl_vx    },
+    {0b101000, ivi, instr_vsrl_vi    },
+    {0b101001, ivv, instr_vsra_vv    },
+    {0b101001, ivx, instr_vsra_vx    },
+    {0b101001, ivi, instr_vsra_vi    },
+    {0b000000, mvv, instr_vredsum_vs },
+    {0b000001, mvv, instr_vredand_vs },
+    {0b000010, mvv, instr_vredor_vs  },
+    {0b000011, mvv, instr_vredxor_vs },
+    {0b000100, mvv, instr_vredminu_vs},
+    {0b000101, mvv, instr_vredmin_vs },
+    {0b000110, mvv, instr_vredmaxu_vs},
+    {0b000111, mvv, instr_vredmax_vs },
+    {0b010000, mvv, instr_vmv_x_s    , true , 0 , {}},
+    {0b010000, mvx, instr_vmv_s_x    , true , {}, 0 },
+    {0b100101, mvv, instr_vmul_vv    },
+    {0b100101, mvx, instr_vmul_vx    },
+    {0b100111, mvv, instr_vmulh_vv   },
+    {0b100111, mvx, instr_vmulh_vx   },
+    {0b100100, mvv, instr_vmulhu_vv  },
+    {0b100100, mvx, instr_vmulhu_vx  },
+    {0b100110, mvv, instr_vmulhsu_vv },
+    {0b100110, mvx, instr_vmulhsu_vx },
+  };
+  // By the log2 of the element width.
+  static constexpr Concrete_instruction loads[][4]{
+    {instr_vle8_v , instr_vle16_v , instr_vle32_v , instr_vle64_v },
+    {instr_vlse8_v, instr_vlse16_v, instr_vlse32_v, instr_vlse64_v},
+  };
+  static constexpr Concrete_instruction stores[][4]{
+    {instr_vse8_v , instr_vse16_v , instr_vse32_v , instr_vse64_v },
+    {instr_vsse8_v, instr_vsse16_v, instr_vsse32_v, instr_vsse64_v},
+  };
+
+  const auto require_v = [&missing_extension, this](
+      Concrete_instruction instr) -> std::optional<Concrete_instruction> {
+    if (m_isa_ext_container[Isa_extension::isa_v]) return instr;
+    missing_extension = Isa_extension::isa_v;
+    return std::nullopt;
+  };
+
+  const Opcode opcode{static_cast<Opcode>(extract_bits(instruction, {6, 2}))};
+  const unsigned int funct3{get_funct3(instruction)};
+  const unsigned int rs1   {get_rs1(instruction)};
+  const unsigned int rs2   {get_rs2(instruction)};
+
+  if ((opcode == Opcode::load_fp) || (opcode == Opcode::store_fp)) {
+    std::size_t width{0};
+    switch (funct3) {
+      case 0b000: width = 0; break;
+      case 0b101: width = 1; break;
+      case 0b110: width = 2; break;
+      case 0b111: width = 3; break;
+      default: return std::nullopt;
+    }
+    // nf and mew.
+    if (extract_bits(instruction, {31, 28})) return std::nullopt;
+    const unsigned int mop{static_cast<unsigned int>(extract_bits(instruction, {27, 26}))};
+    std::size_t addressing{0};
+    if ((mop == 0b00) && (rs2 == 0)) {
+      addressing = 0;
+    } else if (mop == 0b10) {
+      addressing = 1;
+    } else {
+      return std::nullopt;
+    }
+    return require_v((opcode == Opcode::load_fp) ? loads[addressing][width]
+                                                 : stores[addressing][width]);
+  }
+
+  if (funct3 == cfg) {
+    if (!extract_bits(instruction, 31)) return require_v(instr_vsetvli);
+    if (extract_bits(instruction, 30)) return require_v(instr_vsetivli);
+    if (get_funct7(instruction) == 0b1000000) return require_v(instr_vsetvl);
+    return std::nullopt;
+  }
+
+  const unsigned int funct6{static_cast<unsigned int>(extract_bits(instruction, {31, 26}))};
+  const bool vm{extract_bits(instruction, 25) != 0};
+  for (const Encoding &encoding : encodings) {
+    if ((encoding.funct6 != funct6) || (encoding.form != funct3)) continue;
+    if ((encoding.vm && (*encoding.vm != vm)) || (encoding.rs1 && (*encoding.rs1 != rs1)) ||
+        (encoding.rs2 && (*encoding.rs2 != rs2))) {
+      continue;
+    }
+    return require_v(encoding.instruction);
+  }
+  return std::nullopt;
+}
+
+// Every compressed instruction has an equivalent base one, so it's expanded into the same
+// info and executed by the same handlers. RV64 replaces c.jal with c.addiw and the single
+// precision loads and stores of RV32 with c.ld/c.sd; reserved encodings, RV128 ones and
+// FP loads and stores without F/D are illegal.
+template <unsigned int xlen>
+typename Basic_decoder<xlen>::Instruction_info Basic_decoder<xlen>::decode_compressed(
+    Uxlen instruction) const {
+  using enum Concrete_instruction;
+  constexpr unsigned int sp{2};
+  constexpr unsigned int ra{1};
+
+  Instruction_info info{.length = 2};
+  const auto make = [&info](Concrete_instruction instr, unsigned int rd, unsigned int rs1,
+      unsigned int rs2, Uxlen imm) {
+    info.instruction = instr;
+    info.rd  = rd;
+    info.rs1 = rs1;
+    info.rs2 = rs2;
+    info.imm = sign_extend<Uxlen_t<xlen>>(imm);
+    return info;
+  };
+
+  const unsigned int funct3{get_cfunct3(instruction)};
+  const unsigned int quadrant{static_cast<unsigned int>(extract_bits(instruction, {1, 0}))};
+  const unsigned int rd {get_crs1(instruction)};
+  const unsigned int rs2{get_crs2(instruction)};
+  const unsigned int rd_prime {get_crs1_prime(instruction)};
+  const unsigned int rs2_prime{get_crs2_prime(instruction)};
+  const bool bit12{extract_bits(instruction, 12) != 0};
+  constexpr bool rv64{xlen == 64};
+  const bool f{m_isa_ext_container[Isa_extension::isa_f]};
+  const bool d{m_isa_ext_container[Isa_extension::isa_d]};
+
+  switch (quadrant) {
+    case 0b00:
+      switch (funct3) {
+        case 0b000:
+          if (get_caddi4spn_imm(instruction) == 0) break;
+          return make(instr_addi, rs2_prime, sp, 0, get_caddi4spn_imm(instruction));
+        case 0b001:
+          if (!d) break;
+          return make(instr_fld, rs2_prime, rd_prime, 0, get_cldimm5(instruction));
+        case 0b010:
+          return make(instr_lw, rs2_prime, rd_prime, 0, get_clsimm5(instruction));
+        case 0b011:
+          if (rv64) return make(instr_ld, rs2_prime, rd_prime, 0, get_cldimm5(instruction));
+          if (!f) break;
+          return make(instr_flw, rs2_prime, rd_prime, 0, get_clsimm5(instruction));
+        case 0b101:
+          if (!d) break;
+          return make(instr_fsd, 0, rd_prime, rs2_prime, get_cldimm5(instruction));
+        case 0b110:
+          return make(instr_sw, 0, rd_prime, rs2_prime, get_clsimm5(instruction));
+        case 0b111:
+          if (rv64) return make(instr_sd, 0, rd_prime, rs2_prime, get_cldimm5(instruction));
+          if (!f) break;
+          return make(instr_fsw, 0, rd_prime, rs2_prime, get_clsimm5(instruction));
+      }
+      break;
+
+    case 0b01:
+      switch (funct3) {
+        case 0b000: return make(instr_addi, rd, rd, 0, get_cimm6(instruction));
+        case 0b001:
+          if (!rv64) return make(instr_jal, ra, 0, 0, get_cjimm11(instruction));
+          if (rd == 0) break;
+          return make(instr_addiw, rd, rd, 0, get_cimm6(instruction));
+        case 0b010: return make(instr_addi, rd, 0, 0, get_cimm6(instruction));
+        case 0b011:
+          if (rd == sp) {
+            if (get_caddi16sp_imm(instruction) == 0) break;
+            return make(instr_addi, sp, sp, 0, get_caddi16sp_imm(instruction));
+          }
+          if (get_cimm6(instruction) == 0) break;
+          return make(instr_lui, rd, 0, 0, get_cimm6(instruction) & make_mask<Uxlen>(20));
+        case 0b100:
+          switch (extract_bits(instruction, {11, 10})) {
+            case 0b00:
+              if (bit12 && !rv64) break;
+              return make(instr_srli, rd_prime, rd_prime, 0, get_cshamt(instruction));
+            case 0b01:
+              if (bit12 && !rv64) break;
+              return make(instr_srai, rd_prime, rd_prime, 0, get_cshamt(instruction));
+            case 0b10:
+              return make(instr_andi, rd_prime, rd_prime, 0, get_cimm6(instruction));
+            case 0b11:
+              if (bit12) {
+                if (!rv64) break;
+                switch (extract_bits(instruction, {6, 5})) {
+                  case 0b00: return make(instr_subw, rd_prime, rd_prime, rs2_prime, 0);
+                  case 0b01: return make(instr_addw, rd_prime, rd_prime, rs2_prime, 0);
+                }
+                break;
+              }
+              switch (extract_bits(instruction, {6, 5})) {
+                case 0b00: return make(instr_sub, rd_prime, rd_prime, rs2_prime, 0);
+                case 0b01: return make(instr_xor, rd_prime, rd_prime, rs2_prime, 0);
+                case 0b10: return make(instr_or , rd_prime, rd_prime, rs2_prime, 0);
+                case 0b11: return make(instr_and, rd_prime, rd_prime, rs2_prime, 0);
+              }
+              break;
+          }
+          break;
+        case 0b101: return make(instr_jal, 0, 0, 0, get_cjimm11(instruction));
+        case 0b110: return make(instr_beq, 0, rd_prime, 0, get_cbimm8(instruction));
+        case 0b111: return make(instr_bne, 0, rd_prime, 0, get_cbimm8(instruction));
+      }
+      break;
+
+    case 0b10:
+      switch (funct3) {
+        case 0b000:
+          if (bit12 && !rv64) break;
+          return make(instr_slli, rd, rd, 0, get_cshamt(instruction));
+        case 0b001:
+          if (!d) break;
+          return make(instr_fld, rd, sp, 0, get_cldsp_imm(instruction));
+        case 0b010:
+          if (rd == 0) break;
+          return make(instr_lw, rd, sp, 0, get_clwsp_imm(instruction));
+        case 0b011:
+          if (rv64) {
+            if (rd == 0) break;
+            return make(instr_ld, rd, sp, 0, get_cldsp_imm(instruction));
+          }
+          if (!f) break;
+          return make(instr_flw, rd, sp, 0, get_clwsp_imm(instruction));
+        case 0b100:
+          if (!bit12) {
+            if (rs2 != 0) return make(instr_add , rd, 0, rs2, 0);
+            if (rd  != 0) return make(instr_jalr, 0, rd, 0, 0);
+          } else {
+            if (rs2 != 0) return make(instr_add , rd, rd, rs2, 0);
+            if (rd  != 0) return make(instr_jalr, ra, rd, 0, 0);
+            return make(instr_ebreak, 0, 0, 0, 0);
+          }
+          break;
+        case 0b101:
+          if (!d) break;
+          return make(instr_fsd, 0, sp, rs2, get_csdsp_imm(instruction));
+        case 0b110:
+          return make(instr_sw, 0, sp, rs2, get_cswsp_imm(instruction));
+        case 0b111:
+          if (rv64) return make(instr_sd, 0, sp, rs2, get_csdsp_imm(instruction));
+          if (!f) break;
+          return make(instr_fsw, 0, sp, rs2, get_cswsp_imm(instruction));
+      }
+      break;
+  }
+
+  throw Errors::Illegal_instruction{instruction, "Compressed"};
+}
+
+// A. funct5 selects the operation and funct3 the width. The aq and rl bits are ignored:
+// every atomic is sequentially consistent.
+template <unsigned int xlen>
+std::optional<Decoder_base::Concrete_instruction> Basic_decoder<xlen>::decode_atomic(
+    Uxlen instruction, std::optional<Isa_extension> &missing_extension) const {
+  using enum Concrete_instruction;
+  struct Encoding {
+    unsigned int funct5;
+    Concrete_instruction word;
+    Concrete_instruction doubleword;
+  };
+  static constexpr Encoding encodings[]{
+    {0b00010, instr_lr_w     , instr_lr_d     },
+    {0b00011, instr_sc_w     , instr_sc_d     },
+    {0b00001, instr_amoswap_w, instr_amoswap_d},
+    {0b00000, instr_amoadd_w , instr_amoadd_d },
+    {0b00100, instr_amoxor_w , instr_amoxor_d },
+    {0b01100, instr_amoand_w , instr_amoand_d },
+    {0b01000, instr_amoor_w  , instr_amoor_d  },
+    {0b10000, instr_amomin_w , instr_amomin_d },
+    {0b10100, instr_amomax_w , instr_amomax_d },
+    {0b11000, instr_amominu_w, instr_amominu_d},
+    {0b11100, instr_amomaxu_w, instr_amomaxu_d},
+  };
+
+  const unsigned int funct3{get_funct3(instruction)};
+  const bool is_doubleword{funct3 == 0b011};
+  if ((funct3 != 0b010) && !(is_doubleword && (xlen == 64))) return std::nullopt;
+
+  const unsigned int funct5{get_funct7(instruction) >> 2};
+  for (const Encoding &encoding : encodings) {
+    if (encoding.funct5 != funct5) continue;
+    // lr has no rs2.
+    if ((encoding.word == instr_lr_w) && get_rs2(instruction)) return std::nullopt;
+    if (!m_isa_ext_container[Isa_extension::isa_a]) {
+      missing_extension = Isa_extension::isa_a;
+      return std::nullopt;
+    }
+    return is_doubleword ? encoding.doubleword : encoding.word;
+  }
+  return std::nullopt;
+}
+
+template <unsigned int xlen>
+typename Basic_decoder<xlen>::Instruction_info Basic_decoder<xlen>::decode(
+    Uxlen instruction) const {
+  if (is_compressed(instruction)) {
+    if (!m_isa_ext_container[Isa_extension::isa_c]) {
+      throw Errors::Illegal_instruction{instruction, "From extension " + to_string(Isa_extension::isa_c)};
+    }
+    return decode_compressed(instruction & make_mask<Uxlen>(16));
+  }
+
   Instruction_info info{};
 
   info.instruction = decode_concrete_instruction(instruction);
@@ -246,3 +1114,6 @@ Decoder::Instruction_info Decoder::decode(Uxlen instruction) const {
 
   return info;
 }
+
+template class Basic_decoder<32>;
+template class Basic_decoder<64>;
@@ -0,0 +1,166 @@
+#include "elf.hpp"
+
+#include "exception.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+  // Offsets of the fields read, which differ in size and place between the classes.
+  struct Elf32_layout {
+    using Addr = std::uint32_t;
+    static constexpr unsigned int xlen{32};
+
+    static constexpr std::size_t e_entry{24}, e_phoff{28}, e_shoff{32};
+    static constexpr std::size_t e_phentsize{42}, e_phnum{44}, e_shentsize{46}, e_shnum{48};
+
+    static constexpr std::size_t p_type{0}, p_offset{4}, p_paddr{12}, p_filesz{16};
+    static constexpr std::size_t p_memsz{20};
+
+    static constexpr std::size_t sh_type{4}, sh_offset{16}, sh_size{20}, sh_link{24};
+    static constexpr std::size_t sh_entsize{36};
+
+    static constexpr std::size_t st_name{0}, st_value{4}, st_shndx{14};
+  };
+
+  struct Elf64_layout {
+    using Addr = std::uint64_t;
+    static constexpr unsigned int xlen{64};
+
+    static constexpr std::size_t e_entry{24}, e_phoff{32}, e_shoff{40};
+    static constexpr std::size_t e_phentsize{54}, e_phnum{56}, e_shentsize{58}, e_shnum{60};
+
+    static constexpr std::size_t p_type{0}, p_offset{8}, p_paddr{24}, p_filesz{32};
+    static constexpr std::size_t p_memsz{40};
+
+    static constexpr std::size_t sh_type{4}, sh_offset{24}, sh_size{32}, sh_link{40};
+    static constexpr std::size_t sh_entsize{56};
+
+    static constexpr std::size_t st_name{0}, st_value{8}, st_shndx{6};
+  };
+
+  constexpr std::size_t ei_class{4};
+  constexpr std::size_t ei_data {5};
+  constexpr std::size_t e_machine{18};
+  constexpr unsigned char elfclass32{1};
+  constexpr unsigned char elfclass64{2};
+  constexpr unsigned char elfdata2lsb{1};
+  constexpr std::uint16_t em_riscv{243};
+  constexpr std::uint32_t pt_load{1};
+  constexpr std::uint32_t sht_symtab{2};
+  constexpr std::uint16_t shn_undef{0};
+
+  [[nodiscard]] std::span<const std::byte> get_bytes(std::span<const std::byte> file,
+      std::uint64_t offset, std::uint64_t size) {
+    if ((offset > file.size()) || (size > file.size() - offset)) {
+      throw Errors::Error{"Elf. Truncated file"};
+    }
+    return file.subspan(static_cast<std::size_t>(offset), static_cast<std::size_t>(size));
+  }
+
+  template <typename T>
+  [[nodiscard]] T get(std::span<const std::byte> file, std::uint64_t offset) {
+    T value{};
+    std::memcpy(&value, get_bytes(file, offset, sizeof(T)).data(), sizeof(T));
+    return value;
+  }
+}
+
+Elf::Elf(std::span<const std::byte> file) {
+  constexpr unsigned char magic[]{0x7f, 'E', 'L', 'F'};
+  const std::span<const std::byte> ident{get_bytes(file, 0, 16)};
+  if (std::memcmp(ident.data(), magic, sizeof(magic)) != 0) {
+    throw Errors::Error{"Elf. Not an ELF file"};
+  }
+  if (static_cast<unsigned char>(ident[ei_data]) != elfdata2lsb) {
+    throw Errors::Error{"Elf. Not little-endian"};
+  }
+  if (get<std::uint16_t>(file, e_machine) != em_riscv) {
+    throw Errors::Error{"Elf. Not a RISC-V file"};
+  }
+  switch (static_cast<unsigned char>(ident[ei_class])) {
+    case elfclass32: parse<Elf32_layout>(file); break;
+    case elfclass64: parse<Elf64_layout>(file); break;
+    default: throw Errors::Error{"Elf. Unknown class"};
+  }
+}
+
+Elf Elf::from_file(const std::string &path) {
+  std::ifstream stream{path, std::ios::binary};
+  if (!stream) throw Errors::Error{"Elf. Can't open " + path};
+  const std::vector<char> file{std::istreambuf_iterator<char>{stream},
+      std::istreambuf_iterator<char>{}};
+  return Elf{std::as_bytes(std::span{file})};
+}
+
+std::optional<std::uint64_t> Elf::find_symbol(std::string_view name) const {
+  const auto symbol{m_symbols.find(std::string{name})};
+  if (symbol == m_symbols.end()) return {};
+  return symbol->second;
+}
+
+template <unsigned int xlen>
+void Elf::load(Basic_memory<xlen> &memory, std::uint64_t base) const {
+  for (const Segment &segment : m_segments) {
+    const auto addr{static_cast<std::size_t>(segment.addr - base)};
+    memory.write_block(addr, segment.content);
+    const std::vector<std::byte> zeros(
+        static_cast<std::size_t>(segment.mem_size - segment.content.size()));
+    memory.write_block(addr + segment.content.size(), zeros);
+  }
+}
+
+template <typename Header>
+void Elf::parse(std::span<const std::byte> file) {
+  using Addr = typename Header::Addr;
+  m_xlen  = Header::xlen;
+  m_entry = get<Addr>(file, Header::e_entry);
+
+  const std::uint64_t phoff{get<Addr>(file, Header::e_phoff)};
+  const std::uint16_t phentsize{get<std::uint16_t>(file, Header::e_phentsize)};
+  for (std::uint16_t i{0}; i < get<std::uint16_t>(file, Header::e_phnum); ++i) {
+    const std::uint64_t phdr{phoff + std::uint64_t{i} * phentsize};
+    if (get<std::uint32_t>(file, phdr + Header::p_type) != pt_load) continue;
+    const std::uint64_t filesz{get<Addr>(file, phdr + Header::p_filesz)};
+    const std::uint64_t memsz {get<Addr>(file, phdr + Header::p_memsz)};
+    if (filesz > memsz) throw Errors::Error{"Elf. Segment larger in the file than in memory"};
+    const std::span<const std::byte> content{
+        get_bytes(file, get<Addr>(file, phdr + Header::p_offset), filesz)};
+    m_segments.push_back({.addr = get<Addr>(file, phdr + Header::p_paddr),
+        .content = {content.begin(), content.end()}, .mem_size = memsz});
+  }
+
+  // Symbols of the symbol table, with the names in the string table it links to. Stripped
+  // files have none.
+  const std::uint64_t shoff{get<Addr>(file, Header::e_shoff)};
+  const std::uint16_t shentsize{get<std::uint16_t>(file, Header::e_shentsize)};
+  const std::uint16_t shnum{get<std::uint16_t>(file, Header::e_shnum)};
+  for (std::uint16_t i{0}; i < shnum; ++i) {
+    const std::uint64_t shdr{shoff + std::uint64_t{i} * shentsize};
+    if (get<std::uint32_t>(file, shdr + Header::sh_type) != sht_symtab) continue;
+    const std::uint32_t link{get<std::uint32_t>(file, shdr + Header::sh_link)};
+    if (link >= shnum) throw Errors::Error{"Elf. Symbol table without a string table"};
+    const std::uint64_t strtab{shoff + std::uint64_t{link} * shentsize};
+    const std::span<const std::byte> strings{get_bytes(file,
+        get<Addr>(file, strtab + Header::sh_offset), get<Addr>(file, strtab + Header::sh_size))};
+
+    const std::uint64_t offset {get<Addr>(file, shdr + Header::sh_offset)};
+    const std::uint64_t size   {get<Addr>(file, shdr + Header::sh_size)};
+    const std::uint64_t entsize{get<Addr>(file, shdr + Header::sh_entsize)};
+    if (entsize == 0) throw Errors::Error{"Elf. Symbol table without entries"};
+    for (std::uint64_t sym{offset}; sym + entsize <= offset + size; sym += entsize) {
+      if (get<std::uint16_t>(file, sym + Header::st_shndx) == shn_undef) continue;
+      const std::uint32_t name{get<std::uint32_t>(file, sym + Header::st_name)};
+      if (name >= strings.size()) throw Errors::Error{"Elf. Symbol name out of range"};
+      const auto *begin{reinterpret_cast<const char*>(strings.data()) + name};
+      const auto *end{std::find(begin, begin + (strings.size() - name), '\0')};
+      const std::string_view symbol{begin, end};
+      if (!symbol.empty()) m_symbols.emplace(symbol, get<Addr>(file, sym + Header::st_value));
+    }
+  }
+}
+
+template void Elf::load<32>(Basic_memory<32> &memory, std::uint64_t base) const;
+template void Elf::load<64>(Basic_memory<64> &memory, std::uint64_t base) const;
@@ -0,0 +1,136 @@
+#include "fleet.hpp"
+
+#include "core.hpp"
+#include "cow_ram.hpp"
+#include "csr.hpp"
+#include "exception.hpp"
+#include "instr_mem.hpp"
+#include "memory.hpp"
+#include "rf.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+  // The instruction memory of a job: a handle on the shared image, which Instr_mem copies.
+  struct Image_words {
+    std::shared_ptr<const Image> image{};
+
+    [[nodiscard]] Uxlen at(std::size_t word) const { return image->at(word); }
+  };
+
+  struct Job_queue {
+    std::mutex mutex{};
+    std::deque<std::size_t> jobs{};
+  };
+
+  // The next job of thread `self`: the newest of its own, else the oldest of another one.
+  [[nodiscard]] std::optional<std::size_t> take_job(std::vector<Job_queue> &queues,
+      std::size_t self) {
+    for (std::size_t i{0}; i < queues.size(); ++i) {
+      Job_queue &queue{queues[(self + i) % queues.size()]};
+      const std::scoped_lock lock{queue.mutex};
+      if (queue.jobs.empty()) continue;
+      std::size_t job{0};
+      if (i == 0) {
+        job = queue.jobs.back();
+        queue.jobs.pop_back();
+      } else {
+        job = queue.jobs.front();
+        queue.jobs.pop_front();
+      }
+      return job;
+    }
+    return std::nullopt;
+  }
+}
+
+template <unsigned int xlen>
+Basic_fleet<xlen>::Basic_fleet(std::shared_ptr<spdlog::logger> logger,
+    Isa_ext_container isa_ext_container, std::size_t threads)
+    : m_logger{std::move(logger)}, m_isa_ext_container{isa_ext_container},
+    m_threads{(threads != 0) ? threads : std::max(1u, std::thread::hardware_concurrency())} {}
+
+template <unsigned int xlen>
+Fleet_report Basic_fleet<xlen>::run(const std::vector<Fleet_job> &jobs) const {
+  Fleet_report report{};
+  report.results.resize(jobs.size());
+  const std::size_t threads{std::min(m_threads, jobs.size())};
+  const auto start{std::chrono::steady_clock::now()};
+  if (threads != 0) {
+    std::vector<Job_queue> queues(threads);
+    for (std::size_t job{0}; job < jobs.size(); ++job) {
+      queues[job % threads].jobs.push_back(job);
+    }
+    std::vector<std::jthread> workers{};
+    for (std::size_t self{0}; self < threads; ++self) {
+      workers.emplace_back([this, &jobs, &queues, &report, self]() {
+        while (const std::optional<std::size_t> job{take_job(queues, self)}) {
+          report.results[*job] = run_job(jobs[*job]);
+        }
+      });
+    }
+  }
+  const std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() - start};
+  report.seconds = elapsed.count();
+
+  using enum Fleet_result::Status;
+  for (const Fleet_result &result : report.results) {
+    report.instructions += result.instructions;
+    switch (result.status) {
+      case passed   : ++report.passed;    break;
+      case failed   : ++report.failed;    break;
+      case timed_out: ++report.timed_out; break;
+      case error    : ++report.errors;    break;
+      default: assert(0 && "Unknown fleet result status");
+    }
+  }
+  return report;
+}
+
+template <unsigned int xlen>
+Fleet_result Basic_fleet<xlen>::run_job(const Fleet_job &job) const {
+  using enum Fleet_result::Status;
+  Fleet_result result{};
+  try {
+    const Fleet_image &image{job.image};
+    if (!image.image) throw Errors::Error{"Fleet. Job without an image"};
+
+    Basic_cow_ram<xlen> ram{image.ram_size, image.image, image.base};
+    Instr_mem<Image_words> image_words{Image_words{image.image}};
+    Ranged_mem_wrap instr_mem{image_words, (image.image->size() + 3) & ~std::size_t{3},
+        image.base};
+    Basic_rf<xlen> rf{};
+    Basic_csr<xlen> csr{};
+    Basic_core<xlen> core{instr_mem, ram, csr, rf, m_logger, m_isa_ext_container};
+    core.set_pc(static_cast<Uxlen_t<xlen>>(job.entry));
+
+    while (!core.is_waiting() && (result.instructions < job.budget)) {
+      core.cycle();
+      ++result.instructions;
+    }
+    result.private_pages = ram.get_private_pages();
+    if (!core.is_waiting()) {
+      result.status = timed_out;
+      return result;
+    }
+    constexpr std::size_t a0{10};
+    result.exit = rf.read(a0);
+    result.status = (!job.expected_exit || (*job.expected_exit == result.exit)) ? passed : failed;
+  } catch (const std::exception &e) {
+    result.status = error;
+    result.message = e.what();
+  }
+  return result;
+}
+
+template class Basic_fleet<32>;
+template class Basic_fleet<64>;
@@ -0,0 +1,262 @@
+#include "fpu.hpp"
+
+#include <bit>
+#include <cfenv>
+#include <climits>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <cassert>
+
+namespace {
+  using enum Fpu::Op;
+  using Fpu::Reg;
+
+  // Exact IEEE equality is what the guest asks for, so it's spelled std::equal_to and
+  // std::not_equal_to, which -Wfloat-equal doesn't flag.
+
+  // Upper half of a NaN-boxed single.
+  constexpr Reg box_mask{0xffff'ffff'0000'0000};
+
+  template <typename Float> struct Float_traits;
+  template <> struct Float_traits<float> {
+    using Bits = std::uint32_t;
+    static constexpr Bits canonical_nan{0x7fc0'0000};
+  };
+  template <> struct Float_traits<double> {
+    using Bits = std::uint64_t;
+    static constexpr Bits canonical_nan{0x7ff8'0000'0000'0000};
+  };
+  template <typename Float> using Bits = typename Float_traits<Float>::Bits;
+
+  template <typename Float>
+  [[nodiscard("PURE FUN")]] Reg box_bits(Bits<Float> bits) {
+    if constexpr (std::is_same_v<Float, float>) return box_mask | bits;
+    else                                        return bits;
+  }
+
+  // Results are NaN-boxed and their NaNs canonical, whatever the host produced.
+  template <typename Float>
+  [[nodiscard("PURE FUN")]] Reg box(Float value) {
+    if (std::isnan(value)) return box_bits<Float>(Float_traits<Float>::canonical_nan);
+    return box_bits<Float>(std::bit_cast<Bits<Float>>(value));
+  }
+
+  template <typename Float>
+  [[nodiscard("PURE FUN")]] Float unbox(Reg reg) {
+    if constexpr (std::is_same_v<Float, float>) {
+      if ((reg & box_mask) != box_mask) {
+        return std::bit_cast<float>(Float_traits<float>::canonical_nan);
+      }
+      return std::bit_cast<float>(static_cast<std::uint32_t>(reg));
+    } else {
+      return std::bit_cast<double>(reg);
+    }
+  }
+
+  template <typename Float>
+  [[nodiscard("PURE FUN")]] bool is_signaling(Float value) {
+    constexpr Bits<Float> quiet_bit{Bits<Float>{1} << (std::numeric_limits<Float>::digits - 2)};
+    return std::isnan(value) && !(std::bit_cast<Bits<Float>>(value) & quiet_bit);
+  }
+
+  void raise_invalid() { std::feraiseexcept(FE_INVALID); }
+
+  template <typename Float>
+  [[nodiscard("PURE FUN")]] Reg inject_sign(Fpu::Op op, Float a, Float b) {
+    constexpr Bits<Float> sign{Bits<Float>{1} << (sizeof(Float) * CHAR_BIT - 1)};
+    const Bits<Float> a_bits{std::bit_cast<Bits<Float>>(a)};
+    const Bits<Float> b_bits{std::bit_cast<Bits<Float>>(b)};
+    Bits<Float> result_sign{0};
+    switch (op) {
+      case SGNJ : result_sign =  b_bits           & sign; break;
+      case SGNJN: result_sign = ~b_bits           & sign; break;
+      case SGNJX: result_sign = (a_bits ^ b_bits) & sign; break;
+      default: assert(0 && "Not a sign injection");
+    }
+    return box_bits<Float>((a_bits & ~sign) | result_sign);
+  }
+
+  // A NaN operand loses to a number, and -0.0 is less than +0.0.
+  template <typename Float>
+  [[nodiscard]] Reg min_max(Fpu::Op op, Float a, Float b) {
+    if (is_signaling(a) || is_signaling(b)) raise_invalid();
+    if (std::isnan(a)) return box(b);
+    if (std::isnan(b)) return box(a);
+    if (std::equal_to<>{}(a, b)) return box(((op == MIN) == std::signbit(a)) ? a : b);
+    return box(((op == MIN) == (a < b)) ? a : b);
+  }
+
+  template <typename Float>
+  [[nodiscard("PURE FUN")]] std::uint64_t classify(Float a) {
+    const bool negative{std::signbit(a)};
+    switch (std::fpclassify(a)) {
+      case FP_INFINITE : return negative ? 1u << 0 : 1u << 7;
+      case FP_NORMAL   : return negative ? 1u << 1 : 1u << 6;
+      case FP_SUBNORMAL: return negative ? 1u << 2 : 1u << 5;
+      case FP_ZERO     : return negative ? 1u << 3 : 1u << 4;
+      default          : return is_signaling(a) ? 1u << 8 : 1u << 9;
+    }
+  }
+
+  // Out of range values and NaNs saturate and only raise the invalid flag, unlike a host
+  // conversion.
+  template <typename Int, typename Float>
+  [[nodiscard]] std::uint64_t convert_to_int(Float a, Fpu::Rounding_mode rm) {
+    constexpr Int min{std::numeric_limits<Int>::min()};
+    constexpr Int max{std::numeric_limits<Int>::max()};
+    // Powers of two, exact in both formats.
+    const Float upper{std::ldexp(Float{1}, std::numeric_limits<Int>::digits)};
+    const Float lower{std::numeric_limits<Int>::is_signed ? -upper : Float{0}};
+    // nearbyint rounds in the host mode, already set to `rm`.
+    const Float rounded{(rm == Fpu::RMM) ? std::round(a) : std::nearbyint(a)};
+
+    Int result{0};
+    if (std::isnan(a) || (rounded >= upper)) {
+      raise_invalid();
+      result = max;
+    } else if (rounded < lower) {
+      raise_invalid();
+      result = min;
+    } else {
+      if (std::not_equal_to<>{}(rounded, a)) std::feraiseexcept(FE_INEXACT);
+      result = static_cast<Int>(rounded);
+    }
+    // Word results are sign-extended, even unsigned ones.
+    return static_cast<std::uint64_t>(static_cast<std::int64_t>(
+        static_cast<std::make_signed_t<Int>>(result)));
+  }
+
+  template <typename Float>
+  [[nodiscard]] Reg calculate(Fpu::Op op, Reg a_reg, Reg b_reg, Reg c_reg) {
+    const Float a{unbox<Float>(a_reg)};
+    const Float b{unbox<Float>(b_reg)};
+    const Float c{unbox<Float>(c_reg)};
+    switch (op) {
+      case ADD  : return box<Float>(a + b);
+      case SUB  : return box<Float>(a - b);
+      case MUL  : return box<Float>(a * b);
+      case DIV  : return box<Float>(a / b);
+      case SQRT : return box<Float>(std::sqrt(a));
+      case SGNJ :
+      case SGNJN:
+      case SGNJX: return inject_sign(op, a, b);
+      case MIN  :
+      case MAX  : return min_max(op, a, b);
+      case MADD : return box<Float>(std::fma( a, b,  c));
+      case MSUB : return box<Float>(std::fma( a, b, -c));
+      case NMSUB: return box<Float>(std::fma(-a, b,  c));
+      case NMADD: return box<Float>(std::fma(-a, b, -c));
+      case CVT_F:
+        if constexpr (std::is_same_v<Float, float>) {
+          return box(static_cast<float>(unbox<double>(a_reg)));
+        } else {
+          return box(static_cast<double>(unbox<float>(a_reg)));
+        }
+      default: assert(0 && "Not a floating-point result");
+    }
+  }
+
+  template <typename Float>
+  [[nodiscard]] std::uint64_t calculate_integer(Fpu::Op op, Reg a_reg, Reg b_reg,
+      Fpu::Rounding_mode rm) {
+    const Float a{unbox<Float>(a_reg)};
+    const Float b{unbox<Float>(b_reg)};
+    switch (op) {
+      // feq is a quiet comparison, flt and fle are signaling ones.
+      case EQ:
+        if (is_signaling(a) || is_signaling(b)) raise_invalid();
+        return std::equal_to<>{}(a, b);
+      case LT:
+        if (std::isnan(a) || std::isnan(b)) raise_invalid();
+        return a < b;
+      case LE:
+        if (std::isnan(a) || std::isnan(b)) raise_invalid();
+        return a <= b;
+      case CLASS : return classify(a);
+      case CVT_W : return convert_to_int<std::int32_t >(a, rm);
+      case CVT_WU: return convert_to_int<std::uint32_t>(a, rm);
+      case CVT_L : return convert_to_int<std::int64_t >(a, rm);
+      case CVT_LU: return convert_to_int<std::uint64_t>(a, rm);
+      // The raw bits, even of a single that isn't NaN-boxed.
+      case MV_X:
+        if constexpr (std::is_same_v<Float, float>) {
+          return static_cast<std::uint64_t>(static_cast<std::int64_t>(
+              static_cast<std::int32_t>(a_reg)));
+        } else {
+          return a_reg;
+        }
+      default: assert(0 && "Not an integer result");
+    }
+  }
+
+  template <typename Float>
+  [[nodiscard]] Reg convert_from_integer(Fpu::Op op, std::uint64_t a) {
+    switch (op) {
+      case CVT_FROM_W : return box(static_cast<Float>(static_cast<std::int32_t >(a)));
+      case CVT_FROM_WU: return box(static_cast<Float>(static_cast<std::uint32_t>(a)));
+      case CVT_FROM_L : return box(static_cast<Float>(static_cast<std::int64_t >(a)));
+      case CVT_FROM_LU: return box(static_cast<Float>(a));
+      case MV_F       : return box_bits<Float>(static_cast<Bits<Float>>(a));
+      default: assert(0 && "Not an integer source");
+    }
+  }
+
+  // The rounding mode of the host FPU, so that it's only switched on a change.
+  thread_local Fpu::Rounding_mode host_rounding_mode{Fpu::RNE};
+}
+
+bool Fpu::is_rounded(Op op, Format format) {
+  switch (op) {
+    case ADD: case SUB: case MUL: case DIV: case SQRT:
+    case MADD: case MSUB: case NMSUB: case NMADD:
+    case CVT_W: case CVT_WU: case CVT_L: case CVT_LU:
+    case CVT_FROM_L: case CVT_FROM_LU:
+      return true;
+    // Widening is exact.
+    case CVT_F: case CVT_FROM_W: case CVT_FROM_WU:
+      return format == Format::s;
+    default:
+      return false;
+  }
+}
+
+void Fpu::set_rounding_mode(Rounding_mode rm) {
+  assert(is_valid(rm) && "Reserved rounding mode");
+  if (rm == host_rounding_mode) return;
+  host_rounding_mode = rm;
+  switch (rm) {
+    case RTZ: std::fesetround(FE_TOWARDZERO); break;
+    case RDN: std::fesetround(FE_DOWNWARD  ); break;
+    case RUP: std::fesetround(FE_UPWARD    ); break;
+    default : std::fesetround(FE_TONEAREST ); break;
+  }
+}
+
+unsigned int Fpu::take_flags() {
+  const int host_flags{std::fetestexcept(FE_ALL_EXCEPT)};
+  if (!host_flags) return 0;
+  std::feclearexcept(FE_ALL_EXCEPT);
+  unsigned int flags{0};
+  if (host_flags & FE_INEXACT  ) flags |= NX;
+  if (host_flags & FE_UNDERFLOW) flags |= UF;
+  if (host_flags & FE_OVERFLOW ) flags |= OF;
+  if (host_flags & FE_DIVBYZERO) flags |= DZ;
+  if (host_flags & FE_INVALID  ) flags |= NV;
+  return flags;
+}
+
+Fpu::Reg Fpu::calc(Op op, Format format, Reg a, Reg b, Reg c) {
+  return (format == Format::s) ? calculate<float>(op, a, b, c) : calculate<double>(op, a, b, c);
+}
+
+std::uint64_t Fpu::to_integer(Op op, Format format, Reg a, Reg b, Rounding_mode rm) {
+  return (format == Format::s) ? calculate_integer<float >(op, a, b, rm)
+                               : calculate_integer<double>(op, a, b, rm);
+}
+
+Fpu::Reg Fpu::from_integer(Op op, Format format, std::uint64_t a) {
+  return (format == Format::s) ? convert_from_integer<float>(op, a)
+                               : convert_from_integer<double>(op, a);
+}
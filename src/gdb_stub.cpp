@@ -0,0 +1,541 @@
+#include "gdb_stub.hpp"
+
+#include "csr.hpp"
+#include "exception.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <vector>
+
+namespace {
+  constexpr char interrupt{'\x03'};
+
+  [[nodiscard]] Errors::Error make_malformed_error(std::string_view packet) {
+    return Errors::Error{"Gdb_stub. Malformed packet " + std::string{packet}};
+  }
+
+  [[nodiscard]] std::uint64_t parse_hex(std::string_view hex) {
+    std::uint64_t value{0};
+    const auto [end, error]{std::from_chars(hex.data(), hex.data() + hex.size(), value, 16)};
+    if (hex.empty() || (error != std::errc{}) || (end != hex.data() + hex.size())) {
+      throw make_malformed_error(hex);
+    }
+    return value;
+  }
+
+  // Splits at the first `separator`. Throws unless there is one.
+  [[nodiscard]] std::pair<std::string_view, std::string_view> split(std::string_view text,
+      char separator) {
+    const std::size_t pos{text.find(separator)};
+    if (pos == std::string_view::npos) throw make_malformed_error(text);
+    return {text.substr(0, pos), text.substr(pos + 1)};
+  }
+
+  [[nodiscard]] std::string to_hex(std::span<const std::byte> bytes) {
+    constexpr char digits[]{"0123456789abcdef"};
+    std::string hex{};
+    hex.reserve(2 * bytes.size());
+    for (const std::byte byte : bytes) {
+      hex += digits[std::to_integer<unsigned int>(byte) >> 4];
+      hex += digits[std::to_integer<unsigned int>(byte) & 0xf];
+    }
+    return hex;
+  }
+
+  // Numbers other than register values go most significant digit first.
+  [[nodiscard]] std::string to_number_hex(std::uint64_t value) {
+    constexpr char digits[]{"0123456789abcdef"};
+    std::string hex{};
+    do {
+      hex.insert(hex.begin(), digits[value & 0xf]);
+      value >>= 4;
+    } while (value);
+    return hex;
+  }
+
+  [[nodiscard]] std::vector<std::byte> from_hex(std::string_view hex) {
+    if (hex.size() % 2) throw make_malformed_error(hex);
+    std::vector<std::byte> bytes(hex.size() / 2);
+    for (std::size_t i{0}; i < bytes.size(); ++i) {
+      bytes[i] = static_cast<std::byte>(parse_hex(hex.substr(2 * i, 2)));
+    }
+    return bytes;
+  }
+
+  // Registers go over the wire in target byte order, i.e. little-endian.
+  [[nodiscard]] std::string to_register_hex(std::uint64_t value, std::size_t size) {
+    std::array<std::byte, sizeof(value)> bytes{};
+    for (std::size_t i{0}; i < size; ++i) {
+      bytes[i] = static_cast<std::byte>(value >> (CHAR_BIT * i));
+    }
+    return to_hex(std::span{bytes}.first(size));
+  }
+
+  [[nodiscard]] std::uint64_t from_register_hex(std::string_view hex, std::size_t size) {
+    const std::vector<std::byte> bytes{from_hex(hex)};
+    if (bytes.size() != size) throw make_malformed_error(hex);
+    std::uint64_t value{0};
+    for (std::size_t i{0}; i < size; ++i) {
+      value |= std::to_integer<std::uint64_t>(bytes[i]) << (CHAR_BIT * i);
+    }
+    return value;
+  }
+
+  [[nodiscard]] unsigned int get_checksum(std::string_view data) {
+    unsigned int sum{0};
+    for (const char c : data) sum += static_cast<unsigned char>(c);
+    return sum & 0xff;
+  }
+
+  void send_all(int fd, std::string_view data) {
+    while (!data.empty()) {
+      const ssize_t sent{::send(fd, data.data(), data.size(), MSG_NOSIGNAL)};
+      if (sent < 0) {
+        if (errno == EINTR) continue;
+        return;
+      }
+      data.remove_prefix(static_cast<std::size_t>(sent));
+    }
+  }
+
+  [[nodiscard]] int accept_first(int listener, const sockaddr *addr, socklen_t addr_size) {
+    if ((::bind(listener, addr, addr_size) != 0) || (::listen(listener, 1) != 0)) {
+      const int error{errno};
+      ::close(listener);
+      throw Errors::Error{std::string{"Gdb_stub. Can't listen: "} + std::strerror(error)};
+    }
+    const int fd{::accept(listener, nullptr, nullptr)};
+    const int error{errno};
+    ::close(listener);
+    if (fd < 0) throw Errors::Error{std::string{"Gdb_stub. Can't accept: "} + std::strerror(error)};
+    return fd;
+  }
+
+  struct Csr_name {
+    std::size_t reg;
+    const char *name;
+  };
+  constexpr Csr_name csr_names[]{
+    {Csr_base::SSTATUS , "sstatus" },
+    {Csr_base::SIE     , "sie"     },
+    {Csr_base::STVEC   , "stvec"   },
+    {Csr_base::SSCRATCH, "sscratch"},
+    {Csr_base::SEPC    , "sepc"    },
+    {Csr_base::SCAUSE  , "scause"  },
+    {Csr_base::STVAL   , "stval"   },
+    {Csr_base::SIP     , "sip"     },
+    {Csr_base::SATP    , "satp"    },
+    {Csr_base::MSTATUS , "mstatus" },
+    {Csr_base::MEDELEG , "medeleg" },
+    {Csr_base::MIDELEG , "mideleg" },
+    {Csr_base::MIE     , "mie"     },
+    {Csr_base::MTVEC   , "mtvec"   },
+    {Csr_base::MSCRATCH, "mscratch"},
+    {Csr_base::MEPC    , "mepc"    },
+    {Csr_base::MCAUSE  , "mcause"  },
+    {Csr_base::MTVAL   , "mtval"   },
+    {Csr_base::MIP     , "mip"     },
+    {Csr_base::MHARTID , "mhartid" },
+  };
+}
+
+template <unsigned int xlen>
+Basic_gdb_stub<xlen>::Basic_gdb_stub(int fd, Basic_core<xlen> &core, Basic_memory<xlen> &rf,
+    Basic_memory<xlen> &csr, Basic_memory<xlen> &memory, Scheduler &scheduler,
+    Basic_watchpoints<xlen> *watchpoints, Basic_history<xlen> *history)
+    : m_fd{fd}, m_core{core}, m_rf{rf}, m_csr{csr}, m_memory{memory}, m_scheduler{scheduler},
+      m_watchpoints{watchpoints}, m_history{history} {
+  if (m_watchpoints) {
+    m_watchpoints->set_callback([this](const typename Basic_watchpoints<xlen>::Hit &hit) {
+      m_watch_hit = hit;
+      m_core.stop();
+    });
+  }
+}
+
+template <unsigned int xlen>
+Basic_gdb_stub<xlen>::~Basic_gdb_stub() {
+  remove_points();
+  if (m_watchpoints) m_watchpoints->set_callback({});
+  ::close(m_fd);
+}
+
+template <unsigned int xlen>
+int Basic_gdb_stub<xlen>::accept_tcp(std::uint16_t port) {
+  const int listener{::socket(AF_INET, SOCK_STREAM, 0)};
+  if (listener < 0) throw Errors::Error{"Gdb_stub. Can't create a socket"};
+  const int reuse{1};
+  ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  const int fd{accept_first(listener, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))};
+  // Packets are small and each waits for its reply.
+  const int no_delay{1};
+  ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+  return fd;
+}
+
+template <unsigned int xlen>
+int Basic_gdb_stub<xlen>::accept_unix(const std::string &path) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) throw Errors::Error{"Gdb_stub. Path too long"};
+  std::copy(path.begin(), path.end(), addr.sun_path);
+  const int listener{::socket(AF_UNIX, SOCK_STREAM, 0)};
+  if (listener < 0) throw Errors::Error{"Gdb_stub. Can't create a socket"};
+  ::unlink(path.c_str());
+  const int fd{accept_first(listener, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))};
+  ::unlink(path.c_str());
+  return fd;
+}
+
+template <unsigned int xlen>
+void Basic_gdb_stub<xlen>::serve() {
+  while (const std::optional<std::string> packet{receive_packet()}) {
+    if (!handle(*packet)) break;
+  }
+  remove_points();
+}
+
+// Acks of the debugger and interrupts while the core is stopped are dropped.
+template <unsigned int xlen>
+std::optional<std::string> Basic_gdb_stub<xlen>::receive_packet() {
+  for (;;) {
+    const std::size_t start{m_input.find('$')};
+    if (start == std::string::npos) {
+      m_input.clear();
+    } else {
+      m_input.erase(0, start);
+      const std::size_t end{m_input.find('#')};
+      if ((end != std::string::npos) && (m_input.size() >= end + 3)) {
+        std::string packet{m_input.substr(1, end - 1)};
+        const std::string checksum{m_input.substr(end + 1, 2)};
+        m_input.erase(0, end + 3);
+        const bool valid{checksum == to_register_hex(get_checksum(packet), 1)};
+        if (!m_no_ack) send_all(m_fd, valid ? "+" : "-");
+        if (valid) return packet;
+        continue;
+      }
+    }
+    if (!receive(true)) return {};
+  }
+}
+
+template <unsigned int xlen>
+void Basic_gdb_stub<xlen>::send_packet(std::string_view data) {
+  const std::string checksum{to_register_hex(get_checksum(data), 1)};
+  const std::string packet{"$" + std::string{data} + "#" + checksum};
+  for (;;) {
+    send_all(m_fd, packet);
+    if (m_no_ack) return;
+    while (m_input.empty()) {
+      if (!receive(true)) return;
+    }
+    if (m_input.front() != '-') {
+      if (m_input.front() == '+') m_input.erase(0, 1);
+      return;
+    }
+    m_input.erase(0, 1);
+  }
+}
+
+template <unsigned int xlen>
+bool Basic_gdb_stub<xlen>::receive(bool block) {
+  pollfd fd{.fd = m_fd, .events = POLLIN, .revents = 0};
+  const int ready{::poll(&fd, 1, block ? -1 : 0)};
+  if (ready < 0) return errno == EINTR;
+  if (ready == 0) return true;
+  char buffer[4096];
+  const ssize_t size{::recv(m_fd, buffer, sizeof(buffer), 0)};
+  if (size < 0) return (errno == EINTR) || (errno == EAGAIN);
+  if (size == 0) return false;
+  m_input.append(buffer, static_cast<std::size_t>(size));
+  return true;
+}
+
+// A closed connection stops the core too.
+template <unsigned int xlen>
+bool Basic_gdb_stub<xlen>::is_interrupted() {
+  if (!receive(false)) return true;
+  const std::size_t pos{m_input.find(interrupt)};
+  if (pos == std::string::npos) return false;
+  m_input.erase(0, pos + 1);
+  return true;
+}
+
+template <unsigned int xlen>
+bool Basic_gdb_stub<xlen>::handle(std::string_view packet) {
+  std::string reply{};
+  try {
+    const char command{packet.empty() ? '\0' : packet.front()};
+    const std::string_view args{packet.empty() ? packet : packet.substr(1)};
+    switch (command) {
+      case '?': reply = m_stop_reply; break;
+      case 'g':
+        for (std::size_t reg{0}; reg < fp_first; ++reg) reply += *read_register(reg);
+        break;
+      case 'G': {
+        constexpr std::size_t size{2 * xlen / CHAR_BIT};
+        if (args.size() < fp_first * size) throw make_malformed_error(packet);
+        for (std::size_t reg{0}; reg < fp_first; ++reg) {
+          write_register(reg, args.substr(reg * size, size));
+        }
+        if (m_history) m_history->forget_future();
+        reply = "OK";
+        break;
+      }
+      case 'p': {
+        const std::optional<std::string> value{read_register(parse_hex(args))};
+        reply = value ? *value : "E01";
+        break;
+      }
+      case 'P': {
+        const auto [reg, value]{split(args, '=')};
+        const bool written{write_register(parse_hex(reg), value)};
+        if (written && m_history) m_history->forget_future();
+        reply = written ? "OK" : "E01";
+        break;
+      }
+      case 'm': reply = read_memory(args); break;
+      case 'M':
+        reply = write_memory(args);
+        if (m_history) m_history->forget_future();
+        break;
+      case 'c': reply = resume(args, false); break;
+      case 's': reply = resume(args, true ); break;
+      case 'b':
+        if      (m_history && (args == "s")) reply = resume_back(true );
+        else if (m_history && (args == "c")) reply = resume_back(false);
+        break;
+      case 'Z':
+      case 'z': reply = handle_point(packet); break;
+      case 'q': reply = handle_query(packet); break;
+      case 'Q':
+        if (packet == "QStartNoAckMode") {
+          send_packet("OK");
+          m_no_ack = true;
+          return true;
+        }
+        break;
+      case 'H':
+      case 'T': reply = "OK"; break;
+      case 'D':
+        send_packet("OK");
+        m_core.resume();
+        return false;
+      case 'k': return false;
+      default: break;
+    }
+  } catch (const Errors::Error&) {
+    reply = "E01";
+  }
+  send_packet(reply);
+  return true;
+}
+
+template <unsigned int xlen>
+std::string Basic_gdb_stub<xlen>::handle_query(std::string_view packet) const {
+  if (packet.starts_with("qSupported")) {
+    return "PacketSize=" + to_number_hex(packet_size) + ";qXfer:features:read+;QStartNoAckMode+" +
+        (m_history ? ";ReverseStep+;ReverseContinue+" : "");
+  }
+  if (packet == "qAttached"   ) return "1";
+  if (packet == "qC"          ) return "QC1";
+  if (packet == "qfThreadInfo") return "m1";
+  if (packet == "qsThreadInfo") return "l";
+  constexpr std::string_view features{"qXfer:features:read:target.xml:"};
+  if (packet.starts_with(features)) {
+    const auto [offset_hex, length_hex]{split(packet.substr(features.size()), ',')};
+    const std::string xml{get_target_xml()};
+    const std::size_t offset{std::min<std::size_t>(parse_hex(offset_hex), xml.size())};
+    const std::size_t length{std::min<std::size_t>(parse_hex(length_hex), packet_size - 1)};
+    const std::string chunk{xml.substr(offset, length)};
+    return ((offset + chunk.size() < xml.size()) ? "m" : "l") + chunk;
+  }
+  return "";
+}
+
+// Z type,addr,kind: breakpoints take the kind as the instruction length and watchpoints
+// as the size of the range.
+template <unsigned int xlen>
+std::string Basic_gdb_stub<xlen>::handle_point(std::string_view packet) {
+  using Kind = typename Basic_watchpoints<xlen>::Kind;
+  const bool insert{packet.front() == 'Z'};
+  const auto [type, rest]{split(packet.substr(1), ',')};
+  const auto [addr_hex, kind_hex]{split(rest, ',')};
+  const auto addr{static_cast<Data>(parse_hex(addr_hex))};
+  if ((type == "0") || (type == "1")) {
+    if (insert) {
+      m_core.set_breakpoint(addr);
+      m_breakpoints.insert(addr);
+    } else {
+      m_core.clear_breakpoint(addr);
+      m_breakpoints.erase(addr);
+    }
+    return "OK";
+  }
+  if (!m_watchpoints || (type.size() != 1) || (type[0] < '2') || (type[0] > '4')) return "";
+  const Kind kind{(type == "2") ? Kind::write : (type == "3") ? Kind::read : Kind::access};
+  const auto size{static_cast<std::size_t>(parse_hex(kind_hex))};
+  if (insert) m_watchpoints->insert(addr, size, kind);
+  else        static_cast<void>(m_watchpoints->erase(addr, size, kind));
+  return "OK";
+}
+
+// The instruction at pc is executed first, so that the core leaves a breakpoint it stopped
+// at.
+template <unsigned int xlen>
+std::string Basic_gdb_stub<xlen>::resume(std::string_view addr, bool single_step) {
+  if (!addr.empty()) m_core.set_pc(static_cast<Data>(parse_hex(addr)));
+  m_watch_hit.reset();
+  m_core.step();
+  m_scheduler.tick();
+  m_scheduler.advance_to(m_scheduler.get_now());
+  if (!single_step) {
+    while (!m_core.is_halted() && !m_core.is_stopped()) {
+      if (is_interrupted()) {
+        m_stop_reply = "T02";
+        return m_stop_reply;
+      }
+      m_core.run(m_scheduler, m_scheduler.get_now() + poll_interval);
+    }
+  }
+  m_stop_reply = get_stop_reply();
+  return m_stop_reply;
+}
+
+// At the beginning of the history, gdb is told that it can't go further back.
+template <unsigned int xlen>
+std::string Basic_gdb_stub<xlen>::resume_back(bool single_step) {
+  m_watch_hit.reset();
+  const bool stopped{single_step ? m_history->step_back() : m_history->continue_back()};
+  m_stop_reply = stopped ? get_stop_reply() : "T05replaylog:begin;";
+  return m_stop_reply;
+}
+
+template <unsigned int xlen>
+std::string Basic_gdb_stub<xlen>::get_stop_reply() const {
+  using Kind = typename Basic_watchpoints<xlen>::Kind;
+  if (const std::optional<Data> exit_code{m_core.get_exit_code()}) {
+    return "W" + to_register_hex(*exit_code & 0xff, 1);
+  }
+  if (!m_watch_hit) return "T05";
+  const char *const kind{(m_watch_hit->kind == Kind::write) ? "watch" :
+      (m_watch_hit->kind == Kind::read) ? "rwatch" : "awatch"};
+  return std::string{"T05"} + kind + ":" + to_number_hex(m_watch_hit->addr) + ";";
+}
+
+template <unsigned int xlen>
+std::optional<std::string> Basic_gdb_stub<xlen>::read_register(std::size_t reg) {
+  constexpr std::size_t size{xlen / CHAR_BIT};
+  if (reg < 32) return to_register_hex(m_rf.read(reg), size);
+  if (reg == 32) return to_register_hex(m_core.get_pc(), size);
+  if (reg < csr_first) return to_register_hex(m_core.get_fp_rf().read(reg - fp_first), 8);
+  try {
+    return to_register_hex(m_csr.read(reg - csr_first), get_csr_size(reg - csr_first));
+  } catch (const Errors::Error&) {
+    return {};
+  }
+}
+
+template <unsigned int xlen>
+bool Basic_gdb_stub<xlen>::write_register(std::size_t reg, std::string_view hex) {
+  constexpr std::size_t size{xlen / CHAR_BIT};
+  if (reg < 32) {
+    m_rf.write(reg, static_cast<Data>(from_register_hex(hex, size)));
+  } else if (reg == 32) {
+    m_core.set_pc(static_cast<Data>(from_register_hex(hex, size)));
+  } else if (reg < csr_first) {
+    m_core.get_fp_rf().write(reg - fp_first, from_register_hex(hex, 8));
+  } else {
+    try {
+      m_csr.write(reg - csr_first,
+          static_cast<Data>(from_register_hex(hex, get_csr_size(reg - csr_first))));
+    } catch (const Errors::Error&) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <unsigned int xlen>
+std::string Basic_gdb_stub<xlen>::read_memory(std::string_view args) {
+  const auto [addr, length]{split(args, ',')};
+  std::vector<std::byte> data(std::min<std::size_t>(parse_hex(length), packet_size / 2));
+  m_memory.read_block(parse_hex(addr), data);
+  return to_hex(data);
+}
+
+template <unsigned int xlen>
+std::string Basic_gdb_stub<xlen>::write_memory(std::string_view args) {
+  const auto [addr, rest]{split(args, ',')};
+  const auto [length, hex]{split(rest, ':')};
+  const std::vector<std::byte> data{from_hex(hex)};
+  if (data.size() != parse_hex(length)) throw make_malformed_error(args);
+  m_memory.write_block(parse_hex(addr), data);
+  return "OK";
+}
+
+template <unsigned int xlen>
+std::string Basic_gdb_stub<xlen>::get_target_xml() {
+  const std::string bits{std::to_string(xlen)};
+  std::string xml{"<?xml version=\"1.0\"?><!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+      "<target version=\"1.0\"><architecture>riscv:rv" + bits + "</architecture>"};
+  const auto add_reg = [&xml](const std::string &name, const std::string &size,
+      const char *type, std::size_t regnum) {
+    xml += "<reg name=\"" + name + "\" bitsize=\"" + size + "\" type=\"" + type +
+        "\" regnum=\"" + std::to_string(regnum) + "\"/>";
+  };
+  xml += "<feature name=\"org.gnu.gdb.riscv.cpu\">";
+  for (std::size_t reg{0}; reg < 32; ++reg) add_reg("x" + std::to_string(reg), bits, "int", reg);
+  add_reg("pc", bits, "code_ptr", 32);
+  xml += "</feature><feature name=\"org.gnu.gdb.riscv.fpu\">";
+  for (std::size_t reg{0}; reg < 32; ++reg) {
+    add_reg("f" + std::to_string(reg), "64", "ieee_double", fp_first + reg);
+  }
+  const auto add_fp_csr = [&add_reg](const std::string &name, std::size_t csr) {
+    add_reg(name, std::to_string(get_csr_size(csr) * CHAR_BIT), "int", csr_first + csr);
+  };
+  add_fp_csr("fflags", Csr_base::FFLAGS);
+  add_fp_csr("frm"   , Csr_base::FRM   );
+  add_fp_csr("fcsr"  , Csr_base::FCSR  );
+  xml += "</feature><feature name=\"org.gnu.gdb.riscv.csr\">";
+  for (const Csr_name &csr : csr_names) add_reg(csr.name, bits, "int", csr_first + csr.reg);
+  xml += "</feature></target>";
+  return xml;
+}
+
+// gdb's own RISC-V description has the F csrs 32 bits wide whatever XLEN is.
+template <unsigned int xlen>
+std::size_t Basic_gdb_stub<xlen>::get_csr_size(std::size_t csr) {
+  switch (csr) {
+    case Csr_base::FFLAGS:
+    case Csr_base::FRM   :
+    case Csr_base::FCSR  : return 4;
+    default              : return xlen / CHAR_BIT;
+  }
+}
+
+template <unsigned int xlen>
+void Basic_gdb_stub<xlen>::remove_points() {
+  for (const Data addr : m_breakpoints) m_core.clear_breakpoint(addr);
+  m_breakpoints.clear();
+  if (m_watchpoints) m_watchpoints->clear();
+}
+
+template class Basic_gdb_stub<32>;
+template class Basic_gdb_stub<64>;
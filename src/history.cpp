@@ -0,0 +1,170 @@
+#include "history.hpp"
+
+#include "fpu.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+template <unsigned int xlen>
+Basic_history<xlen>::Basic_history(Basic_core<xlen> &core, Basic_rf<xlen> &rf,
+    Basic_csr<xlen> &csr, Basic_ram<xlen> &ram, Scheduler &scheduler, const Config &config)
+    : m_core{core}, m_rf{rf}, m_csr{csr}, m_ram{ram}, m_scheduler{scheduler},
+      m_max_bytes{config.max_bytes}, m_interval{std::max<Time>(config.interval, 1)} {
+  take_snapshot();
+}
+
+template <unsigned int xlen>
+Basic_history<xlen>::~Basic_history() {
+  if (m_event) m_scheduler.cancel(*m_event);
+}
+
+// Forward from now if no snapshot is closer.
+template <unsigned int xlen>
+void Basic_history<xlen>::rewind_to(Time time) {
+  const Time now{m_scheduler.get_now()};
+  const Time target{std::max(time, get_begin())};
+  if ((target < now) || (find(target).time > now)) static_cast<void>(restore(target));
+  static_cast<void>(run_to(target));
+}
+
+template <unsigned int xlen>
+bool Basic_history<xlen>::step_back() {
+  const Time now{m_scheduler.get_now()};
+  if (now <= get_begin()) return false;
+  rewind_to(now - 1);
+  return true;
+}
+
+// Replays the spans between snapshots backwards, from the one now is in, until one of them
+// has a stop. The core is then taken to the last one.
+template <unsigned int xlen>
+bool Basic_history<xlen>::continue_back() {
+  for (Time end{m_scheduler.get_now()}; end > get_begin();) {
+    const Time begin{restore(end - 1)};
+    if (const std::optional<Time> stop{run_to(end)}) {
+      static_cast<void>(restore(*stop));
+      static_cast<void>(run_to(*stop));
+      return true;
+    }
+    end = begin;
+  }
+  rewind_to(get_begin());
+  return false;
+}
+
+template <unsigned int xlen>
+void Basic_history<xlen>::forget_future() {
+  const Time now{m_scheduler.get_now()};
+  while (!m_snapshots.empty() && (m_snapshots.back().time >= now)) {
+    release(m_snapshots.back());
+    m_snapshots.pop_back();
+  }
+  take_snapshot();
+}
+
+template <unsigned int xlen>
+void Basic_history<xlen>::take_snapshot() {
+  const Time now{m_scheduler.get_now()};
+  if (m_snapshots.empty() || (m_snapshots.back().time < now)) {
+    // Folds the flags accrued in the host FPU into fflags.
+    static_cast<void>(m_csr.read(Csr_base::FFLAGS));
+    Snapshot snapshot{.time = now, .core = m_core.get_state(), .rf = m_rf.get_content(),
+        .csr = m_csr.get_state()};
+
+    const std::span<const std::byte> content{m_ram.get_content()};
+    const Snapshot *const previous{m_snapshots.empty() ? nullptr : &m_snapshots.back()};
+    for (std::size_t offset{0}; offset < content.size(); offset += page_size) {
+      const std::size_t size{std::min(page_size, content.size() - offset)};
+      const std::byte *const data{content.data() + offset};
+      const std::shared_ptr<const Page> &shared{previous ?
+          previous->pages[offset / page_size] : nullptr};
+      if (shared && !std::memcmp(shared->data(), data, size)) {
+        snapshot.pages.push_back(shared);
+        continue;
+      }
+      auto page = std::make_shared<Page>();
+      std::memcpy(page->data(), data, size);
+      snapshot.pages.push_back(std::move(page));
+      m_bytes += page_size;
+    }
+    m_snapshots.push_back(std::move(snapshot));
+    while ((m_bytes > m_max_bytes) && (m_snapshots.size() > 2)) thin_out();
+  }
+  schedule_snapshot();
+}
+
+template <unsigned int xlen>
+void Basic_history<xlen>::schedule_snapshot() {
+  if (m_event) m_scheduler.cancel(*m_event);
+  m_event = m_scheduler.schedule_at(m_snapshots.back().time + m_interval, [this]() {
+    m_event.reset();
+    take_snapshot();
+  });
+}
+
+template <unsigned int xlen>
+void Basic_history<xlen>::thin_out() {
+  std::vector<Snapshot> kept{};
+  for (std::size_t i{0}; i < m_snapshots.size(); ++i) {
+    if ((i % 2 == 0) || (i == m_snapshots.size() - 1)) {
+      kept.push_back(std::move(m_snapshots[i]));
+    } else {
+      release(m_snapshots[i]);
+    }
+  }
+  m_snapshots = std::move(kept);
+  m_interval *= 2;
+}
+
+// A page is released with the last snapshot that holds it.
+template <unsigned int xlen>
+void Basic_history<xlen>::release(const Snapshot &snapshot) {
+  for (const std::shared_ptr<const Page> &page : snapshot.pages) {
+    if (page.use_count() == 1) m_bytes -= page_size;
+  }
+}
+
+template <unsigned int xlen>
+auto Basic_history<xlen>::find(Time time) const -> const Snapshot& {
+  const auto next{std::upper_bound(m_snapshots.begin(), m_snapshots.end(), time,
+      [](Time lhs, const Snapshot &rhs) { return lhs < rhs.time; })};
+  return (next == m_snapshots.begin()) ? *next : *std::prev(next);
+}
+
+template <unsigned int xlen>
+auto Basic_history<xlen>::restore(Time time) -> Time {
+  const Snapshot &snapshot{find(time)};
+
+  const std::size_t ram_size{m_ram.get_content().size()};
+  std::byte *const ram{m_ram.get_host_ptr(0, ram_size)};
+  for (std::size_t offset{0}; offset < ram_size; offset += page_size) {
+    const std::size_t size{std::min(page_size, ram_size - offset)};
+    std::memcpy(ram + offset, snapshot.pages[offset / page_size]->data(), size);
+  }
+  for (std::size_t reg{1}; reg < snapshot.rf.size(); ++reg) m_rf.write(reg, snapshot.rf[reg]);
+  m_csr.set_state(snapshot.csr);
+  static_cast<void>(Fpu::take_flags());
+  m_core.set_state(snapshot.core);
+  m_scheduler.jump_to(snapshot.time);
+  schedule_snapshot();
+  return snapshot.time;
+}
+
+template <unsigned int xlen>
+auto Basic_history<xlen>::run_to(Time time) -> std::optional<Time> {
+  std::optional<Time> stop{};
+  while ((m_scheduler.get_now() < time) && !m_core.is_halted()) {
+    if (m_core.is_stopped()) {
+      stop = m_scheduler.get_now();
+      m_core.step();
+      m_scheduler.tick();
+      m_scheduler.advance_to(m_scheduler.get_now());
+      continue;
+    }
+    m_core.run(m_scheduler, time);
+  }
+  return stop;
+}
+
+template class Basic_history<32>;
+template class Basic_history<64>;
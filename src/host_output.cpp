@@ -0,0 +1,135 @@
+#include "host_output.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+  // The output of the guest is best effort: what the host doesn't take is dropped. Returns
+  // the calls of write(2).
+  std::uint64_t write_all(int fd, std::span<const std::byte> data) {
+    std::uint64_t writes{0};
+    std::span<const std::byte> pending{data};
+    while (!pending.empty()) {
+      ++writes;
+      const ssize_t written{::write(fd, pending.data(), pending.size())};
+      if (written < 0) {
+        if (errno == EINTR) continue;
+        break;
+      }
+      pending = pending.subspan(static_cast<std::size_t>(written));
+    }
+    return writes;
+  }
+}
+
+Host_output::Host_output(int fd, std::size_t capacity) : m_fd{fd} {
+  m_buffer.reserve(capacity);
+}
+
+Host_output::~Host_output() {
+  flush();
+}
+
+void Host_output::write(std::span<const std::byte> data) {
+  if (m_buffer.size() + data.size() > m_buffer.capacity()) flush();
+  // Larger than the buffer, so it's written as is.
+  if (data.size() > m_buffer.capacity()) {
+    m_host_writes += write_all(m_fd, data);
+    return;
+  }
+  m_buffer.insert(m_buffer.end(), data.begin(), data.end());
+}
+
+void Host_output::flush() {
+  m_host_writes += write_all(m_fd, m_buffer);
+  m_buffer.clear();
+}
+
+Async_host_output::Async_host_output(int fd, std::size_t capacity,
+    std::chrono::milliseconds interval)
+    : m_fd{fd}, m_interval{interval}, m_ring(std::bit_ceil(std::max<std::size_t>(capacity, 2))),
+      m_writer{[this]() { run(); }} {}
+
+Async_host_output::~Async_host_output() {
+  {
+    const std::lock_guard lock{m_mutex};
+    m_stop = true;
+  }
+  m_wake_up.notify_one();
+  m_writer.join();
+}
+
+void Async_host_output::write(std::span<const std::byte> data) {
+  const std::size_t capacity{m_ring.size()};
+  bool wake_writer{false};
+  while (!data.empty()) {
+    const std::size_t tail{m_tail.load(std::memory_order_relaxed)};
+    const std::size_t used{tail - m_head.load(std::memory_order_acquire)};
+    if (used == capacity) {
+      wake();
+      std::this_thread::yield();
+      continue;
+    }
+    const std::size_t offset{tail & (capacity - 1)};
+    const std::size_t size{std::min({data.size(), capacity - used, capacity - offset})};
+    const auto chunk{data.first(size)};
+    std::memcpy(m_ring.data() + offset, chunk.data(), size);
+    wake_writer = wake_writer ||
+        (std::ranges::find(chunk, std::byte{'\n'}) != chunk.end()) ||
+        (used + size >= capacity / 2);
+    m_tail.store(tail + size, std::memory_order_release);
+    data = data.subspan(size);
+  }
+  if (wake_writer) wake();
+}
+
+void Async_host_output::flush() {
+  const std::size_t tail{m_tail.load(std::memory_order_relaxed)};
+  wake();
+  std::unique_lock lock{m_mutex};
+  m_drained.wait(lock, [&]() { return m_head.load(std::memory_order_acquire) == tail; });
+}
+
+void Async_host_output::wake() {
+  {
+    const std::lock_guard lock{m_mutex};
+    m_wake_requested = true;
+  }
+  m_wake_up.notify_one();
+}
+
+void Async_host_output::run() {
+  for (;;) {
+    bool stop{false};
+    {
+      std::unique_lock lock{m_mutex};
+      m_wake_up.wait_for(lock, m_interval, [&]() { return m_wake_requested || m_stop; });
+      m_wake_requested = false;
+      stop = m_stop;
+    }
+    drain();
+    if (stop) return;
+  }
+}
+
+void Async_host_output::drain() {
+  const std::size_t capacity{m_ring.size()};
+  std::size_t head{m_head.load(std::memory_order_relaxed)};
+  const std::size_t tail{m_tail.load(std::memory_order_acquire)};
+  while (head != tail) {
+    const std::size_t offset{head & (capacity - 1)};
+    const std::size_t size{std::min(tail - head, capacity - offset)};
+    m_host_writes += write_all(m_fd, std::span{m_ring}.subspan(offset, size));
+    head += size;
+    m_head.store(head, std::memory_order_release);
+  }
+  // Taken so that a flush between checking the head and waiting can't miss the notification.
+  {
+    const std::lock_guard lock{m_mutex};
+  }
+  m_drained.notify_all();
+}
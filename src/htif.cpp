@@ -0,0 +1,135 @@
+#include "htif.hpp"
+
+#include "exception.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <string>
+
+namespace {
+  constexpr std::uint64_t payload_mask{(std::uint64_t{1} << 48) - 1};
+  constexpr std::uint64_t device_syscall{0};
+  constexpr std::uint64_t device_console{1};
+  constexpr std::uint64_t console_putchar{1};
+
+  [[nodiscard]] std::size_t get_symbol(const Elf &elf, std::string_view name) {
+    const std::optional<std::uint64_t> addr{elf.find_symbol(name)};
+    if (!addr) throw Errors::Error{"Htif. No symbol " + std::string{name}};
+    return static_cast<std::size_t>(*addr);
+  }
+
+  // Replaces the enabled byte lanes of the word at byte `offset` of `value`.
+  [[nodiscard]] std::uint64_t merge(std::uint64_t value, std::uint64_t data, std::size_t offset,
+      unsigned int byte_en) {
+    std::uint64_t mask{0};
+    for (unsigned int lane{0}; byte_en >> lane; ++lane) {
+      if ((byte_en >> lane) & 1u) mask |= std::uint64_t{0xff} << (8 * lane);
+    }
+    mask <<= 8 * offset;
+    return (value & ~mask) | ((data << (8 * offset)) & mask);
+  }
+}
+
+template <unsigned int xlen>
+Basic_htif<xlen>::Basic_htif(Basic_memory<xlen> &memory, std::size_t tohost,
+    std::optional<std::size_t> fromhost, Host_output &out, Host_output &err)
+    : m_memory{memory}, m_tohost{tohost}, m_fromhost{fromhost}, m_out{out}, m_err{err} {}
+
+template <unsigned int xlen>
+Basic_htif<xlen>::Basic_htif(Basic_memory<xlen> &memory, const Elf &elf, Host_output &out,
+    Host_output &err)
+    : Basic_htif{memory, get_symbol(elf, "tohost"), elf.find_symbol("fromhost"), out, err} {}
+
+template <unsigned int xlen>
+void Basic_htif<xlen>::write(std::size_t addr, Data data, unsigned int byte_en) {
+  if (is_in(addr, m_tohost)) {
+    const std::size_t offset{addr - m_tohost};
+    m_tohost_value = merge(m_tohost_value, data, offset, byte_en);
+    // The lanes of the high word.
+    if ((byte_en << offset) & 0xf0u) {
+      const std::uint64_t command{m_tohost_value};
+      m_tohost_value = 0;
+      if (command) run(command);
+    }
+  } else if (is_in(addr, m_fromhost)) {
+    m_fromhost_value = merge(m_fromhost_value, data, addr - *m_fromhost, byte_en);
+  } else {
+    m_memory.write(addr, data, byte_en);
+  }
+}
+
+template <unsigned int xlen>
+auto Basic_htif<xlen>::read(std::size_t addr, unsigned int byte_en) -> Data {
+  if (is_in(addr, m_tohost)) {
+    return static_cast<Data>(m_tohost_value >> (8 * (addr - m_tohost)));
+  }
+  if (is_in(addr, m_fromhost)) {
+    return static_cast<Data>(m_fromhost_value >> (8 * (addr - *m_fromhost)));
+  }
+  return m_memory.read(addr, byte_en);
+}
+
+template <unsigned int xlen>
+std::byte* Basic_htif<xlen>::get_host_ptr(std::size_t addr, std::size_t size) {
+  const auto overlaps = [addr, size](std::optional<std::size_t> reg) {
+    return reg && (addr < *reg + reg_size) && (*reg < addr + size);
+  };
+  if (overlaps(m_tohost) || overlaps(m_fromhost)) return nullptr;
+  return m_memory.get_host_ptr(addr, size);
+}
+
+template <unsigned int xlen>
+void Basic_htif<xlen>::run(std::uint64_t command) {
+  const std::uint64_t device{command >> 56};
+  const std::uint64_t cmd{(command >> 48) & 0xff};
+  const std::uint64_t payload{command & payload_mask};
+  if (device == device_syscall) {
+    if (payload & 1) {
+      exit(payload >> 1);
+      return;
+    }
+    std::array<std::uint64_t, 8> magic_mem{};
+    const auto addr{static_cast<std::size_t>(payload)};
+    m_memory.read_block(addr, std::as_writable_bytes(std::span{magic_mem}));
+    if (magic_mem[0] == SYS_EXIT) {
+      exit(magic_mem[1]);
+      return;
+    }
+    magic_mem[0] = static_cast<std::uint64_t>(
+        syscall(magic_mem[0], magic_mem[1], magic_mem[2], magic_mem[3]));
+    m_memory.write_block(addr, std::as_bytes(std::span{magic_mem}.first(1)));
+    m_fromhost_value = 1;
+  } else if ((device == device_console) && (cmd == console_putchar)) {
+    const auto c{static_cast<char>(payload & 0xff)};
+    m_out.write(std::string_view{&c, 1});
+    m_fromhost_value = (device_console << 56) | (console_putchar << 48);
+  }
+}
+
+template <unsigned int xlen>
+std::int64_t Basic_htif<xlen>::syscall(std::uint64_t number, std::uint64_t fd,
+    std::uint64_t buf, std::uint64_t len) {
+  if (number != SYS_WRITE) return -ENOSYS;
+  if ((fd != 1) && (fd != 2)) return -EBADF;
+  Host_output &output{(fd == 1) ? m_out : m_err};
+  std::array<std::byte, 256> chunk{};
+  for (std::uint64_t done{0}; done < len; done += chunk.size()) {
+    const std::span<std::byte> data{std::span{chunk}.first(
+        static_cast<std::size_t>(std::min<std::uint64_t>(chunk.size(), len - done)))};
+    m_memory.read_block(static_cast<std::size_t>(buf + done), data);
+    output.write(data);
+  }
+  return static_cast<std::int64_t>(len);
+}
+
+template <unsigned int xlen>
+void Basic_htif<xlen>::exit(std::uint64_t code) {
+  m_out.flush();
+  m_err.flush();
+  m_exit_code = code;
+  if (m_exit_handler) m_exit_handler(code);
+}
+
+template class Basic_htif<32>;
+template class Basic_htif<64>;
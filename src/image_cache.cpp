@@ -0,0 +1,63 @@
+#include "image_cache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+Image::Image(std::span<const std::byte> content, std::uint64_t hash)
+    : m_pages((content.size() + page_size - 1) / page_size * page_size), m_size{content.size()},
+    m_hash{hash} {
+  std::copy(content.begin(), content.end(), m_pages.begin());
+}
+
+Uxlen Image::at(std::size_t word) const {
+  const std::size_t addr{word * 4};
+  if (addr >= m_size) {
+    throw std::out_of_range{"Image. Word " + std::to_string(word) + " is out of the image"};
+  }
+  // Within the padding of the last page.
+  Uxlen data{0};
+  std::memcpy(&data, m_pages.data() + addr, sizeof(data));
+  return data;
+}
+
+Image_cache& Image_cache::get_instance() {
+  static Image_cache instance{};
+  return instance;
+}
+
+std::shared_ptr<const Image> Image_cache::intern(std::span<const std::byte> content) {
+  const std::uint64_t key{hash(content)};
+  const std::scoped_lock lock{m_mutex};
+  erase_expired();
+  const auto [first, last] = m_images.equal_range(key);
+  for (auto it{first}; it != last; ++it) {
+    std::shared_ptr<const Image> image{it->second.lock()};
+    if (image && std::ranges::equal(image->get_content(), content)) return image;
+  }
+  auto image = std::make_shared<const Image>(content, key);
+  m_images.emplace(key, image);
+  return image;
+}
+
+std::size_t Image_cache::get_images() {
+  const std::scoped_lock lock{m_mutex};
+  erase_expired();
+  return m_images.size();
+}
+
+std::uint64_t Image_cache::hash(std::span<const std::byte> content) {
+  constexpr std::uint64_t offset_basis{0xcbf29ce484222325};
+  constexpr std::uint64_t prime{0x100000001b3};
+  std::uint64_t hash{offset_basis};
+  for (const std::byte byte : content) {
+    hash = (hash ^ std::to_integer<std::uint64_t>(byte)) * prime;
+  }
+  return hash;
+}
+
+void Image_cache::erase_expired() {
+  std::erase_if(m_images, [](const auto &entry) { return entry.second.expired(); });
+}
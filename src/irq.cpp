@@ -0,0 +1,35 @@
+#include "irq.hpp"
+
+#include "exception.hpp"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+Irq_pending::~Irq_pending() {
+  if (m_wakeup_fd >= 0) close(m_wakeup_fd);
+}
+
+void Irq_pending::raise(Irq::Cause cause) {
+  const Uxlen mask{Irq::to_mask(cause)};
+  const Uxlen old{m_pending.fetch_or(mask)};
+  m_pending.notify_all();
+  if ((m_wakeup_fd >= 0) && !(old & mask)) {
+    const std::uint64_t one{1};
+    // The counter can only overflow after 2^64 - 1 wakeups nobody consumed.
+    [[maybe_unused]] const auto written{::write(m_wakeup_fd, &one, sizeof(one))};
+  }
+}
+
+int Irq_pending::enable_wakeup_fd() {
+  if (m_wakeup_fd < 0) {
+    m_wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeup_fd < 0) {
+      throw Errors::Error{std::string{"Irq_pending. eventfd failed: "} + std::strerror(errno)};
+    }
+  }
+  return m_wakeup_fd;
+}
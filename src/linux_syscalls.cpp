@@ -0,0 +1,309 @@
+#include "linux_syscalls.hpp"
+
+#include "exception.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+
+namespace {
+  enum Reg : std::size_t {
+    A0 = 10,
+    A7 = 17,
+  };
+
+  // Flags of openat in the generic ABI and on the host.
+  constexpr std::pair<unsigned int, int> open_flags[]{
+    {00000100, O_CREAT    },
+    {00000200, O_EXCL     },
+    {00000400, O_NOCTTY   },
+    {00001000, O_TRUNC    },
+    {00002000, O_APPEND   },
+    {00004000, O_NONBLOCK },
+    {00010000, O_DSYNC    },
+    {00200000, O_DIRECTORY},
+    {00400000, O_NOFOLLOW },
+    {02000000, O_CLOEXEC  },
+  };
+  constexpr unsigned int open_access_mask{0b11};
+  constexpr int at_fdcwd{-100};
+
+  constexpr unsigned int map_shared{0x01};
+  constexpr unsigned int map_fixed{0x10};
+  constexpr unsigned int map_anonymous{0x20};
+
+  // struct stat of the generic ABI, which RV32 and RV64 share.
+  constexpr std::size_t stat_size{128};
+  // timespec of clock_gettime on RV64 and clock_gettime64 on RV32.
+  constexpr std::size_t timespec_size{16};
+
+  template <typename T>
+  void put(std::span<std::byte> buffer, std::size_t offset, T value) {
+    std::memcpy(buffer.data() + offset, &value, sizeof(value));
+  }
+
+  template <typename T>
+  [[nodiscard]] T get_errno() {
+    return static_cast<T>(-errno);
+  }
+}
+
+template <unsigned int xlen>
+Basic_linux_syscalls<xlen>::Basic_linux_syscalls(Xmemory &rf, Xmemory &memory, std::size_t brk,
+    std::size_t mmap_top, std::array<int, 3> stdio)
+    : m_rf{rf}, m_memory{memory}, m_initial_brk{brk}, m_brk{brk},
+    m_mmap_bottom{mmap_top / page_size * page_size} {
+  if (m_mmap_bottom < m_brk) {
+    throw Errors::Error{"Linux_syscalls. The mmap area " + std::to_string(mmap_top) +
+        " is below the program break " + std::to_string(brk)};
+  }
+  for (const int fd : stdio) m_fds.push_back(Fd{.host = fd, .owned = false});
+}
+
+template <unsigned int xlen>
+Basic_linux_syscalls<xlen>::~Basic_linux_syscalls() {
+  for (const std::optional<Fd> &fd : m_fds) {
+    if (fd && fd->owned) ::close(fd->host);
+  }
+}
+
+template <unsigned int xlen>
+auto Basic_linux_syscalls<xlen>::handle() -> std::optional<Data> {
+  const Data number{m_rf.read(A7)};
+  std::array<Data, 6> args{};
+  for (std::size_t i{0}; i < args.size(); ++i) args[i] = m_rf.read(A0 + i);
+  if ((number == EXIT) || (number == EXIT_GROUP)) {
+    m_exit_code = args[0];
+    return m_exit_code;
+  }
+  m_rf.write(A0, static_cast<Data>(call(number, args)));
+  return {};
+}
+
+template <unsigned int xlen>
+auto Basic_linux_syscalls<xlen>::call(Data number, const std::array<Data, 6> &args) -> Sdata {
+  try {
+    switch (number) {
+      case READ           : return sys_read (args[0], args[1], args[2]);
+      case WRITE          : return sys_write(args[0], args[1], args[2]);
+      case OPENAT         : return sys_openat(args[0], args[1], args[2], args[3]);
+      case CLOSE          : return sys_close(args[0]);
+      case FSTAT          : return sys_fstat(args[0], args[1]);
+      case BRK            : return sys_brk(args[0]);
+      // The address is only a hint.
+      case MMAP           : {
+        if (args[3] & map_fixed) return -EINVAL;
+        const Data offset{(xlen == 32) ? static_cast<Data>(args[5] * page_size) : args[5]};
+        return sys_mmap(args[1], args[3], args[4], offset);
+      }
+      // Mappings aren't reused.
+      case MUNMAP         : return 0;
+      case CLOCK_GETTIME  :
+      case CLOCK_GETTIME64: return sys_clock_gettime(args[0], args[1]);
+      default: return -ENOSYS;
+    }
+  } catch (const Errors::Illegal_addr &) {
+    return -EFAULT;
+  }
+}
+
+template <unsigned int xlen>
+auto Basic_linux_syscalls<xlen>::get_fd(Data fd) const -> const Fd* {
+  if ((fd >= m_fds.size()) || !m_fds[fd]) return nullptr;
+  return &*m_fds[fd];
+}
+
+template <unsigned int xlen>
+std::string Basic_linux_syscalls<xlen>::read_string(std::size_t addr) const {
+  std::string string{};
+  for (;;) {
+    if (string.size() >= PATH_MAX) throw Errors::Illegal_addr{addr, "Unterminated string"};
+    std::byte c{};
+    m_memory.read_block(addr + string.size(), {&c, 1});
+    if (c == std::byte{0}) return string;
+    string.push_back(static_cast<char>(c));
+  }
+}
+
+template <unsigned int xlen>
+template <typename Io>
+auto Basic_linux_syscalls<xlen>::transfer(std::size_t addr, std::size_t size, bool into_guest,
+    Io io) -> Sdata {
+  std::size_t done{0};
+  while (done < size) {
+    const std::size_t at{addr + done};
+    std::size_t count{size - done};
+    std::byte *host{m_memory.get_host_ptr(at, count)};
+    // Memories such as Cow_ram only hand out pointers within a page.
+    if (!host) {
+      count = std::min(count, page_size - at % page_size);
+      host = m_memory.get_host_ptr(at, count);
+    }
+    ssize_t result{0};
+    if (host) {
+      result = io(host, count);
+      if (result > 0) m_zero_copy_bytes += static_cast<std::uint64_t>(result);
+    } else {
+      m_bounce.resize(count);
+      // Like the kernel, a transfer running out of memory part way returns what it did.
+      try {
+        if (!into_guest) m_memory.read_block(at, m_bounce);
+        result = io(m_bounce.data(), count);
+        if (into_guest && (result > 0)) {
+          m_memory.write_block(at, std::span{m_bounce}.first(static_cast<std::size_t>(result)));
+        }
+      } catch (const Errors::Illegal_addr &) {
+        if (done) return static_cast<Sdata>(done);
+        throw;
+      }
+    }
+    if (result < 0) return done ? static_cast<Sdata>(done) : get_errno<Sdata>();
+    done += static_cast<std::size_t>(result);
+    if (static_cast<std::size_t>(result) < count) break;
+  }
+  return static_cast<Sdata>(done);
+}
+
+template <unsigned int xlen>
+auto Basic_linux_syscalls<xlen>::sys_read(Data fd, Data buf, Data count) -> Sdata {
+  const Fd *host_fd{get_fd(fd)};
+  if (!host_fd) return -EBADF;
+  return transfer(buf, count, true, [host = host_fd->host](std::byte *data, std::size_t size) {
+    return ::read(host, data, size);
+  });
+}
+
+template <unsigned int xlen>
+auto Basic_linux_syscalls<xlen>::sys_write(Data fd, Data buf, Data count) -> Sdata {
+  const Fd *host_fd{get_fd(fd)};
+  if (!host_fd) return -EBADF;
+  return transfer(buf, count, false, [host = host_fd->host](std::byte *data, std::size_t size) {
+    return ::write(host, data, size);
+  });
+}
+
+template <unsigned int xlen>
+auto Basic_linux_syscalls<xlen>::sys_openat(Data dirfd, Data path, Data flags, Data mode)
+    -> Sdata {
+  int host_dirfd{AT_FDCWD};
+  if (static_cast<int>(dirfd) != at_fdcwd) {
+    const Fd *fd{get_fd(dirfd)};
+    if (!fd) return -EBADF;
+    host_dirfd = fd->host;
+  }
+  int host_flags{static_cast<int>(flags & open_access_mask)};
+  for (const auto &[guest, host] : open_flags) {
+    if (flags & guest) host_flags |= host;
+  }
+  const std::string name{read_string(path)};
+  const int host_fd{::openat(host_dirfd, name.c_str(), host_flags, static_cast<mode_t>(mode))};
+  if (host_fd < 0) return get_errno<Sdata>();
+
+  const Fd opened{.host = host_fd, .owned = true};
+  const auto free{std::find(m_fds.begin(), m_fds.end(), std::nullopt)};
+  if (free != m_fds.end()) {
+    *free = opened;
+    return static_cast<Sdata>(free - m_fds.begin());
+  }
+  m_fds.push_back(opened);
+  return static_cast<Sdata>(m_fds.size() - 1);
+}
+
+template <unsigned int xlen>
+auto Basic_linux_syscalls<xlen>::sys_close(Data fd) -> Sdata {
+  const Fd *host_fd{get_fd(fd)};
+  if (!host_fd) return -EBADF;
+  const bool failed{host_fd->owned && (::close(host_fd->host) < 0)};
+  const int error{errno};
+  m_fds[fd].reset();
+  return failed ? -error : 0;
+}
+
+template <unsigned int xlen>
+auto Basic_linux_syscalls<xlen>::sys_fstat(Data fd, Data buf) -> Sdata {
+  const Fd *host_fd{get_fd(fd)};
+  if (!host_fd) return -EBADF;
+  struct stat host{};
+  if (::fstat(host_fd->host, &host) < 0) return get_errno<Sdata>();
+
+  std::array<std::byte, stat_size> guest{};
+  put<std::uint64_t>(guest,   0, host.st_dev);
+  put<std::uint64_t>(guest,   8, host.st_ino);
+  put<std::uint32_t>(guest,  16, host.st_mode);
+  put<std::uint32_t>(guest,  20, static_cast<std::uint32_t>(host.st_nlink));
+  put<std::uint32_t>(guest,  24, host.st_uid);
+  put<std::uint32_t>(guest,  28, host.st_gid);
+  put<std::uint64_t>(guest,  32, host.st_rdev);
+  put<std::int64_t >(guest,  48, host.st_size);
+  put<std::int32_t >(guest,  56, static_cast<std::int32_t>(host.st_blksize));
+  put<std::int64_t >(guest,  64, host.st_blocks);
+  put<std::int64_t >(guest,  72, host.st_atim.tv_sec);
+  put<std::int64_t >(guest,  80, host.st_atim.tv_nsec);
+  put<std::int64_t >(guest,  88, host.st_mtim.tv_sec);
+  put<std::int64_t >(guest,  96, host.st_mtim.tv_nsec);
+  put<std::int64_t >(guest, 104, host.st_ctim.tv_sec);
+  put<std::int64_t >(guest, 112, host.st_ctim.tv_nsec);
+  m_memory.write_block(buf, guest);
+  return 0;
+}
+
+// Fails by returning the current break.
+template <unsigned int xlen>
+auto Basic_linux_syscalls<xlen>::sys_brk(Data addr) -> Sdata {
+  if ((addr >= m_initial_brk) && (addr <= m_mmap_bottom)) m_brk = addr;
+  return static_cast<Sdata>(m_brk);
+}
+
+template <unsigned int xlen>
+auto Basic_linux_syscalls<xlen>::sys_mmap(Data len, Data flags, Data fd, Data offset) -> Sdata {
+  const bool anonymous{(flags & map_anonymous) != 0};
+  // A copy can't share writes with the file.
+  if ((len == 0) || (!anonymous && (flags & map_shared))) return -EINVAL;
+  const std::size_t size{(std::size_t{len} + page_size - 1) / page_size * page_size};
+  if (size > m_mmap_bottom - m_brk) return -ENOMEM;
+  const std::size_t addr{m_mmap_bottom - size};
+
+  int host_fd{-1};
+  if (!anonymous) {
+    const Fd *file{get_fd(fd)};
+    if (!file) return -EBADF;
+    host_fd = file->host;
+  }
+  const Sdata zeroed{transfer(addr, size, true, [](std::byte *data, std::size_t count) {
+    std::memset(data, 0, count);
+    return static_cast<ssize_t>(count);
+  })};
+  if (zeroed < 0) return zeroed;
+  if (!anonymous) {
+    auto file_offset{static_cast<off_t>(offset)};
+    const Sdata read{transfer(addr, len, true,
+        [host_fd, &file_offset](std::byte *data, std::size_t count) {
+      const ssize_t result{::pread(host_fd, data, count, file_offset)};
+      if (result > 0) file_offset += result;
+      return result;
+    })};
+    if (read < 0) return read;
+  }
+  m_mmap_bottom = addr;
+  return static_cast<Sdata>(addr);
+}
+
+template <unsigned int xlen>
+auto Basic_linux_syscalls<xlen>::sys_clock_gettime(Data clock, Data buf) -> Sdata {
+  timespec now{};
+  if (::clock_gettime(static_cast<clockid_t>(clock), &now) < 0) return get_errno<Sdata>();
+  std::array<std::byte, timespec_size> guest{};
+  put<std::int64_t>(guest, 0, now.tv_sec);
+  put<std::int64_t>(guest, 8, now.tv_nsec);
+  m_memory.write_block(buf, guest);
+  return 0;
+}
+
+template class Basic_linux_syscalls<32>;
+template class Basic_linux_syscalls<64>;
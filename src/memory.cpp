@@ -1,16 +1,131 @@
 #include "memory.hpp"
 
+#include "riscv_algos.hpp"
+
 #include "spdlog/logger.h"
 
-void Traced_mem_wrap::write(std::size_t addr, Uxlen data, unsigned int byte_en) {
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+  // Calls `access(word_addr, byte_en, first_lane, offset, count)` for each word that
+  // [addr, addr + size) touches, where `offset` is the position of the word's first
+  // accessed byte in the block.
+  template <unsigned int xlen>
+  void for_each_word(std::size_t addr, std::size_t size, auto access) {
+    constexpr std::size_t word_size{xlen / CHAR_BIT};
+    for (std::size_t offset{0}; offset < size;) {
+      const std::size_t lane{(addr + offset) & (word_size - 1)};
+      const std::size_t count{std::min(word_size - lane, size - offset)};
+      const unsigned int byte_en{make_mask<unsigned int>(count) << lane};
+      access(addr + offset - lane, byte_en, lane, offset, count);
+      offset += count;
+    }
+  }
+}
+
+template <unsigned int xlen>
+void Basic_memory<xlen>::read_block(std::size_t addr, std::span<std::byte> data) {
+  if (data.empty()) return;
+  if (const std::byte *host{get_host_ptr(addr, data.size())}) {
+    copy_from_guest(data.data(), host, data.size());
+    return;
+  }
+  for_each_word<xlen>(addr, data.size(), [this, data](std::size_t word_addr,
+      unsigned int byte_en, std::size_t lane, std::size_t offset, std::size_t count) {
+    const Data word{read(word_addr, byte_en)};
+    for (std::size_t i{0}; i < count; ++i) {
+      data[offset + i] = static_cast<std::byte>(word >> ((lane + i) * CHAR_BIT));
+    }
+  });
+}
+
+template <unsigned int xlen>
+void Basic_memory<xlen>::write_block(std::size_t addr, std::span<const std::byte> data) {
+  if (data.empty()) return;
+  if (std::byte *host{get_host_ptr(addr, data.size())}) {
+    copy_to_guest(host, data.data(), data.size());
+    return;
+  }
+  for_each_word<xlen>(addr, data.size(), [this, data](std::size_t word_addr,
+      unsigned int byte_en, std::size_t lane, std::size_t offset, std::size_t count) {
+    Data word{0};
+    for (std::size_t i{0}; i < count; ++i) {
+      word |= static_cast<Data>(std::to_integer<Data>(data[offset + i]) << ((lane + i) * CHAR_BIT));
+    }
+    write(word_addr, word, byte_en);
+  });
+}
+
+template class Basic_memory<32>;
+template class Basic_memory<64>;
+
+namespace {
+  using Word = std::uint64_t;
+
+  // Calls `copy_bytes(offset, count)` for the unaligned head and tail of [guest,
+  // guest + size) and `copy_word(offset)` for each aligned word in between.
+  void for_each_chunk(const std::byte *guest, std::size_t size, auto copy_bytes,
+      auto copy_word) {
+    constexpr std::size_t alignment{std::atomic_ref<Word>::required_alignment};
+    const std::size_t misalignment{reinterpret_cast<std::uintptr_t>(guest) % alignment};
+    const std::size_t head{std::min(size, misalignment ? alignment - misalignment : 0)};
+    copy_bytes(0, head);
+    std::size_t offset{head};
+    for (; size - offset >= sizeof(Word); offset += sizeof(Word)) copy_word(offset);
+    copy_bytes(offset, size - offset);
+  }
+
+  // atomic_ref of a const object is C++26, and nothing is written through these.
+  [[nodiscard]] std::atomic_ref<Word> get_word(const std::byte *guest) {
+    return std::atomic_ref<Word>{*reinterpret_cast<Word*>(const_cast<std::byte*>(guest))};
+  }
+  [[nodiscard]] std::atomic_ref<std::byte> get_byte(const std::byte *guest) {
+    return std::atomic_ref<std::byte>{*const_cast<std::byte*>(guest)};
+  }
+}
+
+void copy_from_guest(std::byte *to, const std::byte *guest, std::size_t size) {
+  for_each_chunk(guest, size, [to, guest](std::size_t offset, std::size_t count) {
+    for (std::size_t i{offset}; i < offset + count; ++i) {
+      to[i] = get_byte(guest + i).load(std::memory_order_relaxed);
+    }
+  }, [to, guest](std::size_t offset) {
+    const Word word{get_word(guest + offset).load(std::memory_order_relaxed)};
+    std::memcpy(to + offset, &word, sizeof(word));
+  });
+}
+
+void copy_to_guest(std::byte *guest, const std::byte *from, std::size_t size) {
+  for_each_chunk(guest, size, [guest, from](std::size_t offset, std::size_t count) {
+    for (std::size_t i{offset}; i < offset + count; ++i) {
+      get_byte(guest + i).store(from[i], std::memory_order_relaxed);
+    }
+  }, [guest, from](std::size_t offset) {
+    Word word{};
+    std::memcpy(&word, from + offset, sizeof(word));
+    get_word(guest + offset).store(word, std::memory_order_relaxed);
+  });
+}
+
+template <unsigned int xlen>
+void Basic_traced_mem_wrap<xlen>::write(std::size_t addr, Data data, unsigned int byte_en) {
   m_logger->info("{} write addr:0x{:x}, data:0x{:x}, byte_en:0x{:x}", m_msg, addr, data,
       byte_en);
   m_mem.write(addr, data, byte_en);
 }
 
-[[nodiscard]] Uxlen Traced_mem_wrap::read (std::size_t addr, unsigned int byte_en) {
-  const Uxlen data{m_mem.read(addr, byte_en)};
+template <unsigned int xlen>
+[[nodiscard]] auto Basic_traced_mem_wrap<xlen>::read (std::size_t addr, unsigned int byte_en)
+    -> Data {
+  const Data data{m_mem.read(addr, byte_en)};
   m_logger->info("{} read addr:0x{:x}, data:0x{:x}, byte_en:0x{:x}", m_msg, addr, data,
       byte_en);
   return data;
 }
+
+template class Basic_traced_mem_wrap<32>;
+template class Basic_traced_mem_wrap<64>;
@@ -0,0 +1,336 @@
+#include "mmu.hpp"
+
+#include "exception.hpp"
+
+#include <atomic>
+#include <bit>
+#include <climits>
+
+namespace {
+  // Sv32 page table entry flags.
+  enum Pte : Uxlen {
+    PTE_V = 1u << 0,
+    PTE_R = 1u << 1,
+    PTE_W = 1u << 2,
+    PTE_X = 1u << 3,
+    PTE_U = 1u << 4,
+    PTE_G = 1u << 5,
+    PTE_A = 1u << 6,
+    PTE_D = 1u << 7,
+  };
+  constexpr unsigned int pte_ppn_shift{10};
+  constexpr std::size_t pte_size{4};
+  constexpr unsigned int vpn_bits{10};
+
+  // Accesses to host memory are relaxed atomics, as in Ram. Words are aligned, so they
+  // never cross a page.
+  template <typename T>
+  [[nodiscard]] T load_lanes(std::byte *host, unsigned int byte_en) {
+    if (byte_en == (1u << sizeof(T)) - 1) {
+      return std::atomic_ref<T>{*reinterpret_cast<T*>(host)}.load(std::memory_order_relaxed);
+    }
+    T data{0};
+    for (unsigned int lane{0}; lane < sizeof(T); ++lane) {
+      if ((byte_en >> lane) & 1u) {
+        data |= std::to_integer<T>(std::atomic_ref<std::byte>{host[lane]}.load(
+            std::memory_order_relaxed)) << (lane * CHAR_BIT);
+      }
+    }
+    return data;
+  }
+
+  template <typename T>
+  void store_lanes(std::byte *host, T data, unsigned int byte_en) {
+    if (byte_en == (1u << sizeof(T)) - 1) {
+      std::atomic_ref<T>{*reinterpret_cast<T*>(host)}.store(data, std::memory_order_relaxed);
+      return;
+    }
+    for (unsigned int lane{0}; lane < sizeof(T); ++lane) {
+      if ((byte_en >> lane) & 1u) {
+        std::atomic_ref<std::byte>{host[lane]}.store(
+            static_cast<std::byte>(data >> (lane * CHAR_BIT)), std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // The address of the first accessed byte, which a fault reports.
+  [[nodiscard]] std::size_t get_lane(unsigned int byte_en) {
+    assert(byte_en && "Access without byte lanes");
+    return static_cast<std::size_t>(std::countr_zero(byte_en));
+  }
+
+  // From the first to the last accessed byte.
+  [[nodiscard]] std::size_t get_size(unsigned int byte_en) {
+    return static_cast<std::size_t>(std::bit_width(byte_en)) - get_lane(byte_en);
+  }
+}
+
+template <unsigned int xlen>
+Basic_mmu<xlen>::Basic_mmu(Basic_memory<xlen> &memory, Basic_pmp<xlen> *pmp,
+    Basic_watchpoints<xlen> *watchpoints)
+    : m_memory{memory}, m_pmp{pmp}, m_watchpoints{watchpoints} {
+  if (m_watchpoints) m_watch_subscription = m_watchpoints->subscribe([this]() { flush(); });
+}
+
+template <unsigned int xlen>
+Basic_mmu<xlen>::~Basic_mmu() {
+  if (m_watchpoints) m_watchpoints->unsubscribe(m_watch_subscription);
+}
+
+template <unsigned int xlen>
+void Basic_mmu<xlen>::set_context(Privilege privilege, Data satp, Data mstatus) {
+  m_privilege = privilege;
+  const bool mprv{(mstatus & Csr_base::MSTATUS_MPRV) != 0};
+  m_data_privilege = (mprv && (privilege == Privilege::machine)) ?
+      static_cast<Privilege>((mstatus & Csr_base::MSTATUS_MPP) >> Csr_base::MSTATUS_MPP_SHIFT) :
+      privilege;
+  const bool sv32{(xlen == 32) && (satp & Csr_base::SATP_SV32)};
+  m_translate_fetch = sv32 && (m_privilege      != Privilege::machine);
+  m_translate_data  = sv32 && (m_data_privilege != Privilege::machine);
+  m_sum  = (mstatus & Csr_base::MSTATUS_SUM) != 0;
+  m_mxr  = (mstatus & Csr_base::MSTATUS_MXR) != 0;
+  m_asid = (satp >> Csr_base::SATP_ASID_SHIFT) & Csr_base::SATP_ASID_MASK;
+  m_root = static_cast<std::size_t>(satp & Csr_base::SATP_PPN_MASK) * page_size;
+}
+
+template <unsigned int xlen>
+void Basic_mmu<xlen>::flush(std::optional<Data> vaddr, std::optional<Data> asid) {
+  const auto matches = [asid](const Entry &entry) {
+    return !asid || (!entry.global && (entry.asid == *asid));
+  };
+  for (Tlb *tlb : {&m_itlb, &m_dtlb}) {
+    if (vaddr) {
+      const Data vpn{static_cast<Data>(*vaddr / page_size)};
+      Entry &entry{(*tlb)[vpn % tlb_entries]};
+      if ((entry.vpn == vpn) && matches(entry)) entry.valid = false;
+      continue;
+    }
+    for (Entry &entry : *tlb) {
+      if (matches(entry)) entry.valid = false;
+    }
+  }
+}
+
+template <unsigned int xlen>
+auto Basic_mmu<xlen>::translate(std::size_t vaddr, Access access) -> Translation {
+  Tlb &tlb{(access == Access::fetch) ? m_itlb : m_dtlb};
+  const Data vpn{static_cast<Data>(vaddr / page_size)};
+  Entry *entry{lookup(tlb, vpn)};
+  // A refused hit walks again, since the page table may have been changed to allow it.
+  if (!entry || !is_allowed(*entry, access) ||
+      ((access == Access::store) && !(entry->pte_flags & PTE_D))) [[unlikely]] {
+    entry = &walk(tlb, vaddr, access);
+  }
+  const std::size_t offset{vaddr % page_size};
+  return {entry->page + offset, entry->host ? entry->host + offset : nullptr};
+}
+
+template <unsigned int xlen>
+auto Basic_mmu<xlen>::lookup(Tlb &tlb, Data vpn) -> Entry* {
+  Entry &entry{tlb[vpn % tlb_entries]};
+  const bool hit{entry.valid && (entry.vpn == vpn) && (entry.global || (entry.asid == m_asid))};
+  return hit ? &entry : nullptr;
+}
+
+template <unsigned int xlen>
+bool Basic_mmu<xlen>::is_allowed(const Entry &entry, Access access) const {
+  const Privilege privilege{(access == Access::fetch) ? m_privilege : m_data_privilege};
+  const bool is_user_page{(entry.pte_flags & PTE_U) != 0};
+  if ((privilege == Privilege::user) && !is_user_page) return false;
+  if ((privilege == Privilege::supervisor) && is_user_page &&
+      ((access == Access::fetch) || !m_sum)) {
+    return false;
+  }
+  switch (access) {
+    case Access::fetch: return entry.pte_flags & PTE_X;
+    case Access::load : return (entry.pte_flags & PTE_R) || (m_mxr && (entry.pte_flags & PTE_X));
+    case Access::store: return entry.pte_flags & PTE_W;
+    default: assert(0 && "Unknown access");
+  }
+}
+
+template <unsigned int xlen>
+auto Basic_mmu<xlen>::walk(Tlb &tlb, std::size_t vaddr, Access access) -> Entry& {
+  const auto fault = [vaddr, access]() {
+    switch (access) {
+      case Access::fetch: return Errors::Page_fault{vaddr, Csr_base::INSTRUCTION_PAGE_FAULT};
+      case Access::load : return Errors::Page_fault{vaddr, Csr_base::LOAD_PAGE_FAULT};
+      default           : return Errors::Page_fault{vaddr, Csr_base::STORE_PAGE_FAULT};
+    }
+  };
+  ++m_walks;
+
+  // The implicit accesses of the walk are checked by pmp as of S-mode, and fault as the
+  // access that caused the walk.
+  const auto protect_walk = [this, vaddr, access](std::size_t addr, Access walk_access) {
+    if (m_pmp && !m_pmp->is_allowed(addr, pte_size, walk_access, false)) {
+      throw_access_fault(vaddr, access);
+    }
+  };
+
+  const std::size_t vpn[]{(vaddr >> 12) & ((1u << vpn_bits) - 1),
+      (vaddr >> (12 + vpn_bits)) & ((1u << vpn_bits) - 1)};
+  std::size_t table{m_root};
+  std::size_t pte_addr{0};
+  Uxlen pte{0};
+  int level{1};
+  for (;; --level) {
+    pte_addr = table + vpn[level] * pte_size;
+    protect_walk(pte_addr, Access::load);
+    pte = read_word(pte_addr);
+    if (!(pte & PTE_V) || (!(pte & PTE_R) && (pte & PTE_W))) throw fault();
+    if (pte & (PTE_R | PTE_X)) break;
+    if (level == 0) throw fault();
+    table = static_cast<std::size_t>(pte >> pte_ppn_shift) * page_size;
+  }
+
+  const std::size_t ppn{pte >> pte_ppn_shift};
+  // A superpage takes the low part of the number from the virtual address.
+  if ((level == 1) && (ppn & ((1u << vpn_bits) - 1))) throw fault();
+  const std::size_t page{(level == 1) ? (ppn | vpn[0]) * page_size : ppn * page_size};
+
+  Entry entry{
+    .valid     = true,
+    .global    = (pte & PTE_G) != 0,
+    .pte_flags = static_cast<std::uint8_t>(pte),
+    .vpn       = static_cast<Data>(vaddr / page_size),
+    .asid      = m_asid,
+    .page      = page,
+    .host      = nullptr,
+  };
+  if (!is_allowed(entry, access)) throw fault();
+
+  const Uxlen updated{pte | PTE_A | ((access == Access::store) ? Uxlen{PTE_D} : Uxlen{0})};
+  if (updated != pte) {
+    protect_walk(pte_addr, Access::store);
+    write_word(pte_addr, updated);
+  }
+  entry.pte_flags = static_cast<std::uint8_t>(updated);
+  const bool watched{(access != Access::fetch) && m_watchpoints &&
+      m_watchpoints->is_watched(vaddr / page_size * page_size, page_size)};
+  entry.host = watched ? nullptr : m_memory.get_host_ptr(page, page_size);
+
+  Entry &slot{tlb[entry.vpn % tlb_entries]};
+  slot = entry;
+  return slot;
+}
+
+template <unsigned int xlen>
+void Basic_mmu<xlen>::throw_access_fault(std::size_t vaddr, Access access) {
+  switch (access) {
+    case Access::fetch: throw Errors::Access_fault{vaddr, Csr_base::INSTRUCTION_ACCESS_FAULT};
+    case Access::load : throw Errors::Access_fault{vaddr, Csr_base::LOAD_ACCESS_FAULT};
+    default           : throw Errors::Access_fault{vaddr, Csr_base::STORE_ACCESS_FAULT};
+  }
+}
+
+template <unsigned int xlen>
+Uxlen Basic_mmu<xlen>::read_word(std::size_t addr, unsigned int byte_en) {
+  if constexpr (xlen == 32) {
+    return m_memory.read(addr, byte_en);
+  } else {
+    const std::size_t lane{addr & 0b100};
+    return static_cast<Uxlen>(m_memory.read(addr - lane, byte_en << lane) >> (lane * CHAR_BIT));
+  }
+}
+
+template <unsigned int xlen>
+void Basic_mmu<xlen>::write_word(std::size_t addr, Uxlen data) {
+  if constexpr (xlen == 32) {
+    m_memory.write(addr, data);
+  } else {
+    const std::size_t lane{addr & 0b100};
+    m_memory.write(addr - lane, Data{data} << (lane * CHAR_BIT), 0xfu << lane);
+  }
+}
+
+template <unsigned int xlen>
+void Basic_mmu<xlen>::Instr_port::write(std::size_t /*addr*/, Uxlen /*data*/,
+    unsigned int /*byte_en*/) {
+  throw Errors::Read_only{"Write into the instruction port of the mmu"};
+}
+
+template <unsigned int xlen>
+Uxlen Basic_mmu<xlen>::Instr_port::read(std::size_t addr, unsigned int byte_en) {
+  const std::size_t lane{get_lane(byte_en)};
+  const Privilege privilege{m_mmu.m_privilege};
+  if (!m_mmu.m_translate_fetch) {
+    m_mmu.protect(addr + lane, addr + lane, get_size(byte_en), Access::fetch, privilege);
+    return m_mmu.read_word(addr, byte_en);
+  }
+  const Translation translation{m_mmu.translate(addr + lane, Access::fetch)};
+  m_mmu.protect(translation.addr, addr + lane, get_size(byte_en), Access::fetch, privilege);
+  if (translation.host) return load_lanes<Uxlen>(translation.host - lane, byte_en);
+  return m_mmu.read_word(translation.addr - lane, byte_en);
+}
+
+template <unsigned int xlen>
+void Basic_mmu<xlen>::Data_port::write(std::size_t addr, Data data, unsigned int byte_en) {
+  const std::size_t lane{get_lane(byte_en)};
+  const Privilege privilege{m_mmu.m_data_privilege};
+  if (!m_mmu.m_translate_data) {
+    m_mmu.protect(addr + lane, addr + lane, get_size(byte_en), Access::store, privilege);
+    m_mmu.m_memory.write(addr, data, byte_en);
+    m_mmu.check_watchpoints(addr, byte_en, Access::store);
+    return;
+  }
+  const Translation translation{m_mmu.translate(addr + lane, Access::store)};
+  m_mmu.protect(translation.addr, addr + lane, get_size(byte_en), Access::store, privilege);
+  if (translation.host) {
+    store_lanes<Data>(translation.host - lane, data, byte_en);
+  } else {
+    m_mmu.m_memory.write(translation.addr - lane, data, byte_en);
+    m_mmu.check_watchpoints(addr, byte_en, Access::store);
+  }
+}
+
+template <unsigned int xlen>
+auto Basic_mmu<xlen>::Data_port::read(std::size_t addr, unsigned int byte_en) -> Data {
+  const std::size_t lane{get_lane(byte_en)};
+  const Privilege privilege{m_mmu.m_data_privilege};
+  if (!m_mmu.m_translate_data) {
+    m_mmu.protect(addr + lane, addr + lane, get_size(byte_en), Access::load, privilege);
+    const Data data{m_mmu.m_memory.read(addr, byte_en)};
+    m_mmu.check_watchpoints(addr, byte_en, Access::load);
+    return data;
+  }
+  const Translation translation{m_mmu.translate(addr + lane, Access::load)};
+  m_mmu.protect(translation.addr, addr + lane, get_size(byte_en), Access::load, privilege);
+  if (translation.host) return load_lanes<Data>(translation.host - lane, byte_en);
+  const Data data{m_mmu.m_memory.read(translation.addr - lane, byte_en)};
+  m_mmu.check_watchpoints(addr, byte_en, Access::load);
+  return data;
+}
+
+template <unsigned int xlen>
+std::byte* Basic_mmu<xlen>::Data_port::get_host_ptr(std::size_t addr, std::size_t size) {
+  if (size == 0) return nullptr;
+  std::size_t paddr{addr};
+  std::byte *host{nullptr};
+  if (!m_mmu.m_translate_data) {
+    if (m_mmu.m_watchpoints && m_mmu.m_watchpoints->is_watched(addr, size)) return nullptr;
+    host = m_mmu.m_memory.get_host_ptr(addr, size);
+  } else {
+    const std::size_t offset{addr % page_size};
+    if (size > page_size - offset) return nullptr;
+    const Entry *entry{m_mmu.lookup(m_mmu.m_dtlb, static_cast<Data>(addr / page_size))};
+    if (!entry || !entry->host || !(entry->pte_flags & PTE_D) ||
+        !m_mmu.is_allowed(*entry, Access::store)) {
+      return nullptr;
+    }
+    paddr = entry->page + offset;
+    host = entry->host + offset;
+  }
+  // The caller may both read and write through it.
+  if (m_mmu.m_pmp) {
+    const bool machine{m_mmu.m_data_privilege == Privilege::machine};
+    if (!m_mmu.m_pmp->is_allowed(paddr, size, Access::load , machine) ||
+        !m_mmu.m_pmp->is_allowed(paddr, size, Access::store, machine)) {
+      return nullptr;
+    }
+  }
+  return host;
+}
+
+template class Basic_mmu<32>;
+template class Basic_mmu<64>;
@@ -0,0 +1,100 @@
+#include "plic.hpp"
+
+#include "exception.hpp"
+#include "riscv_algos.hpp"
+
+#include <cassert>
+
+namespace {
+  constexpr Uxlen priority_mask{0x7};
+
+  void assert_legal_source(unsigned int source) {
+    if ((source == 0) || (source >= Plic::sources_number)) {
+      throw Errors::Error{"Plic. Illegal source " + std::to_string(source)};
+    }
+  }
+}
+
+void Plic::write(std::size_t addr, Uxlen data, unsigned int byte_en) {
+  assert((byte_en == 0xf) && "only word access is supported");
+  if (addr < PRIORITY + 4 * sources_number) {
+    m_priority[addr / 4] = data & priority_mask;
+  } else if (addr == ENABLE) {
+    m_enable = data & ~Bits{1};
+  } else if (addr == THRESHOLD) {
+    m_threshold = data & priority_mask;
+  } else if (addr == CLAIM) {
+    complete(data);
+  } else if (addr == PENDING) {
+    throw Errors::Read_only{"Plic. Pending bits."};
+  } else {
+    throw Errors::Illegal_addr{addr, "Plic. Write to unknown register."};
+  }
+  update_irq();
+}
+
+Uxlen Plic::read(std::size_t addr, unsigned int byte_en) {
+  assert((byte_en == 0xf) && "only word access is supported");
+  if (addr < PRIORITY + 4 * sources_number) {
+    return m_priority[addr / 4];
+  } else if (addr == PENDING) {
+    return get_pending();
+  } else if (addr == ENABLE) {
+    return m_enable;
+  } else if (addr == THRESHOLD) {
+    return m_threshold;
+  } else if (addr == CLAIM) {
+    const unsigned int source{claim()};
+    update_irq();
+    return source;
+  }
+  throw Errors::Illegal_addr{addr, "Plic. Read from unknown register."};
+}
+
+void Plic::set_level(unsigned int source, bool level) {
+  assert_legal_source(source);
+  const Bits mask{Bits{1} << source};
+  if (level) m_level |=  mask;
+  else       m_level &= ~mask;
+  update_irq();
+}
+
+unsigned int Plic::claim() {
+  const Bits candidates{get_pending() & m_enable};
+  unsigned int best_source{0};
+  Uxlen best_priority{0};
+  for (unsigned int source{1}; source < sources_number; ++source) {
+    if (extract_bits(candidates, source) && (m_priority[source] > best_priority)) {
+      best_source   = source;
+      best_priority = m_priority[source];
+    }
+  }
+  if (best_source != 0) m_claimed |= Bits{1} << best_source;
+  return best_source;
+}
+
+void Plic::complete(unsigned int source) {
+  if ((source == 0) || (source >= sources_number)) return;
+  m_claimed &= ~(Bits{1} << source);
+}
+
+void Plic::update_irq() {
+  // Each writer bumps the version after changing the state. Whoever writes meip last saw
+  // no newer version after writing it, so the final value is never computed from stale
+  // state: any change made since was followed by its writer's own update.
+  std::uint64_t version{++m_version};
+  for (;;) {
+    const Bits candidates{m_level & ~m_claimed & m_enable};
+    bool meip{false};
+    for (unsigned int source{1}; source < sources_number; ++source) {
+      if (extract_bits(candidates, source) && (m_priority[source] > m_threshold)) {
+        meip = true;
+        break;
+      }
+    }
+    m_irq_pending.set(Irq::MEI, meip);
+    const std::uint64_t latest{m_version};
+    if (latest == version) break;
+    version = latest;
+  }
+}
@@ -0,0 +1,127 @@
+#include "pmp.hpp"
+
+#include <bit>
+#include <cassert>
+#include <limits>
+
+namespace {
+  // pmpaddr holds bits 55:2 of the address on RV64 and 33:2 on RV32.
+  template <unsigned int xlen>
+  constexpr Uxlen_t<xlen> addr_mask{(xlen == 32) ? ~Uxlen_t<xlen>{0} :
+      static_cast<Uxlen_t<xlen>>((std::uint64_t{1} << 54) - 1)};
+
+  [[nodiscard]] Pmp_base::Mode get_mode(std::uint8_t cfg) {
+    return static_cast<Pmp_base::Mode>((cfg & Pmp_base::CFG_A) >> 3);
+  }
+}
+
+template <unsigned int xlen>
+void Basic_pmp<xlen>::set_cfg(std::size_t entry, std::uint8_t cfg) {
+  if (is_locked(entry)) return;
+  cfg &= CFG_R | CFG_W | CFG_X | CFG_A | CFG_L;
+  // W without R is reserved.
+  if (!(cfg & CFG_R)) cfg &= static_cast<std::uint8_t>(~CFG_W);
+  m_cfg.at(entry) = cfg;
+  update();
+}
+
+template <unsigned int xlen>
+void Basic_pmp<xlen>::set_addr(std::size_t entry, Data addr) {
+  if (is_locked(entry)) return;
+  const std::size_t next{entry + 1};
+  if ((next < entries) && is_locked(next) && (get_mode(m_cfg[next]) == Mode::tor)) return;
+  m_addr.at(entry) = addr & addr_mask<xlen>;
+  update();
+}
+
+template <unsigned int xlen>
+void Basic_pmp<xlen>::update() {
+  for (std::size_t i{0}; i < entries; ++i) {
+    const std::uint64_t addr{m_addr[i]};
+    Region &region{m_regions[i]};
+    switch (get_mode(m_cfg[i])) {
+      case Mode::off:
+        region = {};
+        break;
+      case Mode::tor:
+        region = {(i == 0) ? 0 : std::uint64_t{m_addr[i - 1]} << 2, addr << 2};
+        break;
+      case Mode::na4:
+        region = {addr << 2, (addr << 2) + 4};
+        break;
+      // The trailing ones of the address give the size: 8 bytes for none and doubled for
+      // each one.
+      case Mode::napot: {
+        const auto ones{static_cast<unsigned int>(std::countr_one(addr))};
+        if (ones + 3 >= std::numeric_limits<std::uint64_t>::digits) {
+          region = {0, std::numeric_limits<std::uint64_t>::max()};
+        } else {
+          const std::uint64_t begin{(addr >> (ones + 1)) << (ones + 3)};
+          region = {begin, begin + (std::uint64_t{1} << (ones + 3))};
+        }
+        break;
+      }
+      default: assert(0 && "Unknown pmp mode");
+    }
+  }
+  m_cache.fill({});
+}
+
+template <unsigned int xlen>
+auto Basic_pmp<xlen>::get_allowed(std::size_t entry) const -> Allowed {
+  const std::uint8_t cfg{m_cfg[entry]};
+  const Allowed allowed{static_cast<Allowed>(
+      ((cfg & CFG_X) ? 1u << get_bit(Access::fetch, false) : 0u) |
+      ((cfg & CFG_R) ? 1u << get_bit(Access::load , false) : 0u) |
+      ((cfg & CFG_W) ? 1u << get_bit(Access::store, false) : 0u))};
+  // Unlocked entries don't apply to M-mode.
+  return allowed | static_cast<Allowed>((is_locked(entry) ? allowed : all_allowed) << 3);
+}
+
+// The entry with the lowest number matching a byte decides for it, so the first entry
+// overlapping the page decides for all of it if it covers all of it.
+template <unsigned int xlen>
+auto Basic_pmp<xlen>::decide(std::size_t page) const -> Cache_entry {
+  const std::uint64_t begin{std::uint64_t{page} * page_size};
+  const std::uint64_t end{begin + page_size};
+  for (std::size_t i{0}; i < entries; ++i) {
+    const Region &region{m_regions[i]};
+    if ((region.begin >= region.end) || (region.end <= begin) || (region.begin >= end)) continue;
+    if ((region.begin <= begin) && (region.end >= end)) {
+      return {.page = page, .partial = false, .allowed = get_allowed(i)};
+    }
+    return {.page = page, .partial = true, .allowed = 0};
+  }
+  // Without a matching entry only M-mode may access.
+  return {.page = page, .partial = false, .allowed = all_allowed << 3};
+}
+
+template <unsigned int xlen>
+bool Basic_pmp<xlen>::is_allowed_slow(std::size_t addr, std::size_t size, Access access,
+    bool machine) {
+  const std::size_t page{addr / page_size};
+  if ((addr + size - 1) / page_size == page) {
+    Cache_entry &entry{m_cache[page % cache_entries]};
+    if (entry.page != page) entry = decide(page);
+    if (!entry.partial) {
+      return (static_cast<unsigned int>(entry.allowed) >> get_bit(access, machine)) & 1u;
+    }
+  }
+  return scan(addr, std::uint64_t{addr} + size, access, machine);
+}
+
+// An access matching an entry in part fails.
+template <unsigned int xlen>
+bool Basic_pmp<xlen>::scan(std::uint64_t begin, std::uint64_t end, Access access, bool machine) {
+  ++m_scans;
+  for (std::size_t i{0}; i < entries; ++i) {
+    const Region &region{m_regions[i]};
+    if ((region.begin >= region.end) || (region.end <= begin) || (region.begin >= end)) continue;
+    if ((region.begin > begin) || (region.end < end)) return false;
+    return (static_cast<unsigned int>(get_allowed(i)) >> get_bit(access, machine)) & 1u;
+  }
+  return machine;
+}
+
+template class Basic_pmp<32>;
+template class Basic_pmp<64>;
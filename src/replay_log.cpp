@@ -0,0 +1,195 @@
+#include "replay_log.hpp"
+
+#include "exception.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <string>
+
+namespace {
+  constexpr std::array<std::uint8_t, 5> magic{'R', 'V', 'R', 'L', 1};
+
+  // LEB128: 7 bits a byte, low bits first, the top bit set on all bytes but the last.
+  void put_varint(std::vector<std::uint8_t> &buffer, std::uint64_t value) {
+    while (value >= 0x80) {
+      buffer.push_back(static_cast<std::uint8_t>(value | 0x80));
+      value >>= 7;
+    }
+    buffer.push_back(static_cast<std::uint8_t>(value));
+  }
+
+  [[nodiscard]] std::uint64_t get_varint(const std::vector<std::uint8_t> &buffer,
+      std::size_t &pos) {
+    std::uint64_t value{0};
+    for (unsigned int shift{0}; (pos < buffer.size()) && (shift < 64); shift += 7) {
+      const std::uint8_t byte{buffer[pos++]};
+      value |= std::uint64_t{byte & 0x7fu} << shift;
+      if (!(byte & 0x80)) return value;
+    }
+    throw Errors::Error{"Replay_log. Truncated log"};
+  }
+}
+
+Replay_log::Replay_log(Scheduler &scheduler, const std::string &path, Mode mode,
+    Time poll_interval)
+    : m_scheduler{scheduler}, m_mode{mode}, m_poll_interval{poll_interval} {
+  if (m_mode == Mode::replay) {
+    read_log(path);
+    // Which channels are inputs is known once the devices added them.
+    if (!m_entries.empty()) {
+      m_event = m_scheduler.schedule_at(m_entries.front().time, [this]() { dispatch(); });
+    }
+    return;
+  }
+  m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (m_fd < 0) throw Errors::Error{"Replay_log. Can't create " + path};
+  m_buffer.reserve(buffer_size);
+  m_buffer.assign(magic.begin(), magic.end());
+  m_last_time = m_scheduler.get_now();
+  m_event = m_scheduler.schedule_in(m_poll_interval, [this]() { poll(); });
+}
+
+Replay_log::~Replay_log() {
+  if (m_event) m_scheduler.cancel(*m_event);
+  if (m_fd < 0) return;
+  try {
+    flush();
+  } catch (const Errors::Error&) {
+    // Nothing to report it to.
+  }
+  ::close(m_fd);
+}
+
+Replay_log::Channel Replay_log::add_input(Apply apply) {
+  m_channels.push_back(std::move(apply));
+  m_next_read.push_back(0);
+  return static_cast<Channel>(m_channels.size() - 1);
+}
+
+Replay_log::Channel Replay_log::add_irq_line(Irq_pending &irq_pending, Irq::Cause cause) {
+  return add_input([&irq_pending, cause](std::uint64_t level) {
+    irq_pending.set(cause, level != 0);
+  });
+}
+
+Replay_log::Channel Replay_log::add_plic_source(Plic &plic, unsigned int source) {
+  return add_input([&plic, source](std::uint64_t level) { plic.set_level(source, level != 0); });
+}
+
+Replay_log::Channel Replay_log::add_reads() {
+  return add_input({});
+}
+
+void Replay_log::post(Channel channel, std::uint64_t data) {
+  if (is_replaying()) return;
+  const std::lock_guard lock{m_posted_mutex};
+  m_posted.emplace_back(channel, data);
+  m_has_posted.store(true, std::memory_order_release);
+}
+
+void Replay_log::deliver(Channel channel, std::uint64_t data) {
+  if (is_replaying()) return;
+  append(channel, data);
+  m_channels[channel](data);
+}
+
+void Replay_log::record(Channel channel, std::uint64_t data) {
+  append(channel, data);
+}
+
+std::uint64_t Replay_log::replay(Channel channel) {
+  std::size_t &next{m_next_read[channel]};
+  while ((next < m_entries.size()) && (m_entries[next].channel != channel)) ++next;
+  const Time now{m_scheduler.get_now()};
+  if ((next == m_entries.size()) || (m_entries[next].time != now)) {
+    throw Errors::Error{"Replay_log. Replay diverged at " + std::to_string(now)};
+  }
+  ++m_inputs_number;
+  return m_entries[next++].data;
+}
+
+void Replay_log::flush() {
+  std::size_t done{0};
+  while (done < m_buffer.size()) {
+    const ssize_t size{::write(m_fd, m_buffer.data() + done, m_buffer.size() - done)};
+    if ((size < 0) && (errno == EINTR)) continue;
+    if (size <= 0) throw Errors::Error{"Replay_log. Can't write the log"};
+    done += static_cast<std::size_t>(size);
+  }
+  m_buffer.clear();
+}
+
+void Replay_log::append(Channel channel, std::uint64_t data) {
+  const Time now{m_scheduler.get_now()};
+  put_varint(m_buffer, now - m_last_time);
+  put_varint(m_buffer, channel);
+  put_varint(m_buffer, data);
+  m_last_time = now;
+  ++m_inputs_number;
+  if (m_buffer.size() >= buffer_size) flush();
+}
+
+void Replay_log::poll() {
+  if (m_has_posted.exchange(false, std::memory_order_acquire)) {
+    std::vector<std::pair<Channel, std::uint64_t>> posted{};
+    {
+      const std::lock_guard lock{m_posted_mutex};
+      posted.swap(m_posted);
+    }
+    for (const auto &[channel, data] : posted) deliver(channel, data);
+  }
+  m_event = m_scheduler.schedule_in(m_poll_interval, [this]() { poll(); });
+}
+
+void Replay_log::read_log(const std::string &path) {
+  const int fd{::open(path.c_str(), O_RDONLY)};
+  if (fd < 0) throw Errors::Error{"Replay_log. Can't open " + path};
+  std::vector<std::uint8_t> log{};
+  std::array<std::uint8_t, 0x10000> chunk{};
+  ssize_t size{0};
+  do {
+    size = ::read(fd, chunk.data(), chunk.size());
+    if (size > 0) log.insert(log.end(), chunk.begin(), chunk.begin() + size);
+  } while ((size > 0) || ((size < 0) && (errno == EINTR)));
+  ::close(fd);
+  if (size < 0) throw Errors::Error{"Replay_log. Can't read " + path};
+  if ((log.size() < magic.size()) || !std::equal(magic.begin(), magic.end(), log.begin())) {
+    throw Errors::Error{"Replay_log. Not a log"};
+  }
+
+  Time time{m_scheduler.get_now()};
+  for (std::size_t pos{magic.size()}; pos < log.size();) {
+    time += get_varint(log, pos);
+    const auto channel{static_cast<Channel>(get_varint(log, pos))};
+    m_entries.push_back({.time = time, .channel = channel, .data = get_varint(log, pos)});
+  }
+}
+
+// Reads at the same time are left to `replay`.
+void Replay_log::dispatch() {
+  m_event.reset();
+  const Time now{m_scheduler.get_now()};
+  for (; (m_next < m_entries.size()) && (m_entries[m_next].time <= now); ++m_next) {
+    const Entry &entry{m_entries[m_next]};
+    if (entry.channel >= m_channels.size()) {
+      throw Errors::Error{"Replay_log. Input of a channel that wasn't added"};
+    }
+    if (!is_input(entry.channel)) continue;
+    ++m_inputs_number;
+    m_channels[entry.channel](entry.data);
+  }
+  schedule_dispatch();
+}
+
+void Replay_log::schedule_dispatch() {
+  while ((m_next < m_entries.size()) && (m_entries[m_next].channel < m_channels.size()) &&
+      !is_input(m_entries[m_next].channel)) {
+    ++m_next;
+  }
+  if (m_next == m_entries.size()) return;
+  m_event = m_scheduler.schedule_at(m_entries[m_next].time, [this]() { dispatch(); });
+}
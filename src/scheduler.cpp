@@ -0,0 +1,80 @@
+#include "scheduler.hpp"
+
+#include "exception.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+Scheduler::Event_id Scheduler::schedule_at(Time time, Callback callback) {
+  if (time < m_now) {
+    throw Errors::Error{"Scheduler. Event at " + std::to_string(time) + " is in the past, now: " +
+        std::to_string(m_now)};
+  }
+  const Event_id id{m_next_id++};
+  push({.time = time, .id = id, .callback = std::move(callback)});
+  return id;
+}
+
+void Scheduler::cancel(Event_id id) {
+  if (!m_queued.contains(id)) return;
+  m_cancelled.insert(id);
+  drop_cancelled();
+}
+
+void Scheduler::advance_to(Time time) {
+  assert((time >= m_now) && "Time goes backwards");
+  while (!m_heap.empty() && (m_heap.front().time <= time)) {
+    Event event{pop()};
+    m_now = event.time;
+    event.callback();
+    drop_cancelled();
+  }
+  m_now = time;
+}
+
+void Scheduler::push(Event event) {
+  m_queued.insert(event.id);
+  std::size_t pos{m_heap.size()};
+  m_heap.push_back(std::move(event));
+  while (pos > 0) {
+    const std::size_t parent{(pos - 1) / arity};
+    if (!(m_heap[pos] < m_heap[parent])) break;
+    std::swap(m_heap[pos], m_heap[parent]);
+    pos = parent;
+  }
+}
+
+Scheduler::Event Scheduler::pop() {
+  assert(!m_heap.empty());
+  Event top{std::move(m_heap.front())};
+  m_queued.erase(top.id);
+  if (m_heap.size() > 1) m_heap.front() = std::move(m_heap.back());
+  m_heap.pop_back();
+
+  std::size_t pos{0};
+  for (;;) {
+    const std::size_t first_child{pos * arity + 1};
+    if (first_child >= m_heap.size()) break;
+    const std::size_t last_child{std::min(first_child + arity, m_heap.size())};
+    std::size_t min_child{first_child};
+    for (std::size_t child{first_child + 1}; child < last_child; ++child) {
+      if (m_heap[child] < m_heap[min_child]) min_child = child;
+    }
+    if (!(m_heap[min_child] < m_heap[pos])) break;
+    std::swap(m_heap[pos], m_heap[min_child]);
+    pos = min_child;
+  }
+  return top;
+}
+
+// Cancelled events are removed lazily, but never left at the top, so the next deadline is
+// always exact.
+void Scheduler::drop_cancelled() {
+  while (!m_heap.empty()) {
+    const auto it{m_cancelled.find(m_heap.front().id)};
+    if (it == m_cancelled.end()) break;
+    m_cancelled.erase(it);
+    pop();
+  }
+}
@@ -0,0 +1,136 @@
+#include "semihosting.hpp"
+
+#include <algorithm>
+#include <array>
+#include <string>
+
+namespace {
+  enum Reg : std::size_t {
+    A0 = 10,
+    A1 = 11,
+  };
+
+  // Mode of SYS_OPEN, as fopen's: r, rb, r+, r+b, then w, a and their variants.
+  constexpr std::size_t open_modes_read{4};
+  constexpr std::size_t open_modes_write{8};
+  // Paths longer than that aren't the console.
+  constexpr std::size_t max_path{16};
+}
+
+template <unsigned int xlen>
+Basic_semihosting<xlen>::Basic_semihosting(Xmemory &rf, Xmemory &memory, Host_output &out,
+    Host_output &err)
+    : m_rf{rf}, m_memory{memory}, m_out{out}, m_err{err} {}
+
+template <unsigned int xlen>
+auto Basic_semihosting<xlen>::handle() -> std::optional<Data> {
+  const Data operation{m_rf.read(A0)};
+  const Data parameter{m_rf.read(A1)};
+  if ((operation != SYS_EXIT) && (operation != SYS_EXIT_EXTENDED)) {
+    m_rf.write(A0, call(operation, parameter));
+    return {};
+  }
+  // On RV32 the parameter of SYS_EXIT is the reason itself, with no exit code.
+  if ((xlen == 32) && (operation == SYS_EXIT)) {
+    exit(parameter, 0);
+  } else {
+    exit(get_field(parameter, 0), get_field(parameter, 1));
+  }
+  return m_exit_code;
+}
+
+template <unsigned int xlen>
+auto Basic_semihosting<xlen>::call(Data operation, Data parameter) -> Data {
+  constexpr auto error{static_cast<Data>(-1)};
+  switch (operation) {
+    case SYS_OPEN : return sys_open(parameter);
+    case SYS_CLOSE: {
+      const Data handle{get_field(parameter, 0)};
+      return (get_output(handle) || (handle == STDIN)) ? 0 : error;
+    }
+    case SYS_WRITEC: {
+      const char c{read_char(parameter)};
+      m_out.write(std::string_view{&c, 1});
+      return 0;
+    }
+    case SYS_WRITE0: {
+      std::string text{};
+      for (Data addr{parameter}; const char c{read_char(addr)}; ++addr) text.push_back(c);
+      m_out.write(text);
+      return 0;
+    }
+    case SYS_WRITE: return sys_write(parameter);
+    // Nothing was read: the end of the file.
+    case SYS_READ : return get_field(parameter, 2);
+    case SYS_CLOCK: {
+      const auto elapsed{std::chrono::steady_clock::now() - m_start};
+      return static_cast<Data>(
+          std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() / 10);
+    }
+    default: return error;
+  }
+}
+
+template <unsigned int xlen>
+auto Basic_semihosting<xlen>::get_field(Data block, std::size_t index) -> Data {
+  Data value{0};
+  m_memory.read_block(block + index * (xlen / 8), std::as_writable_bytes(std::span{&value, 1}));
+  return value;
+}
+
+template <unsigned int xlen>
+char Basic_semihosting<xlen>::read_char(Data addr) {
+  char c{};
+  m_memory.read_block(addr, std::as_writable_bytes(std::span{&c, 1}));
+  return c;
+}
+
+template <unsigned int xlen>
+Host_output* Basic_semihosting<xlen>::get_output(Data handle) {
+  switch (handle) {
+    case STDOUT: return &m_out;
+    case STDERR: return &m_err;
+    default: return nullptr;
+  }
+}
+
+// Parameters: the path, the mode and the length of the path.
+template <unsigned int xlen>
+auto Basic_semihosting<xlen>::sys_open(Data block) -> Data {
+  const Data path{get_field(block, 0)};
+  const Data mode{get_field(block, 1)};
+  const Data length{get_field(block, 2)};
+  std::array<char, max_path> name{};
+  if (length > name.size()) return static_cast<Data>(-1);
+  m_memory.read_block(path, std::as_writable_bytes(std::span{name}.first(length)));
+  if (std::string_view{name.data(), length} != ":tt") return static_cast<Data>(-1);
+  if (mode < open_modes_read) return STDIN;
+  return (mode < open_modes_write) ? STDOUT : STDERR;
+}
+
+// Parameters: the handle, the buffer and its length. Returns the bytes not written.
+template <unsigned int xlen>
+auto Basic_semihosting<xlen>::sys_write(Data block) -> Data {
+  Host_output *const output{get_output(get_field(block, 0))};
+  const Data buffer{get_field(block, 1)};
+  const Data length{get_field(block, 2)};
+  if (!output) return length;
+  std::array<std::byte, 256> chunk{};
+  for (Data done{0}; done < length; done += chunk.size()) {
+    const std::span<std::byte> data{std::span{chunk}.first(
+        std::min<std::size_t>(chunk.size(), length - done))};
+    m_memory.read_block(buffer + done, data);
+    output->write(data);
+  }
+  return 0;
+}
+
+template <unsigned int xlen>
+void Basic_semihosting<xlen>::exit(Data reason, Data subcode) {
+  m_out.flush();
+  m_err.flush();
+  m_exit_code = (reason == ADP_Stopped_ApplicationExit) ? subcode : 1;
+}
+
+template class Basic_semihosting<32>;
+template class Basic_semihosting<64>;
@@ -0,0 +1,126 @@
+#include "smp.hpp"
+
+#include "exception.hpp"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+
+template <unsigned int xlen>
+Basic_smp<xlen>::Basic_smp(std::size_t harts, Memory &instr_mem, Basic_memory<xlen> &data_mem,
+    std::shared_ptr<spdlog::logger> logger, Isa_ext_container isa_ext_container)
+    : m_reservations{harts} {
+  m_stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (m_stop_fd < 0) {
+    throw Errors::Error{std::string{"Smp. eventfd failed: "} + std::strerror(errno)};
+  }
+  for (std::size_t i{0}; i < harts; ++i) {
+    m_harts.push_back(std::make_unique<Hart>(i, instr_mem, data_mem, logger, isa_ext_container,
+        m_reservations));
+    // Before the pending word is shared with other threads.
+    static_cast<void>(m_harts.back()->irq_pending.enable_wakeup_fd());
+  }
+}
+
+template <unsigned int xlen>
+Basic_smp<xlen>::~Basic_smp() {
+  if (m_stop_fd >= 0) close(m_stop_fd);
+}
+
+template <unsigned int xlen>
+std::vector<Irq_pending*> Basic_smp<xlen>::get_irq_pendings() {
+  std::vector<Irq_pending*> irq_pendings{};
+  for (const std::unique_ptr<Hart> &hart : m_harts) irq_pendings.push_back(&hart->irq_pending);
+  return irq_pendings;
+}
+
+template <unsigned int xlen>
+void Basic_smp<xlen>::run(std::uint64_t instructions) {
+  m_stop.store(false);
+  std::uint64_t count{0};
+  [[maybe_unused]] const auto drained{::read(m_stop_fd, &count, sizeof(count))};
+
+  std::exception_ptr error{};
+  std::mutex error_mutex{};
+  {
+    std::vector<std::jthread> threads{};
+    for (const std::unique_ptr<Hart> &hart : m_harts) {
+      threads.emplace_back([this, &hart = *hart, instructions, &error, &error_mutex]() {
+        try {
+          run_hart(hart, instructions);
+        } catch (...) {
+          const std::scoped_lock lock{error_mutex};
+          if (!error) error = std::current_exception();
+          stop();
+        }
+      });
+    }
+  }
+  if (error) std::rethrow_exception(error);
+}
+
+template <unsigned int xlen>
+void Basic_smp<xlen>::stop() {
+  m_stop.store(true);
+  const std::uint64_t one{1};
+  [[maybe_unused]] const auto written{::write(m_stop_fd, &one, sizeof(one))};
+}
+
+template <unsigned int xlen>
+void Basic_smp<xlen>::run_hart(Hart &hart, std::uint64_t instructions) {
+  Basic_core<xlen> &core{hart.core};
+  std::uint64_t executed{0};
+  while ((executed < instructions) && !m_stop.load(std::memory_order_relaxed)) {
+    // Nothing wakes a hart whose guest exited, so it leaves the others running on.
+    if (core.is_halted()) break;
+    // Stopped for a debugger, which expects every hart to stop with it.
+    if (core.is_stopped()) {
+      stop();
+      break;
+    }
+    if (core.is_polling()) {
+      std::this_thread::yield();
+      core.wake();
+    }
+    if (!core.is_waiting()) {
+      core.cycle();
+      ++executed;
+      continue;
+    }
+    // Resumes and executes an instruction if an enabled interrupt is already pending.
+    core.cycle();
+    if (core.is_waiting()) {
+      sleep(hart);
+    } else {
+      ++executed;
+    }
+  }
+}
+
+// The eventfd of the pending word counts rising lines, so one raised between the check in
+// `cycle` and `poll` isn't missed.
+template <unsigned int xlen>
+void Basic_smp<xlen>::sleep(Hart &hart) const {
+  const int irq_fd{hart.irq_pending.enable_wakeup_fd()};
+  pollfd fds[]{
+    {.fd = irq_fd   , .events = POLLIN, .revents = 0},
+    {.fd = m_stop_fd, .events = POLLIN, .revents = 0},
+  };
+  if ((::poll(fds, 2, -1) < 0) && (errno != EINTR)) {
+    throw Errors::Error{std::string{"Smp. poll failed: "} + std::strerror(errno)};
+  }
+  if (fds[0].revents & POLLIN) {
+    std::uint64_t count{0};
+    [[maybe_unused]] const auto drained{::read(irq_fd, &count, sizeof(count))};
+  }
+}
+
+template class Basic_smp<32>;
+template class Basic_smp<64>;
@@ -0,0 +1,202 @@
+#include "uart16550.hpp"
+
+#include "exception.hpp"
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+Uart16550::Uart16550(Scheduler &scheduler, const Config &config, Plic *plic,
+    unsigned int irq_source, Replay_log *replay_log)
+    : m_scheduler{scheduler}, m_config{config}, m_plic{plic}, m_irq_source{irq_source},
+      m_replay_log{replay_log} {
+  switch (m_config.tx_mode) {
+    case Tx_mode::line:
+      m_line_output = std::make_unique<Host_output>(m_config.tx_fd, m_config.tx_buffer);
+      break;
+    case Tx_mode::thread:
+      m_thread_output = std::make_unique<Async_host_output>(m_config.tx_fd, m_config.tx_buffer);
+      break;
+    case Tx_mode::discard: break;
+    default: assert(0 && "Unknown uart tx mode");
+  }
+  if (m_replay_log) {
+    m_rx_channel = m_replay_log->add_input([this](std::uint64_t c) {
+      push_rx(static_cast<char>(c));
+      update_irq();
+    });
+  }
+  if ((m_config.rx_fd >= 0) && !(m_replay_log && m_replay_log->is_replaying())) {
+    m_poll_event = m_scheduler.schedule_in(m_config.rx_poll_interval, [this]() { poll_rx(); });
+  }
+}
+
+Uart16550::~Uart16550() {
+  if (m_flush_event) m_scheduler.cancel(*m_flush_event);
+  if (m_poll_event ) m_scheduler.cancel(*m_poll_event);
+}
+
+// Each enabled lane holding a register is an access of its own.
+void Uart16550::write(std::size_t addr, Uxlen data, unsigned int byte_en) {
+  const std::size_t spacing_mask{(std::size_t{1} << m_config.reg_shift) - 1};
+  for (unsigned int lane{0}; lane < 4; ++lane) {
+    const std::size_t offset{addr + lane};
+    if (!((byte_en >> lane) & 1u) || (offset & spacing_mask)) continue;
+    write_reg(offset >> m_config.reg_shift, static_cast<std::uint8_t>(data >> (8 * lane)));
+  }
+}
+
+Uxlen Uart16550::read(std::size_t addr, unsigned int byte_en) {
+  const std::size_t spacing_mask{(std::size_t{1} << m_config.reg_shift) - 1};
+  Uxlen data{0};
+  for (unsigned int lane{0}; lane < 4; ++lane) {
+    const std::size_t offset{addr + lane};
+    if (!((byte_en >> lane) & 1u) || (offset & spacing_mask)) continue;
+    data |= Uxlen{read_reg(offset >> m_config.reg_shift)} << (8 * lane);
+  }
+  return data;
+}
+
+void Uart16550::receive(std::string_view input) {
+  if (m_replay_log) {
+    for (const char c : input) m_replay_log->deliver(m_rx_channel, static_cast<unsigned char>(c));
+    return;
+  }
+  for (const char c : input) push_rx(c);
+  update_irq();
+}
+
+void Uart16550::flush() {
+  if (m_line_output  ) m_line_output->flush();
+  if (m_thread_output) m_thread_output->flush();
+}
+
+void Uart16550::write_reg(std::size_t reg, std::uint8_t data) {
+  const bool dlab{(m_lcr & LCR_DLAB) != 0};
+  switch (reg) {
+    case THR:
+      if (dlab) {
+        m_dll = data;
+        return;
+      }
+      transmit(static_cast<char>(data));
+      if (m_ier & IER_ETBEI) m_thre_pending = true;
+      break;
+    case IER:
+      if (dlab) {
+        m_dlm = data;
+        return;
+      }
+      // Enabling it raises the interrupt, THR being empty.
+      if ((data & IER_ETBEI) && !(m_ier & IER_ETBEI)) m_thre_pending = true;
+      m_ier = data & (IER_ERBFI | IER_ETBEI);
+      break;
+    case FCR:
+      m_fifos_enabled = data & FCR_FIFO_EN;
+      if (data & FCR_RX_RESET) m_rx_fifo.clear();
+      break;
+    case LCR: m_lcr = data; return;
+    case MCR: m_mcr = data; return;
+    case SCR: m_scr = data; return;
+    case LSR:
+    case MSR: return;
+    default: throw Errors::Illegal_addr{reg, "Uart16550. Write to unknown register."};
+  }
+  update_irq();
+}
+
+std::uint8_t Uart16550::read_reg(std::size_t reg) {
+  const bool dlab{(m_lcr & LCR_DLAB) != 0};
+  switch (reg) {
+    case RBR: {
+      if (dlab) return m_dll;
+      if (m_rx_fifo.empty()) return 0;
+      const char c{m_rx_fifo.front()};
+      m_rx_fifo.pop_front();
+      update_irq();
+      return static_cast<std::uint8_t>(c);
+    }
+    case IER: return dlab ? m_dlm : m_ier;
+    case IIR: {
+      const std::uint8_t iir{get_iir()};
+      if ((iir & 0x0f) == IIR_THRE) {
+        m_thre_pending = false;
+        update_irq();
+      }
+      return iir;
+    }
+    case LCR: return m_lcr;
+    case MCR: return m_mcr;
+    case LSR: {
+      std::uint8_t lsr{LSR_THRE | LSR_TEMT};
+      if (!m_rx_fifo.empty()) lsr |= LSR_DR;
+      if (m_overrun         ) lsr |= LSR_OE;
+      m_overrun = false;
+      return lsr;
+    }
+    case MSR: return MSR_CONNECTED;
+    case SCR: return m_scr;
+    default: throw Errors::Illegal_addr{reg, "Uart16550. Read from unknown register."};
+  }
+}
+
+// Received data comes before THR empty.
+std::uint8_t Uart16550::get_iir() const {
+  const std::uint8_t fifos{m_fifos_enabled ? std::uint8_t{IIR_FIFOS} : std::uint8_t{0}};
+  if ((m_ier & IER_ERBFI) && !m_rx_fifo.empty()) return fifos | IIR_RX_DATA;
+  if ((m_ier & IER_ETBEI) && m_thre_pending    ) return fifos | IIR_THRE;
+  return fifos | IIR_NO_IRQ;
+}
+
+void Uart16550::transmit(char c) {
+  ++m_tx_bytes;
+  if (m_mcr & MCR_LOOPBACK) {
+    push_rx(c);
+    return;
+  }
+  switch (m_config.tx_mode) {
+    case Tx_mode::line:
+      m_line_output->write(std::string_view{&c, 1});
+      if (c == '\n') {
+        m_line_output->flush();
+      } else if (!m_flush_event) {
+        m_flush_event = m_scheduler.schedule_in(m_config.tx_flush_delay, [this]() {
+          m_flush_event.reset();
+          m_line_output->flush();
+        });
+      }
+      return;
+    case Tx_mode::thread : m_thread_output->write(std::string_view{&c, 1}); return;
+    case Tx_mode::discard: return;
+    default: assert(0 && "Unknown uart tx mode");
+  }
+}
+
+void Uart16550::push_rx(char c) {
+  if (m_rx_fifo.size() < fifo_depth) m_rx_fifo.push_back(c);
+  else                               m_overrun = true;
+}
+
+// Takes only what fits, so the rest waits on the host side rather than overrunning. Stops
+// at the end of the file.
+void Uart16550::poll_rx() {
+  m_poll_event.reset();
+  const std::size_t room{fifo_depth - m_rx_fifo.size()};
+  if (room > 0) {
+    pollfd fd{.fd = m_config.rx_fd, .events = POLLIN, .revents = 0};
+    if ((::poll(&fd, 1, 0) > 0) && (fd.revents & (POLLIN | POLLHUP))) {
+      char buffer[fifo_depth]{};
+      const ssize_t size{::read(m_config.rx_fd, buffer, room)};
+      if (size == 0) return;
+      if ((size < 0) && (errno != EINTR) && (errno != EAGAIN)) return;
+      if (size > 0) receive({buffer, static_cast<std::size_t>(size)});
+    }
+  }
+  m_poll_event = m_scheduler.schedule_in(m_config.rx_poll_interval, [this]() { poll_rx(); });
+}
+
+void Uart16550::update_irq() {
+  if (!m_plic) return;
+  m_plic->set_level(m_irq_source, (get_iir() & 0x0f) != IIR_NO_IRQ);
+}
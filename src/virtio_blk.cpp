@@ -0,0 +1,298 @@
+#include "virtio_blk.hpp"
+
+#include "exception.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <numeric>
+
+namespace {
+  constexpr std::uint32_t version{2};
+  constexpr std::uint32_t vendor_id{0x554d4551};
+  constexpr char device_id[]{"riscv-emu-virtio-blk"};
+  constexpr std::size_t device_id_size{20};
+}
+
+template <unsigned int xlen>
+Basic_virtio_blk<xlen>::Basic_virtio_blk(Basic_memory<xlen> &dma, const std::string &image_path,
+    bool read_only, Plic &plic, unsigned int irq_source)
+    : m_dma{dma}, m_read_only{read_only}, m_plic{plic}, m_irq_source{irq_source} {
+  m_fd = ::open(image_path.c_str(), read_only ? O_RDONLY : O_RDWR);
+  if (m_fd < 0) throw Errors::Error{"Virtio_blk. Can't open " + image_path};
+  struct stat st{};
+  const std::size_t size{(::fstat(m_fd, &st) == 0) ?
+      static_cast<std::size_t>(st.st_size) / sector_size * sector_size : 0};
+  void *const image{(size == 0) ? MAP_FAILED : ::mmap(nullptr, size,
+      read_only ? PROT_READ : (PROT_READ | PROT_WRITE), MAP_SHARED, m_fd, 0)};
+  if (image == MAP_FAILED) {
+    ::close(m_fd);
+    throw Errors::Error{"Virtio_blk. Can't map " + image_path};
+  }
+  m_image = {static_cast<std::byte*>(image), size};
+}
+
+template <unsigned int xlen>
+Basic_virtio_blk<xlen>::~Basic_virtio_blk() {
+  ::munmap(m_image.data(), m_image.size());
+  ::close(m_fd);
+}
+
+template <unsigned int xlen>
+void Basic_virtio_blk<xlen>::write(std::size_t addr, Uxlen data, unsigned int /*byte_en*/) {
+  const bool queue{m_queue_sel == 0};
+  const auto set_low  = [data](std::uint64_t &reg) { reg = (reg & ~0xffffffffull) | data; };
+  const auto set_high = [data](std::uint64_t &reg) {
+    reg = (reg & 0xffffffffull) | (std::uint64_t{data} << 32);
+  };
+  switch (addr) {
+    case DEVICE_FEATURES_SEL: m_device_features_sel = data; return;
+    case DRIVER_FEATURES    :
+      if      (m_driver_features_sel == 0) set_low (m_driver_features);
+      else if (m_driver_features_sel == 1) set_high(m_driver_features);
+      return;
+    case DRIVER_FEATURES_SEL: m_driver_features_sel = data; return;
+    case QUEUE_SEL          : m_queue_sel = data; return;
+    case QUEUE_NUM          :
+      if (queue && (data > 0) && (data <= queue_num_max)) m_queue_num = data;
+      return;
+    case QUEUE_READY        : if (queue) m_queue_ready = data & 1; return;
+    case QUEUE_NOTIFY       : if (data == 0) process_queue(); return;
+    case INTERRUPT_ACK      :
+      m_interrupt_status &= ~data;
+      update_irq();
+      return;
+    case STATUS             :
+      if (data == 0) reset();
+      else           m_status = data;
+      return;
+    case QUEUE_DESC_LOW     : if (queue) set_low (m_desc ); return;
+    case QUEUE_DESC_HIGH    : if (queue) set_high(m_desc ); return;
+    case QUEUE_DRIVER_LOW   : if (queue) set_low (m_avail); return;
+    case QUEUE_DRIVER_HIGH  : if (queue) set_high(m_avail); return;
+    case QUEUE_DEVICE_LOW   : if (queue) set_low (m_used ); return;
+    case QUEUE_DEVICE_HIGH  : if (queue) set_high(m_used ); return;
+    default:
+      // The configuration is read-only.
+      if (addr >= CONFIG) return;
+      throw Errors::Illegal_addr{addr, "Virtio_blk. Write to unknown register."};
+  }
+}
+
+// Configuration fields narrower than a word are read from their lanes of it.
+template <unsigned int xlen>
+Uxlen Basic_virtio_blk<xlen>::read(std::size_t addr, unsigned int /*byte_en*/) {
+  switch (addr) {
+    case MAGIC_VALUE      : return magic;
+    case VERSION          : return version;
+    case DEVICE_ID        : return block_device;
+    case VENDOR_ID        : return vendor_id;
+    case DEVICE_FEATURES  :
+      return (m_device_features_sel < 2) ?
+          static_cast<Uxlen>(get_features() >> (32 * m_device_features_sel)) : 0;
+    case QUEUE_NUM_MAX    : return (m_queue_sel == 0) ? queue_num_max : 0;
+    case QUEUE_READY      : return (m_queue_sel == 0) && m_queue_ready;
+    case INTERRUPT_STATUS : return m_interrupt_status;
+    case STATUS           : return m_status;
+    case CONFIG_GENERATION: return 0;
+    case CONFIG           : return static_cast<Uxlen>(get_capacity());
+    case CONFIG + 4       : return static_cast<Uxlen>(get_capacity() >> 32);
+    case CONFIG_BLK_SIZE  : return sector_size;
+    default:
+      if (addr >= CONFIG) return 0;
+      throw Errors::Illegal_addr{addr, "Virtio_blk. Read from unknown register."};
+  }
+}
+
+template <unsigned int xlen>
+std::uint64_t Basic_virtio_blk<xlen>::get_features() const {
+  return F_VERSION_1 | F_FLUSH | F_BLK_SIZE | (m_read_only ? F_RO : 0);
+}
+
+template <unsigned int xlen>
+void Basic_virtio_blk<xlen>::reset() {
+  m_status = 0;
+  m_interrupt_status = 0;
+  m_device_features_sel = 0;
+  m_driver_features_sel = 0;
+  m_driver_features = 0;
+  m_queue_sel = 0;
+  m_queue_num = 0;
+  m_queue_ready = false;
+  m_desc  = 0;
+  m_avail = 0;
+  m_used  = 0;
+  m_last_avail = 0;
+  m_used_idx = 0;
+  update_irq();
+}
+
+// Serves every request the driver made available since the last notification, then raises
+// a single interrupt unless the driver suppressed it.
+template <unsigned int xlen>
+void Basic_virtio_blk<xlen>::process_queue() {
+  if (!m_queue_ready || (m_queue_num == 0) || (m_status & STATUS_NEEDS_RESET)) return;
+  try {
+    const auto avail_idx{load<std::uint16_t>(m_avail + 2)};
+    if (m_last_avail == avail_idx) return;
+    for (; m_last_avail != avail_idx; ++m_last_avail) {
+      const auto head{load<std::uint16_t>(m_avail + 4 + 2 * (m_last_avail % m_queue_num))};
+      const std::uint32_t written{serve(head)};
+      const std::uint64_t used_elem{m_used + 4 + 8 * (m_used_idx % m_queue_num)};
+      store<std::uint32_t>(used_elem, head);
+      store<std::uint32_t>(used_elem + 4, written);
+      store<std::uint16_t>(m_used + 2, ++m_used_idx);
+      ++m_requests;
+    }
+    if (!(load<std::uint16_t>(m_avail) & AVAIL_F_NO_INTERRUPT)) {
+      m_interrupt_status |= INTERRUPT_USED_BUFFER;
+    }
+  } catch (const Errors::Error&) {
+    m_status |= STATUS_NEEDS_RESET;
+    m_interrupt_status |= INTERRUPT_CONFIG_CHANGE;
+  }
+  update_irq();
+}
+
+// The header and the data to write come first in the device-readable buffers, the data
+// read and the status byte last in the device-writable ones, however the driver splits
+// them into descriptors.
+template <unsigned int xlen>
+std::uint32_t Basic_virtio_blk<xlen>::serve(std::uint16_t head) {
+  read_chain(head);
+  const auto sum = [](const std::vector<Segment> &segments) {
+    return std::accumulate(segments.begin(), segments.end(), std::uint64_t{0},
+        [](std::uint64_t size, const Segment &segment) { return size + segment.len; });
+  };
+  const std::uint64_t readable{sum(m_readable)};
+  const std::uint64_t writable{sum(m_writable)};
+  if ((readable < header_size) || (writable < 1)) {
+    throw Errors::Error{"Virtio_blk. Request without a header or a status"};
+  }
+
+  std::array<std::byte, header_size> header{};
+  copy_from_guest(m_readable, 0, header);
+  std::uint32_t type{0};
+  std::uint64_t sector{0};
+  std::memcpy(&type, header.data(), sizeof(type));
+  std::memcpy(&sector, header.data() + 8, sizeof(sector));
+
+  const std::uint64_t data_size{(type == T_OUT) ? readable - header_size : writable - 1};
+  const Request_status status{execute(type, sector, data_size)};
+  copy_to_guest(m_writable, writable - 1, std::as_bytes(std::span{&status, 1}));
+  const std::uint64_t data_written{((type == T_IN) || (type == T_GET_ID)) &&
+      (status == S_OK) ? data_size : 0};
+  return static_cast<std::uint32_t>(data_written + 1);
+}
+
+template <unsigned int xlen>
+auto Basic_virtio_blk<xlen>::execute(std::uint32_t type, std::uint64_t sector,
+    std::uint64_t data_size) -> Request_status {
+  const std::uint64_t offset{sector * sector_size};
+  const bool in_image{(sector < get_capacity()) && (data_size <= m_image.size() - offset)};
+  switch (type) {
+    case T_IN:
+      if (!in_image) return S_IOERR;
+      copy_to_guest(m_writable, 0, m_image.subspan(offset, data_size));
+      return S_OK;
+    case T_OUT:
+      if (m_read_only || !in_image) return S_IOERR;
+      copy_from_guest(m_readable, header_size, m_image.subspan(offset, data_size));
+      return S_OK;
+    case T_FLUSH:
+      if (m_read_only) return S_OK;
+      return (::msync(m_image.data(), m_image.size(), MS_SYNC) == 0) ? S_OK : S_IOERR;
+    case T_GET_ID: {
+      std::array<char, device_id_size> id{};
+      std::copy_n(device_id, std::min(sizeof(device_id) - 1, id.size()), id.begin());
+      copy_to_guest(m_writable, 0, std::as_bytes(std::span{id}.first(
+          static_cast<std::size_t>(std::min<std::uint64_t>(data_size, id.size())))));
+      return S_OK;
+    }
+    default: return S_UNSUPP;
+  }
+}
+
+// A chain longer than the queue has a loop.
+template <unsigned int xlen>
+void Basic_virtio_blk<xlen>::read_chain(std::uint16_t head) {
+  m_readable.clear();
+  m_writable.clear();
+  std::uint16_t index{head};
+  for (Uxlen i{0}; i < m_queue_num; ++i) {
+    if (index >= m_queue_num) throw Errors::Error{"Virtio_blk. Descriptor out of the queue"};
+    const std::uint64_t desc{m_desc + 16 * std::uint64_t{index}};
+    const Segment segment{.addr = load<std::uint64_t>(desc), .len = load<std::uint32_t>(desc + 8)};
+    const auto flags{load<std::uint16_t>(desc + 12)};
+    if (flags & DESC_F_WRITE) {
+      m_writable.push_back(segment);
+    } else {
+      if (!m_writable.empty()) throw Errors::Error{"Virtio_blk. Readable after writable"};
+      m_readable.push_back(segment);
+    }
+    if (!(flags & DESC_F_NEXT)) return;
+    index = load<std::uint16_t>(desc + 14);
+  }
+  throw Errors::Error{"Virtio_blk. Descriptor chain loops"};
+}
+
+template <unsigned int xlen>
+void Basic_virtio_blk<xlen>::copy_from_guest(const std::vector<Segment> &segments,
+    std::uint64_t offset, std::span<std::byte> data) {
+  for (const Segment &segment : segments) {
+    if (data.empty()) return;
+    if (offset >= segment.len) {
+      offset -= segment.len;
+      continue;
+    }
+    const auto size{static_cast<std::size_t>(std::min<std::uint64_t>(segment.len - offset,
+        data.size()))};
+    m_dma.read_block(static_cast<std::size_t>(segment.addr + offset), data.first(size));
+    data = data.subspan(size);
+    offset = 0;
+  }
+}
+
+template <unsigned int xlen>
+void Basic_virtio_blk<xlen>::copy_to_guest(const std::vector<Segment> &segments,
+    std::uint64_t offset, std::span<const std::byte> data) {
+  for (const Segment &segment : segments) {
+    if (data.empty()) return;
+    if (offset >= segment.len) {
+      offset -= segment.len;
+      continue;
+    }
+    const auto size{static_cast<std::size_t>(std::min<std::uint64_t>(segment.len - offset,
+        data.size()))};
+    m_dma.write_block(static_cast<std::size_t>(segment.addr + offset), data.first(size));
+    data = data.subspan(size);
+    offset = 0;
+  }
+}
+
+template <unsigned int xlen>
+template <typename T>
+T Basic_virtio_blk<xlen>::load(std::uint64_t addr) {
+  T value{};
+  m_dma.read_block(static_cast<std::size_t>(addr), std::as_writable_bytes(std::span{&value, 1}));
+  return value;
+}
+
+template <unsigned int xlen>
+template <typename T>
+void Basic_virtio_blk<xlen>::store(std::uint64_t addr, T value) {
+  m_dma.write_block(static_cast<std::size_t>(addr), std::as_bytes(std::span{&value, 1}));
+}
+
+template <unsigned int xlen>
+void Basic_virtio_blk<xlen>::update_irq() {
+  m_plic.set_level(m_irq_source, m_interrupt_status != 0);
+}
+
+template class Basic_virtio_blk<32>;
+template class Basic_virtio_blk<64>;
@@ -0,0 +1,518 @@
+#include "vpu.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include <cassert>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+  using enum Vpu::Op;
+  using Vpu::Op;
+
+  static_assert(std::endian::native == std::endian::little,
+      "Vector registers hold the elements in guest byte order");
+
+  template <typename T>
+  [[nodiscard]] T load(const std::byte *base, std::size_t i) {
+    T value;
+    std::memcpy(&value, base + i * sizeof(T), sizeof(T));
+    return value;
+  }
+
+  template <typename T>
+  void store(std::byte *base, std::size_t i, T value) {
+    std::memcpy(base + i * sizeof(T), &value, sizeof(T));
+  }
+
+  // For the high half of products.
+  template <typename T> struct Wider;
+  template <> struct Wider<std::uint8_t > { using U = std::uint16_t;     using S = std::int16_t; };
+  template <> struct Wider<std::uint16_t> { using U = std::uint32_t;     using S = std::int32_t; };
+  template <> struct Wider<std::uint32_t> { using U = std::uint64_t;     using S = std::int64_t; };
+  template <> struct Wider<std::uint64_t> { using U = unsigned __int128; using S = __int128;     };
+
+  template <typename T>
+  [[nodiscard("PURE FUN")]] T apply(Op op, T a, T b) {
+    using S  = std::make_signed_t<T>;
+    using WU = typename Wider<T>::U;
+    using WS = typename Wider<T>::S;
+    constexpr unsigned int bits{sizeof(T) * CHAR_BIT};
+    const unsigned int shamt{static_cast<unsigned int>(b) & (bits - 1)};
+    switch (op) {
+      case ADD   : return static_cast<T>(a + b);
+      case SUB   : return static_cast<T>(a - b);
+      case RSUB  : return static_cast<T>(b - a);
+      case AND   : return a & b;
+      case OR    : return a | b;
+      case XOR   : return a ^ b;
+      case MINU  : return std::min(a, b);
+      case MIN   : return (static_cast<S>(a) < static_cast<S>(b)) ? a : b;
+      case MAXU  : return std::max(a, b);
+      case MAX   : return (static_cast<S>(a) > static_cast<S>(b)) ? a : b;
+      case SLL   : return static_cast<T>(a << shamt);
+      case SRL   : return static_cast<T>(a >> shamt);
+      case SRA   : return static_cast<T>(static_cast<S>(a) >> shamt);
+      case MUL   : return static_cast<T>(WU{a} * WU{b});
+      case MULH  : return static_cast<T>((WS{static_cast<S>(a)} * WS{static_cast<S>(b)}) >> bits);
+      case MULHU : return static_cast<T>((WU{a} * WU{b}) >> bits);
+      case MULHSU: return static_cast<T>((WS{static_cast<S>(a)} * static_cast<WS>(b)) >> bits);
+      default: assert(0 && "Not an element-wise op");
+    }
+  }
+
+  template <typename T>
+  [[nodiscard("PURE FUN")]] bool compare(Op op, T a, T b) {
+    using S = std::make_signed_t<T>;
+    switch (op) {
+      case SEQ : return a == b;
+      case SNE : return a != b;
+      case SLTU: return a < b;
+      case SLT : return static_cast<S>(a) < static_cast<S>(b);
+      case SLEU: return a <= b;
+      case SLE : return static_cast<S>(a) <= static_cast<S>(b);
+      case SGTU: return a > b;
+      case SGT : return static_cast<S>(a) > static_cast<S>(b);
+      default: assert(0 && "Not a mask result");
+    }
+  }
+
+  [[nodiscard("PURE FUN")]] Op to_element_op(Op reduction) {
+    switch (reduction) {
+      case REDSUM : return ADD;
+      case REDAND : return AND;
+      case REDOR  : return OR;
+      case REDXOR : return XOR;
+      case REDMINU: return MINU;
+      case REDMIN : return MIN;
+      case REDMAXU: return MAXU;
+      case REDMAX : return MAX;
+      default: assert(0 && "Not a reduction");
+    }
+  }
+
+#if defined(__SSE2__)
+  // Bits 0, 2, 4... of `x` packed into the low half.
+  [[nodiscard("PURE FUN")]] constexpr std::uint32_t pack_even_bits(std::uint32_t x) {
+    x &= 0x5555'5555;
+    x = (x | (x >> 1)) & 0x3333'3333;
+    x = (x | (x >> 2)) & 0x0f0f'0f0f;
+    x = (x | (x >> 4)) & 0x00ff'00ff;
+    x = (x | (x >> 8)) & 0x0000'ffff;
+    return x;
+  }
+#endif
+
+#if defined(__AVX2__)
+  // One host vector and the lane-wise operations on it. Compares set every bit of the
+  // lanes where they hold.
+  struct Simd {
+    using Vec = __m256i;
+    static constexpr std::size_t bytes{32};
+
+    static Vec load (const std::byte *p) { return _mm256_loadu_si256(reinterpret_cast<const Vec*>(p)); }
+    static void store(std::byte *p, Vec v) { _mm256_storeu_si256(reinterpret_cast<Vec*>(p), v); }
+
+    static Vec bit_and(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+    static Vec bit_or (Vec a, Vec b) { return _mm256_or_si256 (a, b); }
+    static Vec bit_xor(Vec a, Vec b) { return _mm256_xor_si256(a, b); }
+    static Vec ones() { return _mm256_set1_epi32(-1); }
+
+    template <typename T> static Vec add(Vec a, Vec b) {
+      if      constexpr (sizeof(T) == 1) return _mm256_add_epi8 (a, b);
+      else if constexpr (sizeof(T) == 2) return _mm256_add_epi16(a, b);
+      else if constexpr (sizeof(T) == 4) return _mm256_add_epi32(a, b);
+      else                               return _mm256_add_epi64(a, b);
+    }
+    template <typename T> static Vec sub(Vec a, Vec b) {
+      if      constexpr (sizeof(T) == 1) return _mm256_sub_epi8 (a, b);
+      else if constexpr (sizeof(T) == 2) return _mm256_sub_epi16(a, b);
+      else if constexpr (sizeof(T) == 4) return _mm256_sub_epi32(a, b);
+      else                               return _mm256_sub_epi64(a, b);
+    }
+
+    template <typename T> static constexpr bool has_eq{true};
+    template <typename T> static Vec eq(Vec a, Vec b) {
+      if      constexpr (sizeof(T) == 1) return _mm256_cmpeq_epi8 (a, b);
+      else if constexpr (sizeof(T) == 2) return _mm256_cmpeq_epi16(a, b);
+      else if constexpr (sizeof(T) == 4) return _mm256_cmpeq_epi32(a, b);
+      else                               return _mm256_cmpeq_epi64(a, b);
+    }
+    // Signed.
+    template <typename T> static constexpr bool has_gt{true};
+    template <typename T> static Vec gt(Vec a, Vec b) {
+      if      constexpr (sizeof(T) == 1) return _mm256_cmpgt_epi8 (a, b);
+      else if constexpr (sizeof(T) == 2) return _mm256_cmpgt_epi16(a, b);
+      else if constexpr (sizeof(T) == 4) return _mm256_cmpgt_epi32(a, b);
+      else                               return _mm256_cmpgt_epi64(a, b);
+    }
+    template <typename T> static Vec sign_bits() {
+      if      constexpr (sizeof(T) == 1) return _mm256_set1_epi8 (std::numeric_limits<std::int8_t >::min());
+      else if constexpr (sizeof(T) == 2) return _mm256_set1_epi16(std::numeric_limits<std::int16_t>::min());
+      else if constexpr (sizeof(T) == 4) return _mm256_set1_epi32(std::numeric_limits<std::int32_t>::min());
+      else                               return _mm256_set1_epi64x(std::numeric_limits<std::int64_t>::min());
+    }
+
+    template <typename T, bool is_signed> static constexpr bool has_min_max{sizeof(T) < 8};
+    template <typename T, bool is_signed> static Vec min(Vec a, Vec b) {
+      if      constexpr (sizeof(T) == 1) return is_signed ? _mm256_min_epi8 (a, b) : _mm256_min_epu8 (a, b);
+      else if constexpr (sizeof(T) == 2) return is_signed ? _mm256_min_epi16(a, b) : _mm256_min_epu16(a, b);
+      else                               return is_signed ? _mm256_min_epi32(a, b) : _mm256_min_epu32(a, b);
+    }
+    template <typename T, bool is_signed> static Vec max(Vec a, Vec b) {
+      if      constexpr (sizeof(T) == 1) return is_signed ? _mm256_max_epi8 (a, b) : _mm256_max_epu8 (a, b);
+      else if constexpr (sizeof(T) == 2) return is_signed ? _mm256_max_epi16(a, b) : _mm256_max_epu16(a, b);
+      else                               return is_signed ? _mm256_max_epi32(a, b) : _mm256_max_epu32(a, b);
+    }
+
+    template <typename T> static constexpr bool has_mul{(sizeof(T) == 2) || (sizeof(T) == 4)};
+    template <typename T> static Vec mul(Vec a, Vec b) {
+      if constexpr (sizeof(T) == 2) return _mm256_mullo_epi16(a, b);
+      else                          return _mm256_mullo_epi32(a, b);
+    }
+
+    // The top bit of each lane.
+    template <typename T> static std::uint32_t get_lane_bits(Vec v) {
+      if constexpr (sizeof(T) == 1) {
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(v));
+      } else if constexpr (sizeof(T) == 2) {
+        return pack_even_bits(static_cast<std::uint32_t>(_mm256_movemask_epi8(v)) >> 1);
+      } else if constexpr (sizeof(T) == 4) {
+        return static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(v)));
+      } else {
+        return static_cast<std::uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(v)));
+      }
+    }
+  };
+#elif defined(__SSE2__)
+  // As above, on SSE2 with the additions of SSE4.1 and SSE4.2 where the build has them.
+  struct Simd {
+    using Vec = __m128i;
+    static constexpr std::size_t bytes{16};
+
+    static Vec load (const std::byte *p) { return _mm_loadu_si128(reinterpret_cast<const Vec*>(p)); }
+    static void store(std::byte *p, Vec v) { _mm_storeu_si128(reinterpret_cast<Vec*>(p), v); }
+
+    static Vec bit_and(Vec a, Vec b) { return _mm_and_si128(a, b); }
+    static Vec bit_or (Vec a, Vec b) { return _mm_or_si128 (a, b); }
+    static Vec bit_xor(Vec a, Vec b) { return _mm_xor_si128(a, b); }
+    static Vec ones() { return _mm_set1_epi32(-1); }
+
+    template <typename T> static Vec add(Vec a, Vec b) {
+      if      constexpr (sizeof(T) == 1) return _mm_add_epi8 (a, b);
+      else if constexpr (sizeof(T) == 2) return _mm_add_epi16(a, b);
+      else if constexpr (sizeof(T) == 4) return _mm_add_epi32(a, b);
+      else                               return _mm_add_epi64(a, b);
+    }
+    template <typename T> static Vec sub(Vec a, Vec b) {
+      if      constexpr (sizeof(T) == 1) return _mm_sub_epi8 (a, b);
+      else if constexpr (sizeof(T) == 2) return _mm_sub_epi16(a, b);
+      else if constexpr (sizeof(T) == 4) return _mm_sub_epi32(a, b);
+      else                               return _mm_sub_epi64(a, b);
+    }
+
+#if defined(__SSE4_1__)
+    template <typename T> static constexpr bool has_eq{true};
+#else
+    template <typename T> static constexpr bool has_eq{sizeof(T) < 8};
+#endif
+    template <typename T> static Vec eq(Vec a, Vec b) {
+      if      constexpr (sizeof(T) == 1) return _mm_cmpeq_epi8 (a, b);
+      else if constexpr (sizeof(T) == 2) return _mm_cmpeq_epi16(a, b);
+      else if constexpr (sizeof(T) == 4) return _mm_cmpeq_epi32(a, b);
+#if defined(__SSE4_1__)
+      else                               return _mm_cmpeq_epi64(a, b);
+#endif
+    }
+#if defined(__SSE4_2__)
+    template <typename T> static constexpr bool has_gt{true};
+#else
+    template <typename T> static constexpr bool has_gt{sizeof(T) < 8};
+#endif
+    template <typename T> static Vec gt(Vec a, Vec b) {
+      if      constexpr (sizeof(T) == 1) return _mm_cmpgt_epi8 (a, b);
+      else if constexpr (sizeof(T) == 2) return _mm_cmpgt_epi16(a, b);
+      else if constexpr (sizeof(T) == 4) return _mm_cmpgt_epi32(a, b);
+#if defined(__SSE4_2__)
+      else                               return _mm_cmpgt_epi64(a, b);
+#endif
+    }
+    template <typename T> static Vec sign_bits() {
+      if      constexpr (sizeof(T) == 1) return _mm_set1_epi8 (std::numeric_limits<std::int8_t >::min());
+      else if constexpr (sizeof(T) == 2) return _mm_set1_epi16(std::numeric_limits<std::int16_t>::min());
+      else if constexpr (sizeof(T) == 4) return _mm_set1_epi32(std::numeric_limits<std::int32_t>::min());
+      else                               return _mm_set1_epi64x(std::numeric_limits<std::int64_t>::min());
+    }
+
+#if defined(__SSE4_1__)
+    template <typename T, bool is_signed> static constexpr bool has_min_max{sizeof(T) < 8};
+#else
+    template <typename T, bool is_signed> static constexpr bool has_min_max{
+        ((sizeof(T) == 1) && !is_signed) || ((sizeof(T) == 2) && is_signed)};
+#endif
+    template <typename T, bool is_signed> static Vec min(Vec a, Vec b) {
+      if      constexpr ((sizeof(T) == 1) && !is_signed) return _mm_min_epu8 (a, b);
+      else if constexpr ((sizeof(T) == 2) &&  is_signed) return _mm_min_epi16(a, b);
+#if defined(__SSE4_1__)
+      else if constexpr (sizeof(T) == 1) return _mm_min_epi8 (a, b);
+      else if constexpr (sizeof(T) == 2) return _mm_min_epu16(a, b);
+      else if constexpr (is_signed     ) return _mm_min_epi32(a, b);
+      else                               return _mm_min_epu32(a, b);
+#endif
+    }
+    template <typename T, bool is_signed> static Vec max(Vec a, Vec b) {
+      if      constexpr ((sizeof(T) == 1) && !is_signed) return _mm_max_epu8 (a, b);
+      else if constexpr ((sizeof(T) == 2) &&  is_signed) return _mm_max_epi16(a, b);
+#if defined(__SSE4_1__)
+      else if constexpr (sizeof(T) == 1) return _mm_max_epi8 (a, b);
+      else if constexpr (sizeof(T) == 2) return _mm_max_epu16(a, b);
+      else if constexpr (is_signed     ) return _mm_max_epi32(a, b);
+      else                               return _mm_max_epu32(a, b);
+#endif
+    }
+
+#if defined(__SSE4_1__)
+    template <typename T> static constexpr bool has_mul{(sizeof(T) == 2) || (sizeof(T) == 4)};
+#else
+    template <typename T> static constexpr bool has_mul{sizeof(T) == 2};
+#endif
+    template <typename T> static Vec mul(Vec a, Vec b) {
+      if constexpr (sizeof(T) == 2) return _mm_mullo_epi16(a, b);
+#if defined(__SSE4_1__)
+      else                          return _mm_mullo_epi32(a, b);
+#endif
+    }
+
+    template <typename T> static std::uint32_t get_lane_bits(Vec v) {
+      if constexpr (sizeof(T) == 1) {
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(v));
+      } else if constexpr (sizeof(T) == 2) {
+        return pack_even_bits(static_cast<std::uint32_t>(_mm_movemask_epi8(v)) >> 1);
+      } else if constexpr (sizeof(T) == 4) {
+        return static_cast<std::uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(v)));
+      } else {
+        return static_cast<std::uint32_t>(_mm_movemask_pd(_mm_castsi128_pd(v)));
+      }
+    }
+  };
+#endif
+
+#if defined(__SSE2__)
+  template <Op op, typename T>
+  [[nodiscard("PURE FUN")]] constexpr bool has_simd() {
+    switch (op) {
+      case ADD: case SUB: case RSUB: case AND: case OR: case XOR:
+        return true;
+      case MINU: case MAXU:
+        return Simd::has_min_max<T, false>;
+      case MIN: case MAX:
+        return Simd::has_min_max<T, true>;
+      case MUL:
+        return Simd::has_mul<T>;
+      case SEQ: case SNE:
+        return Simd::has_eq<T>;
+      case SLTU: case SLT: case SLEU: case SLE: case SGTU: case SGT:
+        return Simd::has_gt<T>;
+      default:
+        return false;
+    }
+  }
+
+  // Unsigned compares are signed ones of the operands with their sign bits flipped.
+  template <Op op, typename T>
+  [[nodiscard("PURE FUN")]] Simd::Vec apply_simd(Simd::Vec a, Simd::Vec b) {
+    const auto flip = [](Simd::Vec v) { return Simd::bit_xor(v, Simd::sign_bits<T>()); };
+    if      constexpr (op == ADD ) return Simd::add<T>(a, b);
+    else if constexpr (op == SUB ) return Simd::sub<T>(a, b);
+    else if constexpr (op == RSUB) return Simd::sub<T>(b, a);
+    else if constexpr (op == AND ) return Simd::bit_and(a, b);
+    else if constexpr (op == OR  ) return Simd::bit_or (a, b);
+    else if constexpr (op == XOR ) return Simd::bit_xor(a, b);
+    else if constexpr (op == MINU) return Simd::min<T, false>(a, b);
+    else if constexpr (op == MIN ) return Simd::min<T, true >(a, b);
+    else if constexpr (op == MAXU) return Simd::max<T, false>(a, b);
+    else if constexpr (op == MAX ) return Simd::max<T, true >(a, b);
+    else if constexpr (op == MUL ) return Simd::mul<T>(a, b);
+    else if constexpr (op == SEQ ) return Simd::eq<T>(a, b);
+    else if constexpr (op == SNE ) return Simd::bit_xor(Simd::eq<T>(a, b), Simd::ones());
+    else if constexpr (op == SLTU) return Simd::gt<T>(flip(b), flip(a));
+    else if constexpr (op == SLT ) return Simd::gt<T>(b, a);
+    else if constexpr (op == SLEU) return Simd::bit_xor(Simd::gt<T>(flip(a), flip(b)), Simd::ones());
+    else if constexpr (op == SLE ) return Simd::bit_xor(Simd::gt<T>(a, b), Simd::ones());
+    else if constexpr (op == SGTU) return Simd::gt<T>(flip(a), flip(b));
+    else                           return Simd::gt<T>(a, b);
+  }
+#endif
+
+  template <Op op, typename T>
+  void binary_loop(std::size_t vl, std::byte *vd, const std::byte *vs2, const std::byte *vs1) {
+    std::size_t i{0};
+#if defined(__SSE2__)
+    if constexpr (has_simd<op, T>()) {
+      constexpr std::size_t lanes{Simd::bytes / sizeof(T)};
+      for (; i + lanes <= vl; i += lanes) {
+        const std::size_t offset{i * sizeof(T)};
+        Simd::store(vd + offset,
+            apply_simd<op, T>(Simd::load(vs2 + offset), Simd::load(vs1 + offset)));
+      }
+    }
+#endif
+    for (; i < vl; ++i) store<T>(vd, i, apply<T>(op, load<T>(vs2, i), load<T>(vs1, i)));
+  }
+
+  template <typename T>
+  void binary(Op op, std::size_t vl, std::byte *vd, const std::byte *vs2, const std::byte *vs1) {
+    switch (op) {
+      case ADD   : binary_loop<ADD   , T>(vl, vd, vs2, vs1); break;
+      case SUB   : binary_loop<SUB   , T>(vl, vd, vs2, vs1); break;
+      case RSUB  : binary_loop<RSUB  , T>(vl, vd, vs2, vs1); break;
+      case AND   : binary_loop<AND   , T>(vl, vd, vs2, vs1); break;
+      case OR    : binary_loop<OR    , T>(vl, vd, vs2, vs1); break;
+      case XOR   : binary_loop<XOR   , T>(vl, vd, vs2, vs1); break;
+      case MINU  : binary_loop<MINU  , T>(vl, vd, vs2, vs1); break;
+      case MIN   : binary_loop<MIN   , T>(vl, vd, vs2, vs1); break;
+      case MAXU  : binary_loop<MAXU  , T>(vl, vd, vs2, vs1); break;
+      case MAX   : binary_loop<MAX   , T>(vl, vd, vs2, vs1); break;
+      case SLL   : binary_loop<SLL   , T>(vl, vd, vs2, vs1); break;
+      case SRL   : binary_loop<SRL   , T>(vl, vd, vs2, vs1); break;
+      case SRA   : binary_loop<SRA   , T>(vl, vd, vs2, vs1); break;
+      case MUL   : binary_loop<MUL   , T>(vl, vd, vs2, vs1); break;
+      case MULH  : binary_loop<MULH  , T>(vl, vd, vs2, vs1); break;
+      case MULHU : binary_loop<MULHU , T>(vl, vd, vs2, vs1); break;
+      case MULHSU: binary_loop<MULHSU, T>(vl, vd, vs2, vs1); break;
+      default: assert(0 && "Not an element-wise op");
+    }
+  }
+
+  // VLMAX is at most VLEN, so a mask fits in these words.
+  using Mask_bits = std::array<std::uint64_t, Vpu::max_vlen / 64>;
+
+  // The host vectors never straddle a word: their lanes divide 64 and the loop starts at 0.
+  template <Op op, typename T>
+  void compare_loop(std::size_t vl, Mask_bits &bits, const std::byte *vs2, const std::byte *vs1) {
+    std::size_t i{0};
+#if defined(__SSE2__)
+    if constexpr (has_simd<op, T>()) {
+      constexpr std::size_t lanes{Simd::bytes / sizeof(T)};
+      for (; i + lanes <= vl; i += lanes) {
+        const std::size_t offset{i * sizeof(T)};
+        const std::uint64_t lane_bits{Simd::get_lane_bits<T>(
+            apply_simd<op, T>(Simd::load(vs2 + offset), Simd::load(vs1 + offset)))};
+        bits[i / 64] |= lane_bits << (i % 64);
+      }
+    }
+#endif
+    for (; i < vl; ++i) {
+      bits[i / 64] |= std::uint64_t{compare<T>(op, load<T>(vs2, i), load<T>(vs1, i))} << (i % 64);
+    }
+  }
+
+  template <typename T>
+  void compare_all(Op op, std::size_t vl, Mask_bits &bits, const std::byte *vs2,
+      const std::byte *vs1) {
+    switch (op) {
+      case SEQ : compare_loop<SEQ , T>(vl, bits, vs2, vs1); break;
+      case SNE : compare_loop<SNE , T>(vl, bits, vs2, vs1); break;
+      case SLTU: compare_loop<SLTU, T>(vl, bits, vs2, vs1); break;
+      case SLT : compare_loop<SLT , T>(vl, bits, vs2, vs1); break;
+      case SLEU: compare_loop<SLEU, T>(vl, bits, vs2, vs1); break;
+      case SLE : compare_loop<SLE , T>(vl, bits, vs2, vs1); break;
+      case SGTU: compare_loop<SGTU, T>(vl, bits, vs2, vs1); break;
+      case SGT : compare_loop<SGT , T>(vl, bits, vs2, vs1); break;
+      default: assert(0 && "Not a mask result");
+    }
+  }
+
+  void write_mask(std::size_t vl, std::byte *vd, const Mask_bits &bits, const std::byte *mask) {
+    for (std::size_t word{0}; word * 64 < vl; ++word) {
+      const std::size_t count{std::min<std::size_t>(64, vl - word * 64)};
+      std::uint64_t enable{(count == 64) ? ~std::uint64_t{0} : (std::uint64_t{1} << count) - 1};
+      if (mask) enable &= load<std::uint64_t>(mask, word);
+      store<std::uint64_t>(vd, word, (load<std::uint64_t>(vd, word) & ~enable) | (bits[word] & enable));
+    }
+  }
+
+  template <typename T>
+  void calc_elements(Op op, std::size_t vl, std::byte *vd, const std::byte *vs2,
+      const std::byte *vs1, const std::byte *mask) {
+    const auto is_active = [mask](std::size_t i) { return !mask || Vpu::is_active(mask, i); };
+
+    if (Vpu::is_reduction(op)) {
+      if (vl == 0) return;
+      const Op element_op{to_element_op(op)};
+      T result{load<T>(vs1, 0)};
+      for (std::size_t i{0}; i < vl; ++i) {
+        if (is_active(i)) result = apply<T>(element_op, result, load<T>(vs2, i));
+      }
+      store<T>(vd, 0, result);
+    } else if (Vpu::is_mask_result(op)) {
+      Mask_bits bits{};
+      compare_all<T>(op, vl, bits, vs2, vs1);
+      write_mask(vl, vd, bits, mask);
+    } else if (op == MERGE) {
+      for (std::size_t i{0}; i < vl; ++i) store<T>(vd, i, load<T>(is_active(i) ? vs1 : vs2, i));
+    } else if (!mask) {
+      binary<T>(op, vl, vd, vs2, vs1);
+    } else {
+      // The whole body at host vector speed, then only the active elements.
+      std::array<std::byte, Vpu::max_group_bytes> result;
+      binary<T>(op, vl, result.data(), vs2, vs1);
+      for (std::size_t i{0}; i < vl; ++i) {
+        if (is_active(i)) store<T>(vd, i, load<T>(result.data(), i));
+      }
+    }
+  }
+}
+
+std::optional<Vpu::Vtype> Vpu::decode_vtype(std::uint64_t vtype) {
+  // vill and the reserved bits above vma.
+  if (vtype >> 8) return std::nullopt;
+  const unsigned int vsew {static_cast<unsigned int>(vtype >> 3) & 0b111u};
+  const unsigned int vlmul{static_cast<unsigned int>(vtype     ) & 0b111u};
+  if ((vsew > static_cast<unsigned int>(Sew::e64)) || (vlmul == 0b100)) return std::nullopt;
+  const int lmul_log2{(vlmul & 0b100) ? static_cast<int>(vlmul) - 8 : static_cast<int>(vlmul)};
+  // log2(SEW) = vsew + 3 and log2(ELEN) = 6.
+  if (static_cast<int>(vsew) + 3 > lmul_log2 + 6) return std::nullopt;
+  return Vtype{.sew = static_cast<Sew>(vsew), .lmul_log2 = lmul_log2,
+      .tail_agnostic = ((vtype >> 6) & 1) != 0, .mask_agnostic = ((vtype >> 7) & 1) != 0};
+}
+
+void Vpu::calc(Op op, Sew sew, std::size_t vl, std::byte *vd, const std::byte *vs2,
+    const std::byte *vs1, const std::byte *mask) {
+  switch (sew) {
+    case Sew::e8 : calc_elements<std::uint8_t >(op, vl, vd, vs2, vs1, mask); break;
+    case Sew::e16: calc_elements<std::uint16_t>(op, vl, vd, vs2, vs1, mask); break;
+    case Sew::e32: calc_elements<std::uint32_t>(op, vl, vd, vs2, vs1, mask); break;
+    case Sew::e64: calc_elements<std::uint64_t>(op, vl, vd, vs2, vs1, mask); break;
+  }
+}
+
+void Vpu::splat(Sew sew, std::size_t vl, std::byte *vd, std::uint64_t value) {
+  for (std::size_t i{0}; i < vl; ++i) set_element(sew, vd, i, value);
+}
+
+std::uint64_t Vpu::get_element(Sew sew, const std::byte *vreg, std::size_t i) {
+  switch (sew) {
+    case Sew::e8 : return load<std::uint8_t >(vreg, i);
+    case Sew::e16: return load<std::uint16_t>(vreg, i);
+    case Sew::e32: return load<std::uint32_t>(vreg, i);
+    case Sew::e64: return load<std::uint64_t>(vreg, i);
+  }
+  assert(0 && "Illegal sew");
+}
+
+void Vpu::set_element(Sew sew, std::byte *vreg, std::size_t i, std::uint64_t value) {
+  switch (sew) {
+    case Sew::e8 : store(vreg, i, static_cast<std::uint8_t >(value)); break;
+    case Sew::e16: store(vreg, i, static_cast<std::uint16_t>(value)); break;
+    case Sew::e32: store(vreg, i, static_cast<std::uint32_t>(value)); break;
+    case Sew::e64: store(vreg, i, value                            ); break;
+  }
+}
@@ -0,0 +1,90 @@
+#include "watchpoints.hpp"
+
+#include <algorithm>
+#include <bit>
+
+template <unsigned int xlen>
+auto Basic_watchpoints<xlen>::subscribe(Invalidator invalidate) -> Subscription {
+  m_invalidators.emplace(m_next_subscription, std::move(invalidate));
+  return m_next_subscription++;
+}
+
+template <unsigned int xlen>
+void Basic_watchpoints<xlen>::insert(std::size_t addr, std::size_t size, Kind kind) {
+  const Watchpoint watchpoint{.addr = addr, .size = std::max<std::size_t>(size, 1),
+      .kind = kind};
+  m_watchpoints.push_back(watchpoint);
+  count_pages(watchpoint, 1);
+}
+
+template <unsigned int xlen>
+bool Basic_watchpoints<xlen>::erase(std::size_t addr, std::size_t size, Kind kind) {
+  const auto it{std::find_if(m_watchpoints.begin(), m_watchpoints.end(),
+      [&](const Watchpoint &watchpoint) {
+        return (watchpoint.addr == addr) && (watchpoint.size == std::max<std::size_t>(size, 1)) &&
+            (watchpoint.kind == kind);
+      })};
+  if (it == m_watchpoints.end()) return false;
+  const Watchpoint watchpoint{*it};
+  m_watchpoints.erase(it);
+  count_pages(watchpoint, -1);
+  return true;
+}
+
+template <unsigned int xlen>
+void Basic_watchpoints<xlen>::clear() {
+  if (m_watchpoints.empty()) return;
+  m_watchpoints.clear();
+  m_pages.clear();
+  invalidate();
+}
+
+template <unsigned int xlen>
+bool Basic_watchpoints<xlen>::is_any_page_watched(std::size_t addr, std::size_t size) const {
+  const std::size_t last{(addr + std::max<std::size_t>(size, 1) - 1) / page_size};
+  for (std::size_t page{addr / page_size}; page <= last; ++page) {
+    if (m_pages.contains(page)) return true;
+  }
+  return false;
+}
+
+// An access watchpoint reports reads and writes alike.
+template <unsigned int xlen>
+void Basic_watchpoints<xlen>::check_ranges(std::size_t addr, unsigned int byte_en,
+    Kind access) {
+  if (byte_en == 0) return;
+  const auto first{static_cast<std::size_t>(std::countr_zero(byte_en))};
+  const auto size{static_cast<std::size_t>(std::bit_width(byte_en)) - first};
+  if (!is_any_page_watched(addr + first, size)) return;
+  for (const Watchpoint &watchpoint : m_watchpoints) {
+    const bool overlaps{(addr + first < watchpoint.addr + watchpoint.size) &&
+        (watchpoint.addr < addr + first + size)};
+    if (overlaps && ((watchpoint.kind == access) || (watchpoint.kind == Kind::access))) {
+      if (m_callback) m_callback({.addr = watchpoint.addr, .kind = watchpoint.kind});
+      return;
+    }
+  }
+}
+
+template <unsigned int xlen>
+void Basic_watchpoints<xlen>::count_pages(const Watchpoint &watchpoint, int delta) {
+  bool changed{false};
+  const std::size_t last{(watchpoint.addr + watchpoint.size - 1) / page_size};
+  for (std::size_t page{watchpoint.addr / page_size}; page <= last; ++page) {
+    if (delta > 0) {
+      changed = (m_pages[page]++ == 0) || changed;
+    } else if (--m_pages[page] == 0) {
+      m_pages.erase(page);
+      changed = true;
+    }
+  }
+  if (changed) invalidate();
+}
+
+template <unsigned int xlen>
+void Basic_watchpoints<xlen>::invalidate() const {
+  for (const auto &[subscription, callback] : m_invalidators) callback();
+}
+
+template class Basic_watchpoints<32>;
+template class Basic_watchpoints<64>;
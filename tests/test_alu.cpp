@@ -453,3 +453,118 @@ TEST_CASE("Alu class", "[class]") {
     REQUIRE(Alu::calc_flag  (Alu::Op::EQ, 2, 2) == 1);
   }
 }
+
+TEST_CASE("Alu_MUL", "[MUL]") {
+  constexpr Uxlen min_signed{0x8000'0000};
+  SECTION("low") {
+    REQUIRE(Alu::calc_result(Alu::Op::MUL, 7, -3u) == -21u);
+    REQUIRE(Alu::calc_result(Alu::Op::MUL, 0x1'0001, 0x1'0001) == 0x2'0001);
+  }
+  SECTION("high") {
+    REQUIRE(Alu::calc_result(Alu::Op::MULH  , -1u, -1u) == 0);
+    REQUIRE(Alu::calc_result(Alu::Op::MULHU , -1u, -1u) == 0xffff'fffe);
+    REQUIRE(Alu::calc_result(Alu::Op::MULHSU, -1u, -1u) == -1u);
+    REQUIRE(Alu::calc_result(Alu::Op::MULH  , min_signed, min_signed) == 0x4000'0000);
+    REQUIRE(Alu::calc_result(Alu::Op::MULHSU, min_signed, 2) == -1u);
+    REQUIRE(Alu::calc_result(Alu::Op::MULHU , min_signed, 2) == 1);
+  }
+}
+
+TEST_CASE("Alu_DIV", "[DIV]") {
+  constexpr Uxlen min_signed{0x8000'0000};
+  SECTION("signed") {
+    REQUIRE(Alu::calc_result(Alu::Op::DIV, -7u, 2) == -3u);
+    REQUIRE(Alu::calc_result(Alu::Op::REM, -7u, 2) == -1u);
+  }
+  SECTION("unsigned") {
+    REQUIRE(Alu::calc_result(Alu::Op::DIVU, -7u, 2) == 0x7fff'fffc);
+    REQUIRE(Alu::calc_result(Alu::Op::REMU, -7u, 2) == 1);
+  }
+  SECTION("by zero") {
+    REQUIRE(Alu::calc_result(Alu::Op::DIV , 5, 0) == -1u);
+    REQUIRE(Alu::calc_result(Alu::Op::DIVU, 5, 0) == -1u);
+    REQUIRE(Alu::calc_result(Alu::Op::REM , -5u, 0) == -5u);
+    REQUIRE(Alu::calc_result(Alu::Op::REMU, 5, 0) == 5);
+  }
+  SECTION("overflow") {
+    REQUIRE(Alu::calc_result(Alu::Op::DIV, min_signed, -1u) == min_signed);
+    REQUIRE(Alu::calc_result(Alu::Op::REM, min_signed, -1u) == 0);
+  }
+}
+
+TEST_CASE("Alu_ZB", "[ZB]") {
+  SECTION("zba") {
+    REQUIRE(Alu::calc_result(Alu::Op::SH1ADD, 3, 100) == 106);
+    REQUIRE(Alu::calc_result(Alu::Op::SH3ADD, 3, 100) == 124);
+  }
+  SECTION("logic") {
+    REQUIRE(Alu::calc_result(Alu::Op::ANDN, 0b1100, 0b1010) == 0b0100);
+    REQUIRE(Alu::calc_result(Alu::Op::ORN , 0, 0xffff'fff0) == 0xf);
+    REQUIRE(Alu::calc_result(Alu::Op::XNOR, 0xf0f0'f0f0, 0xff00'ff00) == 0xf00f'f00f);
+  }
+  SECTION("count") {
+    REQUIRE(Alu::calc_result(Alu::Op::CLZ , 0, 0) == 32);
+    REQUIRE(Alu::calc_result(Alu::Op::CLZ , 0x0001'0000, 0) == 15);
+    REQUIRE(Alu::calc_result(Alu::Op::CTZ , 0, 0) == 32);
+    REQUIRE(Alu::calc_result(Alu::Op::CTZ , 0x0001'0000, 0) == 16);
+    REQUIRE(Alu::calc_result(Alu::Op::CPOP, 0xf0f0'0001, 0) == 9);
+  }
+  SECTION("min max") {
+    REQUIRE(Alu::calc_result(Alu::Op::MAX , -1u, 1) == 1);
+    REQUIRE(Alu::calc_result(Alu::Op::MAXU, -1u, 1) == -1u);
+    REQUIRE(Alu::calc_result(Alu::Op::MIN , -1u, 1) == -1u);
+    REQUIRE(Alu::calc_result(Alu::Op::MINU, -1u, 1) == 1);
+  }
+  SECTION("extend") {
+    REQUIRE(Alu::calc_result(Alu::Op::SEXTB, 0x1234'5680, 0) == 0xffff'ff80);
+    REQUIRE(Alu::calc_result(Alu::Op::SEXTH, 0x1234'8000, 0) == 0xffff'8000);
+    REQUIRE(Alu::calc_result(Alu::Op::ZEXTH, 0x1234'8000, 0) == 0x0000'8000);
+  }
+  SECTION("rotate") {
+    REQUIRE(Alu::calc_result(Alu::Op::ROL, 0x8000'0001, 1) == 0x0000'0003);
+    REQUIRE(Alu::calc_result(Alu::Op::ROR, 0x8000'0001, 1) == 0xc000'0000);
+    REQUIRE(Alu::calc_result(Alu::Op::ROR, 0x8000'0001, 33) == 0xc000'0000);
+  }
+  SECTION("bytes") {
+    REQUIRE(Alu::calc_result(Alu::Op::ORCB, 0x0100'8000, 0) == 0xff00'ff00);
+    REQUIRE(Alu::calc_result(Alu::Op::REV8, 0x0102'0304, 0) == 0x0403'0201);
+  }
+  SECTION("single bit") {
+    REQUIRE(Alu::calc_result(Alu::Op::BCLR, 0xff, 3) == 0xf7);
+    REQUIRE(Alu::calc_result(Alu::Op::BEXT, 0x80, 7) == 1);
+    REQUIRE(Alu::calc_result(Alu::Op::BEXT, 0x80, 39) == 1);
+    REQUIRE(Alu::calc_result(Alu::Op::BINV, 0x80, 7) == 0);
+    REQUIRE(Alu::calc_result(Alu::Op::BSET, 0, 31) == 0x8000'0000);
+  }
+}
+
+TEST_CASE("Alu_RV64", "[RV64]") {
+  using U64 = Uxlen_t<64>;
+  SECTION("full width") {
+    REQUIRE(Alu::calc_result<64>(Alu::Op::ADD, 0xffff'ffff, 1) == 0x1'0000'0000);
+    REQUIRE(Alu::calc_result<64>(Alu::Op::SLL, 1, 63) == U64{1} << 63);
+    REQUIRE(Alu::calc_result<64>(Alu::Op::SRA, U64{1} << 63, 63) == ~U64{0});
+    REQUIRE(Alu::calc_result<64>(Alu::Op::MULHU, ~U64{0}, ~U64{0}) == ~U64{0} - 1);
+    REQUIRE(Alu::calc_result<64>(Alu::Op::DIV, U64{1} << 63, ~U64{0}) == U64{1} << 63);
+    REQUIRE(Alu::calc_result<64>(Alu::Op::CLZ, 1, 0) == 63);
+    REQUIRE(Alu::calc_result<64>(Alu::Op::REV8, 0x0102'0304'0506'0708, 0) ==
+        0x0807'0605'0403'0201);
+    REQUIRE(Alu::calc_flag<64>(Alu::Op::LTS, ~U64{0}, 0));
+  }
+  SECTION("word") {
+    REQUIRE(Alu::calc_result<64>(Alu::Op::ADDW, 0x7fff'ffff, 1) == 0xffff'ffff'8000'0000);
+    REQUIRE(Alu::calc_result<64>(Alu::Op::SUBW, 0x1'0000'0000, 1) == ~U64{0});
+    REQUIRE(Alu::calc_result<64>(Alu::Op::SLLW, 1, 31) == 0xffff'ffff'8000'0000);
+    REQUIRE(Alu::calc_result<64>(Alu::Op::SRLW, 0xffff'ffff'8000'0000, 31) == 1);
+    REQUIRE(Alu::calc_result<64>(Alu::Op::SRAW, 0x8000'0000, 4) == 0xffff'ffff'f800'0000);
+    REQUIRE(Alu::calc_result<64>(Alu::Op::DIVUW, 0xffff'ffff, 0) == ~U64{0});
+    REQUIRE(Alu::calc_result<64>(Alu::Op::REMW, 0x1'0000'0007, 2) == 1);
+    REQUIRE(Alu::calc_result<64>(Alu::Op::CLZW, 0x1'0000'0001, 0) == 31);
+    REQUIRE(Alu::calc_result<64>(Alu::Op::RORW, 1, 1) == 0xffff'ffff'8000'0000);
+  }
+  SECTION("unsigned word") {
+    REQUIRE(Alu::calc_result<64>(Alu::Op::ADDUW, 0xffff'ffff'ffff'ffff, 1) == 0x1'0000'0000);
+    REQUIRE(Alu::calc_result<64>(Alu::Op::SH2ADDUW, 0xf'0000'0001, 1) == 5);
+    REQUIRE(Alu::calc_result<64>(Alu::Op::SLLIUW, 0xffff'ffff'8000'0000, 1) == 0x1'0000'0000);
+  }
+}
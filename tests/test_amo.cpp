@@ -0,0 +1,90 @@
+#define CATCH_CONFIG_MAIN
+
+#include "amo.hpp"
+
+#include "catch2/catch_test_macros.hpp"
+
+#include <array>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Amo calc", "[CALC]") {
+  using U32 = std::uint32_t;
+  const U32 minus_two{0xffff'fffe};
+  REQUIRE(Amo::calc<U32>(Amo::SWAP, 1, 2) == 2);
+  REQUIRE(Amo::calc<U32>(Amo::ADD , minus_two, 3) == 1);
+  REQUIRE(Amo::calc<U32>(Amo::XOR , 0b1100, 0b1010) == 0b0110);
+  REQUIRE(Amo::calc<U32>(Amo::AND , 0b1100, 0b1010) == 0b1000);
+  REQUIRE(Amo::calc<U32>(Amo::OR  , 0b1100, 0b1010) == 0b1110);
+  REQUIRE(Amo::calc<U32>(Amo::MIN , minus_two, 3) == minus_two);
+  REQUIRE(Amo::calc<U32>(Amo::MAX , minus_two, 3) == 3);
+  REQUIRE(Amo::calc<U32>(Amo::MINU, minus_two, 3) == 3);
+  REQUIRE(Amo::calc<U32>(Amo::MAXU, minus_two, 3) == minus_two);
+  REQUIRE(Amo::calc<std::uint64_t>(Amo::MIN, ~std::uint64_t{0}, 0) == ~std::uint64_t{0});
+}
+
+TEST_CASE("Amo memory", "[MEMORY]") {
+  alignas(8) std::array<std::byte, 16> memory{};
+  std::byte *word{memory.data() + 4};
+
+  REQUIRE(Amo::fetch_op<std::uint32_t>(Amo::ADD, word, 5) == 0);
+  REQUIRE(Amo::fetch_op<std::uint32_t>(Amo::MAX, word, 0xffff'ffff) == 5);
+  REQUIRE(Amo::fetch_op<std::uint32_t>(Amo::MAXU, word, 0xffff'ffff) == 5);
+  REQUIRE(Amo::load<std::uint32_t>(word) == 0xffff'ffff);
+  // The neighbouring words are untouched.
+  REQUIRE(Amo::load<std::uint32_t>(memory.data()) == 0);
+  REQUIRE(Amo::load<std::uint32_t>(memory.data() + 8) == 0);
+
+  REQUIRE(!Amo::compare_exchange<std::uint32_t>(word, 0, 1));
+  REQUIRE(Amo::compare_exchange<std::uint32_t>(word, 0xffff'ffff, 1));
+  REQUIRE(Amo::load<std::uint32_t>(word) == 1);
+
+  REQUIRE(Amo::fetch_op<std::uint64_t>(Amo::SWAP, memory.data() + 8, 42) == 0);
+  REQUIRE(Amo::load<std::uint64_t>(memory.data() + 8) == 42);
+}
+
+TEST_CASE("Amo contention", "[CONTENTION]") {
+  constexpr unsigned int threads{4};
+  constexpr unsigned int iterations{10'000};
+  alignas(8) std::array<std::byte, 8> memory{};
+
+  std::vector<std::thread> workers{};
+  for (unsigned int i{0}; i < threads; ++i) {
+    workers.emplace_back([&memory, i] {
+      for (unsigned int j{0}; j < iterations; ++j) {
+        Amo::fetch_op<std::uint32_t>(Amo::ADD, memory.data(), 1);
+        Amo::fetch_op<std::uint32_t>(Amo::MAXU, memory.data() + 4, i * iterations + j);
+      }
+    });
+  }
+  for (std::thread &worker : workers) worker.join();
+
+  REQUIRE(Amo::load<std::uint32_t>(memory.data()) == threads * iterations);
+  REQUIRE(Amo::load<std::uint32_t>(memory.data() + 4) == threads * iterations - 1);
+}
+
+TEST_CASE("Amo reservations", "[RESERVATION]") {
+  Amo::Reservation_set reservations{2};
+
+  reservations.reserve(0, 0x100);
+  REQUIRE(reservations.take(0, 0x100));
+  // sc drops the reservation whether it succeeds or not.
+  REQUIRE(!reservations.take(0, 0x100));
+
+  // Same granule.
+  reservations.reserve(0, 0x100);
+  REQUIRE(reservations.take(0, 0x104));
+  reservations.reserve(0, 0x100);
+  REQUIRE(!reservations.take(0, 0x108));
+
+  reservations.reserve(0, 0x100);
+  reservations.reserve(1, 0x200);
+  reservations.invalidate(0x0fe, 4);
+  REQUIRE(!reservations.take(0, 0x100));
+  REQUIRE(reservations.take(1, 0x200));
+
+  reservations.reserve(1, 0x200);
+  reservations.invalidate(0x1f8, 8);
+  reservations.invalidate(0x208, 8);
+  REQUIRE(reservations.take(1, 0x200));
+}
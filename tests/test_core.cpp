@@ -7,6 +7,7 @@
 #include "csr.hpp"
 #include "isa_extension.hpp"
 #include "memory.hpp"
+#include "ram.hpp"
 #include "rf.hpp"
 
 #include "spdlog/logger.h"
@@ -114,4 +115,415 @@ TEST_CASE("basic", "[BASIC]") {
     ref_data_content[7] = Byte{0xff};
     mem_reqs.eq(ref_data_content, ref_rf_content, ref_csr_content);
   }
+
+  SECTION("mul_div") {
+    const std::vector<Uxlen> instr{
+      0xff900093, // addi x1, x0, -7
+      0x00300113, // addi x2, x0, 3
+      0x022081b3, // mul  x3, x1, x2
+      0x0220c233, // div  x4, x1, x2
+      0x0220e2b3, // rem  x5, x1, x2
+      0x0200d333, // divu x6, x1, x0
+    };
+    Instr_mem instr_mem{instr};
+    Data_mem data_mem{{}};
+    Rf rf{};
+    Csr csr{};
+
+    SECTION("enabled m") {
+      Core core{instr_mem, data_mem, csr, rf, my_logger, {Isa_extension::isa_m}};
+      for (std::size_t i{0}; i < instr.size(); ++i) core.cycle();
+      REQUIRE(rf.read(3) == static_cast<Uxlen>(-21));
+      REQUIRE(rf.read(4) == static_cast<Uxlen>(-2));
+      REQUIRE(rf.read(5) == static_cast<Uxlen>(-1));
+      REQUIRE(rf.read(6) == static_cast<Uxlen>(-1));
+    }
+    SECTION("disabled m") {
+      Core core{instr_mem, data_mem, csr, rf, my_logger, extensions};
+      core.cycle();
+      core.cycle();
+      REQUIRE_THROWS_AS(core.cycle(), Errors::Illegal_instruction);
+    }
+  }
+
+  SECTION("compressed") {
+    const std::vector<Uxlen> instr{
+      0x81134095, // 0x00: c.li x1, 5;           0x02: addi x2, x1, 7 (straddles)
+      0x91060070, //                             0x06: c.add x2, x1
+      0x4205a011, // 0x08: c.j 4;                0x0a: c.li x4, 1
+      0x006002ef, // 0x0c: jal x5, 6
+      0x83164209, // 0x10: c.li x4, 2;           0x12: c.mv x6, x5
+      0x0001a001, // 0x14: c.j 0;                0x16: c.nop
+    };
+    Instr_mem instr_mem{instr};
+    Data_mem data_mem{{}};
+    Rf rf{};
+    Csr csr{};
+    Core core{instr_mem, data_mem, csr, rf, my_logger, {Isa_extension::isa_c}};
+
+    for (int i{0}; i < 7; ++i) core.cycle();
+    REQUIRE(rf.read(1) == 5);
+    REQUIRE(rf.read(2) == 17);
+    REQUIRE(rf.read(4) == 0);
+    REQUIRE(rf.read(5) == 0x10);
+    REQUIRE(rf.read(6) == 0x10);
+    REQUIRE(core.get_pc() == 0x14);
+    REQUIRE(core.is_waiting());
+  }
+
+  SECTION("sub-word") {
+    const std::vector<Uxlen> instr{
+      0xffe00193, // addi x3, x0, -2
+      0x003002a3, // sb x3, 5(x0)
+      0x00301523, // sh x3, 10(x0)
+      0x00504203, // lbu x4, 5(x0)
+      0x00a01283, // lh x5, 10(x0)
+      0x00b00303, // lb x6, 11(x0)
+    };
+    Instr_mem instr_mem{instr};
+    Data_mem data_mem{{}};
+    Rf rf{};
+    Csr csr{};
+    Core core{instr_mem, data_mem, csr, rf, my_logger, extensions};
+
+    for (std::size_t i{0}; i < instr.size(); ++i) core.cycle();
+    REQUIRE(data_mem.get_content() == Data_mem::Map{
+        {5, Byte{0xfe}}, {10, Byte{0xfe}}, {11, Byte{0xff}}});
+    REQUIRE(rf.read(4) == 0xfe);
+    REQUIRE(rf.read(5) == static_cast<Uxlen>(-2));
+    REQUIRE(rf.read(6) == static_cast<Uxlen>(-1));
+  }
+}
+
+TEST_CASE("rv64", "[RV64]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+  using U64 = Uxlen_t<64>;
+
+  const std::vector<Uxlen> instr{
+    0xfff00093, // addi x1, x0, -1
+    0x02809113, // slli x2, x1, 40
+    0x02015113, // srli x2, x2, 32
+    0x0011019b, // addiw x3, x2, 1
+    0x00203423, // sd x2, 8(x0)
+    0x00802203, // lw x4, 8(x0)
+    0x00806283, // lwu x5, 8(x0)
+    0x00803303, // ld x6, 8(x0)
+    0x800003b7, // lui x7, 0x80000
+    0x0073843b, // addw x8, x7, x7
+    0x021384bb, // mulw x9, x7, x1
+  };
+  Instr_mem instr_mem{instr};
+  Data_mem64 data_mem{{}};
+  Rf64 rf{};
+  Csr64 csr{};
+  Core64 core{instr_mem, data_mem, csr, rf, my_logger, {Isa_extension::isa_m}};
+
+  for (std::size_t i{0}; i < instr.size(); ++i) core.cycle();
+  REQUIRE(rf.read(1) == ~U64{0});
+  REQUIRE(rf.read(2) == 0x0000'0000'ffff'ff00);
+  REQUIRE(rf.read(3) == 0xffff'ffff'ffff'ff01);
+  REQUIRE(data_mem.read(8) == 0x0000'0000'ffff'ff00);
+  REQUIRE(rf.read(4) == 0xffff'ffff'ffff'ff00);
+  REQUIRE(rf.read(5) == 0x0000'0000'ffff'ff00);
+  REQUIRE(rf.read(6) == 0x0000'0000'ffff'ff00);
+  REQUIRE(rf.read(7) == 0xffff'ffff'8000'0000);
+  REQUIRE(rf.read(8) == 0);
+  REQUIRE(rf.read(9) == 0xffff'ffff'8000'0000);
+  REQUIRE(core.get_pc() == 4 * instr.size());
+}
+
+TEST_CASE("fd", "[FD]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  const std::vector<Uxlen> instr{
+    0x3f8000b7, // lui x1, 0x3f800
+    0xf00080d3, // fmv.w.x f1, x1
+    0x00300113, // addi x2, x0, 3
+    0xd0017153, // fcvt.s.w f2, x2
+    0x1820f1d3, // fdiv.s f3, f1, f2
+    0x001021f3, // csrr x3, fflags
+    0x00102273, // csrr x4, fflags
+    0xd2010253, // fcvt.d.w f4, x2
+    0x00403427, // fsd f4, 8(x0)
+    0x00803287, // fld f5, 8(x0)
+    0xc202f2d3, // fcvt.w.d x5, f5
+    0x0020d073, // csrwi frm, 1
+    0x1820f353, // fdiv.s f6, f1, f2
+    0xe0030353, // fmv.x.w x6, f6
+    0x00101073, // csrw fflags, x0
+    0x003023f3, // csrr x7, fcsr
+    0x00302827, // fsw f3, 16(x0)
+    0x01002403, // lw x8, 16(x0)
+    0xe00184d3, // fmv.x.w x9, f3
+  };
+  Instr_mem instr_mem{instr};
+  Data_mem data_mem{{}};
+  Rf rf{};
+  Csr csr{};
+  Core core{instr_mem, data_mem, csr, rf, my_logger,
+      {Isa_extension::isa_zicsr, Isa_extension::isa_f, Isa_extension::isa_d}};
+
+  for (std::size_t i{0}; i < instr.size(); ++i) core.cycle();
+  Fp_rf &fp_rf{core.get_fp_rf()};
+  // Singles are NaN-boxed.
+  REQUIRE(fp_rf.read(1) == 0xffff'ffff'3f80'0000);
+  REQUIRE(fp_rf.read(4) == 0x4008'0000'0000'0000);
+  REQUIRE(fp_rf.read(5) == fp_rf.read(4));
+  // Inexact accrues until written.
+  REQUIRE(rf.read(3) == Fpu::NX);
+  REQUIRE(rf.read(4) == Fpu::NX);
+  REQUIRE(rf.read(5) == 3);
+  // 1/3 rounds up to nearest and down toward zero.
+  REQUIRE(rf.read(9) == 0x3eaa'aaab);
+  REQUIRE(rf.read(6) == 0x3eaa'aaaa);
+  REQUIRE(rf.read(7) == Fpu::RTZ << 5);
+  REQUIRE(rf.read(8) == rf.read(9));
+  REQUIRE(data_mem.read(8 ) == 0);
+  REQUIRE(data_mem.read(12) == 0x4008'0000);
+  REQUIRE(core.get_pc() == 4 * instr.size());
+}
+
+TEST_CASE("fp loop", "[FD]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  // Only f1 changes between iterations, so the loop mustn't be taken for an idle one.
+  const std::vector<Uxlen> instr{
+    0xd00070d3, // fcvt.s.w f1, x0
+    0x00100093, // addi x1, x0, 1
+    0xd000f153, // fcvt.s.w f2, x1
+    0x01400093, // addi x1, x0, 20
+    0xd000f1d3, // fcvt.s.w f3, x1
+    0x0020f0d3, // fadd.s f1, f1, f2
+    0xa03092d3, // flt.s x5, f1, f3
+    0xfe029ce3, // bne x5, x0, -8
+    0x00700313, // addi x6, x0, 7
+  };
+  Instr_mem instr_mem{instr};
+  Data_mem data_mem{{}};
+  Rf rf{};
+  Csr csr{};
+  Core core{instr_mem, data_mem, csr, rf, my_logger, {Isa_extension::isa_f}};
+
+  for (std::size_t i{0}; i < 5 + 3 * 20 + 1; ++i) core.cycle();
+  REQUIRE(!core.is_waiting());
+  REQUIRE(rf.read(6) == 7);
+}
+
+TEST_CASE("v", "[V]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  const std::vector<Uxlen> instr{
+    0x10000113, // addi x2, x0, 0x100
+    0x00800293, // addi x5, x0, 8
+    0x0d12f0d7, // vsetvli x1, x5, e32, m2, ta, ma
+    0x02016107, // vle32.v v2, (x2)
+    0x0220b257, // vadd.vi v4, v2, 1
+    0x96412257, // vmul.vv v4, v4, v2
+    0x20000193, // addi x3, x0, 0x200
+    0x0201e227, // vse32.v v4, (x3)
+    0x42006357, // vmv.s.x v6, x0
+    0x02432357, // vredsum.vs v6, v4, v6
+    0x42602257, // vmv.x.s x4, v6
+    0x00500313, // addi x6, x0, 5
+    0x6e234057, // vmslt.vx v0, v2, x6
+    0x5e003457, // vmv.v.i v8, 0
+    0x0022c457, // vadd.vx v8, v2, x5, v0.t
+    0x00800393, // addi x7, x0, 8
+    0x0a716507, // vlse32.v v10, (x2), x7
+    0xc2002473, // csrr x8, vl
+    0xc22024f3, // csrr x9, vlenb
+    0xcc027057, // vsetivli x0, 4, e8, m1, ta, ma
+    0x5e0fb657, // vmv.v.i v12, -1
+    0x42c02557, // vmv.x.s x10, v12
+    0xc2001073, // csrw vl, x0
+    0x0df2f0d7, // vsetvli x1, x5, e64, mf2, ta, ma
+    0x022180d7, // vadd.vv v1, v2, v3
+  };
+  Instr_mem instr_mem{instr};
+  Ram ram{0x400};
+  for (Uxlen i{0}; i < 8; ++i) ram.write(0x100 + 4 * i, i + 1);
+  Rf rf{};
+  Csr csr{};
+  Core core{instr_mem, ram, csr, rf, my_logger,
+      {Isa_extension::isa_zicsr, Isa_extension::isa_v}};
+
+  const auto get_element = [&core](unsigned int reg, std::size_t i) {
+    return Vpu::get_element(Vpu::Sew::e32, core.get_vrf().get(reg), i);
+  };
+
+  for (std::size_t i{0}; i < 22; ++i) core.cycle();
+  // VLMAX is 8 for e32 at LMUL 2 with VLEN 128.
+  REQUIRE(rf.read(1) == 8);
+  REQUIRE(rf.read(8) == 8);
+  REQUIRE(rf.read(9) == 16);
+  for (Uxlen i{0}; i < 8; ++i) {
+    const Uxlen a{i + 1};
+    REQUIRE(ram.read(0x200 + 4 * i) == a * (a + 1));
+    REQUIRE(get_element(8 , i) == ((a < 5) ? a + 8 : 0));
+    REQUIRE(get_element(10, i) == ((i < 4) ? 2 * i + 1 : 0));
+  }
+  REQUIRE(rf.read(4) == 240);
+  // Sign-extended from SEW.
+  REQUIRE(rf.read(10) == 0xffff'ffff);
+
+  REQUIRE_THROWS_AS(core.cycle(), Errors::Read_only);
+  core.set_pc(core.get_pc() + 4);
+  // e64 at LMUL 1/2 is reserved: vill is set and vector instructions are illegal.
+  core.cycle();
+  REQUIRE(rf.read(1) == 0);
+  REQUIRE(csr.read(Csr::VTYPE) == 0x8000'0000);
+  REQUIRE_THROWS_AS(core.cycle(), Errors::Illegal_instruction);
+}
+
+TEST_CASE("a", "[A]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  const std::vector<Uxlen> instr{
+    0x10000113, // addi x2, x0, 0x100
+    0x00500193, // addi x3, x0, 5
+    0x100120af, // lr.w x1, (x2)
+    0x1831222f, // sc.w x4, x3, (x2)
+    0x183122af, // sc.w x5, x3, (x2)
+    0x100120af, // lr.w x1, (x2)
+    0x00012023, // sw x0, 0(x2)
+    0x1831232f, // sc.w x6, x3, (x2)
+    0xffe00393, // addi x7, x0, -2
+    0x0071242f, // amoadd.w x8, x7, (x2)
+    0xe03124af, // amomaxu.w x9, x3, (x2)
+    0xa031252f, // amomax.w x10, x3, (x2)
+    0x087125af, // amoswap.w x11, x7, (x2)
+    0x6031262f, // amoand.w x12, x3, (x2)
+    0x00210693, // addi x13, x2, 2
+    0x4036a72f, // amoor.w x14, x3, (x13)
+  };
+
+  const auto check = [&](Memory &data_mem) {
+    Instr_mem instr_mem{instr};
+    Rf rf{};
+    Csr csr{};
+    Core core{instr_mem, data_mem, csr, rf, my_logger, Isa_extension::isa_a};
+    data_mem.write(0x100, 7);
+
+    for (std::size_t i{0}; i < instr.size() - 1; ++i) core.cycle();
+    REQUIRE(rf.read(1) == 5);
+    REQUIRE(rf.read(4) == 0);
+    // Without a reservation, and after a store to it.
+    REQUIRE(rf.read(5) == 1);
+    REQUIRE(rf.read(6) == 1);
+    REQUIRE(rf.read(8) == 0);
+    REQUIRE(rf.read(9) == 0xffff'fffe);
+    REQUIRE(rf.read(10) == 0xffff'fffe);
+    REQUIRE(rf.read(11) == 5);
+    REQUIRE(rf.read(12) == 0xffff'fffe);
+    REQUIRE(data_mem.read(0x100) == 4);
+    REQUIRE_THROWS_AS(core.cycle(), Errors::Misalignment);
+  };
+
+  SECTION("ram") {
+    Ram ram{0x200};
+    check(ram);
+  }
+  // No host pointer: a plain read-modify-write.
+  SECTION("device") {
+    Data_mem data_mem{{}};
+    check(data_mem);
+  }
+  SECTION("harts") {
+    // The second hart stores the value the first one reserved.
+    const std::vector<Uxlen> other{
+      0x10000113, // addi x2, x0, 0x100
+      0x00700193, // addi x3, x0, 7
+      0x00312023, // sw x3, 0(x2)
+    };
+    Ram ram{0x200};
+    ram.write(0x100, 7);
+    Amo::Reservation_set reservations{2};
+    Instr_mem instr_mem{instr};
+    Instr_mem other_instr_mem{other};
+    Rf rf{};
+    Rf other_rf{};
+    Csr csr{};
+    Csr other_csr{};
+    Core core{instr_mem, ram, csr, rf, my_logger, Isa_extension::isa_a, nullptr,
+        &reservations, 0};
+    Core other_core{other_instr_mem, ram, other_csr, other_rf, my_logger, Isa_extension::isa_a,
+        nullptr, &reservations, 1};
+
+    for (std::size_t i{0}; i < 3; ++i) core.cycle();
+    for (std::size_t i{0}; i < 3; ++i) other_core.cycle();
+    core.cycle();
+    REQUIRE(rf.read(4) == 1);
+    REQUIRE(ram.read(0x100) == 7);
+  }
+  SECTION("rv64") {
+    const std::vector<Uxlen> instr64{
+      0x10000113, // addi x2, x0, 0x100
+      0xffe00393, // addi x7, x0, -2
+      0x0071242f, // amoadd.w x8, x7, (x2)
+      0x007134af, // amoadd.d x9, x7, (x2)
+    };
+    Instr_mem instr_mem{instr64};
+    Ram64 ram{0x200};
+    Rf64 rf{};
+    Csr64 csr{};
+    Core64 core{instr_mem, ram, csr, rf, my_logger, Isa_extension::isa_a};
+    ram.write(0x100, 0x0000'0001'0000'0000);
+
+    for (std::size_t i{0}; i < instr64.size(); ++i) core.cycle();
+    REQUIRE(rf.read(8) == 0);
+    // The word result is sign-extended.
+    REQUIRE(rf.read(9) == 0x0000'0001'ffff'fffe);
+    REQUIRE(ram.read(0x100) == 0x0000'0001'ffff'fffc);
+  }
+}
+
+TEST_CASE("ecall and ebreak", "[SYSTEM]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  const std::vector<Uxlen> instr{
+    0x04000293, // addi t0, x0, 0x40
+    0x30529073, // csrw mtvec, t0
+    0x00000073, // ecall
+    0x00100073, // ebreak
+  };
+  Instr_mem instr_mem{instr};
+  Data_mem data_mem{{}};
+  Rf rf{};
+  Csr csr{};
+  Core core{instr_mem, data_mem, csr, rf, my_logger, Isa_extension::isa_zicsr};
+
+  // Without an ecall handler both trap.
+  for (int i{0}; i < 3; ++i) core.cycle();
+  REQUIRE(core.get_pc() == 0x40);
+  REQUIRE(csr.read(Csr::MCAUSE) == Csr::MACHINE_ECALL);
+  REQUIRE(csr.read(Csr::MEPC) == 0x08);
+
+  core.set_pc(0x0c);
+  core.cycle();
+  REQUIRE(core.get_pc() == 0x40);
+  REQUIRE(csr.read(Csr::MCAUSE) == Csr::BREAKPOINT);
+  REQUIRE(csr.read(Csr::MEPC) == 0x0c);
+  REQUIRE(csr.read(Csr::MTVAL) == 0x0c);
+
+  unsigned int calls{0};
+  core.set_ecall_handler([&calls]() -> std::optional<Uxlen> {
+    if (++calls < 2) return {};
+    return 5;
+  });
+  core.set_pc(0x08);
+  core.cycle();
+  REQUIRE(calls == 1);
+  REQUIRE(core.get_pc() == 0x0c);
+  REQUIRE_FALSE(core.is_halted());
+  REQUIRE_FALSE(core.get_exit_code());
+  core.set_pc(0x08);
+  core.cycle();
+  REQUIRE(core.is_halted());
+  REQUIRE(core.get_exit_code() == 5);
 }
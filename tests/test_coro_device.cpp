@@ -0,0 +1,207 @@
+#define CATCH_CONFIG_MAIN
+
+#include "bus.hpp"
+#include "core.hpp"
+#include "coro_device.hpp"
+#include "coro_timer.hpp"
+#include "coro_uart.hpp"
+#include "csr.hpp"
+#include "instr_mem.hpp"
+#include "irq.hpp"
+#include "plic.hpp"
+#include "rf.hpp"
+#include "scheduler.hpp"
+
+#include "spdlog/logger.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "catch2/catch_test_macros.hpp"
+
+#include <sstream>
+#include <vector>
+
+namespace {
+  constexpr unsigned int irq_source{3};
+
+  void enable_source(Plic &plic, unsigned int source) {
+    plic.write(Plic::PRIORITY + 4 * source, 1);
+    plic.write(Plic::ENABLE, Uxlen{1} << source);
+  }
+
+  // Echoes every write of register 0 to register 4 after a delay.
+  class Echo : public Coro_device {
+    public:
+      explicit Echo(Scheduler &scheduler) : Coro_device{scheduler, 2} { spawn(echo()); }
+
+      std::vector<Scheduler::Time> m_reads{};
+
+    private:
+      Device_task echo() {
+        for (;;) {
+          const Uxlen data{co_await wait_write(0)};
+          co_await delay(5);
+          reg(4) = data;
+          co_await wait_read(4);
+          m_reads.push_back(get_scheduler().get_now());
+          if (data == 0) throw Errors::Error{"Echo. Zero."};
+        }
+      }
+  };
+}
+
+TEST_CASE("frame pool", "[CORO_DEVICE]") {
+  void *const frame{Frame_pool::allocate(100)};
+  Frame_pool::deallocate(frame, 100);
+  REQUIRE(Frame_pool::allocate(128) == frame);
+  Frame_pool::deallocate(frame, 128);
+
+  void *const large{Frame_pool::allocate(100000)};
+  Frame_pool::deallocate(large, 100000);
+}
+
+TEST_CASE("coro device", "[CORO_DEVICE]") {
+  Scheduler scheduler{};
+  Echo echo{scheduler};
+  scheduler.advance_to(1);
+
+  echo.write(0, 42);
+  scheduler.advance_to(5);
+  REQUIRE(echo.read(4) == 0);
+  scheduler.advance_to(6);
+  REQUIRE(echo.read(4) == 42);
+  scheduler.advance_to(10);
+  REQUIRE(echo.m_reads == std::vector<Scheduler::Time>{6});
+
+  SECTION("exception") {
+    echo.write(0, 0);
+    scheduler.advance_to(15);
+    REQUIRE(echo.read(4) == 0);
+    REQUIRE_THROWS_AS(scheduler.advance_to(16), Errors::Error);
+  }
+
+  SECTION("destroyed while suspended") {
+    auto other{std::make_unique<Echo>(scheduler)};
+    scheduler.advance_to(11);
+    other->write(0, 1);
+    other.reset();
+    scheduler.advance_to(100);
+  }
+}
+
+TEST_CASE("coro timer", "[CORO_DEVICE]") {
+  Scheduler scheduler{};
+  Irq_pending irq_pending{};
+  Plic plic{irq_pending};
+  enable_source(plic, irq_source);
+  Coro_timer timer{scheduler, plic, irq_source};
+
+  timer.write(Coro_timer::LOAD, 100);
+
+  SECTION("one-shot") {
+    timer.write(Coro_timer::CTRL, Coro_timer::CTRL_ENABLE);
+    scheduler.advance_to(50);
+    REQUIRE(timer.read(Coro_timer::COUNT) == 50);
+    scheduler.advance_to(99);
+    REQUIRE(irq_pending.get() == 0);
+    scheduler.advance_to(100);
+    REQUIRE(irq_pending.get() == Irq::to_mask(Irq::MEI));
+    REQUIRE(timer.read(Coro_timer::STATUS) == Coro_timer::STATUS_EXPIRED);
+    REQUIRE(timer.read(Coro_timer::CTRL) == 0);
+
+    // Restarting doesn't take effect until the interrupt is acknowledged.
+    timer.write(Coro_timer::CTRL, Coro_timer::CTRL_ENABLE);
+    scheduler.advance_to(300);
+    REQUIRE(timer.read(Coro_timer::COUNT) == 0);
+    REQUIRE(plic.read(Plic::CLAIM) == irq_source);
+    plic.write(Plic::CLAIM, irq_source);
+    timer.write(Coro_timer::STATUS, Coro_timer::STATUS_EXPIRED);
+    REQUIRE(irq_pending.get() == 0);
+    scheduler.advance_to(301);
+    REQUIRE(timer.read(Coro_timer::COUNT) == 99);
+  }
+
+  SECTION("periodic") {
+    timer.write(Coro_timer::CTRL, Coro_timer::CTRL_ENABLE | Coro_timer::CTRL_PERIODIC);
+    scheduler.advance_to(100);
+    timer.write(Coro_timer::STATUS, Coro_timer::STATUS_EXPIRED);
+    REQUIRE(irq_pending.get() == 0);
+    scheduler.advance_to(199);
+    REQUIRE(irq_pending.get() == 0);
+    scheduler.advance_to(200);
+    REQUIRE(irq_pending.get() == Irq::to_mask(Irq::MEI));
+  }
+
+  SECTION("disabled while counting") {
+    timer.write(Coro_timer::CTRL, Coro_timer::CTRL_ENABLE);
+    scheduler.advance_to(50);
+    timer.write(Coro_timer::CTRL, 0);
+    scheduler.advance_to(1000);
+    REQUIRE(irq_pending.get() == 0);
+    REQUIRE(timer.read(Coro_timer::STATUS) == 0);
+  }
+}
+
+TEST_CASE("coro uart", "[CORO_DEVICE]") {
+  Scheduler scheduler{};
+  Irq_pending irq_pending{};
+  Plic plic{irq_pending};
+  enable_source(plic, irq_source);
+  std::ostringstream out{};
+  Coro_uart uart{scheduler, out, 10, plic, irq_source};
+
+  SECTION("tx") {
+    for (char c : std::string{"hello"}) {
+      uart.write(Coro_uart::TXDATA, static_cast<unsigned char>(c));
+    }
+    REQUIRE(uart.read(Coro_uart::STATUS) == 0);
+    scheduler.advance_to(9);
+    REQUIRE(out.str() == "");
+    scheduler.advance_to(10);
+    REQUIRE(out.str() == "h");
+    scheduler.advance_to(100);
+    REQUIRE(out.str() == "hello");
+    REQUIRE(uart.read(Coro_uart::STATUS) == Coro_uart::STATUS_TX_EMPTY);
+  }
+
+  SECTION("rx") {
+    uart.write(Coro_uart::CTRL, Coro_uart::CTRL_RX_IRQ);
+    uart.receive("ab");
+    scheduler.advance_to(9);
+    REQUIRE(irq_pending.get() == 0);
+    scheduler.advance_to(10);
+    REQUIRE(irq_pending.get() == Irq::to_mask(Irq::MEI));
+    uart.write(Coro_uart::ACK, 0);
+    REQUIRE(irq_pending.get() == 0);
+    scheduler.advance_to(100);
+    REQUIRE(uart.read(Coro_uart::STATUS) ==
+        (Coro_uart::STATUS_TX_EMPTY | Coro_uart::STATUS_RX_VALID));
+    REQUIRE(uart.read(Coro_uart::RXDATA) == 'a');
+    REQUIRE(uart.read(Coro_uart::RXDATA) == 'b');
+    REQUIRE(uart.read(Coro_uart::STATUS) == Coro_uart::STATUS_TX_EMPTY);
+  }
+
+  SECTION("core") {
+    auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
+    auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+    const std::vector<Uxlen> instr{
+      0x00001137, // lui x2, 0x1
+      0x06800093, // addi x1, x0, 'h'
+      0x00112023, // sw x1, 0(x2)
+      0x06900093, // addi x1, x0, 'i'
+      0x00112023, // sw x1, 0(x2)
+      0x0000006f, // j .
+    };
+    Instr_mem instr_mem{instr};
+    Rf rf{};
+    Csr csr{irq_pending};
+    Bus bus{};
+    bus.attach(0x1000, uart);
+    Core core{instr_mem, bus, csr, rf, my_logger, Isa_extension::isa_zicsr, &irq_pending};
+
+    core.run(scheduler, 16);
+    REQUIRE(out.str() == "h");
+    core.run(scheduler, 1000);
+    REQUIRE(out.str() == "hi");
+    REQUIRE(scheduler.get_now() == 1000);
+  }
+}
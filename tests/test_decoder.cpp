@@ -198,3 +198,513 @@ TEST_CASE("Decoder sll", "[SLL]") {
     REQUIRE(info.rs2  == 15);
   }
 }
+
+TEST_CASE("Decoder jal", "[JAL]") {
+  Decoder decoder{};
+  SECTION("jal x1, -8") {
+    Decoder::Instruction_info info{decoder.decode(0xff9ff0ef)};
+    REQUIRE(info.instruction == Decoder::Concrete_instruction::instr_jal);
+    REQUIRE(info.get_type() == Decoder::Instruction_type::uj);
+    REQUIRE(info.rd   == 1);
+    REQUIRE(info.imm  == static_cast<Uxlen>(-8));
+  }
+  SECTION("jal x0, 0x800") {
+    Decoder::Instruction_info info{decoder.decode(0x0010006f)};
+    REQUIRE(info.rd   == 0);
+    REQUIRE(info.imm  == 0x800);
+  }
+}
+
+TEST_CASE("Decoder branch", "[BRANCH]") {
+  Decoder decoder{};
+  SECTION("beq x2, x3, -4") {
+    Decoder::Instruction_info info{decoder.decode(0xfe310ee3)};
+    REQUIRE(info.instruction == Decoder::Concrete_instruction::instr_beq);
+    REQUIRE(info.get_type() == Decoder::Instruction_type::sb);
+    REQUIRE(info.rs1  == 2);
+    REQUIRE(info.rs2  == 3);
+    REQUIRE(info.imm  == static_cast<Uxlen>(-4));
+  }
+  SECTION("bne x2, x3, 2048") {
+    Decoder::Instruction_info info{decoder.decode(0x003110e3)};
+    REQUIRE(info.instruction == Decoder::Concrete_instruction::instr_bne);
+    REQUIRE(info.imm  == 2048);
+  }
+}
+
+TEST_CASE("Decoder system", "[SYSTEM]") {
+  Decoder decoder{};
+  SECTION("mret") {
+    REQUIRE(decoder.decode(0x30200073).instruction == Decoder::Concrete_instruction::instr_mret);
+  }
+  SECTION("ecall and ebreak") {
+    REQUIRE(decoder.decode(0x00000073).instruction == Decoder::Concrete_instruction::instr_ecall);
+    REQUIRE(decoder.decode(0x00100073).instruction ==
+        Decoder::Concrete_instruction::instr_ebreak);
+    Decoder c_decoder{Isa_extension::isa_c};
+    Decoder::Instruction_info info{c_decoder.decode(0x9002)}; // c.ebreak
+    REQUIRE(info.instruction == Decoder::Concrete_instruction::instr_ebreak);
+    REQUIRE(info.length == 2);
+  }
+  SECTION("wfi") {
+    Decoder::Instruction_info info{decoder.decode(0x10500073)};
+    REQUIRE(info.instruction == Decoder::Concrete_instruction::instr_wfi);
+    REQUIRE(info.get_type() == Decoder::Instruction_type::none);
+  }
+  SECTION("fence") {
+    Decoder::Instruction_info info{decoder.decode(0x0330000f)}; // fence rw, rw
+    REQUIRE(info.instruction == Decoder::Concrete_instruction::instr_fence);
+    REQUIRE(info.imm == 0x033);
+    // fence.tso
+    REQUIRE((decoder.decode(0x8330000f).imm & 0xfff) == 0x833);
+  }
+  SECTION("s") {
+    Decoder s_decoder{Isa_extension::isa_s};
+    REQUIRE(s_decoder.decode(0x10200073).instruction ==
+        Decoder::Concrete_instruction::instr_sret);
+    Decoder::Instruction_info info{s_decoder.decode(0x12b50073)}; // sfence.vma a0, a1
+    REQUIRE(info.instruction == Decoder::Concrete_instruction::instr_sfence_vma);
+    REQUIRE(info.rs1 == 10);
+    REQUIRE(info.rs2 == 11);
+    REQUIRE_THROWS_AS(decoder.decode(0x10200073), Errors::Illegal_instruction);
+  }
+}
+
+TEST_CASE("Decoder m", "[M]") {
+  SECTION("enabled m") {
+    Decoder decoder{Isa_extension::isa_m};
+    SECTION("mul x1, x2, x3") {
+      Decoder::Instruction_info info{decoder.decode(0x023100b3)};
+      REQUIRE(info.instruction == Decoder::Concrete_instruction::instr_mul);
+      REQUIRE(info.get_type() == Decoder::Instruction_type::r);
+      REQUIRE(info.rd   == 1);
+      REQUIRE(info.rs1  == 2);
+      REQUIRE(info.rs2  == 3);
+    }
+    SECTION("div x1, x2, x3") {
+      REQUIRE(decoder.decode(0x023140b3).instruction == Decoder::Concrete_instruction::instr_div);
+    }
+    SECTION("remu x1, x2, x3") {
+      REQUIRE(decoder.decode(0x023170b3).instruction == Decoder::Concrete_instruction::instr_remu);
+    }
+  }
+  SECTION("disabled m") {
+    Decoder decoder{};
+    REQUIRE_THROWS_AS(decoder.decode(0x023100b3), Errors::Illegal_instruction);
+    REQUIRE(decoder.decode(0x003100b3).instruction == Decoder::Concrete_instruction::instr_add);
+  }
+}
+
+TEST_CASE("Decoder c", "[C]") {
+  using enum Decoder::Concrete_instruction;
+  struct Expansion {
+    Uxlen instruction;
+    Decoder::Concrete_instruction expanded;
+    unsigned int rd;
+    unsigned int rs1;
+    unsigned int rs2;
+    Uxlen imm;
+  };
+
+  SECTION("enabled c") {
+    Decoder decoder{{Isa_extension::isa_c}};
+    const Expansion expansions[]{
+      {0x1475, instr_addi, 8 , 8, 0 , static_cast<Uxlen>(-3) }, // c.addi x8, -3
+      {0x4495, instr_addi, 9 , 0, 0 , 5                      }, // c.li x9, 5
+      {0x4048, instr_lw  , 10, 8, 0 , 4                      }, // c.lw x10, 4(x8)
+      {0xc488, instr_sw  , 0 , 9, 10, 8                      }, // c.sw x10, 8(x9)
+      {0xbfed, instr_jal , 0 , 0, 0 , static_cast<Uxlen>(-6) }, // c.j -6
+      {0x2095, instr_jal , 1 , 0, 0 , 100                    }, // c.jal 100
+      {0xc409, instr_beq , 0 , 8, 0 , 10                     }, // c.beqz x8, 10
+      {0xfcf5, instr_bne , 0 , 9, 0 , static_cast<Uxlen>(-4) }, // c.bnez x9, -4
+      {0x8282, instr_jalr, 0 , 5, 0 , 0                      }, // c.jr x5
+      {0x9282, instr_jalr, 1 , 5, 0 , 0                      }, // c.jalr x5
+      {0x831e, instr_add , 6 , 0, 7 , 0                      }, // c.mv x6, x7
+      {0x931e, instr_add , 6 , 6, 7 , 0                      }, // c.add x6, x7
+      {0x8c65, instr_and , 8 , 8, 9 , 0                      }, // c.and x8, x9
+      {0x7139, instr_addi, 2 , 2, 0 , static_cast<Uxlen>(-64)}, // c.addi16sp -64
+      {0x72fd, instr_lui , 5 , 0, 0 , 0xfffff                }, // c.lui x5, 0xfffff
+      {0x0840, instr_addi, 8 , 2, 0 , 20                     }, // c.addi4spn x8, sp, 20
+      {0x43b2, instr_lw  , 7 , 2, 0 , 12                     }, // c.lwsp x7, 12(sp)
+      {0xc81e, instr_sw  , 0 , 2, 7 , 16                     }, // c.swsp x7, 16(sp)
+      {0x848d, instr_srai, 9 , 9, 0 , 3                      }, // c.srai x9, 3
+      {0x029e, instr_slli, 5 , 5, 0 , 7                      }, // c.slli x5, 7
+      {0x997d, instr_andi, 10, 10, 0, static_cast<Uxlen>(-1) }, // c.andi x10, -1
+    };
+    for (const Expansion &expansion : expansions) {
+      // The upper halfword belongs to the next instruction.
+      const Decoder::Instruction_info info{decoder.decode(0xabcd0000 | expansion.instruction)};
+      INFO("instruction: " << std::hex << expansion.instruction);
+      REQUIRE(info.instruction == expansion.expanded);
+      REQUIRE(info.length == 2);
+      REQUIRE(info.rd  == expansion.rd );
+      REQUIRE(info.rs1 == expansion.rs1);
+      REQUIRE(info.rs2 == expansion.rs2);
+      REQUIRE(info.imm == expansion.imm);
+    }
+
+    REQUIRE(decoder.decode(0x003100b3).length == 4);
+    REQUIRE_THROWS_AS(decoder.decode(0x0000), Errors::Illegal_instruction); // all zeros
+    REQUIRE_THROWS_AS(decoder.decode(0x6101), Errors::Illegal_instruction); // c.addi16sp 0
+  }
+  SECTION("disabled c") {
+    Decoder decoder{};
+    REQUIRE_THROWS_AS(decoder.decode(0x1475), Errors::Illegal_instruction);
+  }
+}
+
+TEST_CASE("Decoder bitmanip", "[ZB]") {
+  using enum Decoder::Concrete_instruction;
+  struct Encoding {
+    Uxlen instruction;
+    Decoder::Concrete_instruction decoded;
+    Decoder::Instruction_type type;
+  };
+  using enum Decoder::Instruction_type;
+  const Encoding encodings[]{
+    {0x203140b3, instr_sh2add, r    }, // sh2add x1, x2, x3
+    {0x403170b3, instr_andn  , r    }, // andn x1, x2, x3
+    {0x403140b3, instr_xnor  , r    }, // xnor x1, x2, x3
+    {0x60011093, instr_clz   , unary}, // clz x1, x2
+    {0x60111093, instr_ctz   , unary}, // ctz x1, x2
+    {0x60211093, instr_cpop  , unary}, // cpop x1, x2
+    {0x0a3160b3, instr_max   , r    }, // max x1, x2, x3
+    {0x0a3150b3, instr_minu  , r    }, // minu x1, x2, x3
+    {0x60411093, instr_sext_b, unary}, // sext.b x1, x2
+    {0x080140b3, instr_zext_h, unary}, // zext.h x1, x2
+    {0x603110b3, instr_rol   , r    }, // rol x1, x2, x3
+    {0x60715093, instr_rori  , i_sh5}, // rori x1, x2, 7
+    {0x28715093, instr_orc_b , unary}, // orc.b x1, x2
+    {0x69815093, instr_rev8  , unary}, // rev8 x1, x2
+    {0x483110b3, instr_bclr  , r    }, // bclr x1, x2, x3
+    {0x49f15093, instr_bexti , i_sh5}, // bexti x1, x2, 31
+    {0x68411093, instr_binvi , i_sh5}, // binvi x1, x2, 4
+    {0x283110b3, instr_bset  , r    }, // bset x1, x2, x3
+  };
+
+  SECTION("enabled") {
+    Decoder decoder{{Isa_extension::isa_zba, Isa_extension::isa_zbb, Isa_extension::isa_zbs}};
+    for (const Encoding &encoding : encodings) {
+      INFO("instruction: " << std::hex << encoding.instruction);
+      const Decoder::Instruction_info info{decoder.decode(encoding.instruction)};
+      REQUIRE(info.instruction == encoding.decoded);
+      REQUIRE(info.get_type() == encoding.type);
+      REQUIRE(info.rd  == 1);
+      REQUIRE(info.rs1 == 2);
+    }
+    REQUIRE(decoder.decode(0x60715093).imm == 7);
+    REQUIRE(decoder.decode(0x203140b3).rs2 == 3);
+  }
+  SECTION("disabled") {
+    Decoder decoder{};
+    for (const Encoding &encoding : encodings) {
+      INFO("instruction: " << std::hex << encoding.instruction);
+      REQUIRE_THROWS_AS(decoder.decode(encoding.instruction), Errors::Illegal_instruction);
+    }
+  }
+  SECTION("one of them") {
+    Decoder decoder{Isa_extension::isa_zbs};
+    REQUIRE(decoder.decode(0x483110b3).instruction == instr_bclr);
+    REQUIRE_THROWS_AS(decoder.decode(0x603110b3), Errors::Illegal_instruction);
+  }
+}
+
+TEST_CASE("Decoder rv64", "[RV64]") {
+  using enum Decoder::Concrete_instruction;
+  using enum Decoder::Instruction_type;
+  struct Encoding {
+    Uxlen instruction;
+    Decoder::Concrete_instruction decoded;
+    Decoder::Instruction_type type;
+    Uxlen_t<64> imm;
+  };
+  const Encoding encodings[]{
+    {0xfff1009b, instr_addiw    , i    , ~Uxlen_t<64>{0}}, // addiw x1, x2, -1
+    {0x0031109b, instr_slliw    , i_sh5, 3              }, // slliw x1, x2, 3
+    {0x41f1509b, instr_sraiw    , i_sh5, 31             }, // sraiw x1, x2, 31
+    {0x003100bb, instr_addw     , r    , 0              }, // addw x1, x2, x3
+    {0x403100bb, instr_subw     , r    , 0              }, // subw x1, x2, x3
+    {0x403150bb, instr_sraw     , r    , 0              }, // sraw x1, x2, x3
+    {0x023150bb, instr_divuw    , r    , 0              }, // divuw x1, x2, x3
+    {0xff813083, instr_ld       , i    , ~Uxlen_t<64>{7}}, // ld x1, -8(x2)
+    {0x00416083, instr_lwu      , i    , 4              }, // lwu x1, 4(x2)
+    {0x03f11093, instr_slli     , i_sh5, 63             }, // slli x1, x2, 63
+    {0x42815093, instr_srai     , i_sh5, 40             }, // srai x1, x2, 40
+    {0x02115093, instr_srli     , i_sh5, 33             }, // srli x1, x2, 33
+    {0x083100bb, instr_add_uw   , r    , 0              }, // add.uw x1, x2, x3
+    {0x0a81109b, instr_slli_uw  , i_sh5, 40             }, // slli.uw x1, x2, 40
+    {0x6001109b, instr_clzw     , unary, 0              }, // clzw x1, x2
+    {0x6051509b, instr_roriw    , i_sh5, 5              }, // roriw x1, x2, 5
+    {0x62815093, instr_rori     , i_sh5, 40             }, // rori x1, x2, 40
+    {0x6b815093, instr_rev8     , unary, 0              }, // rev8 x1, x2
+    {0x080140bb, instr_zext_h   , unary, 0              }, // zext.h x1, x2
+    {0x2bf11093, instr_bseti    , i_sh5, 63             }, // bseti x1, x2, 63
+  };
+  const Isa_ext_container extensions{Isa_extension::isa_m, Isa_extension::isa_zba,
+      Isa_extension::isa_zbb, Isa_extension::isa_zbs};
+
+  SECTION("rv64") {
+    Decoder64 decoder{extensions};
+    for (const Encoding &encoding : encodings) {
+      INFO("instruction: " << std::hex << encoding.instruction);
+      const Decoder64::Instruction_info info{decoder.decode(encoding.instruction)};
+      REQUIRE(info.instruction == encoding.decoded);
+      REQUIRE(info.get_type() == encoding.type);
+      REQUIRE(info.rd  == 1);
+      REQUIRE(info.rs1 == 2);
+      REQUIRE(info.imm == encoding.imm);
+    }
+    const Decoder64::Instruction_info sd{decoder.decode(0x00313823)}; // sd x3, 16(x2)
+    REQUIRE(sd.instruction == instr_sd);
+    REQUIRE(sd.rs1 == 2);
+    REQUIRE(sd.rs2 == 3);
+    REQUIRE(sd.imm == 16);
+  }
+  SECTION("rv32") {
+    Decoder decoder{extensions};
+    for (const Encoding &encoding : encodings) {
+      INFO("instruction: " << std::hex << encoding.instruction);
+      if (encoding.imm < 32) continue;
+      REQUIRE_THROWS_AS(decoder.decode(encoding.instruction), Errors::Illegal_instruction);
+    }
+    REQUIRE_THROWS_AS(decoder.decode(0x003100bb), Errors::Illegal_instruction); // addw
+    REQUIRE_THROWS_AS(decoder.decode(0x00313823), Errors::Illegal_instruction); // sd
+  }
+  SECTION("compressed") {
+    struct Compressed {
+      Uxlen instruction;
+      Decoder::Concrete_instruction decoded;
+      unsigned int rd;
+      unsigned int rs1;
+      unsigned int rs2;
+      Uxlen_t<64> imm;
+    };
+    const Compressed encodings_c[]{
+      {0x6504, instr_ld   ,  9, 10,  0, 8              }, // c.ld x9, 8(x10)
+      {0xfd64, instr_sd   ,  0, 10,  9, 248            }, // c.sd x9, 248(x10)
+      {0x60b2, instr_ld   ,  1,  2,  0, 264            }, // c.ldsp x1, 264(sp)
+      {0xec06, instr_sd   ,  0,  2,  1, 24             }, // c.sdsp x1, 24(sp)
+      {0x30f5, instr_addiw,  1,  1,  0, ~Uxlen_t<64>{2}}, // c.addiw x1, -3
+      {0x9c89, instr_subw ,  9,  9, 10, 0              }, // c.subw x9, x10
+      {0x9ca9, instr_addw ,  9,  9, 10, 0              }, // c.addw x9, x10
+      {0x10a2, instr_slli ,  1,  1,  0, 40             }, // c.slli x1, 40
+      {0x9485, instr_srai ,  9,  9,  0, 33             }, // c.srai x9, 33
+    };
+    Decoder64 decoder{Isa_extension::isa_c};
+    for (const Compressed &encoding : encodings_c) {
+      INFO("instruction: " << std::hex << encoding.instruction);
+      const Decoder64::Instruction_info info{decoder.decode(encoding.instruction)};
+      REQUIRE(info.instruction == encoding.decoded);
+      REQUIRE(info.length == 2);
+      REQUIRE(info.rd  == encoding.rd);
+      REQUIRE(info.rs1 == encoding.rs1);
+      REQUIRE(info.rs2 == encoding.rs2);
+      REQUIRE(info.imm == encoding.imm);
+    }
+    // c.jal on RV32.
+    REQUIRE(Decoder{Isa_extension::isa_c}.decode(0x30f5).instruction == instr_jal);
+  }
+}
+
+TEST_CASE("Decoder fd", "[FD]") {
+  using enum Decoder::Concrete_instruction;
+  using enum Decoder::Instruction_type;
+  struct Encoding {
+    Uxlen instruction;
+    Decoder::Concrete_instruction decoded;
+    Decoder::Instruction_type type;
+    unsigned int rm;
+  };
+  const Encoding encodings[]{
+    {0x203110c3, instr_fmadd_s  , r4  , 0b001}, // fmadd.s f1, f2, f3, f4, rtz
+    {0x223170cf, instr_fnmadd_d , r4  , 0b111}, // fnmadd.d f1, f2, f3, f4
+    {0x003170d3, instr_fadd_s   , r_fp, 0b111}, // fadd.s f1, f2, f3
+    {0x5a0170d3, instr_fsqrt_d  , r_fp, 0b111}, // fsqrt.d f1, f2
+    {0x203120d3, instr_fsgnjx_s , r_fp, 0b010}, // fsgnjx.s f1, f2, f3
+    {0x2a3110d3, instr_fmax_d   , r_fp, 0b001}, // fmax.d f1, f2, f3
+    {0xc00110d3, instr_fcvt_w_s , r_fp, 0b001}, // fcvt.w.s x1, f2, rtz
+    {0x401170d3, instr_fcvt_s_d , r_fp, 0b111}, // fcvt.s.d f1, f2
+    {0x420100d3, instr_fcvt_d_s , r_fp, 0b000}, // fcvt.d.s f1, f2
+    {0xe00100d3, instr_fmv_x_w  , r_fp, 0b000}, // fmv.x.w x1, f2
+    {0xe20110d3, instr_fclass_d , r_fp, 0b001}, // fclass.d x1, f2
+    {0xa23120d3, instr_feq_d    , r_fp, 0b010}, // feq.d x1, f2, f3
+    {0xd21100d3, instr_fcvt_d_wu, r_fp, 0b000}, // fcvt.d.wu f1, x2
+    {0xf00100d3, instr_fmv_w_x  , r_fp, 0b000}, // fmv.w.x f1, x2
+  };
+
+  SECTION("enabled") {
+    Decoder decoder{{Isa_extension::isa_f, Isa_extension::isa_d}};
+    for (const Encoding &encoding : encodings) {
+      INFO("instruction: " << std::hex << encoding.instruction);
+      const Decoder::Instruction_info info{decoder.decode(encoding.instruction)};
+      REQUIRE(info.instruction == encoding.decoded);
+      REQUIRE(info.get_type() == encoding.type);
+      REQUIRE(info.rd  == 1);
+      REQUIRE(info.rs1 == 2);
+      REQUIRE(info.rm  == encoding.rm);
+    }
+    REQUIRE(decoder.decode(0x203110c3).rs2 == 3);
+    REQUIRE(decoder.decode(0x203110c3).rs3 == 4);
+
+    const Decoder::Instruction_info flw{decoder.decode(0x00812087)}; // flw f1, 8(x2)
+    REQUIRE(flw.instruction == instr_flw);
+    REQUIRE(flw.get_type() == i);
+    REQUIRE(flw.imm == 8);
+    const Decoder::Instruction_info fsd{decoder.decode(0xfe313827)}; // fsd f3, -16(x2)
+    REQUIRE(fsd.instruction == instr_fsd);
+    REQUIRE(fsd.get_type() == s);
+    REQUIRE(fsd.rs2 == 3);
+    REQUIRE(fsd.imm == static_cast<Uxlen>(-16));
+
+    // fadd.s with the reserved rounding modes 5 and 6.
+    REQUIRE_THROWS_AS(decoder.decode(0x003150d3), Errors::Illegal_instruction);
+    REQUIRE_THROWS_AS(decoder.decode(0x003160d3), Errors::Illegal_instruction);
+    // fcvt.l.d is RV64 only.
+    REQUIRE_THROWS_AS(decoder.decode(0xc22170d3), Errors::Illegal_instruction);
+  }
+  SECTION("rv64") {
+    Decoder64 decoder{{Isa_extension::isa_f, Isa_extension::isa_d}};
+    REQUIRE(decoder.decode(0xc22170d3).instruction == instr_fcvt_l_d);  // fcvt.l.d x1, f2
+    REQUIRE(decoder.decode(0xf20100d3).instruction == instr_fmv_d_x);   // fmv.d.x f1, x2
+    REQUIRE(decoder.decode(0xd03170d3).instruction == instr_fcvt_s_lu); // fcvt.s.lu f1, x2
+  }
+  SECTION("f only") {
+    Decoder decoder{Isa_extension::isa_f};
+    REQUIRE(decoder.decode(0x003170d3).instruction == instr_fadd_s);
+    REQUIRE_THROWS_AS(decoder.decode(0x023170d3), Errors::Illegal_instruction); // fadd.d
+    REQUIRE_THROWS_AS(decoder.decode(0xfe313827), Errors::Illegal_instruction); // fsd
+  }
+  SECTION("disabled") {
+    Decoder decoder{};
+    for (const Encoding &encoding : encodings) {
+      INFO("instruction: " << std::hex << encoding.instruction);
+      REQUIRE_THROWS_AS(decoder.decode(encoding.instruction), Errors::Illegal_instruction);
+    }
+  }
+  SECTION("compressed") {
+    Decoder decoder{{Isa_extension::isa_c, Isa_extension::isa_f, Isa_extension::isa_d}};
+    const Decoder::Instruction_info c_flw{decoder.decode(0x6144)}; // c.flw f9, 4(x10)
+    REQUIRE(c_flw.instruction == instr_flw);
+    REQUIRE(c_flw.rd  == 9);
+    REQUIRE(c_flw.rs1 == 10);
+    REQUIRE(c_flw.imm == 4);
+    const Decoder::Instruction_info c_fld{decoder.decode(0x2504)}; // c.fld f9, 8(x10)
+    REQUIRE(c_fld.instruction == instr_fld);
+    REQUIRE(c_fld.imm == 8);
+    const Decoder::Instruction_info c_fsdsp{decoder.decode(0xa406)}; // c.fsdsp f1, 8(sp)
+    REQUIRE(c_fsdsp.instruction == instr_fsd);
+    REQUIRE(c_fsdsp.rs1 == 2);
+    REQUIRE(c_fsdsp.rs2 == 1);
+    REQUIRE(c_fsdsp.imm == 8);
+    REQUIRE(c_fsdsp.length == 2);
+
+    Decoder no_fp{Isa_extension::isa_c};
+    REQUIRE_THROWS_AS(no_fp.decode(0x2504), Errors::Illegal_instruction);
+  }
+}
+
+TEST_CASE("Decoder v", "[V]") {
+  using enum Decoder::Concrete_instruction;
+  using enum Decoder::Instruction_type;
+  struct Encoding {
+    Uxlen instruction;
+    Decoder::Concrete_instruction decoded;
+    Decoder::Instruction_type type;
+    bool vm;
+  };
+  const Encoding encodings[]{
+    {0x022180d7, instr_vadd_vv    , v     , true }, // vadd.vv v1, v2, v3
+    {0x0021c0d7, instr_vadd_vx    , v     , false}, // vadd.vx v1, v2, x3, v0.t
+    {0x6e21c0d7, instr_vmslt_vx   , v     , true }, // vmslt.vx v1, v2, x3
+    {0x0221a0d7, instr_vredsum_vs , v     , true }, // vredsum.vs v1, v2, v3
+    {0x9621a0d7, instr_vmul_vv    , v     , true }, // vmul.vv v1, v2, v3
+    {0x9a21e0d7, instr_vmulhsu_vx , v     , true }, // vmulhsu.vx v1, v2, x3
+    {0x5e01c0d7, instr_vmv_v_x    , v     , true }, // vmv.v.x v1, x3
+    {0x4201e0d7, instr_vmv_s_x    , v     , true }, // vmv.s.x v1, x3
+    {0x08315207, instr_vlse16_v   , v_load, false}, // vlse16.v v4, (x2), x3, v0.t
+    {0x02016207, instr_vle32_v    , v_load, true }, // vle32.v v4, (x2)
+  };
+
+  Decoder decoder{Isa_extension::isa_v};
+  SECTION("arithmetic") {
+    for (const Encoding &encoding : encodings) {
+      INFO("instruction: " << std::hex << encoding.instruction);
+      const Decoder::Instruction_info info{decoder.decode(encoding.instruction)};
+      REQUIRE(info.instruction == encoding.decoded);
+      REQUIRE(info.get_type() == encoding.type);
+      REQUIRE(info.vm == encoding.vm);
+    }
+    const Decoder::Instruction_info vadd_vi{decoder.decode(0x022eb0d7)}; // vadd.vi v1, v2, -3
+    REQUIRE(vadd_vi.instruction == instr_vadd_vi);
+    REQUIRE(vadd_vi.rd  == 1);
+    REQUIRE(vadd_vi.rs2 == 2);
+    REQUIRE(vadd_vi.imm == static_cast<Uxlen>(-3));
+    const Decoder::Instruction_info vsll_vi{decoder.decode(0x962fb0d7)}; // vsll.vi v1, v2, 31
+    REQUIRE(vsll_vi.instruction == instr_vsll_vi);
+    REQUIRE(vsll_vi.imm == 31);
+    const Decoder::Instruction_info vmerge{decoder.decode(0x5c22b0d7)}; // vmerge.vim v1, v2, 5, v0
+    REQUIRE(vmerge.instruction == instr_vmerge_vim);
+    REQUIRE(!vmerge.vm);
+    REQUIRE(decoder.decode(0x422020d7).instruction == instr_vmv_x_s); // vmv.x.s x1, v2
+  }
+  SECTION("memory") {
+    const Decoder::Instruction_info vsse{decoder.decode(0x0a310227)}; // vsse8.v v4, (x2), x3
+    REQUIRE(vsse.instruction == instr_vsse8_v);
+    REQUIRE(vsse.rs3 == 4);
+    REQUIRE(vsse.rs1 == 2);
+    REQUIRE(vsse.rs2 == 3);
+    REQUIRE(decoder.decode(0x02017227).instruction == instr_vse64_v); // vse64.v v4, (x2)
+    // Segment and indexed loads.
+    REQUIRE_THROWS_AS(decoder.decode(0x22016207), Errors::Illegal_instruction);
+    REQUIRE_THROWS_AS(decoder.decode(0x06816207), Errors::Illegal_instruction);
+  }
+  SECTION("config") {
+    const Decoder::Instruction_info vsetvli{decoder.decode(0x0d1170d7)}; // vsetvli x1, x2, e32, m2, ta, ma
+    REQUIRE(vsetvli.instruction == instr_vsetvli);
+    REQUIRE(vsetvli.rd  == 1);
+    REQUIRE(vsetvli.rs1 == 2);
+    REQUIRE(vsetvli.imm == 0b1101'0001);
+    const Decoder::Instruction_info vsetivli{decoder.decode(0xc00170d7)}; // vsetivli x1, 2, e8, m1, tu, mu
+    REQUIRE(vsetivli.instruction == instr_vsetivli);
+    REQUIRE(vsetivli.rs1 == 2);
+    REQUIRE(vsetivli.imm == 0);
+    REQUIRE(decoder.decode(0x803170d7).instruction == instr_vsetvl); // vsetvl x1, x2, x3
+  }
+  SECTION("disabled") {
+    Decoder no_v{Isa_extension::isa_f};
+    REQUIRE_THROWS_AS(no_v.decode(0x022180d7), Errors::Illegal_instruction);
+    REQUIRE_THROWS_AS(no_v.decode(0x02016207), Errors::Illegal_instruction);
+    // F loads are unaffected by V.
+    REQUIRE(no_v.decode(0x00812087).instruction == instr_flw);
+  }
+}
+
+TEST_CASE("Decoder a", "[A]") {
+  using enum Decoder::Concrete_instruction;
+  Decoder decoder{Isa_extension::isa_a};
+
+  const Decoder::Instruction_info sc{decoder.decode(0x183120af)}; // sc.w x1, x3, (x2)
+  REQUIRE(sc.instruction == instr_sc_w);
+  REQUIRE(sc.get_type() == Decoder::Instruction_type::r);
+  REQUIRE(sc.rd  == 1);
+  REQUIRE(sc.rs1 == 2);
+  REQUIRE(sc.rs2 == 3);
+  REQUIRE(decoder.decode(0x100120af).instruction == instr_lr_w     ); // lr.w x1, (x2)
+  REQUIRE(decoder.decode(0x0e3120af).instruction == instr_amoswap_w); // amoswap.w.aqrl x1, x3, (x2)
+  REQUIRE(decoder.decode(0x003120af).instruction == instr_amoadd_w ); // amoadd.w x1, x3, (x2)
+  REQUIRE(decoder.decode(0x203120af).instruction == instr_amoxor_w ); // amoxor.w x1, x3, (x2)
+  REQUIRE(decoder.decode(0x803120af).instruction == instr_amomin_w ); // amomin.w x1, x3, (x2)
+  REQUIRE(decoder.decode(0xe03120af).instruction == instr_amomaxu_w); // amomaxu.w x1, x3, (x2)
+  // lr with rs2, and the doubleword forms on RV32.
+  REQUIRE_THROWS_AS(decoder.decode(0x103120af), Errors::Illegal_instruction);
+  REQUIRE_THROWS_AS(decoder.decode(0x100130af), Errors::Illegal_instruction);
+
+  const Decoder64 decoder64{Isa_extension::isa_a};
+  REQUIRE(decoder64.decode(0x100130af).instruction == instr_lr_d     ); // lr.d x1, (x2)
+  REQUIRE(decoder64.decode(0x183130af).instruction == instr_sc_d     ); // sc.d x1, x3, (x2)
+  REQUIRE(decoder64.decode(0x403130af).instruction == instr_amoor_d  ); // amoor.d x1, x3, (x2)
+  REQUIRE(decoder64.decode(0x003120af).instruction == instr_amoadd_w ); // amoadd.w x1, x3, (x2)
+
+  const Decoder no_a{Isa_extension::isa_m};
+  REQUIRE_THROWS_AS(no_a.decode(0x003120af), Errors::Illegal_instruction);
+}
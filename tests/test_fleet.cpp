@@ -0,0 +1,120 @@
+#define CATCH_CONFIG_MAIN
+
+#include "fleet.hpp"
+
+#include "spdlog/logger.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "catch2/catch_test_macros.hpp"
+
+#include <vector>
+
+namespace {
+  Fleet_image make_image(const std::vector<std::uint32_t> &words, std::size_t base,
+      std::size_t ram_size) {
+    std::vector<std::byte> content{};
+    for (const std::uint32_t word : words) {
+      for (unsigned int lane{0}; lane < 4; ++lane) {
+        content.push_back(static_cast<std::byte>(word >> (lane * 8)));
+      }
+    }
+    return {Image_cache::get_instance().intern(content), base, ram_size};
+  }
+
+  constexpr std::size_t base{0x1000};
+  const std::vector<std::uint32_t> program{
+    0x00000513, // 0x1000: addi a0, x0, 0
+    0x06400593, // 0x1004: addi a1, x0, 100
+    0x00b50533, // 0x1008: add a0, a0, a1
+    0xfff58593, // 0x100c: addi a1, a1, -1
+    0xfe059ce3, // 0x1010: bnez a1, -8
+    0x0000006f, // 0x1014: j .
+    0x00000597, // 0x1018: auipc a1, 0
+    0x0105a503, // 0x101c: lw a0, 16(a1)
+    0x00a5aa23, // 0x1020: sw a0, 20(a1)
+    0x10500073, // 0x1024: wfi
+    0x12345678, // 0x1028: data
+    0x00000000, // 0x102c: illegal, also after the store above
+  };
+}
+
+TEST_CASE("Fleet", "[FLEET]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  const Fleet_image image{make_image(program, base, 0x2000)};
+  const Fleet_image too_big{make_image(program, base, 0x1020)};
+  using enum Fleet_result::Status;
+
+  SECTION("statuses") {
+    const std::vector<Fleet_job> jobs{
+      {.image = image  , .entry = 0x1000, .budget = 1000, .expected_exit = 5050      },
+      {.image = image  , .entry = 0x1018, .budget = 1000, .expected_exit = 0x12345678},
+      {.image = image  , .entry = 0x1000, .budget = 1000, .expected_exit = 5049      },
+      {.image = image  , .entry = 0x1000, .budget = 10  , .expected_exit = 5050      },
+      {.image = image  , .entry = 0x102c, .budget = 1000, .expected_exit = 0         },
+      {.image = too_big, .entry = 0x1000, .budget = 1000, .expected_exit = 5050      },
+      {.image = image  , .entry = 0x1018, .budget = 1000                             },
+    };
+    const Fleet fleet{my_logger, {}, 3};
+    const Fleet_report report{fleet.run(jobs)};
+
+    REQUIRE(report.results.size() == jobs.size());
+    REQUIRE(report.results[0].status == passed);
+    REQUIRE(report.results[0].exit == 5050);
+    REQUIRE(report.results[0].instructions == 2 + 3 * 100 + 1);
+    REQUIRE(report.results[0].private_pages == 0);
+    REQUIRE(report.results[1].status == passed);
+    REQUIRE(report.results[1].instructions == 4);
+    REQUIRE(report.results[1].private_pages == 1);
+    REQUIRE(report.results[2].status == failed);
+    REQUIRE(report.results[2].exit == 5050);
+    REQUIRE(report.results[3].status == timed_out);
+    REQUIRE(report.results[3].instructions == 10);
+    REQUIRE(report.results[4].status == error);
+    REQUIRE(!report.results[4].message.empty());
+    REQUIRE(report.results[5].status == error);
+    REQUIRE(report.results[6].status == passed);
+
+    REQUIRE(report.passed    == 3);
+    REQUIRE(report.failed    == 1);
+    REQUIRE(report.timed_out == 1);
+    REQUIRE(report.errors    == 2);
+    REQUIRE(report.instructions == 2 * 303 + 4 + 10 + 4);
+  }
+
+  SECTION("many jobs") {
+    constexpr std::size_t count{200};
+    const std::vector<Fleet_job> jobs(count,
+        {.image = image, .entry = 0x1000, .budget = 1000, .expected_exit = 5050});
+    const Fleet fleet{my_logger, {}, 4};
+    const Fleet_report report{fleet.run(jobs)};
+
+    REQUIRE(report.passed == count);
+    REQUIRE(report.instructions == count * 303);
+    REQUIRE(report.seconds > 0);
+    REQUIRE(report.get_instructions_per_second() > 0);
+    // One copy for all, the same content interned twice included, and released by the
+    // jobs' memories.
+    REQUIRE(image.image == too_big.image);
+    REQUIRE(image.image.use_count() == count + 2);
+  }
+
+  SECTION("no jobs") {
+    const Fleet fleet{my_logger};
+    REQUIRE(fleet.get_threads() > 0);
+    REQUIRE(fleet.run({}).results.empty());
+  }
+}
+
+TEST_CASE("Fleet64", "[FLEET]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  const Fleet_image image{make_image(program, base, 0x2000)};
+  const Fleet64 fleet{my_logger, {}, 2};
+  const Fleet_report report{fleet.run({
+    {.image = image, .entry = 0x1000, .budget = 1000, .expected_exit = 5050      },
+    {.image = image, .entry = 0x1018, .budget = 1000, .expected_exit = 0x12345678},
+  })};
+  REQUIRE(report.passed == 2);
+}
@@ -0,0 +1,169 @@
+#define CATCH_CONFIG_MAIN
+
+#include "fpu.hpp"
+
+#include "catch2/catch_test_macros.hpp"
+
+#include <bit>
+#include <limits>
+
+namespace {
+  using Fpu::Format;
+  using Fpu::Reg;
+
+  [[nodiscard("PURE FUN")]] Reg box(float value) {
+    return Reg{0xffff'ffff'0000'0000} | std::bit_cast<std::uint32_t>(value);
+  }
+  [[nodiscard("PURE FUN")]] Reg box(double value) { return std::bit_cast<Reg>(value); }
+
+  constexpr Reg canonical_nan_s{0xffff'ffff'7fc0'0000};
+  constexpr Reg canonical_nan_d{0x7ff8'0000'0000'0000};
+  constexpr Reg signaling_nan_s{0xffff'ffff'7f80'0001};
+}
+
+TEST_CASE("Fpu arithmetic", "[ARITH]") {
+  Fpu::set_rounding_mode(Fpu::RNE);
+  static_cast<void>(Fpu::take_flags());
+
+  SECTION("single") {
+    REQUIRE(Fpu::calc(Fpu::ADD, Format::s, box(1.5f), box(2.25f)) == box(3.75f));
+    REQUIRE(Fpu::calc(Fpu::MUL, Format::s, box(-2.0f), box(4.0f)) == box(-8.0f));
+    REQUIRE(Fpu::calc(Fpu::SQRT, Format::s, box(9.0f)) == box(3.0f));
+    REQUIRE(Fpu::calc(Fpu::MADD, Format::s, box(2.0f), box(3.0f), box(1.0f)) == box(7.0f));
+    REQUIRE(Fpu::calc(Fpu::NMSUB, Format::s, box(2.0f), box(3.0f), box(1.0f)) == box(-5.0f));
+    REQUIRE(Fpu::calc(Fpu::NMADD, Format::s, box(2.0f), box(3.0f), box(1.0f)) == box(-7.0f));
+    REQUIRE(Fpu::take_flags() == 0);
+  }
+  SECTION("double") {
+    REQUIRE(Fpu::calc(Fpu::SUB, Format::d, box(1.0), box(0.25)) == box(0.75));
+    REQUIRE(Fpu::calc(Fpu::DIV, Format::d, box(1.0), box(4.0)) == box(0.25));
+    REQUIRE(Fpu::calc(Fpu::MSUB, Format::d, box(2.0), box(3.0), box(1.0)) == box(5.0));
+  }
+  SECTION("nan boxing") {
+    // A single that isn't boxed reads as the canonical NaN.
+    REQUIRE(Fpu::calc(Fpu::ADD, Format::s, 0x3f80'0000, box(1.0f)) == canonical_nan_s);
+    REQUIRE(Fpu::calc(Fpu::SGNJN, Format::s, 0x3f80'0000, box(1.0f)) ==
+        (canonical_nan_s | 0x8000'0000));
+  }
+  SECTION("canonical nan") {
+    REQUIRE(Fpu::calc(Fpu::SQRT, Format::s, box(-1.0f)) == canonical_nan_s);
+    REQUIRE(Fpu::take_flags() == Fpu::NV);
+    const double inf{std::numeric_limits<double>::infinity()};
+    REQUIRE(Fpu::calc(Fpu::SUB, Format::d, box(inf), box(inf)) == canonical_nan_d);
+    REQUIRE(Fpu::take_flags() == Fpu::NV);
+  }
+  SECTION("convert format") {
+    REQUIRE(Fpu::calc(Fpu::CVT_F, Format::d, box(1.5f)) == box(1.5));
+    REQUIRE(Fpu::calc(Fpu::CVT_F, Format::s, box(0.1)) == box(0.1f));
+    REQUIRE(Fpu::take_flags() == Fpu::NX);
+  }
+}
+
+TEST_CASE("Fpu flags", "[FLAGS]") {
+  Fpu::set_rounding_mode(Fpu::RNE);
+  static_cast<void>(Fpu::take_flags());
+
+  REQUIRE(Fpu::calc(Fpu::DIV, Format::s, box(1.0f), box(0.0f)) ==
+      box(std::numeric_limits<float>::infinity()));
+  REQUIRE(Fpu::take_flags() == Fpu::DZ);
+  REQUIRE(Fpu::take_flags() == 0);
+
+  static_cast<void>(Fpu::calc(Fpu::MUL, Format::s, box(3e38f), box(10.0f)));
+  REQUIRE(Fpu::take_flags() == (Fpu::OF | Fpu::NX));
+
+  static_cast<void>(Fpu::calc(Fpu::ADD, Format::d, box(1.0), box(1e-30)));
+  // Accrue until taken.
+  static_cast<void>(Fpu::calc(Fpu::DIV, Format::d, box(1.0), box(0.0)));
+  REQUIRE(Fpu::take_flags() == (Fpu::NX | Fpu::DZ));
+}
+
+TEST_CASE("Fpu rounding", "[ROUNDING]") {
+  const Reg one{box(1.0f)};
+  const Reg three{box(3.0f)};
+  SECTION("arithmetic") {
+    Fpu::set_rounding_mode(Fpu::RDN);
+    const Reg down{Fpu::calc(Fpu::DIV, Format::s, one, three)};
+    Fpu::set_rounding_mode(Fpu::RUP);
+    const Reg up{Fpu::calc(Fpu::DIV, Format::s, one, three)};
+    Fpu::set_rounding_mode(Fpu::RTZ);
+    const Reg toward_zero{Fpu::calc(Fpu::DIV, Format::s, one, three)};
+    Fpu::set_rounding_mode(Fpu::RNE);
+    REQUIRE(up == down + 1);
+    REQUIRE(toward_zero == down);
+    REQUIRE(Fpu::calc(Fpu::DIV, Format::s, one, three) == up);
+  }
+  SECTION("to integer") {
+    Fpu::set_rounding_mode(Fpu::RNE);
+    REQUIRE(Fpu::to_integer(Fpu::CVT_W, Format::s, box(2.5f), 0, Fpu::RNE) == 2);
+    REQUIRE(Fpu::to_integer(Fpu::CVT_W, Format::s, box(2.5f), 0, Fpu::RMM) == 3);
+    REQUIRE(Fpu::to_integer(Fpu::CVT_W, Format::s, box(-2.5f), 0, Fpu::RMM) ==
+        static_cast<std::uint64_t>(-3));
+    Fpu::set_rounding_mode(Fpu::RUP);
+    REQUIRE(Fpu::to_integer(Fpu::CVT_W, Format::d, box(2.1), 0, Fpu::RUP) == 3);
+    Fpu::set_rounding_mode(Fpu::RTZ);
+    REQUIRE(Fpu::to_integer(Fpu::CVT_W, Format::d, box(-2.9), 0, Fpu::RTZ) ==
+        static_cast<std::uint64_t>(-2));
+    Fpu::set_rounding_mode(Fpu::RNE);
+  }
+}
+
+TEST_CASE("Fpu integer results", "[INTEGER]") {
+  Fpu::set_rounding_mode(Fpu::RNE);
+  static_cast<void>(Fpu::take_flags());
+  const float nan{std::numeric_limits<float>::quiet_NaN()};
+  const float inf{std::numeric_limits<float>::infinity()};
+
+  SECTION("saturation") {
+    REQUIRE(Fpu::to_integer(Fpu::CVT_W, Format::s, box(3e9f), 0, Fpu::RNE) == 0x7fff'ffff);
+    REQUIRE(Fpu::to_integer(Fpu::CVT_W, Format::s, box(-3e9f), 0, Fpu::RNE) ==
+        0xffff'ffff'8000'0000);
+    REQUIRE(Fpu::to_integer(Fpu::CVT_W, Format::s, box(nan), 0, Fpu::RNE) == 0x7fff'ffff);
+    // Unsigned words are sign-extended too.
+    REQUIRE(Fpu::to_integer(Fpu::CVT_WU, Format::s, box(inf), 0, Fpu::RNE) ==
+        0xffff'ffff'ffff'ffff);
+    REQUIRE(Fpu::to_integer(Fpu::CVT_WU, Format::s, box(-1.0f), 0, Fpu::RNE) == 0);
+    REQUIRE(Fpu::to_integer(Fpu::CVT_LU, Format::d, box(-1.0), 0, Fpu::RNE) == 0);
+    REQUIRE(Fpu::take_flags() == Fpu::NV);
+    REQUIRE(Fpu::to_integer(Fpu::CVT_WU, Format::s, box(-0.25f), 0, Fpu::RNE) == 0);
+    REQUIRE(Fpu::take_flags() == Fpu::NX);
+    REQUIRE(Fpu::to_integer(Fpu::CVT_L, Format::d, box(-0x1p63), 0, Fpu::RNE) ==
+        0x8000'0000'0000'0000);
+    REQUIRE(Fpu::take_flags() == 0);
+  }
+  SECTION("compare") {
+    REQUIRE(Fpu::to_integer(Fpu::LT, Format::s, box(1.0f), box(2.0f), Fpu::RNE) == 1);
+    REQUIRE(Fpu::to_integer(Fpu::LE, Format::d, box(2.0), box(2.0), Fpu::RNE) == 1);
+    REQUIRE(Fpu::to_integer(Fpu::EQ, Format::s, box(nan), box(nan), Fpu::RNE) == 0);
+    REQUIRE(Fpu::take_flags() == 0);
+    REQUIRE(Fpu::to_integer(Fpu::EQ, Format::s, signaling_nan_s, box(1.0f), Fpu::RNE) == 0);
+    REQUIRE(Fpu::take_flags() == Fpu::NV);
+    REQUIRE(Fpu::to_integer(Fpu::LT, Format::s, box(nan), box(1.0f), Fpu::RNE) == 0);
+    REQUIRE(Fpu::take_flags() == Fpu::NV);
+  }
+  SECTION("min max") {
+    REQUIRE(Fpu::calc(Fpu::MIN, Format::s, box(nan), box(1.0f)) == box(1.0f));
+    REQUIRE(Fpu::calc(Fpu::MAX, Format::s, box(nan), box(nan)) == canonical_nan_s);
+    REQUIRE(Fpu::calc(Fpu::MIN, Format::d, box(0.0), box(-0.0)) == box(-0.0));
+    REQUIRE(Fpu::calc(Fpu::MAX, Format::d, box(-0.0), box(0.0)) == box(0.0));
+    REQUIRE(Fpu::take_flags() == 0);
+  }
+  SECTION("classify") {
+    REQUIRE(Fpu::to_integer(Fpu::CLASS, Format::s, box(-inf), 0, Fpu::RNE) == 1 << 0);
+    REQUIRE(Fpu::to_integer(Fpu::CLASS, Format::s, box(-0.0f), 0, Fpu::RNE) == 1 << 3);
+    REQUIRE(Fpu::to_integer(Fpu::CLASS, Format::d, box(1e-310), 0, Fpu::RNE) == 1 << 5);
+    REQUIRE(Fpu::to_integer(Fpu::CLASS, Format::s, signaling_nan_s, 0, Fpu::RNE) == 1 << 8);
+    REQUIRE(Fpu::to_integer(Fpu::CLASS, Format::s, box(nan), 0, Fpu::RNE) == 1 << 9);
+  }
+  SECTION("moves") {
+    REQUIRE(Fpu::to_integer(Fpu::MV_X, Format::s, box(-1.0f), 0, Fpu::RNE) ==
+        0xffff'ffff'bf80'0000);
+    REQUIRE(Fpu::from_integer(Fpu::MV_F, Format::s, 0x3f80'0000) == box(1.0f));
+    REQUIRE(Fpu::from_integer(Fpu::MV_F, Format::d, 0x3ff0'0000'0000'0000) == box(1.0));
+  }
+  SECTION("from integer") {
+    REQUIRE(Fpu::from_integer(Fpu::CVT_FROM_W, Format::s, 0xffff'ffff) == box(-1.0f));
+    REQUIRE(Fpu::from_integer(Fpu::CVT_FROM_WU, Format::d, 0xffff'ffff) == box(4294967295.0));
+    REQUIRE(Fpu::from_integer(Fpu::CVT_FROM_LU, Format::s, ~std::uint64_t{0}) == box(0x1p64f));
+    REQUIRE(Fpu::take_flags() == Fpu::NX);
+  }
+}
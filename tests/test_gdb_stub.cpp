@@ -0,0 +1,280 @@
+#define CATCH_CONFIG_MAIN
+
+#include "gdb_stub.hpp"
+
+#include "core.hpp"
+#include "history.hpp"
+#include "csr.hpp"
+#include "instr_mem.hpp"
+#include "isa_extension.hpp"
+#include "ram.hpp"
+#include "rf.hpp"
+#include "scheduler.hpp"
+#include "watchpoints.hpp"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spdlog/logger.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "catch2/catch_test_macros.hpp"
+
+namespace {
+  // The debugger's end of the connection.
+  struct Client {
+    int fd{-1};
+    bool no_ack{false};
+
+    void send(const std::string &data) const {
+      unsigned int sum{0};
+      for (const char c : data) sum += static_cast<unsigned char>(c);
+      char checksum[3]{};
+      std::snprintf(checksum, sizeof(checksum), "%02x", sum & 0xff);
+      const std::string packet{"$" + data + "#" + checksum};
+      REQUIRE(::write(fd, packet.data(), packet.size()) == static_cast<ssize_t>(packet.size()));
+    }
+
+    // Skips the ack of the request and acks the reply.
+    [[nodiscard]] std::string receive() const {
+      std::string input{};
+      char c{};
+      while ((input.size() < 3) || (input[input.size() - 3] != '#')) {
+        if (::read(fd, &c, 1) != 1) return "";
+        if (input.empty() && (c != '$')) continue;
+        input += c;
+      }
+      if (!no_ack) REQUIRE(::write(fd, "+", 1) == 1);
+      return input.substr(1, input.size() - 4);
+    }
+
+    [[nodiscard]] std::string request(const std::string &data) const {
+      send(data);
+      return receive();
+    }
+  };
+
+  std::shared_ptr<spdlog::logger> make_logger() {
+    auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
+    return std::make_shared<spdlog::logger>("console", sink);
+  }
+}
+
+TEST_CASE("gdb stub", "[GDB]") {
+  const std::vector<Uxlen> program{
+    0x00000513, // addi a0, x0, 0
+    0x00150513, // addi a0, a0, 1
+    0x10a02023, // sw a0, 0x100(x0)
+    0x10002583, // lw a1, 0x100(x0)
+    0xff5ff06f, // j 0x4
+  };
+  Ram ram{0x1000};
+  for (std::size_t i{0}; i < program.size(); ++i) ram.write(4 * i, program[i]);
+
+  Scheduler scheduler{};
+  Watchpoints watchpoints{};
+  Watch_mem_wrap data_mem{ram, watchpoints};
+  Rf rf{};
+  Csr csr{};
+  Core core{ram, data_mem, csr, rf, make_logger()};
+
+  int fds[2]{};
+  REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  Client client{.fd = fds[1]};
+  std::thread server{[&]() {
+    Gdb_stub stub{fds[0], core, rf, csr, ram, scheduler, &watchpoints};
+    stub.serve();
+  }};
+
+  REQUIRE(client.request("qSupported:swbreak+").starts_with("PacketSize=4000;"));
+  REQUIRE(client.request("QStartNoAckMode") == "OK");
+  client.no_ack = true;
+  REQUIRE(client.request("?") == "S05");
+  REQUIRE(client.request("g") == std::string(33 * 8, '0'));
+  // The target description, in chunks.
+  std::string xml{};
+  for (std::string chunk{"m"}; chunk.starts_with("m");) {
+    char offset[17]{};
+    std::snprintf(offset, sizeof(offset), "%zx", xml.size());
+    chunk = client.request(std::string{"qXfer:features:read:target.xml:"} + offset + ",400");
+    REQUIRE(!chunk.empty());
+    xml += chunk.substr(1);
+  }
+  REQUIRE(xml.starts_with("<?xml"));
+  REQUIRE(xml.ends_with("</target>"));
+  REQUIRE(xml.find("riscv:rv32") != std::string::npos);
+
+  // Execution stops before the instruction at a breakpoint, every time round the loop.
+  REQUIRE(client.request("Z0,8,4") == "OK");
+  REQUIRE(client.request("c") == "T05");
+  REQUIRE(client.request("p20") == "08000000");
+  REQUIRE(client.request("pa") == "01000000");
+  REQUIRE(client.request("c") == "T05");
+  REQUIRE(client.request("pa") == "02000000");
+  REQUIRE(client.request("z0,8,4") == "OK");
+
+  // And after the access at a watchpoint, even the first one when continuing.
+  REQUIRE(client.request("Z2,100,4") == "OK");
+  REQUIRE(client.request("c") == "T05watch:100;");
+  REQUIRE(client.request("p20") == "0c000000");
+  REQUIRE(client.request("m100,4") == "02000000");
+  REQUIRE(client.request("z2,100,4") == "OK");
+  REQUIRE(client.request("Z3,102,1") == "OK");
+  REQUIRE(client.request("c") == "T05rwatch:102;");
+  REQUIRE(client.request("p20") == "10000000");
+  REQUIRE(client.request("z3,102,1") == "OK");
+
+  REQUIRE(client.request("s") == "T05");
+  REQUIRE(client.request("p20") == "04000000");
+  REQUIRE(client.request("?") == "T05");
+
+  // Registers and memory.
+  REQUIRE(client.request("Pa=2a000000") == "OK");
+  REQUIRE(rf.read(10) == 42);
+  REQUIRE(client.request("P20=00000000") == "OK");
+  REQUIRE(core.get_pc() == 0);
+  REQUIRE(client.request("P21=0000000000000840") == "OK");
+  REQUIRE(core.get_fp_rf().read(0) == 0x4008000000000000);
+  // mstatus, then a csr that doesn't exist.
+  REQUIRE(client.request("p341").size() == 8);
+  REQUIRE(client.request("p41") == "E01");
+  REQUIRE(client.request("M200,4:78563412") == "OK");
+  REQUIRE(ram.read(0x200) == 0x12345678);
+  REQUIRE(client.request("m200,2") == "7856");
+  REQUIRE(client.request("m10000,4") == "E01");
+  REQUIRE(client.request("Mzz") == "E01");
+  REQUIRE(client.request("vMustReplyEmpty").empty());
+
+  // ctrl-c stops a running core.
+  client.send("c");
+  REQUIRE(::write(client.fd, "\x03", 1) == 1);
+  REQUIRE(client.receive() == "T02");
+
+  REQUIRE(client.request("Z0,4,4") == "OK");
+  REQUIRE(client.request("D") == "OK");
+  server.join();
+  ::close(client.fd);
+  // Detaching removes the breakpoints.
+  core.step();
+  core.step();
+  REQUIRE_FALSE(core.is_stopped());
+}
+
+TEST_CASE("gdb stub reverse", "[GDB]") {
+  const std::vector<Uxlen> program{
+    0x00000513, // addi a0, x0, 0
+    0x00150513, // addi a0, a0, 1
+    0x10a02023, // sw a0, 0x100(x0)
+    0x10002583, // lw a1, 0x100(x0)
+    0xff5ff06f, // j 0x4
+  };
+  Ram ram{0x1000};
+  for (std::size_t i{0}; i < program.size(); ++i) ram.write(4 * i, program[i]);
+
+  Scheduler scheduler{};
+  Rf rf{};
+  Csr csr{};
+  Core core{ram, ram, csr, rf, make_logger()};
+  History history{core, rf, csr, ram, scheduler, {.interval = 1000}};
+
+  int fds[2]{};
+  REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  Client client{.fd = fds[1]};
+  std::thread server{[&]() {
+    Gdb_stub stub{fds[0], core, rf, csr, ram, scheduler, nullptr, &history};
+    stub.serve();
+  }};
+
+  REQUIRE(client.request("qSupported").find("ReverseContinue+") != std::string::npos);
+  REQUIRE(client.request("Z0,8,4") == "OK");
+  REQUIRE(client.request("c") == "T05");
+  REQUIRE(client.request("c") == "T05");
+  REQUIRE(client.request("pa") == "02000000");
+
+  // Back to the previous hit of the breakpoint, then to the beginning.
+  REQUIRE(client.request("bc") == "T05");
+  REQUIRE(client.request("p20") == "08000000");
+  REQUIRE(client.request("pa") == "01000000");
+  REQUIRE(client.request("bc") == "T05replaylog:begin;");
+  REQUIRE(client.request("p20") == "00000000");
+  REQUIRE(client.request("bs") == "T05replaylog:begin;");
+
+  REQUIRE(client.request("c") == "T05");
+  REQUIRE(client.request("bs") == "T05");
+  REQUIRE(client.request("p20") == "04000000");
+  // Changing the past changes what follows.
+  REQUIRE(client.request("Pa=05000000") == "OK");
+  REQUIRE(client.request("c") == "T05");
+  REQUIRE(client.request("pa") == "06000000");
+  REQUIRE(client.request("bs") == "T05");
+  REQUIRE(client.request("pa") == "05000000");
+
+  client.send("k");
+  server.join();
+  ::close(client.fd);
+}
+
+TEST_CASE("gdb stub exit", "[GDB]") {
+  const std::vector<Uxlen> program{
+    0x00300513, // addi a0, x0, 3
+    0x00000073, // ecall
+  };
+  Ram ram{0x1000};
+  for (std::size_t i{0}; i < program.size(); ++i) ram.write(4 * i, program[i]);
+
+  Scheduler scheduler{};
+  Rf rf{};
+  Csr csr{};
+  Core core{ram, ram, csr, rf, make_logger()};
+  core.set_ecall_handler([&rf]() -> std::optional<Uxlen> { return rf.read(10); });
+
+  int fds[2]{};
+  REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  Client client{.fd = fds[1]};
+  std::thread server{[&]() {
+    Gdb_stub stub{fds[0], core, rf, csr, ram, scheduler};
+    stub.serve();
+  }};
+
+  // Without Watchpoints there are no watchpoints.
+  REQUIRE(client.request("Z2,100,4").empty());
+  REQUIRE(client.request("c") == "W03");
+  client.send("k");
+  server.join();
+  ::close(client.fd);
+}
+
+TEST_CASE("gdb stub rv64", "[GDB]") {
+  Ram64 ram{0x1000};
+  Scheduler scheduler{};
+  Rf64 rf{};
+  Csr64 csr{};
+  Instr_mem instr_mem{std::vector<Uxlen>{0x00000013}}; // nop
+  Core64 core{instr_mem, ram, csr, rf, make_logger(), Isa_extension::isa_zicsr};
+
+  int fds[2]{};
+  REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  Client client{.fd = fds[1]};
+  std::thread server{[&]() {
+    Gdb_stub64 stub{fds[0], core, rf, csr, ram, scheduler};
+    stub.serve();
+  }};
+
+  REQUIRE(client.request("Pa=efcdab8967452301") == "OK");
+  REQUIRE(rf.read(10) == 0x0123456789abcdef);
+  REQUIRE(client.request("p20") == "0000000000000000");
+  // mstatus is XLEN wide, the F csrs are 32 bits as in the target description.
+  REQUIRE(client.request("p341").size() == 16);
+  REQUIRE(client.request("P42=01000000") == "OK");
+  REQUIRE(client.request("p42") == "01000000");
+  REQUIRE(client.request("P43=02000000") == "OK");
+  REQUIRE(client.request("p44") == "41000000");
+  REQUIRE(client.request("P44=0000000000000000") == "E01");
+  client.send("k");
+  server.join();
+  ::close(client.fd);
+}
@@ -0,0 +1,110 @@
+#define CATCH_CONFIG_MAIN
+
+#include "history.hpp"
+
+#include "core.hpp"
+#include "csr.hpp"
+#include "ram.hpp"
+#include "rf.hpp"
+#include "scheduler.hpp"
+
+#include <vector>
+
+#include "spdlog/logger.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "catch2/catch_test_macros.hpp"
+
+namespace {
+  // a0 counts the iterations, 3 instructions each, and is stored at 0x100.
+  const std::vector<Uxlen> program{
+    0x00150513, // addi a0, a0, 1
+    0x10a02023, // sw a0, 0x100(x0)
+    0xff9ff06f, // j 0x0
+  };
+
+  struct Machine {
+    Ram ram;
+    Rf rf{};
+    Csr csr{};
+    Scheduler scheduler{};
+    Core core;
+
+    explicit Machine(std::size_t ram_size)
+        : ram{ram_size}, core{ram, ram, csr, rf, std::make_shared<spdlog::logger>("console",
+            std::make_shared<spdlog::sinks::stdout_color_sink_st>())} {
+      for (std::size_t i{0}; i < program.size(); ++i) ram.write(4 * i, program[i]);
+    }
+
+    [[nodiscard]] Scheduler::Time get_now() const { return scheduler.get_now(); }
+  };
+}
+
+TEST_CASE("history", "[HISTORY]") {
+  Machine machine{0x1000};
+  History history{machine.core, machine.rf, machine.csr, machine.ram, machine.scheduler,
+      {.interval = 100}};
+
+  machine.core.run(machine.scheduler, 1000);
+  REQUIRE(machine.rf.read(10) == 334);
+  REQUIRE(history.get_snapshots() == 11);
+
+  history.rewind_to(500);
+  REQUIRE(machine.get_now() == 500);
+  REQUIRE(machine.core.get_pc() == 0x8);
+  REQUIRE(machine.rf.read(10) == 167);
+  REQUIRE(machine.ram.read(0x100) == 167);
+  REQUIRE(history.step_back());
+  REQUIRE(machine.get_now() == 499);
+  REQUIRE(machine.core.get_pc() == 0x4);
+  REQUIRE(machine.ram.read(0x100) == 166);
+
+  // The replay takes no new snapshots.
+  machine.core.run(machine.scheduler, 1000);
+  REQUIRE(machine.rf.read(10) == 334);
+  REQUIRE(history.get_snapshots() == 11);
+
+  // Back to the last breakpoint, even across snapshots.
+  machine.core.set_breakpoint(0x4);
+  REQUIRE(history.continue_back());
+  REQUIRE(machine.get_now() == 997);
+  REQUIRE(machine.core.get_pc() == 0x4);
+  REQUIRE_FALSE(machine.core.is_stopped());
+  REQUIRE(history.continue_back());
+  REQUIRE(machine.get_now() == 994);
+  machine.core.clear_breakpoint(0x4);
+  REQUIRE_FALSE(history.continue_back());
+  REQUIRE(machine.get_now() == 0);
+  REQUIRE(machine.core.get_pc() == 0);
+  REQUIRE(machine.rf.read(10) == 0);
+  REQUIRE_FALSE(history.step_back());
+
+  // A change of the past drops the future.
+  history.rewind_to(500);
+  machine.rf.write(10, 1000);
+  history.forget_future();
+  REQUIRE(history.get_snapshots() == 6);
+  machine.core.run(machine.scheduler, 700);
+  history.rewind_to(600);
+  REQUIRE(machine.rf.read(10) == 1033);
+}
+
+TEST_CASE("history memory", "[HISTORY]") {
+  constexpr std::size_t page_size{History::page_size};
+  constexpr std::size_t max_bytes{8 * page_size};
+  Machine machine{3 * page_size};
+  History history{machine.core, machine.rf, machine.csr, machine.ram, machine.scheduler,
+      {.interval = 100, .max_bytes = max_bytes}};
+
+  // The pages that don't change are shared.
+  machine.core.run(machine.scheduler, 300);
+  REQUIRE(history.get_snapshots() == 4);
+  REQUIRE(history.get_bytes() == 6 * page_size);
+
+  machine.core.run(machine.scheduler, 5000);
+  REQUIRE(history.get_bytes() <= max_bytes);
+  REQUIRE(history.get_interval() > 100);
+  REQUIRE(history.get_begin() == 0);
+  history.rewind_to(1234);
+  REQUIRE(machine.get_now() == 1234);
+  REQUIRE(machine.rf.read(10) == 412);
+}
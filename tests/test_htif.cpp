@@ -0,0 +1,360 @@
+#define CATCH_CONFIG_MAIN
+
+#include "htif.hpp"
+
+#include "core.hpp"
+#include "csr.hpp"
+#include "elf.hpp"
+#include "exception.hpp"
+#include "host_output.hpp"
+#include "ram.hpp"
+#include "rf.hpp"
+#include "semihosting.hpp"
+
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "spdlog/logger.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "catch2/catch_test_macros.hpp"
+
+namespace {
+  struct Pipe {
+    int fds[2]{-1, -1};
+
+    Pipe() { REQUIRE(::pipe(fds) == 0); }
+    ~Pipe() {
+      ::close(fds[0]);
+      ::close(fds[1]);
+    }
+
+    [[nodiscard]] std::string read_all() const {
+      char buffer[256]{};
+      const ssize_t size{::read(fds[0], buffer, sizeof(buffer))};
+      return (size > 0) ? std::string(buffer, static_cast<std::size_t>(size)) : "";
+    }
+  };
+
+  template <typename T>
+  void put(std::vector<std::byte> &file, std::size_t offset, T value) {
+    if (file.size() < offset + sizeof(T)) file.resize(offset + sizeof(T));
+    std::memcpy(file.data() + offset, &value, sizeof(T));
+  }
+
+  // An ELF32 file with one loadable segment and a symbol table.
+  std::vector<std::byte> make_elf32(std::uint32_t entry, std::uint32_t addr,
+      const std::vector<std::uint32_t> &words, std::uint32_t mem_size,
+      const std::vector<std::pair<std::string, std::uint32_t>> &symbols) {
+    constexpr std::size_t phoff{52};
+    constexpr std::size_t content{0x100};
+    std::vector<std::byte> file(content);
+    const unsigned char ident[]{0x7f, 'E', 'L', 'F', 1, 1, 1};
+    std::memcpy(file.data(), ident, sizeof(ident));
+    put<std::uint16_t>(file, 16, 2);
+    put<std::uint16_t>(file, 18, 243);
+    put<std::uint32_t>(file, 24, entry);
+    put<std::uint32_t>(file, 28, phoff);
+    put<std::uint16_t>(file, 42, 32);
+    put<std::uint16_t>(file, 44, 1);
+    put<std::uint16_t>(file, 46, 40);
+
+    put<std::uint32_t>(file, phoff + 0, 1);
+    put<std::uint32_t>(file, phoff + 4, content);
+    put<std::uint32_t>(file, phoff + 12, addr);
+    put<std::uint32_t>(file, phoff + 16, static_cast<std::uint32_t>(4 * words.size()));
+    put<std::uint32_t>(file, phoff + 20, mem_size);
+    for (std::size_t i{0}; i < words.size(); ++i) put(file, content + 4 * i, words[i]);
+
+    std::string strings(1, '\0');
+    const std::size_t symtab{file.size()};
+    put<std::uint64_t>(file, symtab + 8, 0);
+    for (std::size_t i{0}; i < symbols.size(); ++i) {
+      const std::size_t sym{symtab + 16 * (i + 1)};
+      put<std::uint32_t>(file, sym + 0, static_cast<std::uint32_t>(strings.size()));
+      put<std::uint32_t>(file, sym + 4, symbols[i].second);
+      put<std::uint16_t>(file, sym + 14, 1);
+      strings += symbols[i].first + '\0';
+    }
+    const std::size_t strtab{file.size()};
+    for (std::size_t i{0}; i < strings.size(); ++i) put(file, strtab + i, strings[i]);
+
+    // Null, symbol table and string table.
+    const std::size_t shoff{(file.size() + 3) & ~std::size_t{3}};
+    put<std::uint32_t>(file, 32, static_cast<std::uint32_t>(shoff));
+    put<std::uint16_t>(file, 48, 3);
+    put<std::uint32_t>(file, shoff + 40 + 4, 2);
+    put<std::uint32_t>(file, shoff + 40 + 16, static_cast<std::uint32_t>(symtab));
+    put<std::uint32_t>(file, shoff + 40 + 20, static_cast<std::uint32_t>(strtab - symtab));
+    put<std::uint32_t>(file, shoff + 40 + 24, 2);
+    put<std::uint32_t>(file, shoff + 40 + 36, 16);
+    put<std::uint32_t>(file, shoff + 80 + 4, 3);
+    put<std::uint32_t>(file, shoff + 80 + 16, static_cast<std::uint32_t>(strtab));
+    put<std::uint32_t>(file, shoff + 80 + 20, static_cast<std::uint32_t>(strings.size()));
+    put<std::uint32_t>(file, shoff + 80 + 36, 0);
+    return file;
+  }
+
+  void put_string(Ram &ram, std::size_t addr, const std::string &string) {
+    ram.write_block(addr, std::as_bytes(std::span{string.c_str(), string.size() + 1}));
+  }
+}
+
+TEST_CASE("elf", "[HTIF]") {
+  const std::vector<std::byte> file{make_elf32(0x8, 0x100, {0x11111111, 0x22222222}, 0x10,
+      {{"tohost", 0x1000}, {"fromhost", 0x1040}})};
+  const Elf elf{file};
+  REQUIRE(elf.get_xlen() == 32);
+  REQUIRE(elf.get_entry() == 0x8);
+  REQUIRE(elf.get_segments().size() == 1);
+  REQUIRE(elf.get_segments()[0].mem_size == 0x10);
+  REQUIRE(elf.find_symbol("tohost") == 0x1000);
+  REQUIRE(elf.find_symbol("fromhost") == 0x1040);
+  REQUIRE_FALSE(elf.find_symbol("main"));
+
+  Ram ram{0x200};
+  ram.write(0x10c, 0xffffffff);
+  elf.load(ram);
+  REQUIRE(ram.read(0x100) == 0x11111111);
+  REQUIRE(ram.read(0x104) == 0x22222222);
+  // The rest of the segment is cleared.
+  REQUIRE(ram.read(0x10c) == 0);
+
+  REQUIRE_THROWS_AS(Elf{std::span{file}.first(80)}, Errors::Error);
+  std::vector<std::byte> not_elf{file};
+  not_elf[1] = std::byte{'X'};
+  REQUIRE_THROWS_AS(Elf{not_elf}, Errors::Error);
+  REQUIRE_THROWS_AS(Elf::from_file("/nonexistent/file"), Errors::Error);
+}
+
+TEST_CASE("host output", "[HTIF]") {
+  Pipe pipe{};
+  {
+    Host_output output{pipe.fds[1], 8};
+    output.write("abc");
+    output.write("def");
+    output.write("gh");
+    REQUIRE(output.get_host_writes() == 0);
+    // Flushes the full buffer and goes out as is.
+    output.write("0123456789");
+    REQUIRE(output.get_host_writes() == 2);
+    output.write("!");
+  }
+  REQUIRE(pipe.read_all() == "abcdefgh0123456789!");
+}
+
+TEST_CASE("htif", "[HTIF]") {
+  Ram ram{0x2000};
+  Pipe out{};
+  Pipe err{};
+  Host_output out_output{out.fds[1]};
+  Host_output err_output{err.fds[1]};
+  const std::vector<std::byte> file{make_elf32(0, 0, {}, 0,
+      {{"tohost", 0x1000}, {"fromhost", 0x1040}})};
+  Htif htif{ram, Elf{file}, out_output, err_output};
+
+  SECTION("registers") {
+    ram.write(0x0ffc, 1);
+    REQUIRE(htif.read(0x0ffc) == 1);
+    REQUIRE(htif.get_host_ptr(0x0, 0x1000) == ram.get_host_ptr(0x0, 0x1000));
+    REQUIRE(htif.get_host_ptr(0x0, 0x1001) == nullptr);
+    REQUIRE(htif.get_host_ptr(0x1044, 4) == nullptr);
+    htif.write(0x1040, 5);
+    REQUIRE(htif.read(0x1040) == 5);
+    REQUIRE(ram.read(0x1040) == 0);
+    // Only the low word: nothing runs yet.
+    htif.write(0x1000, 0x41);
+    REQUIRE(htif.read(0x1000) == 0x41);
+  }
+
+  SECTION("console") {
+    for (const char c : std::string{"ok\n"}) {
+      htif.write(0x1000, static_cast<unsigned char>(c));
+      htif.write(0x1004, 0x01010000);
+      REQUIRE(htif.read(0x1000) == 0);
+      REQUIRE(htif.read(0x1044) == 0x01010000);
+    }
+    out_output.flush();
+    REQUIRE(out.read_all() == "ok\n");
+  }
+
+  SECTION("syscall") {
+    put_string(ram, 0x200, "to stderr");
+    const std::vector<std::uint64_t> magic_mem{Htif::SYS_WRITE, 2, 0x200, 9, 0, 0, 0, 0};
+    ram.write_block(0x100, std::as_bytes(std::span{magic_mem}));
+    htif.write(0x1000, 0x100);
+    htif.write(0x1004, 0);
+    REQUIRE(htif.read(0x1040) == 1);
+    REQUIRE(ram.read(0x100) == 9);
+    err_output.flush();
+    REQUIRE(err.read_all() == "to stderr");
+
+    const std::vector<std::uint64_t> exit{Htif::SYS_EXIT, 4};
+    ram.write_block(0x100, std::as_bytes(std::span{exit}));
+    htif.write(0x1000, 0x100);
+    htif.write(0x1004, 0);
+    REQUIRE(htif.get_exit_code() == 4);
+  }
+
+  SECTION("rv64") {
+    Ram64 ram64{0x2000};
+    Htif64 htif64{ram64, 0x1000, {}, out_output, err_output};
+    htif64.write(0x1000, 1);
+    REQUIRE(htif64.get_exit_code() == 0);
+  }
+}
+
+TEST_CASE("htif core", "[HTIF]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  // The exit of the riscv-tests, with test 3 failing.
+  const std::vector<Uxlen> program{
+    0x00700293, // addi t0, x0, 7
+    0x00001337, // lui t1, 1
+    0x00532023, // sw t0, 0(t1)
+    0x00032223, // sw x0, 4(t1)
+    0x0000006f, // j .
+  };
+  Ram ram{0x2000};
+  for (std::size_t i{0}; i < program.size(); ++i) ram.write(4 * i, program[i]);
+  Host_output out{1};
+  Host_output err{2};
+  Htif htif{ram, 0x1000, 0x1040, out, err};
+  Rf rf{};
+  Csr csr{};
+  Core core{ram, htif, csr, rf, my_logger};
+  htif.set_exit_handler([&core](std::uint64_t code) { core.halt(static_cast<Uxlen>(code)); });
+
+  Scheduler scheduler{};
+  core.run(scheduler, 1000);
+  // Right after the store.
+  REQUIRE(core.is_halted());
+  REQUIRE(core.get_pc() == 0x10);
+  REQUIRE(scheduler.get_now() == 4);
+  REQUIRE(core.get_exit_code() == 3);
+  REQUIRE(htif.get_exit_code() == 3);
+}
+
+TEST_CASE("semihosting", "[HTIF]") {
+  Ram ram{0x1000};
+  Rf rf{};
+  Pipe out{};
+  Pipe err{};
+  Host_output out_output{out.fds[1]};
+  Host_output err_output{err.fds[1]};
+  Semihosting semihosting{rf, ram, out_output, err_output};
+
+  const auto call = [&](Uxlen operation, Uxlen parameter) {
+    rf.write(10, operation);
+    rf.write(11, parameter);
+    REQUIRE_FALSE(semihosting.handle());
+    return rf.read(10);
+  };
+  const auto put_block = [&](std::size_t addr, const std::vector<Uxlen> &block) {
+    for (std::size_t i{0}; i < block.size(); ++i) ram.write(addr + 4 * i, block[i]);
+  };
+
+  SECTION("console") {
+    put_string(ram, 0x100, ":tt");
+    put_block(0x200, {0x100, 4, 3});
+    const Uxlen stdout_handle{call(Semihosting::SYS_OPEN, 0x200)};
+    REQUIRE(stdout_handle == Semihosting::STDOUT);
+    put_block(0x200, {0x100, 8, 3});
+    REQUIRE(call(Semihosting::SYS_OPEN, 0x200) == Semihosting::STDERR);
+    put_block(0x200, {0x100, 0, 3});
+    REQUIRE(call(Semihosting::SYS_OPEN, 0x200) == Semihosting::STDIN);
+    put_string(ram, 0x100, "file");
+    put_block(0x200, {0x100, 0, 4});
+    REQUIRE(call(Semihosting::SYS_OPEN, 0x200) == static_cast<Uxlen>(-1));
+
+    put_string(ram, 0x101, "hello ");
+    put_block(0x200, {stdout_handle, 0x101, 6});
+    REQUIRE(call(Semihosting::SYS_WRITE, 0x200) == 0);
+    put_string(ram, 0x300, "world");
+    REQUIRE(call(Semihosting::SYS_WRITE0, 0x300) == 0);
+    put_string(ram, 0x303, "!");
+    REQUIRE(call(Semihosting::SYS_WRITEC, 0x303) == 0);
+    put_block(0x200, {Semihosting::STDERR, 0x300, 2});
+    REQUIRE(call(Semihosting::SYS_WRITE, 0x200) == 0);
+    // Nothing goes out before the exit.
+    REQUIRE(out_output.get_host_writes() == 0);
+
+    put_block(0x200, {Semihosting::STDIN, 0x400, 16});
+    REQUIRE(call(Semihosting::SYS_READ, 0x200) == 16);
+    put_block(0x200, {7, 0x300, 2});
+    REQUIRE(call(Semihosting::SYS_WRITE, 0x200) == 2);
+    REQUIRE(call(0x1234, 0) == static_cast<Uxlen>(-1));
+    REQUIRE(call(Semihosting::SYS_CLOCK, 0) < 100);
+
+    rf.write(10, Semihosting::SYS_EXIT);
+    rf.write(11, Semihosting::ADP_Stopped_ApplicationExit);
+    REQUIRE(semihosting.handle() == 0);
+    REQUIRE(out.read_all() == "hello world!");
+    REQUIRE(err.read_all() == "wo");
+  }
+
+  SECTION("exit") {
+    put_block(0x200, {0x20023, 0});
+    rf.write(10, Semihosting::SYS_EXIT_EXTENDED);
+    rf.write(11, 0x200);
+    REQUIRE(semihosting.handle() == 1);
+  }
+}
+
+TEST_CASE("semihosting core", "[HTIF]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  const std::vector<Uxlen> program{
+    0x00400513, // addi a0, x0, 4
+    0x10000593, // addi a1, x0, 0x100
+    0x01f01013, // slli x0, x0, 0x1f
+    0x00100073, // ebreak
+    0x40705013, // srai x0, x0, 7
+    0x02000513, // addi a0, x0, 0x20
+    0x20000593, // addi a1, x0, 0x200
+    0x01f01013, // slli x0, x0, 0x1f
+    0x00100073, // ebreak
+    0x40705013, // srai x0, x0, 7
+    0x0000006f, // j .
+  };
+  Ram ram{0x1000};
+  for (std::size_t i{0}; i < program.size(); ++i) ram.write(4 * i, program[i]);
+  put_string(ram, 0x100, "semihosted\n");
+  ram.write(0x200, Semihosting::ADP_Stopped_ApplicationExit);
+  ram.write(0x204, 3);
+
+  Pipe out{};
+  Host_output out_output{out.fds[1]};
+  Host_output err_output{2};
+  Rf rf{};
+  Csr csr{};
+  Semihosting semihosting{rf, ram, out_output, err_output};
+  Core core{ram, ram, csr, rf, my_logger, Isa_extension::isa_zicsr};
+  core.set_semihosting_handler([&semihosting]() { return semihosting.handle(); });
+
+  for (unsigned int i{0}; (i < 100) && !core.is_halted(); ++i) core.cycle();
+  REQUIRE(core.is_halted());
+  REQUIRE(core.get_pc() == 0x24);
+  REQUIRE(core.get_exit_code() == 3);
+  REQUIRE(out.read_all() == "semihosted\n");
+
+  // An ebreak outside of the sequence is a breakpoint.
+  Rf rf2{};
+  Csr csr2{};
+  Semihosting semihosting2{rf2, ram, out_output, err_output};
+  Core core2{ram, ram, csr2, rf2, my_logger, Isa_extension::isa_zicsr};
+  core2.set_semihosting_handler([&semihosting2]() { return semihosting2.handle(); });
+  csr2.write(Csr::MTVEC, 0x80);
+  core2.set_pc(0x20);
+  core2.cycle();
+  REQUIRE(core2.get_pc() == 0x24);
+  ram.write(0x1c, 0x00000013);
+  core2.set_pc(0x20);
+  core2.cycle();
+  REQUIRE(core2.get_pc() == 0x80);
+  REQUIRE(csr2.read(Csr::MCAUSE) == Csr::BREAKPOINT);
+}
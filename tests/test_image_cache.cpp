@@ -0,0 +1,116 @@
+#define CATCH_CONFIG_MAIN
+
+#include "cow_ram.hpp"
+#include "image_cache.hpp"
+
+#include "exception.hpp"
+
+#include "catch2/catch_test_macros.hpp"
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+  std::vector<std::byte> make_content(std::size_t size, unsigned int seed) {
+    std::vector<std::byte> content(size);
+    for (std::size_t i{0}; i < size; ++i) content[i] = static_cast<std::byte>(i * 7 + seed);
+    return content;
+  }
+}
+
+TEST_CASE("image", "[IMAGE_CACHE]") {
+  const std::vector<std::byte> content{std::byte{0x13}, std::byte{0x05}, std::byte{0x00},
+      std::byte{0x00}, std::byte{0x6f}, std::byte{0x00}};
+  const Image image{content, Image_cache::hash(content)};
+  REQUIRE(image.size() == 6);
+  REQUIRE(image.get_pages() == 1);
+  REQUIRE(image.at(0) == 0x00000513);
+  // Padded with zeros.
+  REQUIRE(image.at(1) == 0x0000006f);
+  REQUIRE_THROWS_AS(image.at(2), std::out_of_range);
+  REQUIRE(Image_cache::hash({}) == 0xcbf29ce484222325);
+}
+
+TEST_CASE("image cache", "[IMAGE_CACHE]") {
+  Image_cache &cache{Image_cache::get_instance()};
+  const std::size_t images{cache.get_images()};
+  {
+    const std::vector<std::byte> content{make_content(5000, 1)};
+    const std::shared_ptr<const Image> first{cache.intern(content)};
+    const std::shared_ptr<const Image> second{cache.intern(make_content(5000, 1))};
+    const std::shared_ptr<const Image> other{cache.intern(make_content(5000, 2))};
+    REQUIRE(first == second);
+    REQUIRE(first != other);
+    REQUIRE(first->get_pages() == 2);
+    REQUIRE(std::ranges::equal(first->get_content(), content));
+    REQUIRE(cache.get_images() == images + 2);
+  }
+  // Released by their last user.
+  REQUIRE(cache.get_images() == images);
+}
+
+TEST_CASE("cow ram", "[COW_RAM]") {
+  constexpr std::size_t page_size{Image::page_size};
+  const std::shared_ptr<const Image> image{
+      Image_cache::get_instance().intern(make_content(page_size + 8, 3))};
+
+  SECTION("shared until written") {
+    Cow_ram first{4 * page_size, image, page_size};
+    Cow_ram second{4 * page_size, image, page_size};
+    REQUIRE(first.read(0) == 0);
+    REQUIRE(first.read(page_size) == second.read(page_size));
+    REQUIRE((first.read(page_size + 4, 0b0010) >> 8) == ((4 + 1) * 7 + 3));
+    REQUIRE(first.get_private_pages() == 0);
+
+    first.write(page_size + 4, 0xdeadbeef);
+    REQUIRE(first.read(page_size + 4) == 0xdeadbeef);
+    REQUIRE(second.read(page_size + 4) != 0xdeadbeef);
+    REQUIRE(first.read(page_size) == second.read(page_size));
+    REQUIRE(first.get_private_pages() == 1);
+    REQUIRE(second.get_private_pages() == 0);
+    REQUIRE(image->get_content()[4] == std::byte{4 * 7 + 3});
+  }
+
+  SECTION("misaligned across pages") {
+    Cow_ram ram{4 * page_size, image, page_size};
+    ram.write(2 * page_size - 2, 0x44332211);
+    REQUIRE(ram.read(2 * page_size - 2) == 0x44332211);
+    REQUIRE(ram.read(2 * page_size) == ((image->at(page_size / 4) & 0xffff0000) | 0x4433));
+    REQUIRE(ram.get_private_pages() == 2);
+  }
+
+  SECTION("host ptr") {
+    Cow_ram64 ram{4 * page_size, image, page_size};
+    REQUIRE(ram.get_host_ptr(page_size - 4, 8) == nullptr);
+    REQUIRE(ram.get_host_ptr(4 * page_size - 4, 8) == nullptr);
+    std::byte *const host{ram.get_host_ptr(page_size + 8, 8)};
+    REQUIRE(host != nullptr);
+    *host = std::byte{0xab};
+    REQUIRE(ram.read(page_size + 8, 0b1) == 0xab);
+    REQUIRE(ram.get_private_pages() == 1);
+  }
+
+  SECTION("errors") {
+    REQUIRE_THROWS_AS(Cow_ram(4 * page_size, image, 8), Errors::Error);
+    REQUIRE_THROWS_AS(Cow_ram(2 * page_size, image, page_size), Errors::Error);
+    Cow_ram ram{page_size};
+    REQUIRE_THROWS_AS(ram.read(page_size - 2), Errors::Illegal_addr);
+  }
+
+  SECTION("threads") {
+    Cow_ram ram{2 * page_size, image, 0};
+    {
+      std::vector<std::jthread> threads{};
+      for (std::size_t thread{0}; thread < 4; ++thread) {
+        threads.emplace_back([&ram, thread]() {
+          for (std::size_t addr{thread * 4}; addr < page_size; addr += 16) {
+            ram.write(addr, static_cast<Uxlen>(addr));
+          }
+        });
+      }
+    }
+    for (std::size_t addr{0}; addr < page_size; addr += 4) REQUIRE(ram.read(addr) == addr);
+    REQUIRE(ram.get_private_pages() == 1);
+  }
+}
@@ -0,0 +1,358 @@
+#define CATCH_CONFIG_MAIN
+
+#include "clint.hpp"
+#include "core.hpp"
+#include "csr.hpp"
+#include "data_mem.hpp"
+#include "instr_mem.hpp"
+#include "irq.hpp"
+#include "plic.hpp"
+#include "rf.hpp"
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <thread>
+
+#include "spdlog/logger.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "catch2/catch_test_macros.hpp"
+
+TEST_CASE("clint", "[CLINT]") {
+  Irq_pending irq_pending{};
+  Clint clint{irq_pending};
+
+  SECTION("msip") {
+    clint.write(Clint::MSIP, 1);
+    REQUIRE(irq_pending.get() == Irq::to_mask(Irq::MSI));
+    REQUIRE(clint.read(Clint::MSIP) == 1);
+    clint.write(Clint::MSIP, 0);
+    REQUIRE(!irq_pending.any());
+  }
+
+  SECTION("mtimecmp") {
+    clint.write(Clint::MTIMECMP_H, 0x1);
+    clint.write(Clint::MTIMECMP  , 0x2);
+    REQUIRE(clint.get_next_deadline() == 0x1'0000'0002);
+    clint.advance(0x1'0000'0001);
+    REQUIRE(!irq_pending.any());
+    REQUIRE(clint.read(Clint::MTIME  ) == 0x1);
+    REQUIRE(clint.read(Clint::MTIME_H) == 0x1);
+    clint.advance(1);
+    REQUIRE(irq_pending.get() == Irq::to_mask(Irq::MTI));
+    clint.write(Clint::MTIMECMP_H, 0x2);
+    REQUIRE(!irq_pending.any());
+  }
+
+  SECTION("illegal_addr") {
+    REQUIRE_THROWS_AS(clint.read(0x8), Errors::Illegal_addr);
+  }
+}
+
+TEST_CASE("clint harts", "[CLINT]") {
+  Irq_pending hart0{};
+  Irq_pending hart1{};
+  Clint clint{{&hart0, &hart1}};
+
+  clint.write(Clint::MSIP + 4, 1);
+  REQUIRE(!hart0.any());
+  REQUIRE(hart1.get() == Irq::to_mask(Irq::MSI));
+  REQUIRE(clint.read(Clint::MSIP + 4) == 1);
+
+  clint.write(Clint::MTIMECMP + 8, 5);
+  clint.write(Clint::MTIMECMP + 12, 0);
+  REQUIRE(clint.read(Clint::MTIMECMP + 8) == 5);
+  REQUIRE(clint.get_next_deadline() == 5);
+  REQUIRE(clint.skip_to_deadline());
+  REQUIRE(!hart0.any());
+  REQUIRE(hart1.get() == (Irq::to_mask(Irq::MSI) | Irq::to_mask(Irq::MTI)));
+
+  REQUIRE_THROWS_AS(clint.read(Clint::MSIP + 8), Errors::Illegal_addr);
+  REQUIRE_THROWS_AS(clint.write(Clint::MTIMECMP + 16, 0), Errors::Illegal_addr);
+}
+
+TEST_CASE("plic", "[PLIC]") {
+  Irq_pending irq_pending{};
+  Plic plic{irq_pending};
+
+  plic.write(Plic::PRIORITY + 4 * 3, 1);
+  plic.write(Plic::PRIORITY + 4 * 5, 2);
+
+  SECTION("disabled") {
+    plic.raise(3);
+    REQUIRE(plic.read(Plic::PENDING) == 1u << 3);
+    REQUIRE(!irq_pending.any());
+  }
+
+  SECTION("claim_complete") {
+    plic.write(Plic::ENABLE, (1u << 3) | (1u << 5));
+    plic.raise(3);
+    plic.raise(5);
+    REQUIRE(irq_pending.get() == Irq::to_mask(Irq::MEI));
+    REQUIRE(plic.read(Plic::CLAIM) == 5);
+    REQUIRE(plic.read(Plic::CLAIM) == 3);
+    REQUIRE(!irq_pending.any());
+    plic.lower(3);
+    plic.write(Plic::CLAIM, 3);
+    plic.write(Plic::CLAIM, 5);
+    REQUIRE(irq_pending.get() == Irq::to_mask(Irq::MEI));
+    REQUIRE(plic.read(Plic::CLAIM) == 5);
+  }
+
+  SECTION("threshold") {
+    plic.write(Plic::ENABLE, 1u << 3);
+    plic.write(Plic::THRESHOLD, 1);
+    plic.raise(3);
+    REQUIRE(!irq_pending.any());
+    plic.write(Plic::THRESHOLD, 0);
+    REQUIRE(irq_pending.any());
+  }
+}
+
+TEST_CASE("core interrupt", "[CORE_IRQ]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  const std::vector<Uxlen> instr{
+    0x02000093, // addi x1, x0, 0x20
+    0x30509073, // csrrw x0, mtvec, x1
+    0x08000093, // addi x1, x0, 0x80
+    0x30409073, // csrrw x0, mie, x1
+    0x30046073, // csrrsi x0, mstatus, 8
+    0x0000006f, // j .
+    0x00000013, // nop
+    0x00000013, // nop
+    0x00100293, // addi x5, x0, 1
+    0x34202373, // csrr x6, mcause
+    0x30200073, // mret
+  };
+  Instr_mem instr_mem{instr};
+  Data_mem data_mem{{}};
+  Rf rf{};
+  Irq_pending irq_pending{};
+  Csr csr{irq_pending};
+  Clint clint{irq_pending};
+  Core core{instr_mem, data_mem, csr, rf, my_logger, Isa_extension::isa_zicsr, &irq_pending};
+
+  for (int i{0}; i < 8; ++i) core.cycle();
+  REQUIRE(core.get_pc() == 0x14);
+
+  clint.write(Clint::MTIMECMP_H, 0);
+  clint.write(Clint::MTIMECMP  , 10);
+  clint.advance(10);
+  REQUIRE(csr.read(Csr::MIP) == Irq::to_mask(Irq::MTI));
+
+  core.cycle();
+  REQUIRE(rf.read(5) == 1);
+  REQUIRE(core.get_pc() == 0x24);
+  REQUIRE(csr.read(Csr::MEPC) == 0x14);
+  REQUIRE((csr.read(Csr::MSTATUS) & Csr::MSTATUS_MIE) == 0);
+  REQUIRE((csr.read(Csr::MSTATUS) & Csr::MSTATUS_MPIE) != 0);
+
+  core.cycle();
+  REQUIRE(rf.read(6) == (Csr::MCAUSE_INTERRUPT | Irq::MTI));
+
+  clint.write(Clint::MTIMECMP_H, 1);
+  core.cycle();
+  REQUIRE(core.get_pc() == 0x14);
+  REQUIRE((csr.read(Csr::MSTATUS) & Csr::MSTATUS_MIE) != 0);
+  core.cycle();
+  REQUIRE(core.get_pc() == 0x14);
+}
+
+TEST_CASE("delegated interrupt", "[CORE_IRQ]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  std::vector<Uxlen> instr{
+    0x02000293, // addi t0, x0, 0x20
+    0x30329073, // csrw mideleg, t0
+    0x30429073, // csrw mie, t0
+    0x08000313, // addi t1, x0, 0x80
+    0x10531073, // csrw stvec, t1
+    0x04000393, // addi t2, x0, 0x40
+    0x34139073, // csrw mepc, t2
+    0x00001e37, // lui t3, 1
+    0x800e0e13, // addi t3, t3, -2048
+    0x300e2073, // csrs mstatus, t3
+    0x10016073, // csrsi sstatus, 2
+    0x30200073, // mret
+  };
+  instr.resize(0x40 / 4, 0x00000013);
+  instr.push_back(0x0000006f); // j .
+  instr.resize(0x80 / 4, 0x00000013);
+  instr.push_back(0x14202473); // csrr s0, scause
+  instr.push_back(0x141024f3); // csrr s1, sepc
+  instr.push_back(0x0000006f); // j .
+  Instr_mem instr_mem{instr};
+  Data_mem data_mem{{}};
+  Rf rf{};
+  Irq_pending irq_pending{};
+  Csr csr{irq_pending};
+  Core core{instr_mem, data_mem, csr, rf, my_logger, {Isa_extension::isa_zicsr,
+      Isa_extension::isa_s}, &irq_pending};
+
+  for (int i{0}; i < 13; ++i) core.cycle();
+  REQUIRE(core.get_pc() == 0x40);
+  REQUIRE(core.get_privilege() == Csr::Privilege::supervisor);
+
+  irq_pending.raise(Irq::STI);
+  for (int i{0}; i < 3; ++i) core.cycle();
+  REQUIRE(core.get_pc() == 0x88);
+  REQUIRE(core.get_privilege() == Csr::Privilege::supervisor);
+  REQUIRE(rf.read(8) == (Csr::MCAUSE_INTERRUPT | Irq::STI));
+  REQUIRE(rf.read(9) == 0x40);
+  REQUIRE((csr.read(Csr::MSTATUS) & Csr::MSTATUS_SIE) == 0);
+  REQUIRE((csr.read(Csr::MSTATUS) & Csr::MSTATUS_SPIE) != 0);
+}
+
+TEST_CASE("host thread injection", "[IRQ_THREAD]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  const std::vector<Uxlen> instr{
+    0x02000093, // addi x1, x0, 0x20
+    0x30509073, // csrrw x0, mtvec, x1
+    0x000010b7, // lui x1, 1
+    0x80008093, // addi x1, x1, -0x800
+    0x30409073, // csrrw x0, mie, x1
+    0x30046073, // csrrsi x0, mstatus, 8
+    0x0000006f, // j .
+    0x00000013, // nop
+    0x00100293, // addi x5, x0, 1
+    0x0000006f, // j .
+  };
+  Instr_mem instr_mem{instr};
+  Data_mem data_mem{{}};
+  Rf rf{};
+  Irq_pending irq_pending{};
+  const int wakeup_fd{irq_pending.enable_wakeup_fd()};
+  Csr csr{irq_pending};
+  Plic plic{irq_pending};
+  plic.write(Plic::PRIORITY + 4 * 1, 1);
+  plic.write(Plic::ENABLE, 1u << 1);
+  Core core{instr_mem, data_mem, csr, rf, my_logger, Isa_extension::isa_zicsr, &irq_pending};
+
+  std::thread device{[&plic]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    plic.raise(1);
+  }};
+
+  // The core keeps spinning in `j .` while the device thread raises the line.
+  for (unsigned int i{0}; (core.get_pc() != 0x24) && (i < 100'000'000); ++i) core.cycle();
+  device.join();
+
+  pollfd wakeup{wakeup_fd, POLLIN, 0};
+  REQUIRE(poll(&wakeup, 1, 0) == 1);
+  REQUIRE(rf.read(5) == 1);
+  REQUIRE(csr.read(Csr::MCAUSE) == (Csr::MCAUSE_INTERRUPT | Irq::MEI));
+  REQUIRE(plic.read(Plic::CLAIM) == 1);
+  REQUIRE(!irq_pending.any());
+}
+
+TEST_CASE("wfi", "[WFI]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  Data_mem data_mem{{}};
+  Rf rf{};
+  Irq_pending irq_pending{};
+  Csr csr{irq_pending};
+
+  SECTION("skip_to_deadline") {
+    const std::vector<Uxlen> instr{
+      0x08000093, // addi x1, x0, 0x80
+      0x30409073, // csrrw x0, mie, x1
+      0x10500073, // wfi
+      0x00100293, // addi x5, x0, 1
+      0x0000006f, // j .
+    };
+    Instr_mem instr_mem{instr};
+    Clint clint{irq_pending};
+    Core core{instr_mem, data_mem, csr, rf, my_logger, Isa_extension::isa_zicsr, &irq_pending};
+    REQUIRE(!clint.skip_to_deadline());
+    clint.write(Clint::MTIMECMP_H, 0);
+    clint.write(Clint::MTIMECMP  , 1000);
+
+    for (int i{0}; i < 3; ++i) core.cycle();
+    REQUIRE(core.is_waiting());
+    core.cycle();
+    REQUIRE(core.get_pc() == 0xc);
+
+    REQUIRE(clint.skip_to_deadline());
+    REQUIRE(clint.get_time() == 1000);
+    core.cycle();
+    REQUIRE(!core.is_waiting());
+    REQUIRE(rf.read(5) == 1);
+  }
+
+  SECTION("host_sleep") {
+    const std::vector<Uxlen> instr{
+      0x00800093, // addi x1, x0, 8
+      0x30409073, // csrrw x0, mie, x1
+      0x10500073, // wfi
+      0x00100293, // addi x5, x0, 1
+      0x0000006f, // j .
+    };
+    Instr_mem instr_mem{instr};
+    Core core{instr_mem, data_mem, csr, rf, my_logger, Isa_extension::isa_zicsr, &irq_pending};
+    for (int i{0}; i < 3; ++i) core.cycle();
+    REQUIRE(core.is_waiting());
+
+    std::thread device{[&irq_pending]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds{10});
+      irq_pending.raise(Irq::MSI);
+    }};
+    core.wait_for_interrupt();
+    device.join();
+    REQUIRE(!core.is_waiting());
+    core.cycle();
+    REQUIRE(rf.read(5) == 1);
+  }
+}
+
+TEST_CASE("idle loop", "[IDLE_LOOP]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  Data_mem data_mem{{}};
+  data_mem.write(0x100, 0);
+  data_mem.write(0x104, 0);
+  Rf rf{};
+  Csr csr{};
+
+  SECTION("polling") {
+    const std::vector<Uxlen> instr{
+      0x10002503, // lw x10, 0x100(x0)
+      0xfe050ee3, // beq x10, x0, -4
+      0x00100593, // addi x11, x0, 1
+      0x0000006f, // j .
+    };
+    Instr_mem instr_mem{instr};
+    Core core{instr_mem, data_mem, csr, rf, my_logger, Isa_extension::isa_zicsr};
+
+    int cycles{0};
+    for (; !core.is_waiting() && (cycles < 100); ++cycles) core.cycle();
+    REQUIRE(core.is_waiting());
+    REQUIRE(core.get_pc() == 0);
+
+    data_mem.write(0x100, 1);
+    core.wake();
+    for (int i{0}; i < 4; ++i) core.cycle();
+    REQUIRE(rf.read(11) == 1);
+    REQUIRE(core.is_waiting());
+    REQUIRE(core.get_pc() == 0xc);
+  }
+
+  SECTION("with_store") {
+    const std::vector<Uxlen> instr{
+      0x10002223, // sw x0, 0x104(x0)
+      0x10002503, // lw x10, 0x100(x0)
+      0xfe050ce3, // beq x10, x0, -8
+    };
+    Instr_mem instr_mem{instr};
+    Core core{instr_mem, data_mem, csr, rf, my_logger, Isa_extension::isa_zicsr};
+    for (int i{0}; i < 300; ++i) core.cycle();
+    REQUIRE(!core.is_waiting());
+  }
+}
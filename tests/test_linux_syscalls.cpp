@@ -0,0 +1,192 @@
+#define CATCH_CONFIG_MAIN
+
+#include "linux_syscalls.hpp"
+
+#include "core.hpp"
+#include "csr.hpp"
+#include "ram.hpp"
+#include "rf.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "spdlog/logger.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "catch2/catch_test_macros.hpp"
+
+namespace {
+  // Closes both ends on scope exit.
+  struct Pipe {
+    int fds[2]{-1, -1};
+
+    Pipe() { REQUIRE(::pipe(fds) == 0); }
+    ~Pipe() {
+      ::close(fds[0]);
+      ::close(fds[1]);
+    }
+  };
+
+  void put_string(Ram &ram, std::size_t addr, const std::string &string) {
+    ram.write_block(addr, std::as_bytes(std::span{string.c_str(), string.size() + 1}));
+  }
+
+  std::int64_t get_int64(Ram &ram, std::size_t addr) {
+    std::int64_t value{0};
+    ram.read_block(addr, std::as_writable_bytes(std::span{&value, 1}));
+    return value;
+  }
+}
+
+TEST_CASE("linux syscalls", "[SYSCALL]") {
+  using Sys = Linux_syscalls;
+  Ram ram{0x40000};
+  Rf rf{};
+  Pipe in{};
+  Pipe out{};
+  Sys syscalls{rf, ram, 0x10000, 0x40000, {in.fds[0], out.fds[1], 2}};
+
+  const auto call = [&](Uxlen number, std::vector<Uxlen> args) {
+    for (std::size_t i{0}; i < args.size(); ++i) rf.write(10 + i, args[i]);
+    rf.write(17, number);
+    REQUIRE_FALSE(syscalls.handle());
+    return static_cast<Sxlen>(rf.read(10));
+  };
+
+  SECTION("read and write") {
+    put_string(ram, 0x1000, "hello");
+    REQUIRE(call(Sys::WRITE, {1, 0x1000, 5}) == 5);
+    char buffer[8]{};
+    REQUIRE(::read(out.fds[0], buffer, sizeof(buffer)) == 5);
+    REQUIRE(std::string{buffer} == "hello");
+
+    REQUIRE(::write(in.fds[1], "world", 5) == 5);
+    REQUIRE(call(Sys::READ, {0, 0x2000, 64}) == 5);
+    REQUIRE(ram.read(0x2000) == 0x6c726f77);
+    REQUIRE(syscalls.get_zero_copy_bytes() == 10);
+
+    REQUIRE(call(Sys::WRITE, {7, 0x1000, 5}) == -EBADF);
+    REQUIRE(call(Sys::WRITE, {1, 0x3fffe, 5}) == 2);
+    REQUIRE(call(Sys::WRITE, {1, 0x40000, 5}) == -EFAULT);
+    REQUIRE(call(Sys::CLOSE, {0}) == 0);
+    REQUIRE(call(Sys::READ, {0, 0x2000, 1}) == -EBADF);
+  }
+
+  SECTION("files") {
+    char path[]{"/tmp/test_linux_syscalls_XXXXXX"};
+    const int fd{::mkstemp(path)};
+    REQUIRE(fd >= 0);
+    ::close(fd);
+    put_string(ram, 0x1000, path);
+    put_string(ram, 0x1100, "file content");
+
+    // O_WRONLY | O_TRUNC
+    const Sxlen guest_fd{call(Sys::OPENAT, {static_cast<Uxlen>(-100), 0x1000, 01001, 0})};
+    REQUIRE(guest_fd == 3);
+    REQUIRE(call(Sys::WRITE, {3, 0x1100, 12}) == 12);
+    REQUIRE(call(Sys::CLOSE, {3}) == 0);
+    REQUIRE(call(Sys::CLOSE, {3}) == -EBADF);
+
+    REQUIRE(call(Sys::OPENAT, {static_cast<Uxlen>(-100), 0x1000, 0, 0}) == 3);
+    REQUIRE(call(Sys::FSTAT, {3, 0x3000}) == 0);
+    REQUIRE(get_int64(ram, 0x3000 + 48) == 12);
+    REQUIRE((ram.read(0x3000 + 16) & S_IFMT) == S_IFREG);
+
+    // A private file mapping, with the offset in pages.
+    const auto addr{static_cast<Uxlen>(call(Sys::MMAP, {0, 100, 1, 0x02, 3, 0}))};
+    REQUIRE(addr == 0x3f000);
+    REQUIRE(ram.read(addr) == 0x656c6966);
+    REQUIRE(ram.read(addr + 12) == 0);
+    // Shared file mappings aren't supported.
+    REQUIRE(call(Sys::MMAP, {0, 100, 1, 0x01, 3, 0}) == -EINVAL);
+    REQUIRE(call(Sys::CLOSE, {3}) == 0);
+    ::unlink(path);
+
+    put_string(ram, 0x1000, "/nonexistent/file");
+    REQUIRE(call(Sys::OPENAT, {static_cast<Uxlen>(-100), 0x1000, 0, 0}) == -ENOENT);
+  }
+
+  SECTION("memory") {
+    REQUIRE(call(Sys::BRK, {0}) == 0x10000);
+    REQUIRE(call(Sys::BRK, {0x12345}) == 0x12345);
+    REQUIRE(syscalls.get_brk() == 0x12345);
+    REQUIRE(call(Sys::BRK, {0x100}) == 0x12345);
+
+    ram.write(0x3e000, 0xdeadbeef);
+    // MAP_PRIVATE | MAP_ANONYMOUS
+    REQUIRE(call(Sys::MMAP, {0, 0x1000, 3, 0x22, static_cast<Uxlen>(-1), 0}) == 0x3f000);
+    REQUIRE(call(Sys::MMAP, {0, 0x1001, 3, 0x22, static_cast<Uxlen>(-1), 0}) == 0x3d000);
+    REQUIRE(ram.read(0x3e000) == 0);
+    REQUIRE(call(Sys::MMAP, {0, 0x40000, 3, 0x22, static_cast<Uxlen>(-1), 0}) == -ENOMEM);
+    // MAP_FIXED
+    REQUIRE(call(Sys::MMAP, {0x20000, 0x1000, 3, 0x32, static_cast<Uxlen>(-1), 0}) == -EINVAL);
+    // Mappings cap the break.
+    REQUIRE(call(Sys::BRK, {0x3e000}) == 0x12345);
+  }
+
+  SECTION("time") {
+    REQUIRE(call(Sys::CLOCK_GETTIME64, {CLOCK_MONOTONIC, 0x1000}) == 0);
+    const std::int64_t seconds{get_int64(ram, 0x1000)};
+    const std::int64_t nanoseconds{get_int64(ram, 0x1008)};
+    REQUIRE(((seconds > 0) || (nanoseconds > 0)));
+    REQUIRE(nanoseconds < 1'000'000'000);
+    REQUIRE(call(Sys::CLOCK_GETTIME, {12345, 0x1000}) == -EINVAL);
+  }
+
+  SECTION("exit") {
+    REQUIRE(call(1234, {}) == -ENOSYS);
+    REQUIRE_FALSE(syscalls.get_exit_code());
+    rf.write(10, 3);
+    rf.write(17, Sys::EXIT_GROUP);
+    REQUIRE(syscalls.handle() == 3);
+    REQUIRE(syscalls.get_exit_code() == 3);
+  }
+}
+
+TEST_CASE("linux user mode", "[SYSCALL]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  const std::vector<Uxlen> program{
+    0x00100513, // addi a0, x0, 1
+    0x10000593, // addi a1, x0, 0x100
+    0x00600613, // addi a2, x0, 6
+    0x04000893, // addi a7, x0, 64
+    0x00000073, // ecall
+    0x05d00893, // addi a7, x0, 93
+    0x02a00513, // addi a0, x0, 42
+    0x00000073, // ecall
+    0x0000006f, // j .
+  };
+  Ram ram{0x10000};
+  for (std::size_t i{0}; i < program.size(); ++i) ram.write(4 * i, program[i]);
+  put_string(ram, 0x100, "hello\n");
+
+  Pipe out{};
+  Rf rf{};
+  Csr csr{};
+  Linux_syscalls syscalls{rf, ram, 0x1000, 0x10000, {0, out.fds[1], 2}};
+  Core core{ram, ram, csr, rf, my_logger, Isa_extension::isa_zicsr};
+  core.set_ecall_handler([&syscalls]() { return syscalls.handle(); });
+
+  for (unsigned int i{0}; (i < 100) && !core.is_halted(); ++i) core.cycle();
+  REQUIRE(core.is_halted());
+  REQUIRE(core.is_waiting());
+  REQUIRE(core.get_pc() == 0x20);
+  REQUIRE(core.get_exit_code() == 42);
+  REQUIRE(syscalls.get_exit_code() == 42);
+  REQUIRE(rf.read(10) == 42);
+  char buffer[8]{};
+  REQUIRE(::read(out.fds[0], buffer, sizeof(buffer)) == 6);
+  REQUIRE(std::string{buffer} == "hello\n");
+
+  // Nothing resumes it.
+  core.wake();
+  core.cycle();
+  REQUIRE(core.get_pc() == 0x20);
+}
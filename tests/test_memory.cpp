@@ -1,9 +1,12 @@
 #include "exception.hpp"
 #include "instr_mem.hpp"
+#include "bus.hpp"
 #include "data_mem.hpp"
 #include "memory.hpp"
+#include "ram.hpp"
 #include "riscv_algos.hpp"
 
+#include <array>
 #include <climits>
 
 #define CATCH_CONFIG_MAIN
@@ -37,6 +40,14 @@ TEST_CASE("instr mem", "[INSTR_MEM]") {
     REQUIRE(instr_mem.get_content() == data);
   }
 
+  SECTION("halfword reads") {
+    const std::vector<Uxlen> data{0x01020304};
+    Instr_mem instr_mem{data};
+
+    REQUIRE(instr_mem.read(0, 0b0011) == 0x00000304);
+    REQUIRE(instr_mem.read(0, 0b1100) == 0x01020000);
+  }
+
   SECTION("exception") {
     std::vector<Uxlen> instr_container{};
     Instr_mem instr_mem{instr_container};
@@ -269,3 +280,100 @@ TEST_CASE("ranged_mem", "[RANGED_MEM]") {
     REQUIRE(data_mem.get_content().size() == 4);
   }
 }
+
+TEST_CASE("narrow_mem", "[NARROW_MEM]") {
+  Data_mem data_mem{{}};
+  Narrow_mem_wrap narrow{data_mem};
+
+  narrow.write(8, 0x0807'0605'0403'0201);
+  REQUIRE(data_mem.read(8)  == 0x0403'0201);
+  REQUIRE(data_mem.read(12) == 0x0807'0605);
+  REQUIRE(narrow.read(8) == 0x0807'0605'0403'0201);
+
+  // Only the words with enabled lanes are accessed.
+  narrow.write(16, 0xaabb'0000'0000, 0b0011'0000);
+  REQUIRE(data_mem.get_content().size() == 10);
+  REQUIRE(narrow.read(16, 0b0011'0000) == 0xaabb'0000'0000);
+  REQUIRE(narrow.read(8, 0b0000'1100) == 0x0403'0000);
+}
+
+TEST_CASE("ram", "[RAM]") {
+  Ram ram{64};
+
+  SECTION("word access") {
+    ram.write(4, 0x0403'0201);
+    REQUIRE(ram.read(4) == 0x0403'0201);
+    ram.write(4, 0xaa00'0000, 0b1000);
+    REQUIRE(ram.read(4) == 0xaa03'0201);
+    REQUIRE(ram.read(4, 0b0110) == 0x0003'0200);
+    REQUIRE(ram.read(0) == 0);
+    REQUIRE_THROWS_AS(ram.read(64), Errors::Illegal_addr);
+    REQUIRE_THROWS_AS(ram.write(62, 0), Errors::Illegal_addr);
+  }
+  SECTION("host ptr") {
+    ram.write(8, 0x0403'0201);
+    std::byte *host{ram.get_host_ptr(9, 2)};
+    REQUIRE(host);
+    REQUIRE(host[0] == Byte{0x02});
+    REQUIRE(host[1] == Byte{0x03});
+    REQUIRE(ram.get_host_ptr(0, 64));
+    REQUIRE_FALSE(ram.get_host_ptr(1, 64));
+    REQUIRE_FALSE(ram.get_host_ptr(64, 1));
+  }
+  SECTION("rv64") {
+    Ram64 ram64{16};
+    ram64.write(8, 0x0807'0605'0403'0201);
+    REQUIRE(ram64.read(8, 0b1111'0000) == 0x0807'0605'0000'0000);
+    REQUIRE(ram64.get_content()[15] == Byte{0x08});
+  }
+}
+
+TEST_CASE("block access", "[BLOCK]") {
+  const std::array<Byte, 7> data{Byte{1}, Byte{2}, Byte{3}, Byte{4}, Byte{5}, Byte{6},
+      Byte{7}};
+  std::array<Byte, 7> read{};
+
+  SECTION("host ptr") {
+    Ram ram{32};
+    ram.write_block(3, data);
+    REQUIRE(ram.read(4) == 0x0504'0302);
+    ram.read_block(3, read);
+    REQUIRE(read == data);
+  }
+  SECTION("word accesses") {
+    // Data_mem has no host pointers: the unaligned block is split into words.
+    Data_mem data_mem{{}};
+    REQUIRE_FALSE(data_mem.get_host_ptr(0, 1));
+    data_mem.write_block(3, data);
+    REQUIRE(data_mem.get_content().size() == 7);
+    REQUIRE(data_mem.read(4) == 0x0504'0302);
+    REQUIRE(data_mem.read(8, 0b0011) == 0x0706);
+    data_mem.read_block(3, read);
+    REQUIRE(read == data);
+  }
+  SECTION("bus") {
+    Ram low{16};
+    Ram high{16};
+    Data_mem device{{}};
+    Bus bus{};
+    bus.attach(0, low);
+    bus.attach(16, high);
+    bus.attach(32, device);
+    REQUIRE(bus.get_host_ptr(20, 8) == high.get_host_ptr(4, 8));
+    // Ranges crossing nodes and devices take the word path.
+    REQUIRE_FALSE(bus.get_host_ptr(12, 8));
+    REQUIRE_FALSE(bus.get_host_ptr(32, 4));
+    bus.write_block(12, data);
+    REQUIRE(low.read(12) == 0x0403'0201);
+    REQUIRE(high.read(0, 0b0111) == 0x07'0605);
+    bus.read_block(12, read);
+    REQUIRE(read == data);
+  }
+  SECTION("narrow") {
+    Ram ram{32};
+    Narrow_mem_wrap narrow{ram};
+    narrow.write_block(5, data);
+    REQUIRE(ram.read(8) == 0x0706'0504);
+    REQUIRE(narrow.get_host_ptr(5, 7) == ram.get_host_ptr(5, 7));
+  }
+}
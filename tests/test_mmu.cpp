@@ -0,0 +1,266 @@
+#define CATCH_CONFIG_MAIN
+
+#include "mmu.hpp"
+
+#include "core.hpp"
+#include "csr.hpp"
+#include "exception.hpp"
+#include "isa_extension.hpp"
+#include "ram.hpp"
+#include "rf.hpp"
+
+#include "spdlog/logger.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "catch2/catch_test_macros.hpp"
+
+#include <vector>
+
+namespace {
+  enum Pte_flags : Uxlen {
+    V = 1u << 0,
+    R = 1u << 1,
+    W = 1u << 2,
+    X = 1u << 3,
+    U = 1u << 4,
+    G = 1u << 5,
+    A = 1u << 6,
+    D = 1u << 7,
+  };
+
+  constexpr Uxlen pte(Uxlen ppn, Uxlen flags) { return (ppn << 10) | flags; }
+
+  constexpr std::size_t root{0x4000};
+  constexpr std::size_t table{0x5000};
+  constexpr Uxlen satp{Csr::SATP_SV32 | (root >> 12)};
+
+  // A 4 MiB identity superpage at 0 and 4 KiB pages at 0x400000 through a second level.
+  void map(Ram &ram) {
+    ram.write(root + 0 * 4, pte(0, V | R | W | X | A | D));
+    ram.write(root + 1 * 4, pte(table >> 12, V));
+    ram.write(table + 0 * 4, pte(6, V | R | W));
+    ram.write(table + 1 * 4, pte(7, V | R | U));
+    ram.write(table + 2 * 4, pte(8, V | X));
+    // A superpage with a misaligned physical page.
+    ram.write(root + 2 * 4, pte(1, V | R));
+  }
+
+  template <typename Fun>
+  unsigned int get_fault_cause(Fun access) {
+    try {
+      access();
+    } catch (const Errors::Page_fault &fault) {
+      return fault.m_cause;
+    }
+    return 0;
+  }
+}
+
+TEST_CASE("supervisor csrs", "[MMU]") {
+  Csr csr{};
+  csr.write(Csr::MIDELEG, Irq::to_mask(Irq::STI) | Irq::to_mask(Irq::SSI));
+  csr.write(Csr::MIE, Irq::to_mask(Irq::MTI) | Irq::to_mask(Irq::STI));
+  REQUIRE(csr.read(Csr::SIE) == Irq::to_mask(Irq::STI));
+  csr.write(Csr::SIE, Irq::to_mask(Irq::SSI));
+  REQUIRE(csr.read(Csr::MIE) == (Irq::to_mask(Irq::MTI) | Irq::to_mask(Irq::SSI)));
+
+  csr.write(Csr::SIP, ~Uxlen{0});
+  REQUIRE(csr.read(Csr::MIP) == Irq::to_mask(Irq::SSI));
+
+  csr.write(Csr::MSTATUS, Csr::MSTATUS_MIE | Csr::MSTATUS_SIE | (Uxlen{1} << 11));
+  REQUIRE(csr.read(Csr::SSTATUS) == Csr::MSTATUS_SIE);
+  csr.write(Csr::SSTATUS, Csr::MSTATUS_SUM | Csr::MSTATUS_MIE);
+  REQUIRE(csr.read(Csr::MSTATUS) == (Csr::MSTATUS_MIE | Csr::MSTATUS_SUM | (Uxlen{1} << 11)));
+  // mpp of 0b10 is reserved.
+  csr.write(Csr::MSTATUS, Uxlen{0b10} << 11);
+  REQUIRE(csr.read(Csr::MSTATUS) == (Uxlen{1} << 11));
+
+  csr.write(Csr::SATP, satp);
+  REQUIRE(csr.read(Csr::SATP) == satp);
+  // RV64 only has Bare.
+  Csr64 csr64{};
+  csr64.write(Csr::SATP, std::uint64_t{8} << 60);
+  REQUIRE(csr64.read(Csr::SATP) == 0);
+
+  REQUIRE(Csr::get_privilege(Csr::SSTATUS) == Csr::Privilege::supervisor);
+  REQUIRE(Csr::get_privilege(Csr::MSTATUS) == Csr::Privilege::machine);
+  REQUIRE(Csr::get_privilege(Csr::FCSR) == Csr::Privilege::user);
+}
+
+TEST_CASE("mmu", "[MMU]") {
+  using enum Csr::Privilege;
+  Ram ram{0x10000};
+  map(ram);
+  Mmu mmu{ram};
+  Memory &instr{mmu.get_instr_port()};
+  Memory &data{mmu.get_data_port()};
+
+  SECTION("bare") {
+    mmu.set_context(machine, satp, 0);
+    data.write(0x6000, 1);
+    REQUIRE(ram.read(0x6000) == 1);
+    mmu.set_context(supervisor, 0, 0);
+    REQUIRE(data.read(0x6000) == 1);
+    REQUIRE(mmu.get_walks() == 0);
+  }
+
+  SECTION("translation") {
+    mmu.set_context(supervisor, satp, 0);
+    data.write(0x400004, 0x1234);
+    REQUIRE(ram.read(0x6004) == 0x1234);
+    REQUIRE(data.read(0x400004) == 0x1234);
+    REQUIRE(data.read(0x400004, 0b0010) == 0x00001200);
+    REQUIRE(ram.read(table) == pte(6, V | R | W | A | D));
+    REQUIRE(mmu.get_walks() == 1);
+    // The superpage.
+    REQUIRE(instr.read(0x34, 0b1100) == (ram.read(0x34) & 0xffff0000));
+    REQUIRE(mmu.get_walks() == 2);
+    REQUIRE(data.get_host_ptr(0x400004, 4) == ram.get_host_ptr(0x6004, 4));
+    REQUIRE(data.get_host_ptr(0x400ffe, 4) == nullptr);
+  }
+
+  SECTION("faults") {
+    mmu.set_context(supervisor, satp, 0);
+    REQUIRE(get_fault_cause([&]() { static_cast<void>(data.read(0xc00000)); }) ==
+        Csr::LOAD_PAGE_FAULT);
+    REQUIRE(get_fault_cause([&]() { static_cast<void>(data.read(0x800000)); }) ==
+        Csr::LOAD_PAGE_FAULT);
+    REQUIRE(get_fault_cause([&]() { static_cast<void>(instr.read(0x400000)); }) ==
+        Csr::INSTRUCTION_PAGE_FAULT);
+    REQUIRE(get_fault_cause([&]() { data.write(0x402000, 0); }) == Csr::STORE_PAGE_FAULT);
+    // The address of the first accessed byte.
+    std::size_t fault_addr{0};
+    try {
+      data.write(0xc00004, 0, 0b1000);
+    } catch (const Errors::Page_fault &fault) {
+      fault_addr = fault.m_addr;
+    }
+    REQUIRE(fault_addr == 0xc00007);
+  }
+
+  SECTION("permissions") {
+    mmu.set_context(supervisor, satp, 0);
+    REQUIRE(get_fault_cause([&]() { static_cast<void>(data.read(0x401000)); }) ==
+        Csr::LOAD_PAGE_FAULT);
+    mmu.set_context(supervisor, satp, Csr::MSTATUS_SUM);
+    REQUIRE(get_fault_cause([&]() { static_cast<void>(data.read(0x401000)); }) == 0);
+    REQUIRE(get_fault_cause([&]() { data.write(0x401000, 0); }) == Csr::STORE_PAGE_FAULT);
+
+    REQUIRE(get_fault_cause([&]() { static_cast<void>(data.read(0x402000)); }) ==
+        Csr::LOAD_PAGE_FAULT);
+    mmu.set_context(supervisor, satp, Csr::MSTATUS_MXR);
+    REQUIRE(get_fault_cause([&]() { static_cast<void>(data.read(0x402000)); }) == 0);
+
+    mmu.set_context(user, satp, 0);
+    REQUIRE(get_fault_cause([&]() { static_cast<void>(data.read(0x401000)); }) == 0);
+    REQUIRE(get_fault_cause([&]() { static_cast<void>(data.read(0x400000)); }) ==
+        Csr::LOAD_PAGE_FAULT);
+
+    // mprv translates M-mode loads and stores as in mpp, but not fetches.
+    mmu.set_context(machine, satp, Csr::MSTATUS_MPRV | (Uxlen{0} << 11));
+    REQUIRE(get_fault_cause([&]() { static_cast<void>(data.read(0x400000)); }) ==
+        Csr::LOAD_PAGE_FAULT);
+    REQUIRE(get_fault_cause([&]() { static_cast<void>(instr.read(0x0)); }) == 0);
+  }
+
+  SECTION("tlb") {
+    mmu.set_context(supervisor, satp, 0);
+    REQUIRE(data.read(0x400000) == 0);
+    REQUIRE(mmu.get_walks() == 1);
+
+    // Stale until flushed.
+    ram.write(table, pte(9, V | R | W | A | D));
+    ram.write(0x9000, 9);
+    REQUIRE(data.read(0x400000) == 0);
+    mmu.flush(0x400123);
+    REQUIRE(data.read(0x400000) == 9);
+    REQUIRE(mmu.get_walks() == 2);
+
+    // Entries are tagged with their address space.
+    mmu.set_context(supervisor, satp | (Uxlen{5} << 22), 0);
+    REQUIRE(data.read(0x400000) == 9);
+    REQUIRE(mmu.get_walks() == 3);
+    mmu.flush({}, 0);
+    REQUIRE(data.read(0x400000) == 9);
+    REQUIRE(mmu.get_walks() == 3);
+    mmu.flush({}, 5);
+    REQUIRE(data.read(0x400000) == 9);
+    REQUIRE(mmu.get_walks() == 4);
+
+    // Global mappings are shared by the address spaces and only go with a full flush.
+    ram.write(root, pte(0, V | R | W | X | A | D | G));
+    mmu.flush();
+    REQUIRE(data.read(0x10) == ram.read(0x10));
+    REQUIRE(mmu.get_walks() == 5);
+    mmu.flush({}, 5);
+    mmu.set_context(supervisor, satp, 0);
+    REQUIRE(data.read(0x10) == ram.read(0x10));
+    REQUIRE(mmu.get_walks() == 5);
+    mmu.flush();
+    REQUIRE(data.read(0x10) == ram.read(0x10));
+    REQUIRE(mmu.get_walks() == 6);
+  }
+}
+
+TEST_CASE("supervisor mode", "[MMU]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  const std::vector<std::pair<std::size_t, std::vector<Uxlen>>> program{
+    {0x000, {
+      0x800002b7, // lui t0, 0x80000
+      0x00428293, // addi t0, t0, 4
+      0x18029073, // csrw satp, t0
+      0x00002337, // lui t1, 2
+      0x30231073, // csrw medeleg, t1
+      0x10000393, // addi t2, x0, 0x100
+      0x10539073, // csrw stvec, t2
+      0x08000e13, // addi t3, x0, 0x80
+      0x341e1073, // csrw mepc, t3
+      0x00001eb7, // lui t4, 1
+      0x800e8e93, // addi t4, t4, -2048
+      0x300ea073, // csrs mstatus, t4
+      0x30200073, // mret
+    }},
+    // S-mode.
+    {0x080, {
+      0x00800537, // lui a0, 0x800
+      0x02a00593, // addi a1, x0, 42
+      0x00b52023, // sw a1, 0(a0)
+      0x00052603, // lw a2, 0(a0)
+      0x004006b7, // lui a3, 0x400
+      0x0006a703, // lw a4, 0(a3)
+    }},
+    // The page fault handler.
+    {0x100, {
+      0x14202473, // csrr s0, scause
+      0x143024f3, // csrr s1, stval
+      0x14102973, // csrr s2, sepc
+      0x0000006f, // j .
+    }},
+  };
+  Ram ram{0x10000};
+  for (const auto &[addr, words] : program) {
+    for (std::size_t i{0}; i < words.size(); ++i) ram.write(addr + 4 * i, words[i]);
+  }
+  // Identity at 0 and 0x800000 to 0x6000. 0x400000 isn't mapped.
+  ram.write(root + 0 * 4, pte(0, V | R | W | X | A | D));
+  ram.write(root + 2 * 4, pte(table >> 12, V));
+  ram.write(table, pte(6, V | R | W));
+
+  Mmu mmu{ram};
+  Rf rf{};
+  Csr csr{};
+  Core core{mmu.get_instr_port(), mmu.get_data_port(), csr, rf, my_logger,
+      {Isa_extension::isa_zicsr, Isa_extension::isa_s}, nullptr, nullptr, 0, &mmu};
+
+  for (unsigned int i{0}; (i < 100) && !core.is_waiting(); ++i) core.cycle();
+  REQUIRE(core.is_waiting());
+  REQUIRE(core.get_privilege() == Csr::Privilege::supervisor);
+  REQUIRE(ram.read(0x6000) == 42);
+  REQUIRE(rf.read(12) == 42);
+  REQUIRE(rf.read(8) == Csr::LOAD_PAGE_FAULT);
+  REQUIRE(rf.read(9) == 0x400000);
+  REQUIRE(rf.read(18) == 0x94);
+  REQUIRE(ram.read(table) == pte(6, V | R | W | A | D));
+  REQUIRE((csr.read(Csr::MSTATUS) & Csr::MSTATUS_SPP) != 0);
+}
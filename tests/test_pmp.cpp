@@ -0,0 +1,244 @@
+#define CATCH_CONFIG_MAIN
+
+#include "pmp.hpp"
+
+#include "core.hpp"
+#include "csr.hpp"
+#include "exception.hpp"
+#include "isa_extension.hpp"
+#include "mmu.hpp"
+#include "ram.hpp"
+#include "rf.hpp"
+
+#include "spdlog/logger.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "catch2/catch_test_macros.hpp"
+
+#include <vector>
+
+namespace {
+  using Access = Pmp_base::Access;
+
+  constexpr std::uint8_t tor  (std::uint8_t rwx) { return rwx | (1u << 3); }
+  constexpr std::uint8_t na4  (std::uint8_t rwx) { return rwx | (2u << 3); }
+  constexpr std::uint8_t napot(std::uint8_t rwx) { return rwx | (3u << 3); }
+  constexpr std::uint8_t rwx{Pmp::CFG_R | Pmp::CFG_W | Pmp::CFG_X};
+
+  // pmpaddr of the naturally aligned power of 2 region [base, base + size).
+  constexpr Uxlen to_napot(std::size_t base, std::size_t size) {
+    return static_cast<Uxlen>((base | (size / 2 - 1)) >> 2);
+  }
+}
+
+TEST_CASE("pmp", "[PMP]") {
+  Pmp pmp{};
+
+  SECTION("no entry") {
+    REQUIRE(pmp.is_allowed(0x1000, 4, Access::store, true));
+    REQUIRE_FALSE(pmp.is_allowed(0x1000, 4, Access::load, false));
+  }
+
+  SECTION("modes") {
+    pmp.set_addr(0, to_napot(0x10000, 0x10000));
+    pmp.set_cfg (0, napot(Pmp::CFG_R | Pmp::CFG_X));
+    pmp.set_addr(1, 0x3000 >> 2);
+    pmp.set_cfg (1, na4(Pmp::CFG_R | Pmp::CFG_W));
+    pmp.set_addr(2, 0x4000 >> 2);
+    pmp.set_addr(3, 0x5000 >> 2);
+    pmp.set_cfg (3, tor(Pmp::CFG_R | Pmp::CFG_W));
+
+    REQUIRE(pmp.is_allowed(0x10000, 4, Access::fetch, false));
+    REQUIRE(pmp.is_allowed(0x1fffc, 4, Access::load , false));
+    REQUIRE_FALSE(pmp.is_allowed(0x1fffc, 4, Access::store, false));
+    REQUIRE_FALSE(pmp.is_allowed(0x20000, 4, Access::load , false));
+    REQUIRE_FALSE(pmp.is_allowed(0x0fffc, 4, Access::load , false));
+
+    REQUIRE(pmp.is_allowed(0x3000, 4, Access::store, false));
+    REQUIRE_FALSE(pmp.is_allowed(0x3004, 4, Access::store, false));
+    // In part in the entry.
+    REQUIRE_FALSE(pmp.is_allowed(0x3002, 4, Access::load, false));
+
+    REQUIRE(pmp.is_allowed(0x4000, 4, Access::store, false));
+    REQUIRE(pmp.is_allowed(0x4ffc, 4, Access::load , false));
+    REQUIRE_FALSE(pmp.is_allowed(0x4ffc, 4, Access::fetch, false));
+    REQUIRE_FALSE(pmp.is_allowed(0x5000, 4, Access::load , false));
+
+    // Unlocked entries don't apply to M-mode.
+    REQUIRE(pmp.is_allowed(0x1fffc, 4, Access::store, true));
+
+    // W without R is reserved.
+    pmp.set_cfg(4, na4(Pmp::CFG_W));
+    REQUIRE(pmp.get_cfg(4) == na4(0));
+  }
+
+  SECTION("priority") {
+    pmp.set_addr(0, 0x2000 >> 2);
+    pmp.set_cfg (0, na4(0));
+    pmp.set_addr(1, to_napot(0, 0x10000));
+    pmp.set_cfg (1, napot(rwx));
+    REQUIRE_FALSE(pmp.is_allowed(0x2000, 4, Access::load, false));
+    REQUIRE(pmp.is_allowed(0x2004, 4, Access::load, false));
+    // The whole address space.
+    pmp.set_addr(1, ~Uxlen{0});
+    REQUIRE(pmp.is_allowed(0xfffffffc, 4, Access::store, false));
+  }
+
+  SECTION("lock") {
+    pmp.set_addr(0, 0x1000 >> 2);
+    pmp.set_addr(1, 0x2000 >> 2);
+    pmp.set_cfg (1, tor(Pmp::CFG_R) | Pmp::CFG_L);
+    REQUIRE_FALSE(pmp.is_allowed(0x1000, 4, Access::store, true));
+    REQUIRE(pmp.is_allowed(0x1000, 4, Access::load, true));
+
+    pmp.set_cfg (1, napot(rwx));
+    pmp.set_addr(1, 0);
+    // The bottom of the locked TOR entry.
+    pmp.set_addr(0, 0);
+    REQUIRE(pmp.get_cfg (1) == (tor(Pmp::CFG_R) | Pmp::CFG_L));
+    REQUIRE(pmp.get_addr(1) == 0x2000 >> 2);
+    REQUIRE(pmp.get_addr(0) == 0x1000 >> 2);
+  }
+
+  SECTION("cache") {
+    pmp.set_addr(0, to_napot(0, 0x10000));
+    pmp.set_cfg (0, napot(rwx));
+    for (std::size_t addr{0}; addr < 0x10000; addr += 4) {
+      REQUIRE(pmp.is_allowed(addr, 4, Access::load, false));
+    }
+    REQUIRE(pmp.get_scans() == 0);
+
+    // A page an entry covers in part is scanned.
+    pmp.set_addr(1, 0x20000 >> 2);
+    pmp.set_cfg (1, na4(Pmp::CFG_R));
+    REQUIRE(pmp.is_allowed(0x20000, 4, Access::load, false));
+    REQUIRE_FALSE(pmp.is_allowed(0x20004, 4, Access::load, false));
+    REQUIRE(pmp.get_scans() == 2);
+
+    // Writes clear the cache.
+    REQUIRE(pmp.is_allowed(0x1000, 4, Access::store, false));
+    pmp.set_cfg(0, napot(Pmp::CFG_R));
+    REQUIRE_FALSE(pmp.is_allowed(0x1000, 4, Access::store, false));
+  }
+}
+
+TEST_CASE("pmp csrs", "[PMP]") {
+  SECTION("rv32") {
+    Csr csr{};
+    csr.write(Csr::PMPCFG0 + 3, 0x1f111b19);
+    REQUIRE(csr.read(Csr::PMPCFG0 + 3) == 0x1f111b19);
+    REQUIRE(csr.get_pmp().get_cfg(13) == 0x1b);
+    csr.write(Csr::PMPADDR0 + 15, 0xffffffff);
+    REQUIRE(csr.get_pmp().get_addr(15) == 0xffffffff);
+    REQUIRE(csr.read(Csr::PMPADDR0 + 15) == 0xffffffff);
+    REQUIRE_THROWS_AS(csr.read(Csr::PMPADDR0 + 16), Errors::Illegal_addr);
+  }
+  SECTION("rv64") {
+    Csr64 csr{};
+    csr.write(Csr::PMPCFG0 + 2, 0x1f1e1d1c'1b1a1918);
+    REQUIRE(csr.get_pmp().get_cfg(8)  == 0x18);
+    REQUIRE(csr.get_pmp().get_cfg(15) == 0x1f);
+    REQUIRE_THROWS_AS(csr.write(Csr::PMPCFG0 + 1, 0), Errors::Illegal_addr);
+    csr.write(Csr::PMPADDR0, ~std::uint64_t{0});
+    REQUIRE(csr.read(Csr::PMPADDR0) == (std::uint64_t{1} << 54) - 1);
+  }
+}
+
+TEST_CASE("pmp mmu", "[PMP]") {
+  using enum Csr::Privilege;
+  Ram ram{0x10000};
+  Csr csr{};
+  Mmu mmu{ram, &csr.get_pmp()};
+  Memory &data{mmu.get_data_port()};
+  Memory &instr{mmu.get_instr_port()};
+
+  csr.write(Csr::PMPADDR0, to_napot(0, 0x4000));
+  csr.write(Csr::PMPADDR0 + 1, 0x5000 >> 2);
+  csr.write(Csr::PMPCFG0, (tor(Pmp::CFG_R) << 8) | napot(Pmp::CFG_X));
+
+  mmu.set_context(machine, 0, 0);
+  data.write(0x4000, 1);
+  mmu.set_context(supervisor, 0, 0);
+  REQUIRE(data.read(0x4000) == 1);
+  REQUIRE(instr.read(0x0) == 0);
+  REQUIRE(data.get_host_ptr(0x4000, 4) == nullptr);
+
+  unsigned int cause{0};
+  std::size_t addr{0};
+  try {
+    data.write(0x4000, 2, 0b0100);
+  } catch (const Errors::Access_fault &fault) {
+    cause = fault.m_cause;
+    addr  = fault.m_addr;
+  }
+  REQUIRE(cause == Csr::STORE_ACCESS_FAULT);
+  REQUIRE(addr == 0x4002);
+  REQUIRE_THROWS_AS(data.read(0x5000), Errors::Access_fault);
+  REQUIRE_THROWS_AS(instr.read(0x4000), Errors::Access_fault);
+
+  // The page tables are read as of S-mode.
+  mmu.set_context(supervisor, Csr::SATP_SV32 | (0x6000 >> 12), 0);
+  try {
+    static_cast<void>(data.read(0x1000));
+  } catch (const Errors::Access_fault &fault) {
+    cause = fault.m_cause;
+  }
+  REQUIRE(cause == Csr::LOAD_ACCESS_FAULT);
+}
+
+TEST_CASE("pmp core", "[PMP]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  const std::vector<std::pair<std::size_t, std::vector<Uxlen>>> program{
+    {0x000, {
+      0x3ff00293, // addi t0, x0, 0x3ff
+      0x3b029073, // csrw pmpaddr0, t0
+      0x000012b7, // lui t0, 1
+      0xc0028293, // addi t0, t0, -1024
+      0x3b129073, // csrw pmpaddr1, t0
+      0x000012b7, // lui t0, 1
+      0x11f28293, // addi t0, t0, 0x11f
+      0x3a029073, // csrw pmpcfg0, t0
+      0x10000313, // addi t1, x0, 0x100
+      0x30531073, // csrw mtvec, t1
+      0x08000393, // addi t2, x0, 0x80
+      0x34139073, // csrw mepc, t2
+      0x00001e37, // lui t3, 1
+      0x800e0e13, // addi t3, t3, -2048
+      0x300e2073, // csrs mstatus, t3
+      0x30200073, // mret
+    }},
+    // S-mode, allowed 0 to 0x2000 and to read 0x3000 to 0x3004.
+    {0x080, {
+      0x00003537, // lui a0, 3
+      0x00052583, // lw a1, 0(a0)
+      0x00b52023, // sw a1, 0(a0)
+    }},
+    {0x100, {
+      0x34202473, // csrr s0, mcause
+      0x343024f3, // csrr s1, mtval
+      0x34102973, // csrr s2, mepc
+      0x0000006f, // j .
+    }},
+  };
+  Ram ram{0x10000};
+  for (const auto &[addr, words] : program) {
+    for (std::size_t i{0}; i < words.size(); ++i) ram.write(addr + 4 * i, words[i]);
+  }
+  ram.write(0x3000, 7);
+
+  Rf rf{};
+  Csr csr{};
+  Mmu mmu{ram, &csr.get_pmp()};
+  Core core{mmu.get_instr_port(), mmu.get_data_port(), csr, rf, my_logger,
+      {Isa_extension::isa_zicsr, Isa_extension::isa_s}, nullptr, nullptr, 0, &mmu};
+
+  for (unsigned int i{0}; (i < 100) && !core.is_waiting(); ++i) core.cycle();
+  REQUIRE(core.is_waiting());
+  REQUIRE(core.get_privilege() == Csr::Privilege::machine);
+  REQUIRE(rf.read(11) == 7);
+  REQUIRE(rf.read(8) == Csr::STORE_ACCESS_FAULT);
+  REQUIRE(rf.read(9) == 0x3000);
+  REQUIRE(rf.read(18) == 0x88);
+  REQUIRE(ram.read(0x3000) == 7);
+}
@@ -0,0 +1,177 @@
+#define CATCH_CONFIG_MAIN
+
+#include "replay_log.hpp"
+
+#include "core.hpp"
+#include "csr.hpp"
+#include "data_mem.hpp"
+#include "exception.hpp"
+#include "instr_mem.hpp"
+#include "irq.hpp"
+#include "plic.hpp"
+#include "ram.hpp"
+#include "rf.hpp"
+#include "scheduler.hpp"
+#include "uart16550.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "spdlog/logger.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "catch2/catch_test_macros.hpp"
+
+namespace {
+  using Mode = Replay_log::Mode;
+
+  struct Log_file {
+    char path[32]{"/tmp/test_replay_log_XXXXXX"};
+
+    Log_file() {
+      const int fd{::mkstemp(path)};
+      REQUIRE(fd >= 0);
+      ::close(fd);
+    }
+    ~Log_file() { ::unlink(path); }
+
+    [[nodiscard]] std::size_t size() const {
+      struct stat st{};
+      REQUIRE(::stat(path, &st) == 0);
+      return static_cast<std::size_t>(st.st_size);
+    }
+  };
+
+  [[nodiscard]] bool is_mei_pending(const Irq_pending &irq_pending) {
+    return (irq_pending.get() & Irq::to_mask(Irq::MEI)) != 0;
+  }
+
+  [[nodiscard]] std::uint8_t get(Uart16550 &uart, std::size_t reg) {
+    const std::size_t lane{reg % 4};
+    return static_cast<std::uint8_t>(uart.read(reg - lane, 1u << lane) >> (8 * lane));
+  }
+}
+
+TEST_CASE("replay log", "[REPLAY]") {
+  const Log_file file{};
+  const Uart16550::Config config{.tx_mode = Uart16550::Tx_mode::discard};
+
+  {
+    Scheduler scheduler{};
+    Irq_pending irq_pending{};
+    Ram ram{0x100};
+    Replay_log log{scheduler, file.path, Mode::record, 100};
+    const Replay_log::Channel line{log.add_irq_line(irq_pending, Irq::MEI)};
+    Replay_mem_wrap device{ram, log};
+    Uart16550 uart{scheduler, config, nullptr, 0, &log};
+
+    // Inputs of other threads wait for the next poll.
+    std::thread{[&]() { log.post(line, 1); }}.join();
+    scheduler.advance_to(99);
+    REQUIRE_FALSE(is_mei_pending(irq_pending));
+    scheduler.advance_to(250);
+    REQUIRE(is_mei_pending(irq_pending));
+
+    uart.receive("ab");
+    ram.write(0x10, 7);
+    REQUIRE(device.read(0x10) == 7);
+    scheduler.advance_to(260);
+    ram.write(0x10, 8);
+    REQUIRE(device.read(0x10) == 8);
+    std::thread{[&]() { log.post(line, 0); }}.join();
+    scheduler.advance_to(400);
+    REQUIRE_FALSE(is_mei_pending(irq_pending));
+    REQUIRE(log.get_inputs() == 6);
+  }
+  // The header and 3 bytes an input, 4 after the 150 instructions between 100 and 250.
+  REQUIRE(file.size() == 5 + 6 * 3 + 1);
+
+  Scheduler scheduler{};
+  Irq_pending irq_pending{};
+  Ram ram{0x100};
+  ram.write(0x10, 99);
+  Replay_log log{scheduler, file.path, Mode::replay, 100};
+  const Replay_log::Channel line{log.add_irq_line(irq_pending, Irq::MEI)};
+  Replay_mem_wrap device{ram, log};
+  Uart16550 uart{scheduler, config, nullptr, 0, &log};
+
+  // Live inputs are dropped, the logged ones come at the same times.
+  log.post(line, 1);
+  scheduler.advance_to(99);
+  REQUIRE_FALSE(is_mei_pending(irq_pending));
+  scheduler.advance_to(100);
+  REQUIRE(is_mei_pending(irq_pending));
+  scheduler.advance_to(250);
+  uart.receive("zz");
+  REQUIRE(get(uart, Uart16550::RBR) == 'a');
+  REQUIRE(get(uart, Uart16550::RBR) == 'b');
+  REQUIRE((get(uart, Uart16550::LSR) & Uart16550::LSR_DR) == 0);
+  REQUIRE(device.read(0x10) == 7);
+  scheduler.advance_to(260);
+  REQUIRE(device.read(0x10) == 8);
+  REQUIRE(ram.read(0x10) == 99);
+  // A read the log doesn't have.
+  REQUIRE_THROWS_AS(device.read(0x10), Errors::Error);
+  scheduler.advance_to(299);
+  REQUIRE(is_mei_pending(irq_pending));
+  scheduler.advance_to(300);
+  REQUIRE_FALSE(is_mei_pending(irq_pending));
+  REQUIRE(log.get_inputs() == 6);
+
+  REQUIRE_THROWS_AS((Replay_log{scheduler, "/nonexistent/log", Mode::replay}), Errors::Error);
+}
+
+TEST_CASE("replay of a core", "[REPLAY]") {
+  const std::vector<Uxlen> instr{
+    0x02000093, // addi x1, x0, 0x20
+    0x30509073, // csrrw x0, mtvec, x1
+    0x000010b7, // lui x1, 1
+    0x80008093, // addi x1, x1, -0x800
+    0x30409073, // csrrw x0, mie, x1
+    0x30046073, // csrrsi x0, mstatus, 8
+    0x00150513, // addi a0, a0, 1
+    0xffdff06f, // j 0x18
+    0x00050293, // addi x5, a0, 0
+    0x0000006f, // j .
+  };
+  const Log_file file{};
+
+  // The instructions retired before the interrupt, and mepc.
+  const auto run = [&](Mode mode) {
+    Instr_mem instr_mem{instr};
+    Data_mem data_mem{{}};
+    Rf rf{};
+    Irq_pending irq_pending{};
+    Csr csr{irq_pending};
+    Plic plic{irq_pending};
+    plic.write(Plic::PRIORITY + 4 * 1, 1);
+    plic.write(Plic::ENABLE, 1u << 1);
+    auto logger = std::make_shared<spdlog::logger>("console",
+        std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+    Core core{instr_mem, data_mem, csr, rf, logger, Isa_extension::isa_zicsr, &irq_pending};
+    Scheduler scheduler{};
+    Replay_log log{scheduler, file.path, mode, 1000};
+    const Replay_log::Channel source{log.add_plic_source(plic, 1)};
+
+    // At whatever instruction the host gets to it.
+    std::thread device{[&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds{mode == Mode::record ? 5 : 1});
+      log.post(source, 1);
+    }};
+    for (unsigned int i{0}; (core.get_pc() != 0x24) && (i < 1'000'000); ++i) {
+      core.run(scheduler, scheduler.get_now() + 100);
+    }
+    device.join();
+    REQUIRE(core.get_pc() == 0x24);
+    return std::pair{rf.read(5), csr.read(Csr::MEPC)};
+  };
+
+  const auto recorded{run(Mode::record)};
+  REQUIRE(recorded.first > 0);
+  REQUIRE(run(Mode::replay) == recorded);
+}
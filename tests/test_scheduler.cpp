@@ -0,0 +1,118 @@
+#define CATCH_CONFIG_MAIN
+
+#include "clint.hpp"
+#include "core.hpp"
+#include "csr.hpp"
+#include "data_mem.hpp"
+#include "instr_mem.hpp"
+#include "irq.hpp"
+#include "rf.hpp"
+#include "scheduler.hpp"
+
+#include "spdlog/logger.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "catch2/catch_test_macros.hpp"
+
+#include <vector>
+
+TEST_CASE("scheduler", "[SCHEDULER]") {
+  Scheduler scheduler{};
+  std::vector<int> order{};
+
+  SECTION("empty") {
+    REQUIRE(scheduler.get_next_deadline() == Scheduler::never);
+    scheduler.advance_to(100);
+    REQUIRE(scheduler.get_now() == 100);
+    REQUIRE_THROWS_AS(scheduler.schedule_at(99, []() {}), Errors::Error);
+  }
+
+  SECTION("order") {
+    const std::vector<Scheduler::Time> times{50, 10, 70, 10, 30, 90, 20, 60, 40, 80, 30};
+    for (std::size_t i{0}; i < times.size(); ++i) {
+      scheduler.schedule_at(times[i], [&order, &scheduler, i]() {
+        order.push_back(static_cast<int>(scheduler.get_now() * 100 + i));
+      });
+    }
+    REQUIRE(scheduler.get_next_deadline() == 10);
+    scheduler.advance_to(35);
+    REQUIRE(order == std::vector<int>{1001, 1003, 2006, 3004, 3010});
+    REQUIRE(scheduler.get_now() == 35);
+    REQUIRE(scheduler.get_next_deadline() == 40);
+    scheduler.advance_to(1000);
+    REQUIRE(order.size() == times.size());
+    REQUIRE(scheduler.empty());
+  }
+
+  SECTION("cancel") {
+    const auto first {scheduler.schedule_in(10, [&order]() { order.push_back(1); })};
+    const auto second{scheduler.schedule_in(20, [&order]() { order.push_back(2); })};
+    scheduler.schedule_in(30, [&order]() { order.push_back(3); });
+    scheduler.cancel(second);
+    scheduler.cancel(first);
+    REQUIRE(scheduler.get_next_deadline() == 30);
+    scheduler.advance_to(30);
+    REQUIRE(order == std::vector<int>{3});
+    // Already ran.
+    scheduler.cancel(first);
+    scheduler.schedule_in(10, [&order]() { order.push_back(4); });
+    scheduler.advance_to(40);
+    REQUIRE(order == std::vector<int>{3, 4});
+  }
+
+  SECTION("nested") {
+    scheduler.schedule_at(10, [&]() {
+      order.push_back(1);
+      scheduler.schedule_in(0, [&order]() { order.push_back(2); });
+      scheduler.schedule_in(5, [&order]() { order.push_back(3); });
+    });
+    scheduler.advance_to(12);
+    REQUIRE(order == std::vector<int>{1, 2});
+    scheduler.advance_to(15);
+    REQUIRE(order == std::vector<int>{1, 2, 3});
+  }
+}
+
+TEST_CASE("core run", "[CORE_RUN]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  const std::vector<Uxlen> instr{
+    0x02000093, // addi x1, x0, 0x20
+    0x30509073, // csrrw x0, mtvec, x1
+    0x08000093, // addi x1, x0, 0x80
+    0x30409073, // csrrw x0, mie, x1
+    0x30046073, // csrrsi x0, mstatus, 8
+    0x10500073, // wfi
+    0x0000006f, // j .
+    0x00000013, // nop
+    0x00128293, // addi x5, x5, 1
+    0x0000006f, // j .
+  };
+  Instr_mem instr_mem{instr};
+  Data_mem data_mem{{}};
+  Rf rf{};
+  Irq_pending irq_pending{};
+  Csr csr{irq_pending};
+  Scheduler scheduler{};
+  Clint clint{irq_pending, scheduler, 10};
+  Core core{instr_mem, data_mem, csr, rf, my_logger, Isa_extension::isa_zicsr, &irq_pending};
+
+  clint.write(Clint::MTIMECMP_H, 0);
+  clint.write(Clint::MTIMECMP  , 100);
+  REQUIRE(scheduler.get_next_deadline() == 1000);
+
+  std::vector<Scheduler::Time> device_events{};
+  scheduler.schedule_at(3, [&]() { device_events.push_back(scheduler.get_now()); });
+
+  core.run(scheduler, 999);
+  REQUIRE(core.is_waiting());
+  REQUIRE(device_events == std::vector<Scheduler::Time>{3});
+  REQUIRE(scheduler.get_now() == 999);
+  REQUIRE(rf.read(5) == 0);
+  REQUIRE(clint.get_time() == 99);
+
+  core.run(scheduler, 1001);
+  REQUIRE(rf.read(5) == 1);
+  REQUIRE(csr.read(Csr::MEPC) == 0x18);
+  REQUIRE(scheduler.get_now() == 1001);
+}
@@ -0,0 +1,146 @@
+#define CATCH_CONFIG_MAIN
+
+#include "smp.hpp"
+
+#include "amo.hpp"
+#include "bus.hpp"
+#include "clint.hpp"
+#include "instr_mem.hpp"
+#include "isa_extension.hpp"
+#include "ram.hpp"
+
+#include "spdlog/logger.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "catch2/catch_test_macros.hpp"
+
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace {
+  // Stops the harts once the word at `addr` holds `value`.
+  std::jthread stop_when(Smp &smp, Ram &ram, std::size_t addr, std::uint32_t value) {
+    return std::jthread{[&smp, host = ram.get_host_ptr(addr, 4), value]() {
+      while (Amo::load<std::uint32_t>(host) != value) std::this_thread::yield();
+      smp.stop();
+    }};
+  }
+}
+
+TEST_CASE("Smp shared counters", "[SMP]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  const std::vector<Uxlen> instr{
+    0xf14020f3, // csrr x1, mhartid
+    0x10000113, // addi x2, x0, 0x100
+    0x00100193, // addi x3, x0, 1
+    0x3e800213, // addi x4, x0, 1000
+    0x0031202f, // amoadd.w x0, x3, (x2)
+    0xfff20213, // addi x4, x4, -1
+    0xfe021ce3, // bnez x4, -8
+    0x00410393, // addi x7, x2, 4
+    0x3e800213, // addi x4, x0, 1000
+    0x1003a42f, // lr.w x8, (x7)
+    0x00140413, // addi x8, x8, 1
+    0x1883a4af, // sc.w x9, x8, (x7)
+    0xfe049ae3, // bnez x9, -12
+    0xfff20213, // addi x4, x4, -1
+    0xfe0216e3, // bnez x4, -20
+    0x00209293, // slli x5, x1, 2
+    0x002282b3, // add x5, x5, x2
+    0x0012a823, // sw x1, 16(x5)
+    0x0330000f, // fence rw, rw
+    0x00810313, // addi x6, x2, 8
+    0x0033202f, // amoadd.w x0, x3, (x6)
+    0x0000006f, // j .
+  };
+  Instr_mem instr_mem{instr};
+  Ram ram{0x200};
+  constexpr std::size_t harts{4};
+  Smp smp{harts, instr_mem, ram, my_logger, {Isa_extension::isa_zicsr, Isa_extension::isa_a}};
+
+  // Every hart stops at the instruction budget.
+  smp.run(3);
+  for (std::size_t hart{0}; hart < harts; ++hart) {
+    REQUIRE(smp.get_core(hart).get_pc() == 12);
+    REQUIRE(smp.get_rf(hart).read(2) == 0x100);
+  }
+
+  {
+    const std::jthread stopper{stop_when(smp, ram, 0x108, harts)};
+    smp.run(1'000'000);
+  }
+  // amoadd and the lr/sc loop lose no increment.
+  REQUIRE(ram.read(0x100) == harts * 1000);
+  REQUIRE(ram.read(0x104) == harts * 1000);
+  for (Uxlen hart{0}; hart < harts; ++hart) {
+    REQUIRE(ram.read(0x110 + 4 * hart) == hart);
+    REQUIRE(smp.get_csr(hart).read(Csr::MHARTID) == hart);
+  }
+}
+
+TEST_CASE("Smp software interrupt", "[SMP]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  // Hart 0 sets the msip of hart 1, which waits for it in wfi.
+  const std::vector<Uxlen> instr{
+    0xf14020f3, // csrr x1, mhartid
+    0x02000537, // lui x10, 0x2000
+    0x00009863, // bnez x1, 16
+    0x00100193, // addi x3, x0, 1
+    0x00352223, // sw x3, 4(x10)
+    0x0000006f, // j .
+    0x00800193, // addi x3, x0, 8
+    0x30419073, // csrw mie, x3
+    0x10500073, // wfi
+    0x34402273, // csrr x4, mip
+    0x20402023, // sw x4, 0x200(x0)
+    0x00052223, // sw x0, 4(x10)
+    0x0000006f, // j .
+  };
+  Instr_mem instr_mem{instr};
+  Ram ram{0x400};
+  Bus bus{};
+  bus.attach(0, ram);
+  Smp smp{2, instr_mem, bus, my_logger, Isa_extension::isa_zicsr};
+  Clint clint{smp.get_irq_pendings()};
+  bus.attach(0x2000000, clint);
+
+  {
+    const std::jthread stopper{stop_when(smp, ram, 0x200, Irq::to_mask(Irq::MSI))};
+    smp.run(1'000'000);
+  }
+  REQUIRE(ram.read(0x200) == Irq::to_mask(Irq::MSI));
+  REQUIRE(smp.get_irq_pending(0).get() == 0);
+}
+
+TEST_CASE("Smp hart exit", "[SMP]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  // Hart 0 exits right away while hart 1 counts to 1000 first.
+  const std::vector<Uxlen> instr{
+    0xf14020f3, // csrr x1, mhartid
+    0x00009463, // bnez x1, 8
+    0x00000073, // ecall
+    0x3e800213, // addi x4, x0, 1000
+    0x00128293, // addi x5, x5, 1
+    0xfff20213, // addi x4, x4, -1
+    0xfe021ce3, // bnez x4, -8
+    0x10502023, // sw x5, 0x100(x0)
+    0x00000073, // ecall
+  };
+  Instr_mem instr_mem{instr};
+  Ram ram{0x200};
+  Smp smp{2, instr_mem, ram, my_logger, Isa_extension::isa_zicsr};
+  smp.get_core(0).set_ecall_handler([]() -> std::optional<Uxlen> { return 3; });
+  smp.get_core(1).set_ecall_handler([]() -> std::optional<Uxlen> { return 5; });
+
+  // Returns without `stop` once both guests exited.
+  smp.run(1'000'000);
+  REQUIRE(smp.get_core(0).get_exit_code() == 3);
+  REQUIRE(smp.get_core(1).get_exit_code() == 5);
+  REQUIRE(ram.read(0x100) == 1000);
+}
@@ -0,0 +1,254 @@
+#define CATCH_CONFIG_MAIN
+
+#include "uart16550.hpp"
+
+#include "bus.hpp"
+#include "core.hpp"
+#include "csr.hpp"
+#include "irq.hpp"
+#include "plic.hpp"
+#include "ram.hpp"
+#include "rf.hpp"
+#include "scheduler.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "spdlog/logger.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+#include "catch2/catch_test_macros.hpp"
+
+namespace {
+  constexpr unsigned int irq_source{10};
+
+  struct Pipe {
+    int fds[2]{-1, -1};
+
+    Pipe() {
+      REQUIRE(::pipe(fds) == 0);
+      REQUIRE(::fcntl(fds[0], F_SETFL, O_NONBLOCK) == 0);
+    }
+    ~Pipe() {
+      ::close(fds[0]);
+      ::close(fds[1]);
+    }
+
+    [[nodiscard]] std::string read_all() const {
+      char buffer[256]{};
+      const ssize_t size{::read(fds[0], buffer, sizeof(buffer))};
+      return (size > 0) ? std::string(buffer, static_cast<std::size_t>(size)) : "";
+    }
+  };
+
+  void put(Uart16550 &uart, std::string_view text) {
+    for (const char c : text) uart.write(Uart16550::THR, static_cast<unsigned char>(c), 0b0001);
+  }
+
+  [[nodiscard]] std::uint8_t get(Uart16550 &uart, std::size_t reg) {
+    const std::size_t lane{reg % 4};
+    return static_cast<std::uint8_t>(uart.read(reg - lane, 1u << lane) >> (8 * lane));
+  }
+}
+
+TEST_CASE("uart registers", "[UART]") {
+  Scheduler scheduler{};
+  Irq_pending irq_pending{};
+  Plic plic{irq_pending};
+  plic.write(Plic::PRIORITY + 4 * irq_source, 1);
+  plic.write(Plic::ENABLE, Uxlen{1} << irq_source);
+  Uart16550 uart{scheduler, {.tx_mode = Uart16550::Tx_mode::discard}, &plic, irq_source};
+
+  SECTION("idle") {
+    REQUIRE(get(uart, Uart16550::LSR) == (Uart16550::LSR_THRE | Uart16550::LSR_TEMT));
+    REQUIRE(get(uart, Uart16550::IIR) == Uart16550::IIR_NO_IRQ);
+    REQUIRE(get(uart, Uart16550::MSR) == Uart16550::MSR_CONNECTED);
+    uart.write(4, 0x5a << 24, 0b1000);
+    REQUIRE(get(uart, Uart16550::SCR) == 0x5a);
+    // The divisor latch.
+    uart.write(0, Uxlen{Uart16550::LCR_DLAB} << 24, 0b1000);
+    uart.write(0, 0x0c, 0b0001);
+    REQUIRE(get(uart, Uart16550::DLL) == 0x0c);
+    REQUIRE(uart.get_tx_bytes() == 0);
+    uart.write(0, 0x03 << 24, 0b1000);
+    REQUIRE(get(uart, Uart16550::RBR) == 0);
+    REQUIRE_THROWS_AS(uart.read(8, 0b0001), Errors::Illegal_addr);
+  }
+
+  SECTION("rx") {
+    uart.write(0, Uart16550::IER_ERBFI << 8, 0b0010);
+    uart.receive("ab");
+    REQUIRE(irq_pending.get() == Irq::to_mask(Irq::MEI));
+    REQUIRE(get(uart, Uart16550::IIR) == Uart16550::IIR_RX_DATA);
+    REQUIRE(get(uart, Uart16550::LSR) & Uart16550::LSR_DR);
+    REQUIRE(get(uart, Uart16550::RBR) == 'a');
+    REQUIRE(get(uart, Uart16550::RBR) == 'b');
+    REQUIRE(irq_pending.get() == 0);
+    REQUIRE_FALSE(get(uart, Uart16550::LSR) & Uart16550::LSR_DR);
+
+    uart.receive(std::string(Uart16550::fifo_depth + 1, 'x'));
+    REQUIRE(get(uart, Uart16550::LSR) & Uart16550::LSR_OE);
+    REQUIRE_FALSE(get(uart, Uart16550::LSR) & Uart16550::LSR_OE);
+    uart.write(0, Uart16550::FCR_FIFO_EN << 16 | Uart16550::FCR_RX_RESET << 16, 0b0100);
+    REQUIRE(get(uart, Uart16550::IIR) == (Uart16550::IIR_FIFOS | Uart16550::IIR_NO_IRQ));
+  }
+
+  SECTION("tx empty") {
+    uart.write(0, Uart16550::IER_ETBEI << 8, 0b0010);
+    REQUIRE(irq_pending.get() == Irq::to_mask(Irq::MEI));
+    REQUIRE(get(uart, Uart16550::IIR) == Uart16550::IIR_THRE);
+    REQUIRE(irq_pending.get() == 0);
+    REQUIRE(get(uart, Uart16550::IIR) == Uart16550::IIR_NO_IRQ);
+    put(uart, "x");
+    REQUIRE(irq_pending.get() == Irq::to_mask(Irq::MEI));
+    REQUIRE(uart.get_tx_bytes() == 1);
+  }
+
+  SECTION("loopback") {
+    uart.write(4, Uart16550::MCR_LOOPBACK, 0b0001);
+    put(uart, "l");
+    REQUIRE(get(uart, Uart16550::RBR) == 'l');
+  }
+}
+
+TEST_CASE("uart tx", "[UART]") {
+  Scheduler scheduler{};
+  Pipe out{};
+
+  SECTION("line") {
+    Uart16550 uart{scheduler, {.tx_fd = out.fds[1], .tx_flush_delay = 100}};
+    put(uart, "hello\n");
+    REQUIRE(out.read_all() == "hello\n");
+    put(uart, "wor");
+    scheduler.advance_to(50);
+    put(uart, "ld");
+    REQUIRE(out.read_all().empty());
+    // After the delay from the first byte.
+    scheduler.advance_to(100);
+    REQUIRE(out.read_all() == "world");
+    put(uart, "!");
+  }
+
+  SECTION("buffer full") {
+    Uart16550 uart{scheduler, {.tx_fd = out.fds[1], .tx_buffer = 4}};
+    put(uart, "abcdef");
+    REQUIRE(out.read_all() == "abcd");
+    uart.flush();
+    REQUIRE(out.read_all() == "ef");
+  }
+
+  SECTION("thread") {
+    {
+      Uart16550 uart{scheduler, {.tx_mode = Uart16550::Tx_mode::thread, .tx_fd = out.fds[1]}};
+      put(uart, "from a thread");
+      uart.flush();
+      REQUIRE(out.read_all() == "from a thread");
+      put(uart, " and more");
+    }
+    REQUIRE(out.read_all() == " and more");
+  }
+
+  SECTION("discard") {
+    Uart16550 uart{scheduler, {.tx_mode = Uart16550::Tx_mode::discard, .tx_fd = out.fds[1]}};
+    put(uart, "nothing\n");
+    uart.flush();
+    REQUIRE(uart.get_tx_bytes() == 8);
+    REQUIRE(out.read_all().empty());
+  }
+
+  // Left unflushed, the timeout can't outlive the uart.
+  REQUIRE(scheduler.get_next_deadline() == Scheduler::never);
+}
+
+TEST_CASE("async host output", "[UART]") {
+  Pipe out{};
+  std::string expected{};
+  {
+    Async_host_output output{out.fds[1], 8};
+    for (int i{0}; i < 10; ++i) {
+      const std::string line{"line " + std::to_string(i) + "\n"};
+      output.write(line);
+      expected += line;
+    }
+    output.flush();
+    std::string received{};
+    for (std::string part{out.read_all()}; !part.empty(); part = out.read_all()) received += part;
+    REQUIRE(received == expected);
+    REQUIRE(output.get_host_writes() >= 10);
+  }
+}
+
+TEST_CASE("uart rx from host", "[UART]") {
+  Scheduler scheduler{};
+  Irq_pending irq_pending{};
+  Plic plic{irq_pending};
+  plic.write(Plic::PRIORITY + 4 * irq_source, 1);
+  plic.write(Plic::ENABLE, Uxlen{1} << irq_source);
+  Pipe in{};
+  const std::string input(20, 'i');
+  REQUIRE(::write(in.fds[1], input.data(), input.size()) == 20);
+
+  Uart16550 uart{scheduler, {.tx_mode = Uart16550::Tx_mode::discard, .rx_fd = in.fds[0],
+      .rx_poll_interval = 10}, &plic, irq_source};
+  uart.write(0, Uart16550::IER_ERBFI << 8, 0b0010);
+  scheduler.advance_to(9);
+  REQUIRE(irq_pending.get() == 0);
+  scheduler.advance_to(10);
+  REQUIRE(irq_pending.get() == Irq::to_mask(Irq::MEI));
+
+  // No overrun: the rest waits until there is room.
+  std::size_t received{0};
+  while (get(uart, Uart16550::LSR) & Uart16550::LSR_DR) {
+    REQUIRE(get(uart, Uart16550::RBR) == 'i');
+    ++received;
+  }
+  REQUIRE(received == Uart16550::fifo_depth);
+  scheduler.advance_to(20);
+  while (get(uart, Uart16550::LSR) & Uart16550::LSR_DR) {
+    static_cast<void>(get(uart, Uart16550::RBR));
+    ++received;
+  }
+  REQUIRE(received == 20);
+
+  // Polling stops at the end of the file.
+  ::close(in.fds[1]);
+  in.fds[1] = -1;
+  scheduler.advance_to(30);
+  REQUIRE(scheduler.get_next_deadline() == Scheduler::never);
+}
+
+TEST_CASE("uart on a bus", "[UART]") {
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_st>();
+  auto my_logger = std::make_shared<spdlog::logger>("console", sink);
+
+  const std::vector<Uxlen> program{
+    0x10000537, // lui a0, 0x10000
+    0x06800593, // addi a1, x0, 'h'
+    0x00b50023, // sb a1, 0(a0)
+    0x06900593, // addi a1, x0, 'i'
+    0x00b50023, // sb a1, 0(a0)
+    0x00a00593, // addi a1, x0, '\n'
+    0x00b50023, // sb a1, 0(a0)
+    0x00554603, // lbu a2, 5(a0)
+    0x0000006f, // j .
+  };
+  Ram ram{0x1000};
+  for (std::size_t i{0}; i < program.size(); ++i) ram.write(4 * i, program[i]);
+
+  Scheduler scheduler{};
+  Pipe out{};
+  Uart16550 uart{scheduler, {.tx_fd = out.fds[1]}};
+  Bus bus{};
+  bus.attach(0x0, ram);
+  bus.attach(0x10000000, uart);
+  Rf rf{};
+  Csr csr{};
+  Core core{ram, bus, csr, rf, my_logger};
+
+  core.run(scheduler, 100);
+  REQUIRE(out.read_all() == "hi\n");
+  REQUIRE(rf.read(12) == (Uart16550::LSR_THRE | Uart16550::LSR_TEMT));
+  REQUIRE(uart.get_tx_bytes() == 3);
+}
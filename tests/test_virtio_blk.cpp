@@ -0,0 +1,231 @@
+#define CATCH_CONFIG_MAIN
+
+#include "virtio_blk.hpp"
+
+#include "irq.hpp"
+#include "plic.hpp"
+#include "ram.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+
+#include "catch2/catch_test_macros.hpp"
+
+namespace {
+  constexpr unsigned int irq_source{8};
+  constexpr std::size_t sectors{8};
+
+  // The queue lives in guest RAM: descriptors, then the driver and the device rings.
+  constexpr std::size_t queue_size{8};
+  constexpr std::size_t desc_addr {0x1000};
+  constexpr std::size_t avail_addr{0x1100};
+  constexpr std::size_t used_addr {0x1200};
+  constexpr std::size_t header_addr{0x2000};
+  constexpr std::size_t status_addr{0x2100};
+  constexpr std::size_t data_addr  {0x3000};
+
+  struct Image {
+    char path[32]{"/tmp/test_virtio_blk_XXXXXX"};
+
+    Image() {
+      const int fd{::mkstemp(path)};
+      REQUIRE(fd >= 0);
+      std::string content(sectors * Virtio_blk::sector_size, '\0');
+      for (std::size_t i{0}; i < content.size(); ++i) content[i] = static_cast<char>(i / 512 + 'a');
+      // A partial sector at the end isn't part of the disk.
+      content += "tail";
+      REQUIRE(::write(fd, content.data(), content.size()) ==
+          static_cast<ssize_t>(content.size()));
+      ::close(fd);
+    }
+    ~Image() { ::unlink(path); }
+
+    [[nodiscard]] std::string read(std::size_t offset, std::size_t size) const {
+      std::string content(size, '\0');
+      const int fd{::open(path, O_RDONLY)};
+      REQUIRE(::pread(fd, content.data(), size, static_cast<off_t>(offset)) ==
+          static_cast<ssize_t>(size));
+      ::close(fd);
+      return content;
+    }
+  };
+
+  struct Driver {
+    Ram &ram;
+    Virtio_blk &blk;
+    std::uint16_t avail_idx{0};
+
+    void set_up() {
+      blk.write(Virtio_blk::STATUS, 0x1 | 0x2);
+      blk.write(Virtio_blk::DRIVER_FEATURES_SEL, 1);
+      blk.write(Virtio_blk::DRIVER_FEATURES, 1);
+      blk.write(Virtio_blk::STATUS, 0x1 | 0x2 | 0x8);
+      blk.write(Virtio_blk::QUEUE_SEL, 0);
+      blk.write(Virtio_blk::QUEUE_NUM, queue_size);
+      blk.write(Virtio_blk::QUEUE_DESC_LOW  , desc_addr );
+      blk.write(Virtio_blk::QUEUE_DRIVER_LOW, avail_addr);
+      blk.write(Virtio_blk::QUEUE_DEVICE_LOW, used_addr );
+      blk.write(Virtio_blk::QUEUE_READY, 1);
+      blk.write(Virtio_blk::STATUS, 0x1 | 0x2 | 0x4 | 0x8);
+    }
+
+    void put_desc(std::size_t index, std::uint64_t addr, std::uint32_t len, std::uint16_t flags,
+        std::uint16_t next) {
+      const std::size_t desc{desc_addr + 16 * index};
+      ram.write(desc    , static_cast<Uxlen>(addr));
+      ram.write(desc + 4, static_cast<Uxlen>(addr >> 32));
+      ram.write(desc + 8, len);
+      ram.write(desc + 12, flags | (Uxlen{next} << 16));
+    }
+
+    // A chain of a header, `data_descs` buffers of `data_size` bytes each and the status.
+    void request(std::uint32_t type, std::uint64_t sector, std::size_t data_descs,
+        std::uint32_t data_size) {
+      ram.write(header_addr, type);
+      ram.write(header_addr + 4, 0);
+      ram.write(header_addr + 8, static_cast<Uxlen>(sector));
+      ram.write(header_addr + 12, static_cast<Uxlen>(sector >> 32));
+      ram.write(status_addr, 0xff, 0b0001);
+      const std::uint16_t data_flags{static_cast<std::uint16_t>(
+          (type == Virtio_blk::T_OUT) ? 1 : (1 | 2))};
+      put_desc(0, header_addr, 16, 1, 1);
+      for (std::size_t i{0}; i < data_descs; ++i) {
+        put_desc(1 + i, data_addr + i * data_size, data_size, data_flags,
+            static_cast<std::uint16_t>(2 + i));
+      }
+      put_desc(1 + data_descs, status_addr, 1, 2, 0);
+      ram.write(avail_addr + 4 + 2 * (avail_idx % queue_size), 0, 0b0011);
+      ++avail_idx;
+      ram.write(avail_addr, Uxlen{avail_idx} << 16);
+      blk.write(Virtio_blk::QUEUE_NOTIFY, 0);
+    }
+
+    [[nodiscard]] std::uint8_t get_status() {
+      return static_cast<std::uint8_t>(ram.read(status_addr, 0b0001));
+    }
+    [[nodiscard]] std::uint16_t get_used_idx() {
+      return static_cast<std::uint16_t>(ram.read(used_addr) >> 16);
+    }
+    [[nodiscard]] Uxlen get_used_len() {
+      return ram.read(used_addr + 4 + 8 * ((get_used_idx() - 1u) % queue_size) + 4);
+    }
+    [[nodiscard]] std::string get_data(std::size_t size) {
+      std::string data(size, '\0');
+      ram.read_block(data_addr, std::as_writable_bytes(std::span{data}));
+      return data;
+    }
+  };
+}
+
+TEST_CASE("virtio-blk registers", "[VIRTIO]") {
+  Image image{};
+  Ram ram{0x10000};
+  Irq_pending irq_pending{};
+  Plic plic{irq_pending};
+  Virtio_blk blk{ram, image.path, true, plic, irq_source};
+
+  REQUIRE(blk.read(Virtio_blk::MAGIC_VALUE) == Virtio_blk::magic);
+  REQUIRE(blk.read(Virtio_blk::VERSION) == 2);
+  REQUIRE(blk.read(Virtio_blk::DEVICE_ID) == Virtio_blk::block_device);
+  REQUIRE(blk.get_capacity() == sectors);
+  REQUIRE(blk.read(Virtio_blk::CONFIG) == sectors);
+  REQUIRE(blk.read(Virtio_blk::CONFIG + 4) == 0);
+  REQUIRE(blk.read(Virtio_blk::CONFIG_BLK_SIZE) == Virtio_blk::sector_size);
+  REQUIRE(blk.read(Virtio_blk::DEVICE_FEATURES) & Virtio_blk::F_RO);
+  blk.write(Virtio_blk::DEVICE_FEATURES_SEL, 1);
+  REQUIRE(blk.read(Virtio_blk::DEVICE_FEATURES) == 1);
+  REQUIRE(blk.read(Virtio_blk::QUEUE_NUM_MAX) == Virtio_blk::queue_num_max);
+  blk.write(Virtio_blk::QUEUE_SEL, 1);
+  REQUIRE(blk.read(Virtio_blk::QUEUE_NUM_MAX) == 0);
+  REQUIRE_THROWS_AS(blk.read(0x018), Errors::Illegal_addr);
+
+  REQUIRE_THROWS_AS((Virtio_blk{ram, "/nonexistent/image", true, plic, irq_source}),
+      Errors::Error);
+}
+
+TEST_CASE("virtio-blk requests", "[VIRTIO]") {
+  Image image{};
+  Ram ram{0x10000};
+  Irq_pending irq_pending{};
+  Plic plic{irq_pending};
+  plic.write(Plic::PRIORITY + 4 * irq_source, 1);
+  plic.write(Plic::ENABLE, Uxlen{1} << irq_source);
+  Virtio_blk blk{ram, image.path, false, plic, irq_source};
+  Driver driver{ram, blk};
+  driver.set_up();
+
+  SECTION("read") {
+    // Split over descriptors, the second starting in the middle of a sector.
+    driver.request(Virtio_blk::T_IN, 2, 2, 256);
+    REQUIRE(driver.get_status() == Virtio_blk::S_OK);
+    REQUIRE(driver.get_used_idx() == 1);
+    REQUIRE(driver.get_used_len() == 512 + 1);
+    REQUIRE(driver.get_data(512) == std::string(512, 'c'));
+    REQUIRE(irq_pending.get() == Irq::to_mask(Irq::MEI));
+    REQUIRE(blk.read(Virtio_blk::INTERRUPT_STATUS) == Virtio_blk::INTERRUPT_USED_BUFFER);
+    blk.write(Virtio_blk::INTERRUPT_ACK, Virtio_blk::INTERRUPT_USED_BUFFER);
+    REQUIRE(irq_pending.get() == 0);
+    REQUIRE(blk.get_requests() == 1);
+  }
+
+  SECTION("write and flush") {
+    const std::string data(1024, 'w');
+    ram.write_block(data_addr, std::as_bytes(std::span{data}));
+    driver.request(Virtio_blk::T_OUT, 6, 1, 1024);
+    REQUIRE(driver.get_status() == Virtio_blk::S_OK);
+    REQUIRE(driver.get_used_len() == 1);
+    driver.request(Virtio_blk::T_FLUSH, 0, 0, 0);
+    REQUIRE(driver.get_status() == Virtio_blk::S_OK);
+    REQUIRE(driver.get_used_idx() == 2);
+    REQUIRE(image.read(5 * 512, 512) == std::string(512, 'f'));
+    REQUIRE(image.read(6 * 512, 1024) == data);
+    REQUIRE(image.read(8 * 512, 4) == "tail");
+  }
+
+  SECTION("errors") {
+    // Past the end of the disk.
+    driver.request(Virtio_blk::T_IN, 7, 1, 1024);
+    REQUIRE(driver.get_status() == Virtio_blk::S_IOERR);
+    REQUIRE(driver.get_used_len() == 1);
+    driver.request(Virtio_blk::T_IN, sectors, 1, 512);
+    REQUIRE(driver.get_status() == Virtio_blk::S_IOERR);
+    driver.request(0xdead, 0, 0, 0);
+    REQUIRE(driver.get_status() == Virtio_blk::S_UNSUPP);
+
+    driver.request(Virtio_blk::T_GET_ID, 0, 1, 20);
+    REQUIRE(driver.get_status() == Virtio_blk::S_OK);
+    REQUIRE(driver.get_used_len() == 21);
+    REQUIRE(driver.get_data(9) == "riscv-emu");
+
+    // A descriptor pointing out of guest memory breaks the device until a reset.
+    driver.put_desc(0, 0x100000, 16, 1, 1);
+    ram.write(avail_addr + 4 + 2 * (driver.avail_idx % queue_size), 0, 0b0011);
+    ram.write(avail_addr, Uxlen{++driver.avail_idx} << 16);
+    blk.write(Virtio_blk::QUEUE_NOTIFY, 0);
+    REQUIRE(blk.read(Virtio_blk::STATUS) & Virtio_blk::STATUS_NEEDS_RESET);
+    REQUIRE(blk.read(Virtio_blk::INTERRUPT_STATUS) & Virtio_blk::INTERRUPT_CONFIG_CHANGE);
+    blk.write(Virtio_blk::STATUS, 0);
+    REQUIRE(blk.read(Virtio_blk::STATUS) == 0);
+    REQUIRE(irq_pending.get() == 0);
+  }
+}
+
+TEST_CASE("virtio-blk read-only", "[VIRTIO]") {
+  Image image{};
+  Ram ram{0x10000};
+  Irq_pending irq_pending{};
+  Plic plic{irq_pending};
+  Virtio_blk blk{ram, image.path, true, plic, irq_source};
+  Driver driver{ram, blk};
+  driver.set_up();
+
+  driver.request(Virtio_blk::T_OUT, 0, 1, 512);
+  REQUIRE(driver.get_status() == Virtio_blk::S_IOERR);
+  REQUIRE(image.read(0, 1) == "a");
+  driver.request(Virtio_blk::T_IN, 1, 1, 512);
+  REQUIRE(driver.get_status() == Virtio_blk::S_OK);
+  REQUIRE(driver.get_data(512) == std::string(512, 'b'));
+}
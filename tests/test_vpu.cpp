@@ -0,0 +1,165 @@
+#define CATCH_CONFIG_MAIN
+
+#include "vpu.hpp"
+
+#include "catch2/catch_test_macros.hpp"
+
+#include <array>
+
+namespace {
+  using Vpu::Sew;
+
+  // Long enough for whole host vectors and a tail at every element width.
+  constexpr std::size_t vl_bytes{72};
+  using Vreg = std::array<std::byte, Vpu::max_group_bytes>;
+
+  void fill(Sew sew, Vreg &vreg, std::uint64_t start, std::uint64_t step) {
+    for (std::size_t i{0}; i < vl_bytes / Vpu::get_bytes(sew); ++i) {
+      Vpu::set_element(sew, vreg.data(), i, start + i * step);
+    }
+  }
+}
+
+TEST_CASE("Vpu vtype", "[VTYPE]") {
+  const auto vtype{Vpu::decode_vtype(0b1101'0001)};
+  REQUIRE(vtype);
+  REQUIRE(vtype->sew == Sew::e32);
+  REQUIRE(vtype->lmul_log2 == 1);
+  REQUIRE(vtype->tail_agnostic);
+  REQUIRE(vtype->mask_agnostic);
+  REQUIRE(Vpu::get_vlmax(128, *vtype) == 8);
+  REQUIRE(Vpu::get_vlmax(256, *Vpu::decode_vtype(0b00'011'001)) == 8);
+
+  // vlmul 0b100, vsew 0b100, e64 at LMUL 1/2, vill.
+  REQUIRE(!Vpu::decode_vtype(0b00'000'100));
+  REQUIRE(!Vpu::decode_vtype(0b00'100'000));
+  REQUIRE(!Vpu::decode_vtype(0b00'011'111));
+  REQUIRE(!Vpu::decode_vtype(std::uint64_t{1} << 31));
+}
+
+TEST_CASE("Vpu element-wise", "[ARITH]") {
+  Vreg vs2{};
+  Vreg vs1{};
+  Vreg vd{};
+
+  for (const Sew sew : {Sew::e8, Sew::e16, Sew::e32, Sew::e64}) {
+    const std::size_t vl{vl_bytes / Vpu::get_bytes(sew)};
+    const std::uint64_t mask{(sew == Sew::e64) ? ~std::uint64_t{0}
+                                               : (std::uint64_t{1} << (8 << static_cast<int>(sew))) - 1};
+    // Crosses zero, so the signed and unsigned results differ.
+    fill(sew, vs2, static_cast<std::uint64_t>(-5), 3);
+    fill(sew, vs1, 7, 1);
+
+    const auto check = [&](Vpu::Op op, auto expected) {
+      vd.fill(std::byte{0});
+      Vpu::calc(op, sew, vl, vd.data(), vs2.data(), vs1.data());
+      for (std::size_t i{0}; i < vl; ++i) {
+        const std::uint64_t a{Vpu::get_element(sew, vs2.data(), i)};
+        const std::uint64_t b{Vpu::get_element(sew, vs1.data(), i)};
+        REQUIRE(Vpu::get_element(sew, vd.data(), i) == (expected(a, b) & mask));
+      }
+    };
+    const auto to_signed = [&](std::uint64_t a) {
+      const int shift{64 - (8 << static_cast<int>(sew))};
+      return static_cast<std::int64_t>(a << shift) >> shift;
+    };
+
+    check(Vpu::ADD , [](std::uint64_t a, std::uint64_t b) { return a + b; });
+    check(Vpu::SUB , [](std::uint64_t a, std::uint64_t b) { return a - b; });
+    check(Vpu::RSUB, [](std::uint64_t a, std::uint64_t b) { return b - a; });
+    check(Vpu::XOR , [](std::uint64_t a, std::uint64_t b) { return a ^ b; });
+    check(Vpu::MUL , [](std::uint64_t a, std::uint64_t b) { return a * b; });
+    check(Vpu::MINU, [](std::uint64_t a, std::uint64_t b) { return std::min(a, b); });
+    check(Vpu::MAX , [&](std::uint64_t a, std::uint64_t b) {
+      return (to_signed(a) > to_signed(b)) ? a : b;
+    });
+    check(Vpu::SRA , [&](std::uint64_t a, std::uint64_t b) {
+      return static_cast<std::uint64_t>(to_signed(a) >> (b % (8 << static_cast<int>(sew))));
+    });
+    check(Vpu::MULHU, [&](std::uint64_t a, std::uint64_t b) {
+      return static_cast<std::uint64_t>((static_cast<unsigned __int128>(a) * b) >>
+          (8 << static_cast<int>(sew)));
+    });
+    check(Vpu::MULH, [&](std::uint64_t a, std::uint64_t b) {
+      return static_cast<std::uint64_t>((static_cast<__int128>(to_signed(a)) * to_signed(b)) >>
+          (8 << static_cast<int>(sew)));
+    });
+  }
+}
+
+TEST_CASE("Vpu masks", "[MASK]") {
+  Vreg vs2{};
+  Vreg vs1{};
+  Vreg vd{};
+  // Every third element.
+  Vreg mask{};
+  for (std::size_t i{0}; i < Vpu::max_vlen; i += 3) {
+    mask[i / 8] |= std::byte{1} << (i % 8);
+  }
+
+  SECTION("compare") {
+    for (const Sew sew : {Sew::e8, Sew::e16, Sew::e32, Sew::e64}) {
+      const std::size_t vl{vl_bytes / Vpu::get_bytes(sew)};
+      fill(sew, vs2, static_cast<std::uint64_t>(-3), 1);
+      fill(sew, vs1, 0, 0);
+      vd.fill(std::byte{0xff});
+      // Only -3, -2 and -1 are signed less than 0.
+      Vpu::calc(Vpu::SLT, sew, vl, vd.data(), vs2.data(), vs1.data());
+      for (std::size_t i{0}; i < vl; ++i) REQUIRE(Vpu::is_active(vd.data(), i) == (i < 3));
+      // The tail is undisturbed.
+      REQUIRE(Vpu::is_active(vd.data(), vl));
+
+      vd.fill(std::byte{0});
+      Vpu::calc(Vpu::SLTU, sew, vl, vd.data(), vs2.data(), vs1.data());
+      for (std::size_t i{0}; i < vl; ++i) REQUIRE(!Vpu::is_active(vd.data(), i));
+      Vpu::calc(Vpu::SGTU, sew, vl, vd.data(), vs2.data(), vs1.data(), mask.data());
+      for (std::size_t i{0}; i < vl; ++i) {
+        REQUIRE(Vpu::is_active(vd.data(), i) == ((i != 3) && (i % 3 == 0)));
+      }
+    }
+  }
+  SECTION("masked") {
+    const std::size_t vl{vl_bytes / 2};
+    fill(Sew::e16, vs2, 100, 1);
+    fill(Sew::e16, vs1, 1, 0);
+    fill(Sew::e16, vd, 7, 0);
+    Vpu::set_element(Sew::e16, vd.data(), vl, 7);
+    Vpu::calc(Vpu::ADD, Sew::e16, vl, vd.data(), vs2.data(), vs1.data(), mask.data());
+    for (std::size_t i{0}; i < vl; ++i) {
+      REQUIRE(Vpu::get_element(Sew::e16, vd.data(), i) == ((i % 3 == 0) ? 101 + i : 7));
+    }
+    REQUIRE(Vpu::get_element(Sew::e16, vd.data(), vl) == 7);
+  }
+  SECTION("merge") {
+    fill(Sew::e32, vs2, 10, 0);
+    Vpu::splat(Sew::e32, 5, vs1.data(), static_cast<std::uint64_t>(-1));
+    Vpu::calc(Vpu::MERGE, Sew::e32, 5, vd.data(), vs2.data(), vs1.data(), mask.data());
+    REQUIRE(Vpu::get_element(Sew::e32, vd.data(), 0) == 0xffff'ffff);
+    REQUIRE(Vpu::get_element(Sew::e32, vd.data(), 1) == 10);
+    REQUIRE(Vpu::get_element(Sew::e32, vd.data(), 3) == 0xffff'ffff);
+    REQUIRE(Vpu::get_element(Sew::e32, vd.data(), 5) == 0);
+  }
+}
+
+TEST_CASE("Vpu reductions", "[REDUCTION]") {
+  Vreg vs2{};
+  Vreg vs1{};
+  Vreg vd{};
+  fill(Sew::e32, vs2, 1, 1);
+  Vpu::set_element(Sew::e32, vs1.data(), 0, 1000);
+  Vpu::set_element(Sew::e32, vd.data(), 1, 42);
+
+  Vpu::calc(Vpu::REDSUM, Sew::e32, 10, vd.data(), vs2.data(), vs1.data());
+  REQUIRE(Vpu::get_element(Sew::e32, vd.data(), 0) == 1055);
+  REQUIRE(Vpu::get_element(Sew::e32, vd.data(), 1) == 42);
+
+  Vpu::set_element(Sew::e32, vs2.data(), 4, static_cast<std::uint64_t>(-8));
+  Vpu::calc(Vpu::REDMIN, Sew::e32, 10, vd.data(), vs2.data(), vs1.data());
+  REQUIRE(Vpu::get_element(Sew::e32, vd.data(), 0) == 0xffff'fff8);
+  Vpu::calc(Vpu::REDMAXU, Sew::e32, 10, vd.data(), vs2.data(), vs1.data());
+  REQUIRE(Vpu::get_element(Sew::e32, vd.data(), 0) == 0xffff'fff8);
+
+  // No elements leave vd alone.
+  Vpu::calc(Vpu::REDSUM, Sew::e32, 0, vd.data(), vs2.data(), vs1.data());
+  REQUIRE(Vpu::get_element(Sew::e32, vd.data(), 0) == 0xffff'fff8);
+}
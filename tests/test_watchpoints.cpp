@@ -0,0 +1,137 @@
+#define CATCH_CONFIG_MAIN
+
+#include "watchpoints.hpp"
+
+#include "csr.hpp"
+#include "mmu.hpp"
+#include "ram.hpp"
+
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+
+namespace {
+  using Kind = Watchpoints::Kind;
+  using Hit  = Watchpoints::Hit;
+
+  struct Recorder {
+    std::vector<Hit> hits{};
+    unsigned int invalidations{0};
+
+    explicit Recorder(Watchpoints &watchpoints) {
+      watchpoints.set_callback([this](const Hit &hit) { hits.push_back(hit); });
+      static_cast<void>(watchpoints.subscribe([this]() { ++invalidations; }));
+    }
+
+    [[nodiscard]] bool hit(std::size_t addr, Kind kind) {
+      const bool found{(hits.size() == 1) && (hits[0].addr == addr) && (hits[0].kind == kind)};
+      hits.clear();
+      return found;
+    }
+  };
+}
+
+TEST_CASE("watch mem wrap", "[WATCH]") {
+  Ram ram{0x4000};
+  Watchpoints watchpoints{};
+  Recorder recorder{watchpoints};
+  Watch_mem_wrap memory{ram, watchpoints};
+
+  REQUIRE(memory.get_host_ptr(0x1000, 4) != nullptr);
+  watchpoints.insert(0x1004, 4, Kind::write);
+  REQUIRE(recorder.invalidations == 1);
+  // The whole page leaves the fast path, the others stay on it.
+  REQUIRE(memory.get_host_ptr(0x1000, 4) == nullptr);
+  REQUIRE(memory.get_host_ptr(0x2000, 4) != nullptr);
+  REQUIRE(memory.get_host_ptr(0x0ffc, 8) == nullptr);
+
+  memory.write(0x1000, 1);
+  memory.write(0x1008, 1);
+  REQUIRE(recorder.hits.empty());
+  memory.write(0x1004, 0x5a << 16, 0b0100);
+  REQUIRE(recorder.hit(0x1004, Kind::write));
+  REQUIRE(ram.read(0x1004) == (0x5a << 16));
+  REQUIRE(memory.read(0x1004) == (0x5a << 16));
+  REQUIRE(recorder.hits.empty());
+
+  // Block accesses take word accesses on a watched page.
+  const std::vector<std::byte> block(16, std::byte{0xff});
+  memory.write_block(0x1000, block);
+  REQUIRE(recorder.hit(0x1004, Kind::write));
+
+  // A range across pages watches both.
+  watchpoints.insert(0x1ffe, 4, Kind::access);
+  REQUIRE(recorder.invalidations == 2);
+  REQUIRE(memory.get_host_ptr(0x2000, 4) == nullptr);
+  static_cast<void>(memory.read(0x2000, 0b0001));
+  REQUIRE(recorder.hit(0x1ffe, Kind::access));
+  memory.write(0x1ffc, 0, 0b0011);
+  REQUIRE(recorder.hits.empty());
+
+  // Another watchpoint on a watched page changes no page.
+  watchpoints.insert(0x1100, 1, Kind::read);
+  REQUIRE(recorder.invalidations == 2);
+  REQUIRE_FALSE(watchpoints.erase(0x1100, 2, Kind::read));
+  REQUIRE(watchpoints.erase(0x1100, 1, Kind::read));
+  REQUIRE(recorder.invalidations == 2);
+  REQUIRE(watchpoints.erase(0x1ffe, 4, Kind::access));
+  REQUIRE(recorder.invalidations == 3);
+  REQUIRE(memory.get_host_ptr(0x2000, 4) != nullptr);
+  watchpoints.clear();
+  REQUIRE(recorder.invalidations == 4);
+  REQUIRE(memory.get_host_ptr(0x1000, 4) != nullptr);
+}
+
+TEST_CASE("watchpoints in the mmu", "[WATCH]") {
+  using enum Csr::Privilege;
+  constexpr std::size_t root{0x4000};
+  constexpr std::size_t table{0x5000};
+  constexpr Uxlen satp{Csr::SATP_SV32 | (root >> 12)};
+  // V, R, W, A and D.
+  constexpr Uxlen flags{0xc7};
+
+  // 0x400000 and 0x401000 to 0x6000 and 0x7000.
+  Ram ram{0x10000};
+  ram.write(root + 1 * 4, ((table >> 12) << 10) | 1);
+  ram.write(table + 0 * 4, (6 << 10) | flags);
+  ram.write(table + 1 * 4, (7 << 10) | flags);
+
+  Watchpoints watchpoints{};
+  Recorder recorder{watchpoints};
+  Mmu mmu{ram, nullptr, &watchpoints};
+  Memory &data{mmu.get_data_port()};
+  mmu.set_context(supervisor, satp, 0);
+
+  data.write(0x400000, 1);
+  data.write(0x401000, 2);
+  REQUIRE(data.get_host_ptr(0x400000, 4) != nullptr);
+  const std::uint64_t walks{mmu.get_walks()};
+
+  // By virtual address. The TLB is flushed and the watched page filled without its host
+  // pointer.
+  watchpoints.insert(0x400010, 4, Kind::write);
+  data.write(0x400000, 3);
+  REQUIRE(recorder.hits.empty());
+  REQUIRE(data.get_host_ptr(0x400000, 4) == nullptr);
+  data.write(0x401000, 4);
+  REQUIRE(data.get_host_ptr(0x401000, 4) != nullptr);
+  REQUIRE(mmu.get_walks() == walks + 2);
+
+  data.write(0x400010, 5);
+  REQUIRE(recorder.hit(0x400010, Kind::write));
+  REQUIRE(ram.read(0x6010) == 5);
+  REQUIRE(data.read(0x400010) == 5);
+  REQUIRE(recorder.hits.empty());
+
+  REQUIRE(watchpoints.erase(0x400010, 4, Kind::write));
+  data.write(0x400010, 6);
+  REQUIRE(recorder.hits.empty());
+  REQUIRE(data.get_host_ptr(0x400000, 4) != nullptr);
+
+  // Bare mode has no fast path, so addresses are physical.
+  mmu.set_context(machine, 0, 0);
+  watchpoints.insert(0x6010, 4, Kind::read);
+  REQUIRE(data.get_host_ptr(0x6000, 4) == nullptr);
+  REQUIRE(data.read(0x6010) == 6);
+  REQUIRE(recorder.hit(0x6010, Kind::read));
+}